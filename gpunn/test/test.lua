@@ -963,6 +963,58 @@ end
    mytester:assertlt(error:abs():max(), precision_forward, 'error on state (forward) ')
 end]]--
 
+function gpunntest.SpatialConvolutionMM_winograd()
+   local bs = math.random(1,4)
+   local from = math.random(1,32)
+   local to = math.random(1,8) * 8
+   local padding = math.random(0,2)
+   local outi = math.random(1,64)
+   local outj = math.random(1,64)
+   local ini = outi+2-2*padding
+   local inj = outj+2-2*padding
+   if ini < 3 or inj < 3 then
+      padding = 0
+      ini = outi+2
+      inj = outj+2
+   end
+
+   local tm = {}
+   local title = string.format('SpatialConvolutionMM.winograd %dx%dx%dx%d o 3x3 -> %dx%dx%dx%d [p: %d]',
+                               bs, from, inj, ini, bs, to, outj, outi, padding)
+   times[title] = tm
+
+   -- reference: the im2col+GEMM path on the CPU
+   local input = torch.randn(bs,from,inj,ini)
+   local sconv = nn.SpatialConvolutionMM(from,to,3,3,1,1,padding)
+   sconv.winograd = false
+   local groundtruth = sconv:forward(input)
+   local gradOutput = torch.randn(groundtruth:size())
+   sconv:zeroGradParameters()
+   local groundgrad = sconv:backward(input, gradOutput)
+
+   input = input:gpu()
+   gradOutput = gradOutput:gpu()
+   local gconv = nn.SpatialConvolutionMM(from,to,3,3,1,1,padding):gpu()
+   gconv.weight = sconv.weight:gpu()
+   gconv.bias = sconv.bias:gpu()
+   local a = torch.Timer()
+   for i = 1,nloop do
+      gconv:forward(input)
+   end
+   gputorch.synchronize()
+   tm.gpu = a:time().real
+
+   for _,tile in ipairs({2, 4}) do
+      gconv.winograd = tile
+      local error = gconv:forward(input):float() - groundtruth
+      mytester:assertlt(error:abs():max(), precision_forward,
+                        'error on state (forward) with F(' .. tile .. 'x' .. tile .. ',3x3) ')
+      error = gconv:updateGradInput(input, gradOutput):float() - groundgrad
+      mytester:assertlt(error:abs():max(), precision_backward,
+                        'error on state (backward) with F(' .. tile .. 'x' .. tile .. ',3x3) ')
+   end
+end
+
 function gpunntest.SpatialConvolutionGPU_forward_batch()
    local bs = 32
    local from = 4 * math.random(1,4)
@@ -2812,6 +2864,154 @@ function gpunntest.ClassNLLCriterionMultipleTarget()
    mytester:assertlt(gerr:abs():max(), precision_forward, 'error  on gradInput')
 end
 
+function gpunntest.LookupTable_backward()
+   local nIndex = math.random(100,1000)
+   local nEntry = math.random(16,128)
+   local bs = math.random(8,64)
+   local seq = math.random(8,32)
+   -- few distinct rows so that most indices are duplicates
+   local input = torch.LongTensor(bs, seq):random(1, math.random(1,nIndex))
+   local gradOutput = torch.randn(bs, seq, nEntry)
+
+   local tm = {}
+   local title = string.format('LookupTable.backward %dx%d -> %dx%d', bs, seq, nIndex, nEntry)
+   times[title] = tm
+
+   local slt = nn.LookupTable(nIndex, nEntry)
+   local glt = slt:clone():gpu()
+   slt:zeroGradParameters()
+   local a = torch.Timer()
+   slt:forward(input)
+   slt:backward(input, gradOutput)
+   slt:updateParameters(0.1)
+   tm.cpu = a:time().real
+
+   local ggradOutput = gradOutput:gpu()
+   glt:zeroGradParameters()
+   a:reset()
+   glt:forward(input)
+   glt:backward(input, ggradOutput)
+   glt:updateParameters(0.1)
+   gputorch.synchronize()
+   tm.gpu = a:time().real
+
+   local error = glt.gradWeight:float() - slt.gradWeight
+   mytester:assertlt(error:abs():max(), precision_backward, 'error on gradWeight ')
+   error = glt.weight:float() - slt.weight
+   mytester:assertlt(error:abs():max(), precision_backward, 'error on weight (updateParameters) ')
+
+   slt:accUpdateGradParameters(input, gradOutput, 0.1)
+   glt:accUpdateGradParameters(input, ggradOutput, 0.1)
+   error = glt.weight:float() - slt.weight
+   mytester:assertlt(error:abs():max(), precision_backward, 'error on weight (accUpdateGradParameters) ')
+
+   glt:zeroGradParameters()
+   mytester:assertlt(glt.gradWeight:float():abs():max(), precision_backward, 'gradWeight not zeroed ')
+end
+
+function gpunntest.getParameters_fused()
+   local tm = {}
+   local title = 'getParameters + fused SGD'
+   times[title] = tm
+
+   local smlp = nn.Sequential():add(nn.Linear(17, 9)):add(nn.Tanh()):add(nn.Linear(9, 4))
+   local gmlp = smlp:clone():gpu()
+   local sx, sdfdx = smlp:getParameters()
+   local gx, gdfdx = gmlp:getParameters()
+   mytester:asserteq(gx:nElement(), sx:nElement(), 'error on flat size ')
+   mytester:assertlt((gx:float() - sx):abs():max(), precision_forward, 'error on flat parameters ')
+   mytester:assertlt((gmlp.modules[3].weight:float() - smlp.modules[3].weight):abs():max(), precision_forward,
+                     'error on weight view ')
+
+   local input = torch.randn(5, 17)
+   local gradOutput = torch.randn(5, 4)
+   local sconfig = {learningRate = 0.1, momentum = 0.9, weightDecay = 1e-3}
+   local gconfig = {learningRate = 0.1, momentum = 0.9, weightDecay = 1e-3}
+   local a = torch.Timer()
+   for i = 1,2 do
+      smlp:zeroGradParameters()
+      smlp:forward(input)
+      smlp:backward(input, gradOutput)
+      nn.fusedSGD(sx, sdfdx, sconfig)
+   end
+   tm.cpu = a:time().real
+   input, gradOutput = input:gpu(), gradOutput:gpu()
+   a:reset()
+   for i = 1,2 do
+      gmlp:zeroGradParameters()
+      gmlp:forward(input)
+      gmlp:backward(input, gradOutput)
+      nn.fusedSGD(gx, gdfdx, gconfig)
+   end
+   gputorch.synchronize()
+   tm.gpu = a:time().real
+   mytester:assertlt((gx:float() - sx):abs():max(), precision_backward, 'error on fused sgd ')
+   mytester:assertlt((gconfig.dfdx:float() - sconfig.dfdx):abs():max(), precision_backward, 'error on momentum ')
+end
+
+function gpunntest.FlatParameters_steps()
+   local n = math.random(1000, 2000)
+   local x, dfdx = torch.randn(n), torch.randn(n)
+   local gx, gdfdx = x:gpu(), dfdx:gpu()
+   local steps = {
+      {'sgd', nn.fusedSGD, {learningRate = 0.1, weightDecay = 1e-3}},
+      {'nesterov', nn.fusedSGD, {learningRate = 0.1, momentum = 0.5, dampening = 0, nesterov = true}},
+      {'adagrad', nn.fusedAdagrad, {learningRate = 0.1, weightDecay = 1e-3}},
+      {'rmsprop', nn.fusedRMSProp, {learningRate = 0.01, alpha = 0.9}},
+   }
+   for _, step in ipairs(steps) do
+      local name, f, config = step[1], step[2], step[3]
+      local sconfig, gconfig = {}, {}
+      for k, v in pairs(config) do
+         sconfig[k], gconfig[k] = v, v
+      end
+      for i = 1,3 do
+         f(x, dfdx, sconfig)
+         f(gx, gdfdx, gconfig)
+      end
+      mytester:assertlt((gx:float() - x):abs():max(), precision_backward, 'error on fused ' .. name .. ' ')
+   end
+end
+
+function gpunntest.Dropout()
+   local p = 0.3
+   local size = math.random(1000, 2000)
+
+   local tm = {}
+   local title = string.format('Dropout forward/backward %d -> %d', size, size)
+   times[title] = tm
+
+   -- the generators differ, so the GPU mask is checked against its own output
+   local input = torch.rand(size):add(1)
+   local sconv = nn.Dropout(p)
+   local a = torch.Timer()
+   for i = 1,nloop do
+      sconv:forward(input)
+      sconv:backward(input, input)
+   end
+   tm.cpu = a:time().real
+
+   input = input:gpu()
+   local gconv = nn.Dropout(p):gpu()
+   local output, gradInput
+   a:reset()
+   for i = 1,nloop do
+      output = gconv:forward(input)
+      gradInput = gconv:backward(input, input)
+   end
+   gputorch.synchronize()
+   tm.gpu = a:time().real
+
+   mytester:asserteq(gconv.mask:nElement(), math.ceil(size/24), 'error on mask size ')
+   local foutput, finput = output:float(), input:float()
+   local kept = foutput:ne(0):float()
+   mytester:assertlt(math.abs(kept:mean() - (1-p)), 0.05, 'error on drop rate ')
+   local error = foutput - finput:cmul(kept):div(1-p)
+   mytester:assertlt(error:abs():max(), precision_forward, 'error on state (forward) ')
+   error = gradInput:float() - foutput
+   mytester:assertlt(error:abs():max(), precision_backward, 'error on state (backward) ')
+end
+
 function nn.testgpu(tests)
    local oldtype = torch.getdefaulttensortype()
    torch.setdefaulttensortype('torch.FloatTensor')
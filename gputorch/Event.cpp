@@ -0,0 +1,47 @@
+#include "THC.h"
+#include "luaT.h"
+
+/* handle returned by the asynchronous copies (copyAsync) */
+
+static int gputorch_GPUEvent_free(lua_State *L)
+{
+  THGPUEvent *event = (THGPUEvent *)luaT_checkudata(L, 1, "torch.GPUEvent");
+  THGPUEvent_free(event);
+  return 0;
+}
+
+static int gputorch_GPUEvent_wait(lua_State *L)
+{
+  THGPUEvent *event = (THGPUEvent *)luaT_checkudata(L, 1, "torch.GPUEvent");
+  THGPUEvent_synchronize(event);
+  lua_settop(L, 1);
+  return 1;
+}
+
+static int gputorch_GPUEvent_query(lua_State *L)
+{
+  THGPUEvent *event = (THGPUEvent *)luaT_checkudata(L, 1, "torch.GPUEvent");
+  lua_pushboolean(L, THGPUEvent_query(event));
+  return 1;
+}
+
+static int gputorch_GPUEvent___tostring__(lua_State *L)
+{
+  THGPUEvent *event = (THGPUEvent *)luaT_checkudata(L, 1, "torch.GPUEvent");
+  lua_pushfstring(L, "torch.GPUEvent [status: %s]", (THGPUEvent_query(event) ? "complete" : "pending"));
+  return 1;
+}
+
+static const struct luaL_Reg gputorch_GPUEvent__ [] = {
+  {"wait", gputorch_GPUEvent_wait},
+  {"query", gputorch_GPUEvent_query},
+  {"__tostring__", gputorch_GPUEvent___tostring__},
+  {NULL, NULL}
+};
+
+void gputorch_GPUEvent_init(lua_State *L)
+{
+  luaT_newmetatable(L, "torch.GPUEvent", NULL, NULL, gputorch_GPUEvent_free, NULL);
+  luaL_register(L, NULL, gputorch_GPUEvent__);
+  lua_pop(L, 1);
+}
@@ -0,0 +1,147 @@
+#include "THC.h"
+#include "luaT.h"
+
+/* torch.GPUFusion: records elementwise expressions and evaluates them fused
+   local f = torch.GPUFusion()
+   local x = f:input(t)
+   f:output(f:tanh(f:addvalue(f:mulvalue(x, a), b)), t)
+   f:run() */
+
+static int gputorch_GPUFusion_new(lua_State *L)
+{
+  THGPUFusion *fusion = THGPUFusion_new();
+  luaT_pushudata(L, fusion, "torch.GPUFusion");
+  return 1;
+}
+
+static int gputorch_GPUFusion_free(lua_State *L)
+{
+  THGPUFusion *fusion = (THGPUFusion *)luaT_checkudata(L, 1, "torch.GPUFusion");
+  THGPUFusion_free(fusion);
+  return 0;
+}
+
+static int gputorch_GPUFusion_input(lua_State *L)
+{
+  THGPUFusion *fusion = (THGPUFusion *)luaT_checkudata(L, 1, "torch.GPUFusion");
+  THGPUTensor *tensor = (THGPUTensor *)luaT_checkudata(L, 2, "torch.GPUTensor");
+  lua_pushnumber(L, THGPUFusion_input(fusion, tensor));
+  return 1;
+}
+
+static int gputorch_GPUFusion_output(lua_State *L)
+{
+  THGPUFusion *fusion = (THGPUFusion *)luaT_checkudata(L, 1, "torch.GPUFusion");
+  int node = luaL_checkint(L, 2);
+  THGPUTensor *tensor = (THGPUTensor *)luaT_checkudata(L, 3, "torch.GPUTensor");
+  THGPUFusion_output(fusion, node, tensor);
+  lua_settop(L, 3);
+  return 1;
+}
+
+static int gputorch_GPUFusion_run(lua_State *L)
+{
+  THGPUFusion *fusion = (THGPUFusion *)luaT_checkudata(L, 1, "torch.GPUFusion");
+  THGPUFusion_run(fusion);
+  lua_settop(L, 1);
+  return 1;
+}
+
+/* returns the outputs computed on the host, as FloatTensors */
+static int gputorch_GPUFusion_runReference(lua_State *L)
+{
+  THGPUFusion *fusion = (THGPUFusion *)luaT_checkudata(L, 1, "torch.GPUFusion");
+  int nOutputs = THGPUFusion_nOutputs(fusion);
+  THFloatTensor **result = (THFloatTensor **)THAlloc(sizeof(THFloatTensor*) * (nOutputs > 0 ? nOutputs : 1));
+  int i;
+
+  THGPUFusion_runReference(fusion, result);
+  for (i = 0; i < nOutputs; i++)
+    luaT_pushudata(L, result[i], "torch.FloatTensor");
+  THFree(result);
+  return nOutputs;
+}
+
+static int gputorch_GPUFusion_nGroups(lua_State *L)
+{
+  THGPUFusion *fusion = (THGPUFusion *)luaT_checkudata(L, 1, "torch.GPUFusion");
+  lua_pushnumber(L, THGPUFusion_nGroups(fusion));
+  return 1;
+}
+
+/* f:op(x [, value1 [, value2]]) for unary ops, f:op(x, y) for binary ones;
+   the op is the closure upvalue */
+static int gputorch_GPUFusion_op(lua_State *L)
+{
+  THGPUFusion *fusion = (THGPUFusion *)luaT_checkudata(L, 1, "torch.GPUFusion");
+  THGPUFusionOp op = (THGPUFusionOp)lua_tointeger(L, lua_upvalueindex(1));
+  int x = luaL_checkint(L, 2);
+
+  if (op >= THGPU_FUSION_ADD)
+    lua_pushnumber(L, THGPUFusion_binary(fusion, op, x, luaL_checkint(L, 3)));
+  else
+    lua_pushnumber(L, THGPUFusion_unary(fusion, op, x, (float)luaL_optnumber(L, 3, 0), (float)luaL_optnumber(L, 4, 0)));
+  return 1;
+}
+
+static const struct {
+  const char *name;
+  THGPUFusionOp op;
+} gputorch_GPUFusion_ops[] = {
+  {"addvalue", THGPU_FUSION_ADDVALUE},
+  {"mulvalue", THGPU_FUSION_MULVALUE},
+  {"divvalue", THGPU_FUSION_DIVVALUE},
+  {"pow", THGPU_FUSION_POW},
+  {"clamp", THGPU_FUSION_CLAMP},
+  {"log", THGPU_FUSION_LOG},
+  {"log1p", THGPU_FUSION_LOG1P},
+  {"exp", THGPU_FUSION_EXP},
+  {"cos", THGPU_FUSION_COS},
+  {"acos", THGPU_FUSION_ACOS},
+  {"cosh", THGPU_FUSION_COSH},
+  {"sin", THGPU_FUSION_SIN},
+  {"asin", THGPU_FUSION_ASIN},
+  {"sinh", THGPU_FUSION_SINH},
+  {"tan", THGPU_FUSION_TAN},
+  {"atan", THGPU_FUSION_ATAN},
+  {"tanh", THGPU_FUSION_TANH},
+  {"sqrt", THGPU_FUSION_SQRT},
+  {"ceil", THGPU_FUSION_CEIL},
+  {"floor", THGPU_FUSION_FLOOR},
+  {"abs", THGPU_FUSION_ABS},
+  {"round", THGPU_FUSION_ROUND},
+  {"sign", THGPU_FUSION_SIGN},
+  {"sigmoid", THGPU_FUSION_SIGMOID},
+  {"add", THGPU_FUSION_ADD},
+  {"sub", THGPU_FUSION_SUB},
+  {"cmul", THGPU_FUSION_MUL},
+  {"cdiv", THGPU_FUSION_DIV},
+  {"atan2", THGPU_FUSION_ATAN2},
+  {"cmax", THGPU_FUSION_MAX},
+  {"cmin", THGPU_FUSION_MIN},
+  {NULL, THGPU_FUSION_INPUT}
+};
+
+static const struct luaL_Reg gputorch_GPUFusion__ [] = {
+  {"input", gputorch_GPUFusion_input},
+  {"output", gputorch_GPUFusion_output},
+  {"run", gputorch_GPUFusion_run},
+  {"runReference", gputorch_GPUFusion_runReference},
+  {"nGroups", gputorch_GPUFusion_nGroups},
+  {NULL, NULL}
+};
+
+void gputorch_GPUFusion_init(lua_State *L)
+{
+  int i;
+
+  luaT_newmetatable(L, "torch.GPUFusion", NULL, gputorch_GPUFusion_new, gputorch_GPUFusion_free, NULL);
+  luaL_register(L, NULL, gputorch_GPUFusion__);
+  for (i = 0; gputorch_GPUFusion_ops[i].name; i++)
+  {
+    lua_pushinteger(L, gputorch_GPUFusion_ops[i].op);
+    lua_pushcclosure(L, gputorch_GPUFusion_op, 1);
+    lua_setfield(L, -2, gputorch_GPUFusion_ops[i].name);
+  }
+  lua_pop(L, 1);
+}
@@ -60,6 +60,8 @@ static int gputorch_GPUStorage_copy(lua_State *L)
     THGPUStorage_copyFloat(storage, (THFloatStorage *)src);
   else if ( (src = luaT_toudata(L, 2, "torch.DoubleStorage")) )
     THGPUStorage_copyDouble(storage, (THDoubleStorage *)src);
+  else if ( (src = luaT_toudata(L, 2, "torch.HalfStorage")) )
+    THGPUStorage_copyHalf(storage, (THHalfStorage *)src);
   else if ( (src = luaT_toudata(L, 2, "torch.GPUStorage")) )
     THGPUStorage_copyGPU(storage, (THGPUStorage *)src);
   else
@@ -90,6 +92,8 @@ static int gputorch_GPUStorage_copy(lua_State *L)
       TH##TYPEC##Storage_copyFloat(storage, (THFloatStorage *)src);                                       \
     else if ( (src = luaT_toudata(L, 2, "torch.DoubleStorage")) )                                         \
       TH##TYPEC##Storage_copyDouble(storage, (THDoubleStorage*)src);                                      \
+    else if ( (src = luaT_toudata(L, 2, "torch.HalfStorage")) )                                           \
+      TH##TYPEC##Storage_copyHalf(storage, (THHalfStorage *)src);                                         \
     else if ( (src = luaT_toudata(L, 2, "torch.GPUStorage")) )                                            \
       TH##TYPEC##Storage_copyGPU(storage, (THGPUStorage *)src);                                           \
     else                                                                                                  \
@@ -106,6 +110,7 @@ GPU_IMPLEMENT_STORAGE_COPY(Int)
 GPU_IMPLEMENT_STORAGE_COPY(Long)
 GPU_IMPLEMENT_STORAGE_COPY(Float)
 GPU_IMPLEMENT_STORAGE_COPY(Double)
+GPU_IMPLEMENT_STORAGE_COPY(Half)
 
 void gputorch_GPUStorage_init(lua_State* L)
 {
@@ -116,26 +121,28 @@ void gputorch_GPUStorage_init(lua_State* L)
   {
     int i;
 
-    const char* tnames[8] = {"torch.ByteStorage",
+    const char* tnames[9] = {"torch.ByteStorage",
                              "torch.CharStorage",
                              "torch.ShortStorage",
                              "torch.IntStorage",
                              "torch.LongStorage",
                              "torch.FloatStorage",
                              "torch.DoubleStorage",
+                             "torch.HalfStorage",
                              "torch.GPUStorage"};
 
-    static int (*funcs[8])(lua_State *) = {gputorch_ByteStorage_copy,
+    static int (*funcs[9])(lua_State *) = {gputorch_ByteStorage_copy,
                                            gputorch_CharStorage_copy,
                                            gputorch_ShortStorage_copy,
                                            gputorch_IntStorage_copy,
                                            gputorch_LongStorage_copy,
                                            gputorch_FloatStorage_copy,
                                            gputorch_DoubleStorage_copy,
+                                           gputorch_HalfStorage_copy,
                                            gputorch_GPUStorage_copy
                                           };
 
-    for (i = 0; i < 8; i++)
+    for (i = 0; i < 9; i++)
     {
       luaT_pushmetatable(L, tnames[i]);
       lua_pushcfunction(L, funcs[i]);
@@ -55,6 +55,8 @@ static int gputorch_GPUTensor_copy(lua_State *L)
     THGPUTensor_copyFloat(storage, (THFloatTensor *)src);
   else if ( (src = luaT_toudata(L, 2, "torch.DoubleTensor")) )
     THGPUTensor_copyDouble(storage, (THDoubleTensor *)src);
+  else if ( (src = luaT_toudata(L, 2, "torch.HalfTensor")) )
+    THGPUTensor_copyHalf(storage, (THHalfTensor *)src);
   else if ( (src = luaT_toudata(L, 2, "torch.GPUTensor")) )
     THGPUTensor_copyGPU(storage, (THGPUTensor *)src);
   else
@@ -85,6 +87,8 @@ static int gputorch_GPUTensor_copy(lua_State *L)
       TH##TYPEC##Tensor_copyFloat(storage, (THFloatTensor *)src);                                      \
     else if ( (src = luaT_toudata(L, 2, "torch.DoubleTensor")) )                                       \
       TH##TYPEC##Tensor_copyDouble(storage, (THDoubleTensor *)src);                                    \
+    else if ( (src = luaT_toudata(L, 2, "torch.HalfTensor")) )                                         \
+      TH##TYPEC##Tensor_copyHalf(storage, (THHalfTensor *)src);                                        \
     else if ( (src = luaT_toudata(L, 2, "torch.GPUTensor")) )                                          \
       TH##TYPEC##Tensor_copyGPU(storage, (THGPUTensor *)src);                                          \
     else                                                                                               \
@@ -101,6 +105,49 @@ GPU_IMPLEMENT_TENSOR_COPY(Int)
 GPU_IMPLEMENT_TENSOR_COPY(Long)
 GPU_IMPLEMENT_TENSOR_COPY(Float)
 GPU_IMPLEMENT_TENSOR_COPY(Double)
+GPU_IMPLEMENT_TENSOR_COPY(Half)
+
+static int gputorch_GPUTensor_copyAsync(lua_State *L)
+{
+  THGPUTensor *self = (THGPUTensor *)luaT_checkudata(L, 1, "torch.GPUTensor");
+  THGPUEvent *event = NULL;
+  void *src;
+  if ( (src = luaT_toudata(L, 2, "torch.GPUTensor")) )
+    event = THGPUTensor_copyAsyncGPU(self, (THGPUTensor *)src);
+  else if ( (src = luaT_toudata(L, 2, "torch.ByteTensor")) )
+    event = THGPUTensor_copyAsyncByte(self, (THByteTensor *)src);
+  else if ( (src = luaT_toudata(L, 2, "torch.CharTensor")) )
+    event = THGPUTensor_copyAsyncChar(self, (THCharTensor *)src);
+  else if ( (src = luaT_toudata(L, 2, "torch.ShortTensor")) )
+    event = THGPUTensor_copyAsyncShort(self, (THShortTensor *)src);
+  else if ( (src = luaT_toudata(L, 2, "torch.IntTensor")) )
+    event = THGPUTensor_copyAsyncInt(self, (THIntTensor *)src);
+  else if ( (src = luaT_toudata(L, 2, "torch.LongTensor")) )
+    event = THGPUTensor_copyAsyncLong(self, (THLongTensor *)src);
+  else if ( (src = luaT_toudata(L, 2, "torch.FloatTensor")) )
+    event = THGPUTensor_copyAsyncFloat(self, (THFloatTensor *)src);
+  else if ( (src = luaT_toudata(L, 2, "torch.DoubleTensor")) )
+    event = THGPUTensor_copyAsyncDouble(self, (THDoubleTensor *)src);
+  else if ( (src = luaT_toudata(L, 2, "torch.HalfTensor")) )
+    event = THGPUTensor_copyAsyncHalf(self, (THHalfTensor *)src);
+  else
+    luaL_typerror(L, 2, "torch.*Tensor");
+
+  lua_settop(L, 1);
+  luaT_pushudata(L, event, "torch.GPUEvent");
+  return 2;
+}
+
+static int gputorch_FloatTensor_copyAsync(lua_State *L)
+{
+  THFloatTensor *self = (THFloatTensor *)luaT_checkudata(L, 1, "torch.FloatTensor");
+  THGPUTensor *src = (THGPUTensor *)luaT_checkudata(L, 2, "torch.GPUTensor");
+  THGPUEvent *event = THFloatTensor_copyAsyncGPU(self, src);
+
+  lua_settop(L, 1);
+  luaT_pushudata(L, event, "torch.GPUEvent");
+  return 2;
+}
 
 static void THFloatTensor_computesz(THFloatTensor *self, long **sz_, long **st_)
 {
@@ -195,32 +242,41 @@ void gputorch_GPUTensor_init(lua_State* L)
   luaT_pushmetatable(L, "torch.FloatTensor");
   lua_pushcfunction(L, gpu_FloatTensor_fakecopy);
   lua_setfield(L, -2, "fakecopy");
+  lua_pushcfunction(L, gputorch_FloatTensor_copyAsync);
+  lua_setfield(L, -2, "copyAsync");
+  lua_pop(L, 1);
+
+  luaT_pushmetatable(L, "torch.GPUTensor");
+  lua_pushcfunction(L, gputorch_GPUTensor_copyAsync);
+  lua_setfield(L, -2, "copyAsync");
   lua_pop(L, 1);
 
   /* the copy methods */
   {
     int i;
 
-    const char* tnames[8] = {"torch.ByteTensor",
+    const char* tnames[9] = {"torch.ByteTensor",
                              "torch.CharTensor",
                              "torch.ShortTensor",
                              "torch.IntTensor",
                              "torch.LongTensor",
                              "torch.FloatTensor",
                              "torch.DoubleTensor",
+                             "torch.HalfTensor",
                              "torch.GPUTensor"};
 
-    static int (*funcs[8])(lua_State *) = {gputorch_ByteTensor_copy,
+    static int (*funcs[9])(lua_State *) = {gputorch_ByteTensor_copy,
                                            gputorch_CharTensor_copy,
                                            gputorch_ShortTensor_copy,
                                            gputorch_IntTensor_copy,
                                            gputorch_LongTensor_copy,
                                            gputorch_FloatTensor_copy,
                                            gputorch_DoubleTensor_copy,
+                                           gputorch_HalfTensor_copy,
                                            gputorch_GPUTensor_copy
                                           };
 
-    for (i = 0; i < 8; i++)
+    for (i = 0; i < 9; i++)
     {
       luaT_pushmetatable(L, tnames[i]);
       lua_pushcfunction(L, funcs[i]);
@@ -29,15 +29,20 @@ end
 local function Tensor__float(self,type)
    return self:type('torch.FloatTensor')
 end
+local function Tensor__half(self,type)
+   return self:type('torch.HalfTensor')
+end
 
 rawset(torch.getmetatable('torch.DoubleTensor'), 'gpu', Tensor__gpu)
 rawset(torch.getmetatable('torch.FloatTensor'), 'gpu', Tensor__gpu)
+rawset(torch.getmetatable('torch.HalfTensor'), 'gpu', Tensor__gpu)
 rawset(torch.getmetatable('torch.GPUTensor'), 'gpu', Tensor__gpu)
 
 rawset(torch.getmetatable('torch.GPUTensor'), 'type', Tensor__type)
 rawset(torch.getmetatable('torch.GPUTensor'), 'typeAs', Tensor__typeAs)
 rawset(torch.getmetatable('torch.GPUTensor'), 'double', Tensor__double)
 rawset(torch.getmetatable('torch.GPUTensor'), 'float', Tensor__float)
+rawset(torch.getmetatable('torch.GPUTensor'), 'half', Tensor__half)
 
 do
     local metatable = torch.getmetatable('torch.GPUTensor')
@@ -3,11 +3,7 @@
 #include "THC.h"
 #include "luaT.h"
 #include "utils.h"
-
-struct THGPUState
-{
-  THGPURNGState* rngState;
-};
+#include "THCState.h"
 
 static int gputorch_GPUTensor_zero(lua_State *L)
 {
@@ -595,6 +591,50 @@ static int gputorch_GPUTensor_mm(lua_State *L)
   return 1;
 }
 
+static int gputorch_GPUTensor_bmm(lua_State *L)
+{
+  int narg = lua_gettop(L);
+  THGPUTensor *arg1 = NULL;
+  int arg1_idx = 0;
+  float arg2 = 1;
+  THGPUTensor *arg3 = NULL;
+  float arg4 = 1;
+  THGPUTensor *arg5 = NULL;
+  THGPUTensor *arg6 = NULL;
+
+  if (narg == 2
+      && (arg5 = (THGPUTensor*)luaT_toudata(L, 1, "torch.GPUTensor"))
+      && (arg5->nDimension == 3)
+      && (arg6 = (THGPUTensor*)luaT_toudata(L, 2, "torch.GPUTensor"))
+      && (arg6->nDimension == 3)
+     )
+  {
+    arg1 = THGPUTensor_new();
+    THGPUTensor_resize3d(arg1, arg5->size[0], arg5->size[1], arg6->size[2]);
+    arg3 = arg1;
+  }
+  else if (narg == 3
+           && (arg1 = (THGPUTensor*)luaT_toudata(L, 1, "torch.GPUTensor"))
+           && (arg5 = (THGPUTensor*)luaT_toudata(L, 2, "torch.GPUTensor"))
+           && (arg5->nDimension == 3)
+           && (arg6 = (THGPUTensor*)luaT_toudata(L, 3, "torch.GPUTensor"))
+           && (arg6->nDimension == 3)
+          )
+  {
+    arg1_idx = 1;
+    arg3 = arg1;
+  }
+  else
+    luaL_error(L, "expected arguments: [*GPUTensor*] GPUTensor~3D GPUTensor~3D");
+  THGPUTensor_zero(arg1);
+  if (arg1_idx)
+    lua_pushvalue(L, arg1_idx);
+  else
+    luaT_pushudata(L, arg1, "torch.GPUTensor");
+  THGPUTensor_baddbmm(arg1, arg2, arg3, arg4, arg5, arg6);
+  return 1;
+}
+
 static int gputorch_GPUTensor_ger(lua_State *L)
 {
   int narg = lua_gettop(L);
@@ -897,6 +937,135 @@ static int gputorch_GPUTensor_addmm(lua_State *L)
   return 1;
 }
 
+static int gputorch_GPUTensor_baddbmm(lua_State *L)
+{
+  int narg = lua_gettop(L);
+  THGPUTensor *arg1 = NULL;
+  int arg1_idx = 0;
+  float arg2 = 1;
+  THGPUTensor *arg3 = NULL;
+  float arg4 = 1;
+  THGPUTensor *arg5 = NULL;
+  THGPUTensor *arg6 = NULL;
+
+  if (narg == 3
+      && (arg3 = (THGPUTensor*)luaT_toudata(L, 1, "torch.GPUTensor"))
+      && (arg3->nDimension == 3)
+      && (arg5 = (THGPUTensor*)luaT_toudata(L, 2, "torch.GPUTensor"))
+      && (arg5->nDimension == 3)
+      && (arg6 = (THGPUTensor*)luaT_toudata(L, 3, "torch.GPUTensor"))
+      && (arg6->nDimension == 3)
+     )
+  {
+    arg1 = THGPUTensor_new();
+  }
+  else if (narg == 4
+           && (arg1 = (THGPUTensor*)luaT_toudata(L, 1, "torch.GPUTensor"))
+           && (arg3 = (THGPUTensor*)luaT_toudata(L, 2, "torch.GPUTensor"))
+           && (arg3->nDimension == 3)
+           && (arg5 = (THGPUTensor*)luaT_toudata(L, 3, "torch.GPUTensor"))
+           && (arg5->nDimension == 3)
+           && (arg6 = (THGPUTensor*)luaT_toudata(L, 4, "torch.GPUTensor"))
+           && (arg6->nDimension == 3)
+          )
+  {
+    arg1_idx = 1;
+  }
+  else if (narg == 4
+           && lua_isnumber(L, 1)
+           && (arg3 = (THGPUTensor*)luaT_toudata(L, 2, "torch.GPUTensor"))
+           && (arg3->nDimension == 3)
+           && (arg5 = (THGPUTensor*)luaT_toudata(L, 3, "torch.GPUTensor"))
+           && (arg5->nDimension == 3)
+           && (arg6 = (THGPUTensor*)luaT_toudata(L, 4, "torch.GPUTensor"))
+           && (arg6->nDimension == 3)
+          )
+  {
+    arg2 = (float)lua_tonumber(L, 1);
+    arg1 = THGPUTensor_new();
+  }
+  else if (narg == 5
+           && (arg1 = (THGPUTensor*)luaT_toudata(L, 1, "torch.GPUTensor"))
+           && lua_isnumber(L, 2)
+           && (arg3 = (THGPUTensor*)luaT_toudata(L, 3, "torch.GPUTensor"))
+           && (arg3->nDimension == 3)
+           && (arg5 = (THGPUTensor*)luaT_toudata(L, 4, "torch.GPUTensor"))
+           && (arg5->nDimension == 3)
+           && (arg6 = (THGPUTensor*)luaT_toudata(L, 5, "torch.GPUTensor"))
+           && (arg6->nDimension == 3)
+          )
+  {
+    arg1_idx = 1;
+    arg2 = (float)lua_tonumber(L, 2);
+  }
+  else if (narg == 4
+           && (arg3 = (THGPUTensor*)luaT_toudata(L, 1, "torch.GPUTensor"))
+           && (arg3->nDimension == 3)
+           && lua_isnumber(L, 2)
+           && (arg5 = (THGPUTensor*)luaT_toudata(L, 3, "torch.GPUTensor"))
+           && (arg5->nDimension == 3)
+           && (arg6 = (THGPUTensor*)luaT_toudata(L, 4, "torch.GPUTensor"))
+           && (arg6->nDimension == 3)
+          )
+  {
+    arg4 = (float)lua_tonumber(L, 2);
+    arg1 = THGPUTensor_new();
+  }
+  else if (narg == 5
+           && (arg1 = (THGPUTensor*)luaT_toudata(L, 1, "torch.GPUTensor"))
+           && (arg3 = (THGPUTensor*)luaT_toudata(L, 2, "torch.GPUTensor"))
+           && (arg3->nDimension == 3)
+           && lua_isnumber(L, 3)
+           && (arg5 = (THGPUTensor*)luaT_toudata(L, 4, "torch.GPUTensor"))
+           && (arg5->nDimension == 3)
+           && (arg6 = (THGPUTensor*)luaT_toudata(L, 5, "torch.GPUTensor"))
+           && (arg6->nDimension == 3)
+          )
+  {
+    arg1_idx = 1;
+    arg4 = (float)lua_tonumber(L, 3);
+  }
+  else if (narg == 5
+           && lua_isnumber(L, 1)
+           && (arg3 = (THGPUTensor*)luaT_toudata(L, 2, "torch.GPUTensor"))
+           && (arg3->nDimension == 3)
+           && lua_isnumber(L, 3)
+           && (arg5 = (THGPUTensor*)luaT_toudata(L, 4, "torch.GPUTensor"))
+           && (arg5->nDimension == 3)
+           && (arg6 = (THGPUTensor*)luaT_toudata(L, 5, "torch.GPUTensor"))
+           && (arg6->nDimension == 3)
+          )
+  {
+    arg2 = (float)lua_tonumber(L, 1);
+    arg4 = (float)lua_tonumber(L, 3);
+    arg1 = THGPUTensor_new();
+  }
+  else if (narg == 6
+           && (arg1 = (THGPUTensor*)luaT_toudata(L, 1, "torch.GPUTensor"))
+           && lua_isnumber(L, 2)
+           && (arg3 = (THGPUTensor*)luaT_toudata(L, 3, "torch.GPUTensor"))
+           && (arg3->nDimension == 3)
+           && lua_isnumber(L, 4)
+           && (arg5 = (THGPUTensor*)luaT_toudata(L, 5, "torch.GPUTensor"))
+           && (arg5->nDimension == 3)
+           && (arg6 = (THGPUTensor*)luaT_toudata(L, 6, "torch.GPUTensor"))
+           && (arg6->nDimension == 3)
+          )
+  {
+    arg1_idx = 1;
+    arg2 = (float)lua_tonumber(L, 2);
+    arg4 = (float)lua_tonumber(L, 4);
+  }
+  else
+    luaL_error(L, "expected arguments: [*GPUTensor*] [float] GPUTensor~3D [float] GPUTensor~3D GPUTensor~3D");
+  if (arg1_idx)
+    lua_pushvalue(L, arg1_idx);
+  else
+    luaT_pushudata(L, arg1, "torch.GPUTensor");
+  THGPUTensor_baddbmm(arg1, arg2, arg3, arg4, arg5, arg6);
+  return 1;
+}
+
 static int gputorch_GPUTensor_addr(lua_State *L)
 {
   int narg = lua_gettop(L);
@@ -2678,7 +2847,7 @@ static int gputorch_GPUTensor_geometric(lua_State *L)
   arg1 = (THGPUState*)lua_touserdata(L, -1);
   lua_pop(L, 2);
   lua_pushvalue(L, arg2_idx);
-  THGPUTensor_geometric(NULL, arg2, arg3);
+  THGPUTensor_geometric(arg1->rngState, arg2, arg3);
   return 1;
 }
 
@@ -2763,7 +2932,7 @@ static int gputorch_GPUTensor_uniform(lua_State *L)
   arg1 = (THGPUState*)lua_touserdata(L, -1);
   lua_pop(L, 2);
   lua_pushvalue(L, arg2_idx);
-  THGPUTensor_uniform(NULL, arg2, arg3, arg4);
+  THGPUTensor_uniform(arg1->rngState, arg2, arg3, arg4);
   return 1;
 }
 
@@ -2815,7 +2984,7 @@ static int gputorch_GPUTensor_normal(lua_State *L)
   arg1 = (THGPUState*)lua_touserdata(L, -1);
   lua_pop(L, 2);
   lua_pushvalue(L, arg2_idx);
-  THGPUTensor_normal(NULL, arg2, arg3, arg4);
+  THGPUTensor_normal(arg1->rngState, arg2, arg3, arg4);
   return 1;
 }
 
@@ -2867,7 +3036,7 @@ static int gputorch_GPUTensor_cauchy(lua_State *L)
   arg1 = (THGPUState*)lua_touserdata(L, -1);
   lua_pop(L, 2);
   lua_pushvalue(L, arg2_idx);
-  THGPUTensor_cauchy(NULL, arg2, arg3, arg4);
+  THGPUTensor_cauchy(arg1->rngState, arg2, arg3, arg4);
   return 1;
 }
 
@@ -2919,7 +3088,7 @@ static int gputorch_GPUTensor_logNormal(lua_State *L)
   arg1 = (THGPUState*)lua_touserdata(L, -1);
   lua_pop(L, 2);
   lua_pushvalue(L, arg2_idx);
-  THGPUTensor_logNormal(NULL, arg2, arg3, arg4);
+  THGPUTensor_logNormal(arg1->rngState, arg2, arg3, arg4);
   return 1;
 }
 
@@ -2946,7 +3115,7 @@ static int gputorch_GPUTensor_exponential(lua_State *L)
   arg1 = (THGPUState*)lua_touserdata(L, -1);
   lua_pop(L, 2);
   lua_pushvalue(L, arg2_idx);
-  THGPUTensor_exponential(NULL, arg2, arg3);
+  THGPUTensor_exponential(arg1->rngState, arg2, arg3);
   return 1;
 }
 
@@ -3183,6 +3352,103 @@ static int gputorch_GPUTensor_dist(lua_State *L)
   return 1;
 }
 
+static int gputorch_GPUTensor_histc(lua_State *L)
+{
+  int narg = lua_gettop(L);
+  THGPUTensor *arg1 = NULL;
+  int arg1_idx = 0;
+  THGPUTensor *arg2 = NULL;
+  long arg4 = 100;
+  float arg5 = 0;
+  float arg6 = 0;
+  int first = 0;
+
+  if (narg >= 2
+      && (arg1 = (THGPUTensor*)luaT_toudata(L, 1, "torch.GPUTensor"))
+      && (arg2 = (THGPUTensor*)luaT_toudata(L, 2, "torch.GPUTensor"))
+     )
+  {
+    arg1_idx = 1;
+    first = 3;
+  }
+  else if (narg >= 1
+           && (arg2 = (THGPUTensor*)luaT_toudata(L, 1, "torch.GPUTensor"))
+          )
+  {
+    first = 2;
+  }
+  if (!first || narg > first + 2
+      || (narg >= first && !lua_isnumber(L, first))
+      || (narg >= first + 1 && !lua_isnumber(L, first + 1))
+      || (narg >= first + 2 && !lua_isnumber(L, first + 2)))
+    luaL_error(L, "expected arguments: [*GPUTensor*] GPUTensor [long] [float] [float]");
+  if (narg >= first)
+    arg4 = (long)lua_tonumber(L, first);
+  if (narg >= first + 1)
+    arg5 = (float)lua_tonumber(L, first + 1);
+  if (narg >= first + 2)
+    arg6 = (float)lua_tonumber(L, first + 2);
+  if (arg1_idx)
+    lua_pushvalue(L, arg1_idx);
+  else
+  {
+    arg1 = THGPUTensor_new();
+    luaT_pushudata(L, arg1, "torch.GPUTensor");
+  }
+  THGPUTensor_histc(arg1, arg2, arg4, arg5, arg6);
+  return 1;
+}
+
+static int gputorch_GPUTensor_histcw(lua_State *L)
+{
+  int narg = lua_gettop(L);
+  THGPUTensor *arg1 = NULL;
+  int arg1_idx = 0;
+  THGPUTensor *arg2 = NULL;
+  THGPUTensor *arg3 = NULL;
+  long arg4 = 100;
+  float arg5 = 0;
+  float arg6 = 0;
+  int first = 0;
+
+  if (narg >= 3
+      && (arg1 = (THGPUTensor*)luaT_toudata(L, 1, "torch.GPUTensor"))
+      && (arg2 = (THGPUTensor*)luaT_toudata(L, 2, "torch.GPUTensor"))
+      && (arg3 = (THGPUTensor*)luaT_toudata(L, 3, "torch.GPUTensor"))
+     )
+  {
+    arg1_idx = 1;
+    first = 4;
+  }
+  else if (narg >= 2
+           && (arg2 = (THGPUTensor*)luaT_toudata(L, 1, "torch.GPUTensor"))
+           && (arg3 = (THGPUTensor*)luaT_toudata(L, 2, "torch.GPUTensor"))
+          )
+  {
+    first = 3;
+  }
+  if (!first || narg > first + 2
+      || (narg >= first && !lua_isnumber(L, first))
+      || (narg >= first + 1 && !lua_isnumber(L, first + 1))
+      || (narg >= first + 2 && !lua_isnumber(L, first + 2)))
+    luaL_error(L, "expected arguments: [*GPUTensor*] GPUTensor GPUTensor [long] [float] [float]");
+  if (narg >= first)
+    arg4 = (long)lua_tonumber(L, first);
+  if (narg >= first + 1)
+    arg5 = (float)lua_tonumber(L, first + 1);
+  if (narg >= first + 2)
+    arg6 = (float)lua_tonumber(L, first + 2);
+  if (arg1_idx)
+    lua_pushvalue(L, arg1_idx);
+  else
+  {
+    arg1 = THGPUTensor_new();
+    luaT_pushudata(L, arg1, "torch.GPUTensor");
+  }
+  THGPUTensor_histcw(arg1, arg2, arg3, arg4, arg5, arg6);
+  return 1;
+}
+
 static int gputorch_GPUTensor_squeeze(lua_State *L)
 {
   int narg = lua_gettop(L);
@@ -3787,6 +4053,34 @@ static int wrapper_mm(lua_State *L)
   return 1;
 }
 
+static int wrapper_bmm(lua_State *L)
+{
+  int narg = lua_gettop(L);
+  THGPUTensor *arg1 = NULL;
+  int arg1_idx = 0;
+  float arg2 = 1;
+  THGPUTensor *arg3 = NULL;
+  float arg4 = 1;
+  THGPUTensor *arg5 = NULL;
+  THGPUTensor *arg6 = NULL;
+
+  if (narg == 3
+      && (arg1 = (THGPUTensor*)luaT_toudata(L, 1, "torch.GPUTensor"))
+      && (arg5 = (THGPUTensor*)luaT_toudata(L, 2, "torch.GPUTensor")) && (arg5->nDimension == 3)
+      && (arg6 = (THGPUTensor*)luaT_toudata(L, 3, "torch.GPUTensor")) && (arg6->nDimension == 3)
+     )
+  {
+    arg1_idx = 1;
+    arg3 = arg1;
+  }
+  else
+    luaL_error(L, "expected arguments: *GPUTensor* GPUTensor~3D GPUTensor~3D");
+  THGPUTensor_zero(arg1);
+  lua_pushvalue(L, arg1_idx);
+  THGPUTensor_baddbmm(arg1, arg2, arg3, arg4, arg5, arg6);
+  return 1;
+}
+
 static int wrapper_ger(lua_State *L)
 {
   int narg = lua_gettop(L);
@@ -4031,6 +4325,114 @@ static int wrapper_addmm(lua_State *L)
   return 0;
 }
 
+static int wrapper_baddbmm(lua_State *L)
+{
+  int narg = lua_gettop(L);
+  int argset = 0;
+  THGPUTensor *arg1 = NULL;
+  int arg1_idx = 0;
+  float arg2 = 1;
+  THGPUTensor *arg3 = NULL;
+  float arg4 = 1;
+  THGPUTensor *arg5 = NULL;
+  THGPUTensor *arg6 = NULL;
+  THGPUTensor *arg7 = NULL;
+  int arg7_idx = 0;
+  float arg8 = 0;
+  THGPUTensor *arg9 = NULL;
+  float arg10 = 0;
+  THGPUTensor *arg11 = NULL;
+  THGPUTensor *arg12 = NULL;
+
+  if (narg == 3
+      && (arg1 = (THGPUTensor*)luaT_toudata(L, 1, "torch.GPUTensor")) && (arg1->nDimension == 3)
+      && (arg5 = (THGPUTensor*)luaT_toudata(L, 2, "torch.GPUTensor")) && (arg5->nDimension == 3)
+      && (arg6 = (THGPUTensor*)luaT_toudata(L, 3, "torch.GPUTensor")) && (arg6->nDimension == 3)
+     )
+  {
+    argset = 1;
+    arg1_idx = 1;
+    arg3 = arg1;
+  }
+  else if (narg == 4
+           && (arg1 = (THGPUTensor*)luaT_toudata(L, 1, "torch.GPUTensor")) && (arg1->nDimension == 3)
+           && (arg3 = (THGPUTensor*)luaT_toudata(L, 2, "torch.GPUTensor")) && (arg3->nDimension == 3)
+           && (arg5 = (THGPUTensor*)luaT_toudata(L, 3, "torch.GPUTensor")) && (arg5->nDimension == 3)
+           && (arg6 = (THGPUTensor*)luaT_toudata(L, 4, "torch.GPUTensor")) && (arg6->nDimension == 3)
+          )
+  {
+    argset = 1;
+    arg1_idx = 1;
+  }
+  else if (narg == 4
+           && (arg1 = (THGPUTensor*)luaT_toudata(L, 1, "torch.GPUTensor")) && (arg1->nDimension == 3)
+           && lua_isnumber(L, 2)
+           && (arg5 = (THGPUTensor*)luaT_toudata(L, 3, "torch.GPUTensor")) && (arg5->nDimension == 3)
+           && (arg6 = (THGPUTensor*)luaT_toudata(L, 4, "torch.GPUTensor")) && (arg6->nDimension == 3)
+          )
+  {
+    argset = 1;
+    arg1_idx = 1;
+    arg4 = (float)lua_tonumber(L, 2);
+    arg3 = arg1;
+  }
+  else if (narg == 5
+           && (arg1 = (THGPUTensor*)luaT_toudata(L, 1, "torch.GPUTensor")) && (arg1->nDimension == 3)
+           && (arg3 = (THGPUTensor*)luaT_toudata(L, 2, "torch.GPUTensor")) && (arg3->nDimension == 3)
+           && lua_isnumber(L, 3)
+           && (arg5 = (THGPUTensor*)luaT_toudata(L, 4, "torch.GPUTensor")) && (arg5->nDimension == 3)
+           && (arg6 = (THGPUTensor*)luaT_toudata(L, 5, "torch.GPUTensor")) && (arg6->nDimension == 3)
+          )
+  {
+    argset = 1;
+    arg1_idx = 1;
+    arg4 = (float)lua_tonumber(L, 3);
+  }
+  else if (narg == 5
+           && (arg7 = (THGPUTensor*)luaT_toudata(L, 1, "torch.GPUTensor")) && (arg7->nDimension == 3)
+           && lua_isnumber(L, 2)
+           && lua_isnumber(L, 3)
+           && (arg11 = (THGPUTensor*)luaT_toudata(L, 4, "torch.GPUTensor")) && (arg11->nDimension == 3)
+           && (arg12 = (THGPUTensor*)luaT_toudata(L, 5, "torch.GPUTensor")) && (arg12->nDimension == 3)
+          )
+  {
+    argset = 2;
+    arg7_idx = 1;
+    arg8 = (float)lua_tonumber(L, 2);
+    arg10 = (float)lua_tonumber(L, 3);
+    arg9 = arg7;
+  }
+  else if (narg == 6
+           && (arg7 = (THGPUTensor*)luaT_toudata(L, 1, "torch.GPUTensor")) && (arg7->nDimension == 3)
+           && lua_isnumber(L, 2)
+           && (arg9 = (THGPUTensor*)luaT_toudata(L, 3, "torch.GPUTensor")) && (arg9->nDimension == 3)
+           && lua_isnumber(L, 4)
+           && (arg11 = (THGPUTensor*)luaT_toudata(L, 5, "torch.GPUTensor")) && (arg11->nDimension == 3)
+           && (arg12 = (THGPUTensor*)luaT_toudata(L, 6, "torch.GPUTensor")) && (arg12->nDimension == 3)
+          )
+  {
+    argset = 2;
+    arg7_idx = 1;
+    arg8 = (float)lua_tonumber(L, 2);
+    arg10 = (float)lua_tonumber(L, 4);
+  }
+  else
+    luaL_error(L, "expected arguments: *GPUTensor~3D* [GPUTensor~3D] [float] GPUTensor~3D GPUTensor~3D | *GPUTensor~3D* float [GPUTensor~3D] float GPUTensor~3D GPUTensor~3D");
+  if (argset == 1)
+  {
+    lua_pushvalue(L, arg1_idx);
+    THGPUTensor_baddbmm(arg1, arg2, arg3, arg4, arg5, arg6);
+    return 1;
+  }
+  else if (argset == 2)
+  {
+    lua_pushvalue(L, arg7_idx);
+    THGPUTensor_baddbmm(arg7, arg8, arg9, arg10, arg11, arg12);
+    return 1;
+  }
+  return 0;
+}
+
 static int wrapper_addr(lua_State *L)
 {
   int narg = lua_gettop(L);
@@ -5495,7 +5897,7 @@ static int wrapper_geometric(lua_State *L)
   arg1 = (THGPUState*)lua_touserdata(L, -1);
   lua_pop(L, 2);
   lua_pushvalue(L, arg2_idx);
-  THGPUTensor_geometric(NULL, arg2, arg3);
+  THGPUTensor_geometric(arg1->rngState, arg2, arg3);
   return 1;
 }
 
@@ -5528,7 +5930,7 @@ static int wrapper_bernoulli(lua_State *L)
   arg1 = (THGPUState*)lua_touserdata(L, -1);
   lua_pop(L, 2);
   lua_pushvalue(L, arg2_idx);
-  THGPUTensor_bernoulli(NULL, arg2, arg3);
+  THGPUTensor_bernoulli(arg1->rngState, arg2, arg3);
   return 1;
 }
 
@@ -5580,7 +5982,7 @@ static int wrapper_uniform(lua_State *L)
   arg1 = (THGPUState*)lua_touserdata(L, -1);
   lua_pop(L, 2);
   lua_pushvalue(L, arg2_idx);
-  THGPUTensor_uniform(NULL, arg2, arg3, arg4);
+  THGPUTensor_uniform(arg1->rngState, arg2, arg3, arg4);
   return 1;
 }
 
@@ -5632,7 +6034,7 @@ static int wrapper_normal(lua_State *L)
   arg1 = (THGPUState*)lua_touserdata(L, -1);
   lua_pop(L, 2);
   lua_pushvalue(L, arg2_idx);
-  THGPUTensor_normal(NULL, arg2, arg3, arg4);
+  THGPUTensor_normal(arg1->rngState, arg2, arg3, arg4);
   return 1;
 }
 
@@ -5684,7 +6086,7 @@ static int wrapper_cauchy(lua_State *L)
   arg1 = (THGPUState*)lua_touserdata(L, -1);
   lua_pop(L, 2);
   lua_pushvalue(L, arg2_idx);
-  THGPUTensor_cauchy(NULL, arg2, arg3, arg4);
+  THGPUTensor_cauchy(arg1->rngState, arg2, arg3, arg4);
   return 1;
 }
 
@@ -5736,7 +6138,7 @@ static int wrapper_logNormal(lua_State *L)
   arg1 = (THGPUState*)lua_touserdata(L, -1);
   lua_pop(L, 2);
   lua_pushvalue(L, arg2_idx);
-  THGPUTensor_logNormal(NULL, arg2, arg3, arg4);
+  THGPUTensor_logNormal(arg1->rngState, arg2, arg3, arg4);
   return 1;
 }
 
@@ -5763,7 +6165,7 @@ static int wrapper_exponential(lua_State *L)
   arg1 = (THGPUState*)lua_touserdata(L, -1);
   lua_pop(L, 2);
   lua_pushvalue(L, arg2_idx);
-  THGPUTensor_exponential(NULL, arg2, arg3);
+  THGPUTensor_exponential(arg1->rngState, arg2, arg3);
   return 1;
 }
 
@@ -6089,9 +6491,11 @@ static const struct luaL_Reg m_gputorch_GPUTensorMath__ [] = {
   { "addcdiv", wrapper_addcdiv },
   { "mv", wrapper_mv },
   { "mm", wrapper_mm },
+  { "bmm", wrapper_bmm },
   { "ger", wrapper_ger },
   { "addmv", wrapper_addmv },
   { "addmm", wrapper_addmm },
+  { "baddbmm", wrapper_baddbmm },
   { "addr", wrapper_addr },
   { "dot", wrapper_dot },
   { "sum", wrapper_sum },
@@ -6140,6 +6544,8 @@ static const struct luaL_Reg m_gputorch_GPUTensorMath__ [] = {
   { "norm", wrapper_norm },
   { "renorm", wrapper_renorm },
   { "dist", wrapper_dist },
+  { "histc", gputorch_GPUTensor_histc },
+  { "histcw", gputorch_GPUTensor_histcw },
   { "squeeze", wrapper_squeeze },
   { NULL, NULL }
 };
@@ -6160,9 +6566,11 @@ static const struct luaL_Reg gputorch_GPUTensorMath__ [] = {
   { "addcdiv", gputorch_GPUTensor_addcdiv },
   { "mv", gputorch_GPUTensor_mv },
   { "mm", gputorch_GPUTensor_mm },
+  { "bmm", gputorch_GPUTensor_bmm },
   { "ger", gputorch_GPUTensor_ger },
   { "addmv", gputorch_GPUTensor_addmv },
   { "addmm", gputorch_GPUTensor_addmm },
+  { "baddbmm", gputorch_GPUTensor_baddbmm },
   { "addr", gputorch_GPUTensor_addr },
   { "dot", gputorch_GPUTensor_dot },
   { "sum", gputorch_GPUTensor_sum },
@@ -6211,6 +6619,8 @@ static const struct luaL_Reg gputorch_GPUTensorMath__ [] = {
   { "norm", gputorch_GPUTensor_norm },
   { "renorm", gputorch_GPUTensor_renorm },
   { "dist", gputorch_GPUTensor_dist },
+  { "histc", gputorch_GPUTensor_histc },
+  { "histcw", gputorch_GPUTensor_histcw },
   { "squeeze", gputorch_GPUTensor_squeeze },
   { NULL, NULL }
 };
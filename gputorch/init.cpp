@@ -2,14 +2,27 @@
 #include "luaT.h"
 #include "THCGeneral.h"
 #include "THCTensorRandom.h"
+#include "THCState.h"
+#include "THCCachingAllocator.h"
+#include "THCTensorCopy.h"
+#include "THCBlas.h"
 
 extern void gputorch_GPUStorage_init(lua_State* L);
 extern void gputorch_GPUTensor_init(lua_State* L);
 extern void gputorch_GPUTensorMath_init(lua_State* L);
+extern void gputorch_GPUEvent_init(lua_State* L);
+extern void gputorch_GPUFusion_init(lua_State* L);
 
 static int gputorch_synchronize(lua_State *L)
 {
-  /* TO BE IMPLEMENTED */
+  THGPUSynchronize();
+  return 0;
+}
+
+/* __gc of gputorch._state, run when the Lua state is closed */
+static int gputorch_shutdown(lua_State *L)
+{
+  THGPUShutdown();
   return 0;
 }
 
@@ -49,22 +62,197 @@ static int gputorch_getDeviceProperties(lua_State *L)
 
 static int gputorch_seed(lua_State *L)
 {
-  /* TO BE IMPLEMENTED */
+  unsigned long seed = THCRandom_seed(THGPUState_rngState(L));
+  lua_pushnumber(L, seed);
+  return 1;
+}
+
+static int gputorch_seedAll(lua_State *L)
+{
+  unsigned long seed = THCRandom_seedAll(THGPUState_rngState(L));
+  lua_pushnumber(L, seed);
   return 1;
 }
 
 static int gputorch_initialSeed(lua_State *L)
 {
-  /* TO BE IMPLEMENTED */
+  unsigned long seed = THCRandom_initialSeed(THGPUState_rngState(L));
+  lua_pushnumber(L, seed);
   return 1;
 }
 
 static int gputorch_manualSeed(lua_State *L)
 {
-  /* TO BE IMPLEMENTED */
+  unsigned long seed = luaL_checknumber(L, 1);
+  THCRandom_manualSeed(THGPUState_rngState(L), seed);
+  return 0;
+}
+
+static int gputorch_manualSeedAll(lua_State *L)
+{
+  unsigned long seed = luaL_checknumber(L, 1);
+  THCRandom_manualSeedAll(THGPUState_rngState(L), seed);
+  return 0;
+}
+
+static int gputorch_getRNGState(lua_State *L)
+{
+  THByteTensor* t = THByteTensor_new();
+  THCRandom_getRNGState(THGPUState_rngState(L), t);
+  luaT_pushudata(L, t, "torch.ByteTensor");
+  return 1;
+}
+
+static int gputorch_setRNGState(lua_State *L)
+{
+  THByteTensor* t = (THByteTensor*)luaT_checkudata(L, 1, "torch.ByteTensor");
+  THCRandom_setRNGState(THGPUState_rngState(L), t);
   return 0;
 }
 
+/* gputorch.referenceFill(FloatTensor, 'uniform'|'normal'|'bernoulli' [, a, b]):
+   the values the next GPU fill would produce, computed on the host */
+static int gputorch_referenceFill(lua_State *L)
+{
+  static const char *names[] = {"uniform", "normal", "bernoulli", NULL};
+  THFloatTensor *t = (THFloatTensor*)luaT_checkudata(L, 1, "torch.FloatTensor");
+  int distribution = luaL_checkoption(L, 2, NULL, names);
+  double a = luaL_optnumber(L, 3, distribution == THC_RNG_BERNOULLI ? 0.5 : 0);
+  double b = luaL_optnumber(L, 4, 1);
+  THCRandom_referenceFill(THGPUState_rngState(L), t, distribution, a, b);
+  lua_settop(L, 1);
+  return 1;
+}
+
+static int gputorch_setCacheLimit(lua_State *L)
+{
+  long limit = (long)luaL_checknumber(L, 1);
+  THGPUCachingAllocator_setLimit(limit);
+  if (limit >= 0)
+    THGPUPinnedBuffer_trim(limit);
+  return 0;
+}
+
+static int gputorch_getCacheLimit(lua_State *L)
+{
+  lua_pushnumber(L, THGPUCachingAllocator_getLimit());
+  return 1;
+}
+
+static int gputorch_trimCache(lua_State *L)
+{
+  long bytes = (long)luaL_optnumber(L, 1, 0);
+  THGPUCachingAllocator_trim(bytes);
+  THGPUPinnedBuffer_trim(bytes);
+  return 0;
+}
+
+static int gputorch_getCachedBytes(lua_State *L)
+{
+  lua_pushnumber(L, THGPUCachingAllocator_cachedBytes());
+  return 1;
+}
+
+/* bytes held by the idle page-locked staging buffers of copyAsync */
+static int gputorch_getPinnedBytes(lua_State *L)
+{
+  lua_pushnumber(L, THGPUPinnedBuffer_cachedBytes());
+  return 1;
+}
+
+#define SET_STAT(NAME) \
+  lua_pushnumber(L, stats.NAME); \
+  lua_setfield(L, -2, #NAME);
+
+static int gputorch_getAllocatorStats(lua_State *L)
+{
+  THGPUCachingAllocatorStats stats;
+  THGPUCachingAllocator_getStats(&stats);
+  lua_newtable(L);
+  SET_STAT(nDeviceAllocs);
+  SET_STAT(nDeviceFrees);
+  SET_STAT(nCacheHits);
+  SET_STAT(nCacheMisses);
+  SET_STAT(allocatedBytes);
+  SET_STAT(cachedBytes);
+  return 1;
+}
+
+static int gputorch_resetAllocatorStats(lua_State *L)
+{
+  THGPUCachingAllocator_resetStats();
+  return 0;
+}
+
+static int gputorch_setGemmTuning(lua_State *L)
+{
+  THGPUBlas_setGemmTuning(lua_toboolean(L, 1));
+  return 0;
+}
+
+static int gputorch_getGemmTuning(lua_State *L)
+{
+  lua_pushboolean(L, THGPUBlas_getGemmTuning());
+  return 1;
+}
+
+/* gputorch.setGemmCacheFile([path]): no path keeps the choices in memory */
+static int gputorch_setGemmCacheFile(lua_State *L)
+{
+  THGPUBlas_setGemmCacheFile(luaL_optstring(L, 1, NULL));
+  return 0;
+}
+
+static int gputorch_getGemmCacheFile(lua_State *L)
+{
+  const char *path = THGPUBlas_getGemmCacheFile();
+  if (*path)
+    lua_pushstring(L, path);
+  else
+    lua_pushnil(L);
+  return 1;
+}
+
+static int gputorch_resetGemmTuning(lua_State *L)
+{
+  THGPUBlas_resetGemmTuning();
+  return 0;
+}
+
+/* gputorch.setGemmKernel([name]): no name goes back to the tuned choices */
+static int gputorch_setGemmKernel(lua_State *L)
+{
+  THGPUBlas_setGemmKernel(luaL_optstring(L, 1, NULL));
+  return 0;
+}
+
+/* gputorch.getGemmKernel(transa, transb, m, n, k): kernel chosen for that
+   THGPUBlas_gemm shape, nil if none */
+static int gputorch_getGemmKernel(lua_State *L)
+{
+  const char *name = THGPUBlas_getGemmKernel(luaL_checkstring(L, 1)[0], luaL_checkstring(L, 2)[0],
+                                             (long)luaL_checknumber(L, 3), (long)luaL_checknumber(L, 4),
+                                             (long)luaL_checknumber(L, 5));
+  if (name)
+    lua_pushstring(L, name);
+  else
+    lua_pushnil(L);
+  return 1;
+}
+
+static int gputorch_gemmKernels(lua_State *L)
+{
+  const char *name;
+  int i;
+  lua_newtable(L);
+  for (i = 0; (name = THGPUBlas_gemmKernelName(i)) != NULL; i++)
+  {
+    lua_pushstring(L, name);
+    lua_rawseti(L, -2, i+1);
+  }
+  return 1;
+}
+
 static const struct luaL_Reg gputorch_stuff__ [] = {
   {"synchronize", gputorch_synchronize},
   {"getDevice", gputorch_getDevice},
@@ -73,8 +261,28 @@ static const struct luaL_Reg gputorch_stuff__ [] = {
   {"getDeviceProperties", gputorch_getDeviceProperties},
   {"setDevice", gputorch_setDevice},
   {"seed", gputorch_seed},
+  {"seedAll", gputorch_seedAll},
   {"initialSeed", gputorch_initialSeed},
   {"manualSeed", gputorch_manualSeed},
+  {"manualSeedAll", gputorch_manualSeedAll},
+  {"getRNGState", gputorch_getRNGState},
+  {"setRNGState", gputorch_setRNGState},
+  {"referenceFill", gputorch_referenceFill},
+  {"setCacheLimit", gputorch_setCacheLimit},
+  {"getCacheLimit", gputorch_getCacheLimit},
+  {"trimCache", gputorch_trimCache},
+  {"getCachedBytes", gputorch_getCachedBytes},
+  {"getPinnedBytes", gputorch_getPinnedBytes},
+  {"getAllocatorStats", gputorch_getAllocatorStats},
+  {"resetAllocatorStats", gputorch_resetAllocatorStats},
+  {"setGemmTuning", gputorch_setGemmTuning},
+  {"getGemmTuning", gputorch_getGemmTuning},
+  {"setGemmCacheFile", gputorch_setGemmCacheFile},
+  {"getGemmCacheFile", gputorch_getGemmCacheFile},
+  {"resetGemmTuning", gputorch_resetGemmTuning},
+  {"setGemmKernel", gputorch_setGemmKernel},
+  {"getGemmKernel", gputorch_getGemmKernel},
+  {"gemmKernels", gputorch_gemmKernels},
   {NULL, NULL}
 };
 
@@ -88,7 +296,17 @@ int luaopen_libgputorch(lua_State *L)
   gputorch_GPUStorage_init(L);
   gputorch_GPUTensor_init(L);
   gputorch_GPUTensorMath_init(L);
+  gputorch_GPUEvent_init(L);
+  gputorch_GPUFusion_init(L);
 
+  THGPUState* state = (THGPUState*)lua_newuserdata(L, sizeof(THGPUState));
+  state->rngState = (THGPURNGState*)malloc(sizeof(THGPURNGState));
+  THCRandom_init(state->rngState, 1, 0);
+  lua_newtable(L);
+  lua_pushcfunction(L, gputorch_shutdown);
+  lua_setfield(L, -2, "__gc");
+  lua_setmetatable(L, -2);
+  lua_setfield(L, -2, "_state");
 
   return 1;
 }
@@ -9,5 +9,6 @@
 #include "THCTensorRandom.h"
 #include "THCTensorMath.h"
 #include "THCTensorConv.h"
+#include "THCFusion.h"
 
 #endif
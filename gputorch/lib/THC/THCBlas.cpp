@@ -1,16 +1,22 @@
 #include "THCBlas.h"
 #include "THCGeneral.h"
+#include "THCCachingAllocator.h"
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
 #define OFFSET(N, incX) ((incX) > 0 ? 0 : ((N) - 1) * (-(incX)))
 #define BLOCK_SIZE 256
 #define TILE_DIM   16
 #define THREADS    16
 #define GEMM_BLOCK 256
+#define GEMM_TK    16
 
 // Matrix Multiplication with  A and B matrices  not transposed
 static void gemm_NoTransAB(Concurrency::array_view<float, 1> &A, long aOffset,
                            Concurrency::array_view<float, 1> &B, long bOffset,
                            Concurrency::array_view<float, 1> &C, long cOffset,
-                           int M, int N, int K, int lda, int ldb, int ldc,
+                           int M, int N, int K, long lda, long ldb, long ldc,
                            float alpha, float beta)
 {
   // Make grid size in each dimension an exact multiple of threadblock size in the corresponding dimension
@@ -43,7 +49,7 @@ static void gemm_NoTransAB(Concurrency::array_view<float, 1> &A, long aOffset,
       tidx.barrier.wait();
 
       for (int n = 0; n < TILE_DIM; ++n)
-        CValue += Bs[tidx.local[0]][n] * As[n][tidx.local[1]] * alpha;
+        CValue += Bs[tidx.local[0]][n] * As[n][tidx.local[1]];
 
       tidx.barrier.wait();
     }
@@ -51,7 +57,7 @@ static void gemm_NoTransAB(Concurrency::array_view<float, 1> &A, long aOffset,
     if (Row < N && Col < M)
     {
       C[cOffset + (tidx.global[0] * M) + tidx.global[1]] *= beta;
-      C[cOffset + (tidx.global[0] * M) + tidx.global[1]] += CValue;
+      C[cOffset + (tidx.global[0] * M) + tidx.global[1]] += CValue * alpha;
     }
   });
 }
@@ -60,7 +66,7 @@ static void gemm_NoTransAB(Concurrency::array_view<float, 1> &A, long aOffset,
 static void gemm_NoTransB(Concurrency::array_view<float, 1> &A, long aOffset,
                           Concurrency::array_view<float, 1> &B, long bOffset,
                           Concurrency::array_view<float, 1> &C, long cOffset,
-                          int M, int N, int K, int lda, int ldb, int ldc,
+                          int M, int N, int K, long lda, long ldb, long ldc,
                           float alpha, float beta)
 {
   // If K is small then make use of threads and blocks across M and N dimension
@@ -174,7 +180,7 @@ static void gemm_NoTransB(Concurrency::array_view<float, 1> &A, long aOffset,
 static void gemm_NoTransA(Concurrency::array_view<float, 1> &A, long aOffset,
                           Concurrency::array_view<float, 1> &B, long bOffset,
                           Concurrency::array_view<float, 1> &C, long cOffset,
-                          int M, int N, int K, int lda, int ldb, int ldc,
+                          int M, int N, int K, long lda, long ldb, long ldc,
                           float alpha, float beta)
 {
   // Make grid size in each dimension an exact multiple of threadblock size in the corresponding dimension
@@ -245,6 +251,382 @@ static void gemm_TransAB(Concurrency::array_view<float, 1> &A, long aOffset,
   });
 }
 
+// Register-blocked Matrix Multiplication, for any transposition and leading
+// dimensions. A tile of (TS/WPT)^2 threads computes a TS x TS block of C, each
+// thread WPT x WPT elements kept in registers, TS/WPT rows (columns) apart so
+// that neighbouring threads read and write neighbouring elements. Slices of
+// GEMM_TK columns of op(A) and rows of op(B) go through tile_static memory,
+// double-buffered: slice s is loaded while slice s-1 is consumed, so a single
+// barrier per slice is needed.
+// The first dimension of the grid indexes nBatch products, matrix p of A
+// starting at aOffset + p * strideA (and likewise for B and C).
+template <int TS, int WPT, bool TRANSA, bool TRANSB>
+static void gemm_BlockedBatched(Concurrency::array_view<float, 1> &A, long aOffset, long strideA,
+                                Concurrency::array_view<float, 1> &B, long bOffset, long strideB,
+                                Concurrency::array_view<float, 1> &C, long cOffset, long strideC,
+                                int nBatch, int M, int N, int K, long lda, long ldb, long ldc,
+                                float alpha, float beta)
+{
+  const int T = TS / WPT;
+  // elements of a slice of A (or B) loaded by each thread
+  const int LOADS = GEMM_TK * TS / (T * T);
+  Concurrency::extent<3> grdExt(nBatch, (N + TS - 1) / TS * T, (M + TS - 1) / TS * T);
+  Concurrency::tiled_extent<1, T, T> t_ext(grdExt);
+
+  Concurrency::parallel_for_each(t_ext, [=] (Concurrency::tiled_index<1, T, T> tidx) restrict(amp)
+  {
+    tile_static float As[2][GEMM_TK][TS + 1];
+    tile_static float Bs[2][GEMM_TK][TS + 1];
+    float acc[WPT][WPT];
+    float a[WPT], b[WPT];
+    long aBase = aOffset + tidx.tile[0] * strideA;
+    long bBase = bOffset + tidx.tile[0] * strideB;
+    long cBase = cOffset + tidx.tile[0] * strideC;
+    int tc = tidx.local[1];
+    int tr = tidx.local[2];
+    int id = tc * T + tr;
+    int i0 = tidx.tile[2] * TS;
+    int j0 = tidx.tile[1] * TS;
+    int nSlice = (K + GEMM_TK - 1) / GEMM_TK;
+
+    for (int r = 0; r < WPT; r++)
+      for (int c = 0; c < WPT; c++)
+        acc[r][c] = 0;
+
+    for (int s = 0; s <= nSlice; s++)
+    {
+      // Load slice s, consecutive threads reading consecutive addresses
+      if (s < nSlice)
+      {
+        int k0 = s * GEMM_TK;
+        for (int x = 0; x < LOADS; x++)
+        {
+          int idx = id + x * T * T;
+          int i = (TRANSA ? idx / GEMM_TK : idx % TS);
+          int l = (TRANSA ? idx % GEMM_TK : idx / TS);
+          if (i0 + i < M && k0 + l < K)
+            As[s & 1][l][i] = A[aBase + (TRANSA ? k0 + l + (i0 + i) * lda : i0 + i + (k0 + l) * lda)];
+          else
+            As[s & 1][l][i] = 0;
+
+          int j = (TRANSB ? idx % TS : idx / GEMM_TK);
+          l = (TRANSB ? idx / TS : idx % GEMM_TK);
+          if (k0 + l < K && j0 + j < N)
+            Bs[s & 1][l][j] = B[bBase + (TRANSB ? j0 + j + (k0 + l) * ldb : k0 + l + (j0 + j) * ldb)];
+          else
+            Bs[s & 1][l][j] = 0;
+        }
+      }
+
+      // Multiply slice s-1
+      if (s > 0)
+      {
+        int cur = (s - 1) & 1;
+        for (int l = 0; l < GEMM_TK; l++)
+        {
+          for (int r = 0; r < WPT; r++)
+            a[r] = As[cur][l][tr + r * T];
+          for (int c = 0; c < WPT; c++)
+            b[c] = Bs[cur][l][tc + c * T];
+          for (int r = 0; r < WPT; r++)
+            for (int c = 0; c < WPT; c++)
+              acc[r][c] += a[r] * b[c];
+        }
+      }
+
+      tidx.barrier.wait();
+    }
+
+    for (int r = 0; r < WPT; r++)
+    {
+      for (int c = 0; c < WPT; c++)
+      {
+        int i = i0 + tr + r * T;
+        int j = j0 + tc + c * T;
+        if (i < M && j < N)
+        {
+          long idx = cBase + i + j * ldc;
+          C[idx] = alpha * acc[r][c] + (beta == 0 ? 0 : beta * C[idx]);
+        }
+      }
+    }
+  });
+}
+
+template <int TS, int WPT, bool TRANSA, bool TRANSB>
+static void gemm_Blocked(Concurrency::array_view<float, 1> &A, long aOffset,
+                         Concurrency::array_view<float, 1> &B, long bOffset,
+                         Concurrency::array_view<float, 1> &C, long cOffset,
+                         int M, int N, int K, long lda, long ldb, long ldc,
+                         float alpha, float beta)
+{
+  gemm_BlockedBatched<TS, WPT, TRANSA, TRANSB>(A, aOffset, 0, B, bOffset, 0, C, cOffset, 0,
+                                               1, M, N, K, lda, ldb, ldc, alpha, beta);
+}
+
+typedef void (*THGPUGemmKernel)(Concurrency::array_view<float, 1> &A, long aOffset,
+                                Concurrency::array_view<float, 1> &B, long bOffset,
+                                Concurrency::array_view<float, 1> &C, long cOffset,
+                                int M, int N, int K, long lda, long ldb, long ldc,
+                                float alpha, float beta);
+
+typedef void (*THGPUGemmBatchedKernel)(Concurrency::array_view<float, 1> &A, long aOffset, long strideA,
+                                       Concurrency::array_view<float, 1> &B, long bOffset, long strideB,
+                                       Concurrency::array_view<float, 1> &C, long cOffset, long strideC,
+                                       int nBatch, int M, int N, int K, long lda, long ldb, long ldc,
+                                       float alpha, float beta);
+
+// The kernels THGPUBlas_gemm chooses from, for the transpositions nn, nt, tn, tt
+typedef struct THGPUGemmConfig
+{
+  const char *name;
+  THGPUGemmKernel kernel[4];
+  THGPUGemmBatchedKernel batched[4];  // NULL if there is no batched version
+} THGPUGemmConfig;
+
+#define GEMM_BLOCKED(TS, WPT)                                                       \
+  {#TS "x" #TS "/" #WPT "x" #WPT,                                                   \
+   {gemm_Blocked<TS, WPT, false, false>, gemm_Blocked<TS, WPT, false, true>,        \
+    gemm_Blocked<TS, WPT, true, false>, gemm_Blocked<TS, WPT, true, true>},         \
+   {gemm_BlockedBatched<TS, WPT, false, false>, gemm_BlockedBatched<TS, WPT, false, true>, \
+    gemm_BlockedBatched<TS, WPT, true, false>, gemm_BlockedBatched<TS, WPT, true, true>}}
+
+static const THGPUGemmConfig gemmConfigs[] = {
+  // one element per thread, packed matrices only
+  {"16x16", {gemm_NoTransAB, gemm_NoTransA, gemm_NoTransB, gemm_TransAB}, {NULL, NULL, NULL, NULL}},
+  GEMM_BLOCKED(32, 2),
+  GEMM_BLOCKED(32, 4),
+  GEMM_BLOCKED(64, 4),
+  GEMM_BLOCKED(64, 8),
+};
+
+#define GEMM_N_CONFIG    ((int)(sizeof(gemmConfigs) / sizeof(gemmConfigs[0])))
+#define GEMM_PACKED_ONLY 0   // "16x16"
+#define GEMM_SMALL       1   // "32x32/2x2"
+#define GEMM_LARGE       3   // "64x64/4x4"
+// smaller products are not worth tuning
+#define GEMM_TUNE_MIN_OPS (64L * 64 * 64)
+#define GEMM_TUNE_RUNS    3
+
+typedef struct THGPUGemmShape
+{
+  char transA, transB;
+  long M, N, K;
+
+  bool operator<(const THGPUGemmShape &o) const
+  {
+    if (transA != o.transA) return transA < o.transA;
+    if (transB != o.transB) return transB < o.transB;
+    if (M != o.M) return M < o.M;
+    if (N != o.N) return N < o.N;
+    return K < o.K;
+  }
+} THGPUGemmShape;
+
+static std::map<THGPUGemmShape, int> gemmChoices;  // shape -> index in gemmConfigs
+static std::string gemmCacheFile;
+static bool gemmCacheLoaded = false;
+static bool gemmDefaultsRead = false;
+static int gemmTuning = 0;
+static int gemmForced = -1;                        // set by THGPUBlas_setGemmKernel
+// guards the state above: products may be issued from several host threads
+static std::mutex gemmMutex;
+
+static void gemm_readDefaults()
+{
+  const char *tuning = getenv("THGPU_GEMM_TUNING");
+  const char *file = getenv("THGPU_GEMM_CACHE");
+
+  if (gemmDefaultsRead)
+    return;
+  gemmDefaultsRead = true;
+  // opt-in: nothing is timed nor written unless asked for
+  gemmTuning = (tuning && strcmp(tuning, "0") != 0);
+  if (file)
+    gemmCacheFile = file;
+}
+
+static int gemm_findConfig(const char *name)
+{
+  for (int i = 0; i < GEMM_N_CONFIG; i++)
+    if (strcmp(gemmConfigs[i].name, name) == 0)
+      return i;
+  return -1;
+}
+
+// One line per tuned shape, "transA transB M N K kernel"; later lines win
+static void gemm_loadCache()
+{
+  char line[256], name[64];
+  THGPUGemmShape shape;
+  FILE *f;
+
+  gemmCacheLoaded = true;
+  if (gemmCacheFile.empty() || !(f = fopen(gemmCacheFile.c_str(), "r")))
+    return;
+  while (fgets(line, sizeof(line), f))
+  {
+    if (sscanf(line, " %c %c %ld %ld %ld %63s", &shape.transA, &shape.transB,
+               &shape.M, &shape.N, &shape.K, name) == 6)
+    {
+      int config = gemm_findConfig(name);
+      if (config >= 0)
+        gemmChoices[shape] = config;
+    }
+  }
+  fclose(f);
+}
+
+static void gemm_saveChoice(const THGPUGemmShape &shape, int config)
+{
+  FILE *f;
+
+  if (gemmCacheFile.empty() || !(f = fopen(gemmCacheFile.c_str(), "a")))
+    return;
+  fseek(f, 0, SEEK_END);
+  if (ftell(f) == 0)
+    fprintf(f, "# THGPUBlas_gemm kernels: transA transB M N K kernel\n");
+  fprintf(f, "%c %c %ld %ld %ld %s\n", shape.transA, shape.transB,
+          shape.M, shape.N, shape.K, gemmConfigs[config].name);
+  fclose(f);
+}
+
+// Times every kernel on a scratch output (so that C is written only once) and
+// returns the fastest. The first launch of each kernel, which may compile it,
+// is not timed.
+static int gemm_tune(int op, long M, long N, long K, float alpha,
+                     Concurrency::array_view<float, 1> &A, long aOffset, long lda,
+                     Concurrency::array_view<float, 1> &B, long bOffset, long ldb,
+                     bool packed)
+{
+  Concurrency::array_view<float, 1> *scratch = THGPUCachingAllocator_malloc(M * N);
+  double bestTime = 0;
+  int best = -1;
+
+  for (int i = 0; i < GEMM_N_CONFIG; i++)
+  {
+    THGPUGemmKernel kernel = gemmConfigs[i].kernel[op];
+
+    if (i == GEMM_PACKED_ONLY && !packed)
+      continue;
+    kernel(A, aOffset, B, bOffset, *scratch, 0, M, N, K, lda, ldb, M, alpha, 0);
+    THGPUSynchronize();
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (int run = 0; run < GEMM_TUNE_RUNS; run++)
+      kernel(A, aOffset, B, bOffset, *scratch, 0, M, N, K, lda, ldb, M, alpha, 0);
+    THGPUSynchronize();
+    double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (best < 0 || time < bestTime)
+    {
+      best = i;
+      bestTime = time;
+    }
+  }
+
+  THGPUCachingAllocator_free(scratch);
+  return best;
+}
+
+static int gemm_chooseConfig(int op, long M, long N, long K, float alpha,
+                             Concurrency::array_view<float, 1> &A, long aOffset, long lda,
+                             Concurrency::array_view<float, 1> &B, long bOffset, long ldb,
+                             long ldc, bool *chosen)
+{
+  THGPUGemmShape shape = {(op & 2 ? 't' : 'n'), (op & 1 ? 't' : 'n'), M, N, K};
+  bool packed = (lda == (op & 2 ? K : M) && ldb == (op & 1 ? N : K) && ldc == M);
+  std::map<THGPUGemmShape, int>::iterator it;
+  int config;
+  std::lock_guard<std::mutex> lock(gemmMutex);
+
+  *chosen = true;
+  gemm_readDefaults();
+  if (gemmForced >= 0 && (gemmForced != GEMM_PACKED_ONLY || packed))
+    return gemmForced;
+
+  if (!gemmCacheLoaded)
+    gemm_loadCache();
+  it = gemmChoices.find(shape);
+  if (it != gemmChoices.end() && (it->second != GEMM_PACKED_ONLY || packed))
+    return it->second;
+
+  if (gemmTuning && it == gemmChoices.end() && M * N * K >= GEMM_TUNE_MIN_OPS)
+  {
+    config = gemm_tune(op, M, N, K, alpha, A, aOffset, lda, B, bOffset, ldb, packed);
+    gemmChoices[shape] = config;
+    gemm_saveChoice(shape, config);
+    return config;
+  }
+  // Untuned shapes keep the 16x16 kernels used before tuning existed. Those
+  // read packed matrices only, the others go to the smallest blocked kernel.
+  *chosen = false;
+  return (packed ? GEMM_PACKED_ONLY : GEMM_SMALL);
+}
+
+void THGPUBlas_setGemmTuning(int enabled)
+{
+  std::lock_guard<std::mutex> lock(gemmMutex);
+  gemm_readDefaults();
+  gemmTuning = enabled;
+}
+
+int THGPUBlas_getGemmTuning(void)
+{
+  std::lock_guard<std::mutex> lock(gemmMutex);
+  gemm_readDefaults();
+  return gemmTuning;
+}
+
+void THGPUBlas_setGemmCacheFile(const char *path)
+{
+  std::lock_guard<std::mutex> lock(gemmMutex);
+  gemm_readDefaults();
+  gemmCacheFile = (path ? path : "");
+  gemmChoices.clear();
+  gemmCacheLoaded = false;
+}
+
+const char* THGPUBlas_getGemmCacheFile(void)
+{
+  std::lock_guard<std::mutex> lock(gemmMutex);
+  gemm_readDefaults();
+  return gemmCacheFile.c_str();
+}
+
+void THGPUBlas_resetGemmTuning(void)
+{
+  std::lock_guard<std::mutex> lock(gemmMutex);
+  gemmChoices.clear();
+  gemmCacheLoaded = true;
+}
+
+void THGPUBlas_setGemmKernel(const char *name)
+{
+  int config = (name ? gemm_findConfig(name) : -1);
+  THArgCheck(!name || config >= 0, 1, "unknown gemm kernel");
+  std::lock_guard<std::mutex> lock(gemmMutex);
+  gemmForced = config;
+}
+
+const char* THGPUBlas_getGemmKernel(char transa, char transb, long m, long n, long k)
+{
+  THGPUGemmShape shape = {(transa == 'n' ? 'n' : 't'), (transb == 'n' ? 'n' : 't'), m, n, k};
+  std::map<THGPUGemmShape, int>::iterator it;
+  std::lock_guard<std::mutex> lock(gemmMutex);
+
+  gemm_readDefaults();
+  if (!gemmCacheLoaded)
+    gemm_loadCache();
+  it = gemmChoices.find(shape);
+  return (it == gemmChoices.end() ? NULL : gemmConfigs[it->second].name);
+}
+
+const char* THGPUBlas_gemmKernelName(int i)
+{
+  return (i >= 0 && i < GEMM_N_CONFIG ? gemmConfigs[i].name : NULL);
+}
+
 // API used in torch to invoke AMP gemm operation
 void THGPUBlas_gemm(char TransA, char TransB, const long M, const long N, const long K, const float alpha,
              Concurrency::array_view<float> &A_mat, long aOffset, long lda,
@@ -263,28 +645,53 @@ void THGPUBlas_gemm(char TransA, char TransB, const long M, const long N, const
     {
       for (j = 0; j < N; ++j)
         for (i = 0; i < M; ++i)
-          C_mat[i + j * ldc] = 0;
+          C_mat[cOffset + i + j * ldc] = 0;
     }
     else
     {
       for (j = 0; j < N; ++j)
         for (i = 0; i < M; ++i)
-          C_mat[i + j * ldc] *= beta;
+          C_mat[cOffset + i + j * ldc] *= beta;
     }
     return ;
   }
 
-  if (TransB == 'n')
+  int op = 2 * (TransA != 'n') + (TransB != 'n');
+  bool chosen;
+  int config = gemm_chooseConfig(op, M, N, K, alpha, A_mat, aOffset, lda, B_mat, bOffset, ldb, ldc, &chosen);
+  gemmConfigs[config].kernel[op](A_mat, aOffset, B_mat, bOffset, C_mat, cOffset, M, N, K, lda, ldb, ldc, alpha, beta);
+}
+
+// nBatch products in a single launch when the kernel tuned, cached or forced
+// for one product of that shape has a batched version. Otherwise, and for
+// untuned shapes, one THGPUBlas_gemm per product.
+void THGPUBlas_gemmBatched(char TransA, char TransB, long nBatch, const long M, const long N, const long K, const float alpha,
+                           Concurrency::array_view<float> &A_mat, long aOffset, long lda, long strideA,
+                           Concurrency::array_view<float> &B_mat, long bOffset, long ldb, long strideB, const float beta,
+                           Concurrency::array_view<float> &C_mat, long cOffset, long ldc, long strideC)
+{
+  int op = 2 * (TransA != 'n') + (TransB != 'n');
+  int config;
+  bool chosen;
+  long p;
+
+  if (!nBatch || !M || !N)
+    return;
+
+  if (nBatch > 1)
   {
-    if (TransA == 'n')
-      gemm_NoTransAB(A_mat, aOffset, B_mat, bOffset, C_mat, cOffset, M, N, K, lda, ldb, ldc, alpha, beta);
-    else
-      gemm_NoTransB(A_mat, aOffset, B_mat, bOffset, C_mat, cOffset, M, N, K, lda, ldb, ldc, alpha, beta);
+    config = gemm_chooseConfig(op, M, N, K, alpha, A_mat, aOffset, lda, B_mat, bOffset, ldb, ldc, &chosen);
+    if (chosen && gemmConfigs[config].batched[op])
+    {
+      gemmConfigs[config].batched[op](A_mat, aOffset, strideA, B_mat, bOffset, strideB, C_mat, cOffset, strideC,
+                                      nBatch, M, N, K, lda, ldb, ldc, alpha, beta);
+      return;
+    }
   }
-  else if (TransA == 'n')
-    gemm_NoTransA(A_mat, aOffset, B_mat, bOffset, C_mat, cOffset, M, N, K, lda, ldb, ldc, alpha, beta);
-  else
-    gemm_TransAB(A_mat, aOffset, B_mat, bOffset, C_mat, cOffset, M, N, K, lda, ldb, ldc, alpha, beta);
+
+  for (p = 0; p < nBatch; p++)
+    THGPUBlas_gemm(TransA, TransB, M, N, K, alpha, A_mat, aOffset + p * strideA, lda,
+                   B_mat, bOffset + p * strideB, ldb, beta, C_mat, cOffset + p * strideC, ldc);
 }
 
 // Matrix Vector Multiplication where the Matrix A is transposed
@@ -38,6 +38,35 @@ void THGPUBlas_gemm(char transa, char transb,
                         Concurrency::array_view<float> &b, long bOffset, long ldb, const float beta,
                         Concurrency::array_view<float> &c, long cOffset, long ldc);
 
+// nBatch products c[p] = alpha op(a[p]) op(b[p]) + beta c[p], in one launch
+// when the shape has a tuned, cached or forced kernel; matrix p of a starts at aOffset + p * strideA (likewise for b and c)
+void THGPUBlas_gemmBatched(char transa, char transb, long nBatch,
+                        const long m, const long n, const long k, const float alpha,
+                        Concurrency::array_view<float> &a, long aOffset, long lda, long strideA,
+                        Concurrency::array_view<float> &b, long bOffset, long ldb, long strideB, const float beta,
+                        Concurrency::array_view<float> &c, long cOffset, long ldc, long strideC);
+
+// THGPUBlas_gemm runs one of several kernels, chosen per (transa, transb, m, n, k).
+// Shapes without a choice run the 16x16 kernels (packed matrices) or 32x32/2x2.
+// Tuning is off unless THGPU_GEMM_TUNING=1 or THGPUBlas_setGemmTuning(1): while
+// it is on, the first product of a shape times every kernel and keeps the
+// fastest. The choices are appended to the cache file, if any (THGPU_GEMM_CACHE
+// or THGPUBlas_setGemmCacheFile), which later runs read back, tuning or not.
+THC_API void THGPUBlas_setGemmTuning(int enabled);
+THC_API int THGPUBlas_getGemmTuning(void);
+// NULL or "" keeps the choices in memory only; the choices of the new file
+// replace those in memory
+THC_API void THGPUBlas_setGemmCacheFile(const char *path);
+THC_API const char* THGPUBlas_getGemmCacheFile(void);
+// Forgets every choice, the cache file is left as it is
+THC_API void THGPUBlas_resetGemmTuning(void);
+// Runs kernel 'name' for every product it supports; NULL goes back to the choices
+THC_API void THGPUBlas_setGemmKernel(const char *name);
+// Kernel chosen for a shape, NULL if there is none yet
+THC_API const char* THGPUBlas_getGemmKernel(char transa, char transb, long m, long n, long k);
+// Name of the i-th kernel, NULL past the last one
+THC_API const char* THGPUBlas_gemmKernelName(int i);
+
 void THGPUBlas_axpy(long n, float a,
                         Concurrency::array_view<float> &x, long xOffset, long incx,
                         Concurrency::array_view<float> &y, long yOffset, long incy);
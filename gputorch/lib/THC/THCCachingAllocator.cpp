@@ -0,0 +1,175 @@
+#include "THCCachingAllocator.h"
+#include <map>
+#include <mutex>
+#include <vector>
+
+// Sizes (in floats) up to THGPU_CACHE_POW2_LIMIT are rounded to the next
+// power of two, larger ones to a multiple of THGPU_CACHE_LARGE_ROUND.
+#define THGPU_CACHE_MIN_SIZE 128L
+#define THGPU_CACHE_POW2_LIMIT (1L << 20)
+#define THGPU_CACHE_LARGE_ROUND (1L << 18)
+#define THGPU_CACHE_DEFAULT_LIMIT (1024L * 1024L * 1024L)
+
+typedef Concurrency::array_view<float, 1> THGPUBuffer;
+
+static std::map<long, std::vector<THGPUBuffer*> > freeBuffers;  // capacity -> cached buffers
+static std::map<THGPUBuffer*, long> liveBuffers;                 // buffer -> capacity
+static long cacheLimit = THGPU_CACHE_DEFAULT_LIMIT;
+static THGPUCachingAllocatorStats stats = {0, 0, 0, 0, 0, 0};
+// Storages may be created and freed from several host threads
+static std::mutex cacheMutex;
+
+static long THGPUCachingAllocator_roundSize(long size)
+{
+  if (size <= THGPU_CACHE_MIN_SIZE)
+    return THGPU_CACHE_MIN_SIZE;
+
+  if (size <= THGPU_CACHE_POW2_LIMIT)
+  {
+    long rounded = THGPU_CACHE_MIN_SIZE;
+    while (rounded < size)
+      rounded <<= 1;
+    return rounded;
+  }
+
+  return ((size + THGPU_CACHE_LARGE_ROUND - 1) / THGPU_CACHE_LARGE_ROUND) * THGPU_CACHE_LARGE_ROUND;
+}
+
+static void THGPUCachingAllocator_release(THGPUBuffer *av, long capacity)
+{
+  delete av;
+  stats.nDeviceFrees++;
+  stats.cachedBytes -= capacity * sizeof(float);
+}
+
+// THGPUCachingAllocator_trim, with cacheMutex already held
+static void THGPUCachingAllocator_trimLocked(long bytes)
+{
+  std::map<long, std::vector<THGPUBuffer*> >::reverse_iterator it = freeBuffers.rbegin();
+  while (stats.cachedBytes > bytes && it != freeBuffers.rend())
+  {
+    while (stats.cachedBytes > bytes && !it->second.empty())
+    {
+      THGPUCachingAllocator_release(it->second.back(), it->first);
+      it->second.pop_back();
+    }
+    ++it;
+  }
+}
+
+Concurrency::array_view<float, 1>* THGPUCachingAllocator_malloc(long size)
+{
+  long capacity = THGPUCachingAllocator_roundSize(size);
+  THGPUBuffer *av = NULL;
+  std::lock_guard<std::mutex> lock(cacheMutex);
+
+  std::map<long, std::vector<THGPUBuffer*> >::iterator it = freeBuffers.find(capacity);
+  if (it != freeBuffers.end() && !it->second.empty())
+  {
+    av = it->second.back();
+    it->second.pop_back();
+    stats.cachedBytes -= capacity * sizeof(float);
+    stats.nCacheHits++;
+  }
+  else
+  {
+    stats.nCacheMisses++;
+    try
+    {
+      av = new THGPUBuffer(Concurrency::extent<1>(capacity));
+    }
+    catch (...)
+    {
+      // Out of device memory: give the cached buffers back and retry once
+      THGPUCachingAllocator_trimLocked(0);
+      av = new THGPUBuffer(Concurrency::extent<1>(capacity));
+    }
+    stats.nDeviceAllocs++;
+  }
+
+  liveBuffers[av] = capacity;
+  stats.allocatedBytes += capacity * sizeof(float);
+  return av;
+}
+
+void THGPUCachingAllocator_free(Concurrency::array_view<float, 1>* av)
+{
+  if (!av)
+    return;
+
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  std::map<THGPUBuffer*, long>::iterator it = liveBuffers.find(av);
+  if (it == liveBuffers.end())
+  {
+    delete av;
+    return;
+  }
+
+  long capacity = it->second;
+  long bytes = capacity * sizeof(float);
+  liveBuffers.erase(it);
+  stats.allocatedBytes -= bytes;
+
+  if (cacheLimit >= 0)
+  {
+    if (bytes > cacheLimit)
+    {
+      delete av;
+      stats.nDeviceFrees++;
+      return;
+    }
+    if (stats.cachedBytes + bytes > cacheLimit)
+      THGPUCachingAllocator_trimLocked(cacheLimit - bytes);
+  }
+
+  freeBuffers[capacity].push_back(av);
+  stats.cachedBytes += bytes;
+}
+
+long THGPUCachingAllocator_capacity(Concurrency::array_view<float, 1>* av)
+{
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  std::map<THGPUBuffer*, long>::iterator it = liveBuffers.find(av);
+  return (it == liveBuffers.end()) ? 0 : it->second;
+}
+
+void THGPUCachingAllocator_setLimit(long bytes)
+{
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  cacheLimit = bytes;
+  if (cacheLimit >= 0)
+    THGPUCachingAllocator_trimLocked(cacheLimit);
+}
+
+long THGPUCachingAllocator_getLimit(void)
+{
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  return cacheLimit;
+}
+
+void THGPUCachingAllocator_trim(long bytes)
+{
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  THGPUCachingAllocator_trimLocked(bytes);
+}
+
+long THGPUCachingAllocator_cachedBytes(void)
+{
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  return stats.cachedBytes;
+}
+
+void THGPUCachingAllocator_getStats(THGPUCachingAllocatorStats *stats_)
+{
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  *stats_ = stats;
+}
+
+void THGPUCachingAllocator_resetStats(void)
+{
+  std::lock_guard<std::mutex> lock(cacheMutex);
+  stats.nDeviceAllocs = 0;
+  stats.nDeviceFrees = 0;
+  stats.nCacheHits = 0;
+  stats.nCacheMisses = 0;
+}
@@ -0,0 +1,38 @@
+#ifndef THC_CACHING_ALLOCATOR_INC
+#define THC_CACHING_ALLOCATOR_INC
+
+#include "THCGeneral.h"
+#include "amp.h"
+
+// Device buffers released by THGPUStorage are kept in size buckets and handed
+// out again to later requests of the same bucket, instead of going back to
+// the runtime. A buffer may therefore be larger than the storage using it.
+
+typedef struct THGPUCachingAllocatorStats
+{
+  long nDeviceAllocs;   // buffers created through the runtime
+  long nDeviceFrees;    // buffers released to the runtime
+  long nCacheHits;      // requests served from the cache
+  long nCacheMisses;    // requests that needed a new buffer
+  long allocatedBytes;  // bytes held by live buffers
+  long cachedBytes;     // bytes held by cached (free) buffers
+} THGPUCachingAllocatorStats;
+
+// Returns a device buffer of at least 'size' floats.
+Concurrency::array_view<float, 1>* THGPUCachingAllocator_malloc(long size);
+// Returns 'av' to the cache. Buffers not created by THGPUCachingAllocator_malloc
+// (e.g. those wrapping host memory) are deleted.
+void THGPUCachingAllocator_free(Concurrency::array_view<float, 1>* av);
+// Number of floats usable in a buffer returned by THGPUCachingAllocator_malloc
+long THGPUCachingAllocator_capacity(Concurrency::array_view<float, 1>* av);
+
+// Cached bytes never exceed the limit; a negative limit disables it.
+THC_API void THGPUCachingAllocator_setLimit(long bytes);
+THC_API long THGPUCachingAllocator_getLimit(void);
+// Releases cached buffers, largest first, until at most 'bytes' are cached.
+THC_API void THGPUCachingAllocator_trim(long bytes);
+THC_API long THGPUCachingAllocator_cachedBytes(void);
+THC_API void THGPUCachingAllocator_getStats(THGPUCachingAllocatorStats *stats);
+THC_API void THGPUCachingAllocator_resetStats(void);
+
+#endif
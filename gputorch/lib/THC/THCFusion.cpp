@@ -0,0 +1,559 @@
+#include "THCFusion.h"
+#include "THCBolt.h"
+#include "THCTensorCopy.h"
+#include "copyHelpers.h"
+#include <math.h>
+#include <vector>
+
+// A fused group reads at most THGPU_FUSION_MAX_INPUTS tensors, writes at most
+// THGPU_FUSION_MAX_OUTPUTS and keeps every value it loads or computes in one
+// of THGPU_FUSION_MAX_REGS registers. Larger DAGs are split into several
+// groups, the values crossing a group boundary going through temporaries.
+#define THGPU_FUSION_MAX_INPUTS 8
+#define THGPU_FUSION_MAX_OUTPUTS 4
+#define THGPU_FUSION_MAX_REGS 32
+
+#ifndef DIVUP
+#define DIVUP(x, y) (((x) + (y) - 1) / (y))
+#endif
+
+typedef struct THGPUFusionNode
+{
+  THGPUFusionOp op;
+  int x, y;
+  float value1, value2;
+  THGPUTensor *tensor;  // inputs only
+} THGPUFusionNode;
+
+typedef struct THGPUFusionOutput
+{
+  int node;
+  THGPUTensor *tensor;
+} THGPUFusionOutput;
+
+typedef struct THGPUFusionGroup
+{
+  int begin, end;             // nodes [begin, end)
+  std::vector<int> externals; // nodes computed before the group, read by it
+} THGPUFusionGroup;
+
+struct THGPUFusion
+{
+  std::vector<THGPUFusionNode> nodes;
+  std::vector<THGPUFusionOutput> outputs;
+  long nElement;
+  int nGroups;
+};
+
+static int THGPUFusion_arity(THGPUFusionOp op)
+{
+  if (op == THGPU_FUSION_INPUT)
+    return 0;
+  return (op >= THGPU_FUSION_ADD) ? 2 : 1;
+}
+
+THGPUFusion* THGPUFusion_new(void)
+{
+  THGPUFusion *self = new THGPUFusion;
+  self->nElement = -1;
+  self->nGroups = 0;
+  return self;
+}
+
+void THGPUFusion_free(THGPUFusion *self)
+{
+  for (size_t i = 0; i < self->nodes.size(); i++)
+  {
+    if (self->nodes[i].tensor)
+      THGPUTensor_free(self->nodes[i].tensor);
+  }
+  for (size_t i = 0; i < self->outputs.size(); i++)
+    THGPUTensor_free(self->outputs[i].tensor);
+  delete self;
+}
+
+static void THGPUFusion_checkSize(THGPUFusion *self, THGPUTensor *tensor, int arg)
+{
+  long nElement = THGPUTensor_nElement(tensor);
+  THArgCheck(self->nElement < 0 || self->nElement == nElement, arg, "number of elements does not match the other tensors of the expression");
+  self->nElement = nElement;
+}
+
+static int THGPUFusion_push(THGPUFusion *self, THGPUFusionOp op, int x, int y, float value1, float value2, THGPUTensor *tensor)
+{
+  THGPUFusionNode node = {op, x, y, value1, value2, tensor};
+  self->nodes.push_back(node);
+  return (int)self->nodes.size() - 1;
+}
+
+int THGPUFusion_input(THGPUFusion *self, THGPUTensor *tensor)
+{
+  THGPUFusion_checkSize(self, tensor, 2);
+  THGPUTensor_retain(tensor);
+  return THGPUFusion_push(self, THGPU_FUSION_INPUT, -1, -1, 0, 0, tensor);
+}
+
+int THGPUFusion_unary(THGPUFusion *self, THGPUFusionOp op, int x, float value1, float value2)
+{
+  THArgCheck(THGPUFusion_arity(op) == 1, 2, "not a unary operation");
+  THArgCheck(x >= 0 && x < (int)self->nodes.size(), 3, "invalid node");
+  return THGPUFusion_push(self, op, x, -1, value1, value2, NULL);
+}
+
+int THGPUFusion_binary(THGPUFusion *self, THGPUFusionOp op, int x, int y)
+{
+  THArgCheck(THGPUFusion_arity(op) == 2, 2, "not a binary operation");
+  THArgCheck(x >= 0 && x < (int)self->nodes.size(), 3, "invalid node");
+  THArgCheck(y >= 0 && y < (int)self->nodes.size(), 4, "invalid node");
+  return THGPUFusion_push(self, op, x, y, 0, 0, NULL);
+}
+
+void THGPUFusion_output(THGPUFusion *self, int node, THGPUTensor *tensor)
+{
+  THArgCheck(node >= 0 && node < (int)self->nodes.size(), 2, "invalid node");
+  THGPUFusion_checkSize(self, tensor, 3);
+  THGPUTensor_retain(tensor);
+  THGPUFusionOutput output = {node, tensor};
+  self->outputs.push_back(output);
+}
+
+int THGPUFusion_nOutputs(THGPUFusion *self)
+{
+  return (int)self->outputs.size();
+}
+
+int THGPUFusion_nGroups(THGPUFusion *self)
+{
+  return self->nGroups;
+}
+
+/* Device evaluation */
+
+static inline float THGPUFusion_apply(int op, float x, float y, float value1, float value2) restrict(amp)
+{
+  switch (op)
+  {
+    case THGPU_FUSION_ADDVALUE: return addvalue_functor(value1)(x);
+    case THGPU_FUSION_MULVALUE: return mulvalue_functor(value1)(x);
+    case THGPU_FUSION_DIVVALUE: return divvalue_functor(value1)(x);
+    case THGPU_FUSION_POW: return pow_functor(value1)(x);
+    case THGPU_FUSION_CLAMP: return clamp_functor(value1, value2)(x);
+    case THGPU_FUSION_LOG: return Concurrency::fast_math::log(x);
+    case THGPU_FUSION_LOG1P: return Concurrency::precise_math::log1p(x);
+    case THGPU_FUSION_EXP: return Concurrency::fast_math::exp(x);
+    case THGPU_FUSION_COS: return Concurrency::fast_math::cos(x);
+    case THGPU_FUSION_ACOS: return Concurrency::fast_math::acos(x);
+    case THGPU_FUSION_COSH: return Concurrency::fast_math::cosh(x);
+    case THGPU_FUSION_SIN: return Concurrency::fast_math::sin(x);
+    case THGPU_FUSION_ASIN: return Concurrency::fast_math::asin(x);
+    case THGPU_FUSION_SINH: return Concurrency::fast_math::sinh(x);
+    case THGPU_FUSION_TAN: return Concurrency::fast_math::tan(x);
+    case THGPU_FUSION_ATAN: return Concurrency::fast_math::atan(x);
+    case THGPU_FUSION_TANH: return Concurrency::fast_math::tanh(x);
+    case THGPU_FUSION_SQRT: return Concurrency::fast_math::sqrt(x);
+    case THGPU_FUSION_CEIL: return Concurrency::fast_math::ceil(x);
+    case THGPU_FUSION_FLOOR: return Concurrency::fast_math::floor(x);
+    case THGPU_FUSION_ABS: return Concurrency::fast_math::fabs(x);
+    case THGPU_FUSION_ROUND: return Concurrency::fast_math::roundf(x);
+    case THGPU_FUSION_SIGN: return sign_functor()(x);
+    case THGPU_FUSION_SIGMOID: return 1.0f / (1.0f + Concurrency::fast_math::exp(-x));
+    case THGPU_FUSION_ADD: return x + y;
+    case THGPU_FUSION_SUB: return x - y;
+    case THGPU_FUSION_MUL: return x * y;
+    case THGPU_FUSION_DIV: return x / y;
+    case THGPU_FUSION_ATAN2: return atan2_functor()(x, y);
+    case THGPU_FUSION_MAX: return x > y ? x : y;
+    case THGPU_FUSION_MIN: return x < y ? x : y;
+  }
+  return 0;
+}
+
+template <typename T>
+static Concurrency::array_view<T, 1>* THGPUFusion_upload(const std::vector<T> &host)
+{
+  Concurrency::array_view<T, 1> *av = new Concurrency::array_view<T, 1>(Concurrency::extent<1>(host.size()));
+  T* av_ptr = static_cast<T*>(Concurrency::getAllocator().device_data(av->data()));
+  THGPUCheck(gpuMemcpy(av_ptr, 0, (void*)&host[0], 0, host.size() * sizeof(T), gpuMemcpyHostToDevice));
+  av->discard_data();
+  return av;
+}
+
+// Runs the program of one group: instruction k writes register k. The first
+// instructions load the inputs (operand x is the input slot), the stores then
+// write register store[2*s] to output slot store[2*s+1].
+static void THGPUFusion_kernel(THGPUTensor **inputs, int nInputs, THGPUTensor **outputs, int nOutputs,
+                               Concurrency::array_view<int, 1> &av_prog,
+                               Concurrency::array_view<float, 1> &av_values, int nInstr,
+                               Concurrency::array_view<int, 1> &av_store, int nStores,
+                               Concurrency::array_view<long, 1> &av_offset, long n)
+{
+  Concurrency::array_view<float, 1> in0 = inputs[0]->get_array_view();
+  Concurrency::array_view<float, 1> in1 = (nInputs > 1) ? inputs[1]->get_array_view() : in0;
+  Concurrency::array_view<float, 1> in2 = (nInputs > 2) ? inputs[2]->get_array_view() : in0;
+  Concurrency::array_view<float, 1> in3 = (nInputs > 3) ? inputs[3]->get_array_view() : in0;
+  Concurrency::array_view<float, 1> in4 = (nInputs > 4) ? inputs[4]->get_array_view() : in0;
+  Concurrency::array_view<float, 1> in5 = (nInputs > 5) ? inputs[5]->get_array_view() : in0;
+  Concurrency::array_view<float, 1> in6 = (nInputs > 6) ? inputs[6]->get_array_view() : in0;
+  Concurrency::array_view<float, 1> in7 = (nInputs > 7) ? inputs[7]->get_array_view() : in0;
+  Concurrency::array_view<float, 1> out0 = outputs[0]->get_array_view();
+  Concurrency::array_view<float, 1> out1 = (nOutputs > 1) ? outputs[1]->get_array_view() : out0;
+  Concurrency::array_view<float, 1> out2 = (nOutputs > 2) ? outputs[2]->get_array_view() : out0;
+  Concurrency::array_view<float, 1> out3 = (nOutputs > 3) ? outputs[3]->get_array_view() : out0;
+
+  Concurrency::extent<1> fuseExt(DIVUP(n, 256) * 256);
+  Concurrency::tiled_extent<256> t_ext(fuseExt);
+
+  Concurrency::parallel_for_each(t_ext, [=] (Concurrency::tiled_index<256> tidx) restrict(amp)
+  {
+    long i = tidx.global[0];
+    if (i >= n)
+      return;
+
+    float reg[THGPU_FUSION_MAX_REGS];
+    for (int k = 0; k < nInstr; k++)
+    {
+      int op = av_prog[Concurrency::index<1>(3*k)];
+      int x = av_prog[Concurrency::index<1>(3*k+1)];
+      int y = av_prog[Concurrency::index<1>(3*k+2)];
+
+      if (op == THGPU_FUSION_INPUT)
+      {
+        long idx = av_offset[Concurrency::index<1>(x)] + i;
+        switch (x)
+        {
+          case 0: reg[k] = in0[Concurrency::index<1>(idx)]; break;
+          case 1: reg[k] = in1[Concurrency::index<1>(idx)]; break;
+          case 2: reg[k] = in2[Concurrency::index<1>(idx)]; break;
+          case 3: reg[k] = in3[Concurrency::index<1>(idx)]; break;
+          case 4: reg[k] = in4[Concurrency::index<1>(idx)]; break;
+          case 5: reg[k] = in5[Concurrency::index<1>(idx)]; break;
+          case 6: reg[k] = in6[Concurrency::index<1>(idx)]; break;
+          default: reg[k] = in7[Concurrency::index<1>(idx)]; break;
+        }
+      }
+      else
+      {
+        reg[k] = THGPUFusion_apply(op, reg[x], reg[y],
+                                   av_values[Concurrency::index<1>(2*k)],
+                                   av_values[Concurrency::index<1>(2*k+1)]);
+      }
+    }
+
+    for (int s = 0; s < nStores; s++)
+    {
+      float v = reg[av_store[Concurrency::index<1>(2*s)]];
+      int slot = av_store[Concurrency::index<1>(2*s+1)];
+      long idx = av_offset[Concurrency::index<1>(THGPU_FUSION_MAX_INPUTS + slot)] + i;
+      switch (slot)
+      {
+        case 0: out0[Concurrency::index<1>(idx)] = v; break;
+        case 1: out1[Concurrency::index<1>(idx)] = v; break;
+        case 2: out2[Concurrency::index<1>(idx)] = v; break;
+        default: out3[Concurrency::index<1>(idx)] = v; break;
+      }
+    }
+  });
+}
+
+// An output can be written by the kernels directly unless an input shares its
+// storage: elementwise reads and writes of the very same elements are fine
+// within one kernel, anything else could overwrite values still to be read.
+static int THGPUFusion_isSafeOutput(THGPUFusion *self, THGPUTensor *tensor, int nGroups)
+{
+  if (!THGPUTensor_isContiguous(tensor))
+    return 0;
+
+  for (size_t i = 0; i < self->nodes.size(); i++)
+  {
+    THGPUTensor *input = self->nodes[i].tensor;
+    if (input && input->storage == tensor->storage &&
+        (nGroups > 1 || input->storageOffset != tensor->storageOffset || !THGPUTensor_isContiguous(input)))
+      return 0;
+  }
+  return 1;
+}
+
+static int THGPUFusion_isInternal(THGPUFusion *self, int node, int begin, int end)
+{
+  return node >= begin && node < end && self->nodes[node].op != THGPU_FUSION_INPUT;
+}
+
+static void THGPUFusion_addExternal(std::vector<int> &externals, int node)
+{
+  for (size_t i = 0; i < externals.size(); i++)
+  {
+    if (externals[i] == node)
+      return;
+  }
+  externals.push_back(node);
+}
+
+// Splits the nodes into groups, in order, each as large as the limits allow.
+// 'needed' marks the nodes some output depends on.
+static void THGPUFusion_split(THGPUFusion *self, const std::vector<char> &needed,
+                              const std::vector<int> &lastUse, const std::vector<int> &outputOf,
+                              std::vector<THGPUFusionGroup> &groups)
+{
+  int nNodes = (int)self->nodes.size();
+  int begin = 0;
+
+  while (begin < nNodes)
+  {
+    if (self->nodes[begin].op == THGPU_FUSION_INPUT || !needed[begin])
+    {
+      begin++;
+      continue;
+    }
+
+    THGPUFusionGroup group;
+    int nInternal = 0;
+    int end;
+    group.begin = begin;
+
+    for (end = begin; end < nNodes; end++)
+    {
+      const THGPUFusionNode &node = self->nodes[end];
+      if (node.op == THGPU_FUSION_INPUT || !needed[end])
+        continue;
+
+      std::vector<int> externals = group.externals;
+      if (!THGPUFusion_isInternal(self, node.x, begin, end))
+        THGPUFusion_addExternal(externals, node.x);
+      if (THGPUFusion_arity(node.op) == 2 && !THGPUFusion_isInternal(self, node.y, begin, end))
+        THGPUFusion_addExternal(externals, node.y);
+
+      int nLiveOut = 0;
+      for (int j = begin; j <= end; j++)
+      {
+        if (THGPUFusion_isInternal(self, j, begin, end + 1) && needed[j] && (lastUse[j] > end || outputOf[j] >= 0))
+          nLiveOut++;
+      }
+
+      if (nInternal > 0 && ((int)externals.size() > THGPU_FUSION_MAX_INPUTS ||
+                            (int)externals.size() + nInternal + 1 > THGPU_FUSION_MAX_REGS ||
+                            nLiveOut > THGPU_FUSION_MAX_OUTPUTS))
+        break;
+
+      group.externals = externals;
+      nInternal++;
+    }
+
+    group.end = end;
+    groups.push_back(group);
+    begin = end;
+  }
+}
+
+void THGPUFusion_run(THGPUFusion *self)
+{
+  int nNodes = (int)self->nodes.size();
+  long n = self->nElement;
+  self->nGroups = 0;
+  if (self->outputs.empty() || n == 0)
+    return;
+
+  std::vector<char> needed(nNodes, 0);
+  std::vector<int> lastUse(nNodes, -1);
+  std::vector<int> outputOf(nNodes, -1);
+  for (int k = (int)self->outputs.size() - 1; k >= 0; k--)
+  {
+    needed[self->outputs[k].node] = 1;
+    outputOf[self->outputs[k].node] = k;
+  }
+  for (int i = nNodes - 1; i >= 0; i--)
+  {
+    const THGPUFusionNode &node = self->nodes[i];
+    if (!needed[i] || node.op == THGPU_FUSION_INPUT)
+      continue;
+    needed[node.x] = 1;
+    if (lastUse[node.x] < 0)
+      lastUse[node.x] = i;
+    if (THGPUFusion_arity(node.op) == 2)
+    {
+      needed[node.y] = 1;
+      if (lastUse[node.y] < 0)
+        lastUse[node.y] = i;
+    }
+  }
+
+  std::vector<THGPUFusionGroup> groups;
+  THGPUFusion_split(self, needed, lastUse, outputOf, groups);
+
+  // Contiguous device tensor holding the value of every evaluated node
+  std::vector<THGPUTensor*> value(nNodes, (THGPUTensor*)NULL);
+  for (int i = 0; i < nNodes; i++)
+  {
+    if (self->nodes[i].op == THGPU_FUSION_INPUT && needed[i])
+      value[i] = THGPUTensor_newContiguous(self->nodes[i].tensor);
+  }
+
+  for (size_t g = 0; g < groups.size(); g++)
+  {
+    const THGPUFusionGroup &group = groups[g];
+    std::vector<int> reg(nNodes, -1);
+    std::vector<int> prog;
+    std::vector<float> values;
+    std::vector<int> store;
+    std::vector<long> offset(THGPU_FUSION_MAX_INPUTS + THGPU_FUSION_MAX_OUTPUTS, 0);
+    THGPUTensor *inputs[THGPU_FUSION_MAX_INPUTS];
+    THGPUTensor *outputs[THGPU_FUSION_MAX_OUTPUTS];
+    int nInputs = (int)group.externals.size();
+    int nOutputs = 0;
+
+    for (int k = 0; k < nInputs; k++)
+    {
+      int node = group.externals[k];
+      inputs[k] = value[node];
+      offset[k] = value[node]->storageOffset;
+      reg[node] = (int)prog.size() / 3;
+      prog.push_back(THGPU_FUSION_INPUT);
+      prog.push_back(k);
+      prog.push_back(0);
+      values.push_back(0);
+      values.push_back(0);
+    }
+
+    for (int i = group.begin; i < group.end; i++)
+    {
+      const THGPUFusionNode &node = self->nodes[i];
+      if (node.op == THGPU_FUSION_INPUT || !needed[i])
+        continue;
+
+      reg[i] = (int)prog.size() / 3;
+      prog.push_back(node.op);
+      prog.push_back(reg[node.x]);
+      prog.push_back(THGPUFusion_arity(node.op) == 2 ? reg[node.y] : 0);
+      values.push_back(node.value1);
+      values.push_back(node.value2);
+
+      if (lastUse[i] >= group.end || outputOf[i] >= 0)
+      {
+        // Write straight into the output when it is safe, else into a temporary
+        THGPUTensor *dst = NULL;
+        if (outputOf[i] >= 0)
+        {
+          THGPUTensor *tensor = self->outputs[outputOf[i]].tensor;
+          if (THGPUFusion_isSafeOutput(self, tensor, (int)groups.size()))
+          {
+            dst = tensor;
+            THGPUTensor_retain(dst);
+          }
+        }
+        if (!dst)
+          dst = THGPUTensor_newWithSize1d(n);
+
+        value[i] = dst;
+        outputs[nOutputs] = dst;
+        offset[THGPU_FUSION_MAX_INPUTS + nOutputs] = dst->storageOffset;
+        store.push_back(reg[i]);
+        store.push_back(nOutputs);
+        nOutputs++;
+      }
+    }
+
+    Concurrency::array_view<int, 1> *av_prog = THGPUFusion_upload(prog);
+    Concurrency::array_view<float, 1> *av_values = THGPUFusion_upload(values);
+    Concurrency::array_view<int, 1> *av_store = THGPUFusion_upload(store);
+    Concurrency::array_view<long, 1> *av_offset = THGPUFusion_upload(offset);
+
+    THGPUFusion_kernel(inputs, nInputs, outputs, nOutputs, *av_prog, *av_values, (int)prog.size() / 3,
+                       *av_store, nOutputs, *av_offset, n);
+    self->nGroups++;
+
+    delete av_prog;
+    delete av_values;
+    delete av_store;
+    delete av_offset;
+  }
+
+  for (size_t k = 0; k < self->outputs.size(); k++)
+  {
+    THGPUTensor *tensor = self->outputs[k].tensor;
+    THGPUTensor *src = value[self->outputs[k].node];
+    if (src != tensor)
+      THGPUTensor_copy(tensor, src);
+  }
+
+  for (int i = 0; i < nNodes; i++)
+  {
+    if (value[i])
+      THGPUTensor_free(value[i]);
+  }
+}
+
+/* Host reference */
+
+static float THGPUFusion_applyReference(int op, float x, float y, float value1, float value2)
+{
+  switch (op)
+  {
+    case THGPU_FUSION_ADDVALUE: return x + value1;
+    case THGPU_FUSION_MULVALUE: return x * value1;
+    case THGPU_FUSION_DIVVALUE: return x / value1;
+    case THGPU_FUSION_POW: return powf(x, value1);
+    case THGPU_FUSION_CLAMP: return x < value1 ? value1 : (x > value2 ? value2 : x);
+    case THGPU_FUSION_LOG: return logf(x);
+    case THGPU_FUSION_LOG1P: return log1pf(x);
+    case THGPU_FUSION_EXP: return expf(x);
+    case THGPU_FUSION_COS: return cosf(x);
+    case THGPU_FUSION_ACOS: return acosf(x);
+    case THGPU_FUSION_COSH: return coshf(x);
+    case THGPU_FUSION_SIN: return sinf(x);
+    case THGPU_FUSION_ASIN: return asinf(x);
+    case THGPU_FUSION_SINH: return sinhf(x);
+    case THGPU_FUSION_TAN: return tanf(x);
+    case THGPU_FUSION_ATAN: return atanf(x);
+    case THGPU_FUSION_TANH: return tanhf(x);
+    case THGPU_FUSION_SQRT: return sqrtf(x);
+    case THGPU_FUSION_CEIL: return ceilf(x);
+    case THGPU_FUSION_FLOOR: return floorf(x);
+    case THGPU_FUSION_ABS: return fabsf(x);
+    case THGPU_FUSION_ROUND: return roundf(x);
+    case THGPU_FUSION_SIGN: return (x > 0) - (x < 0);
+    case THGPU_FUSION_SIGMOID: return 1.0f / (1.0f + expf(-x));
+    case THGPU_FUSION_ADD: return x + y;
+    case THGPU_FUSION_SUB: return x - y;
+    case THGPU_FUSION_MUL: return x * y;
+    case THGPU_FUSION_DIV: return x / y;
+    case THGPU_FUSION_ATAN2: return atan2f(x, y);
+    case THGPU_FUSION_MAX: return x > y ? x : y;
+    case THGPU_FUSION_MIN: return x < y ? x : y;
+  }
+  return 0;
+}
+
+void THGPUFusion_runReference(THGPUFusion *self, THFloatTensor **result)
+{
+  int nNodes = (int)self->nodes.size();
+  long n = THMax(self->nElement, 0);
+  std::vector<THFloatTensor*> value(nNodes, (THFloatTensor*)NULL);
+
+  for (int i = 0; i < nNodes; i++)
+  {
+    const THGPUFusionNode &node = self->nodes[i];
+    value[i] = THFloatTensor_newWithSize1d(n);
+    float *dst = THFloatTensor_data(value[i]);
+
+    if (node.op == THGPU_FUSION_INPUT)
+    {
+      THFloatTensor_copyGPU(value[i], node.tensor);
+      continue;
+    }
+
+    float *x = THFloatTensor_data(value[node.x]);
+    float *y = (THGPUFusion_arity(node.op) == 2) ? THFloatTensor_data(value[node.y]) : x;
+    for (long j = 0; j < n; j++)
+      dst[j] = THGPUFusion_applyReference(node.op, x[j], y[j], node.value1, node.value2);
+  }
+
+  for (size_t k = 0; k < self->outputs.size(); k++)
+  {
+    THLongStorage *size = THGPUTensor_newSizeOf(self->outputs[k].tensor);
+    result[k] = THFloatTensor_newWithSize(size, NULL);
+    THFloatTensor_copy(result[k], value[self->outputs[k].node]);
+    THLongStorage_free(size);
+  }
+
+  for (int i = 0; i < nNodes; i++)
+    THFloatTensor_free(value[i]);
+}
@@ -0,0 +1,72 @@
+#ifndef THC_FUSION_INC
+#define THC_FUSION_INC
+
+#include "THCTensor.h"
+
+// Lazily evaluated elementwise expressions. Nodes are recorded into a
+// THGPUFusion and identified by the int returned when adding them; nothing
+// runs on the device until THGPUFusion_run, which evaluates the whole DAG
+// with one kernel per fused group instead of one bolt transform per op.
+// All inputs and outputs must have the same number of elements.
+
+typedef enum THGPUFusionOp
+{
+  THGPU_FUSION_INPUT,
+  // unary, with up to two scalar arguments
+  THGPU_FUSION_ADDVALUE,
+  THGPU_FUSION_MULVALUE,
+  THGPU_FUSION_DIVVALUE,
+  THGPU_FUSION_POW,
+  THGPU_FUSION_CLAMP,
+  THGPU_FUSION_LOG,
+  THGPU_FUSION_LOG1P,
+  THGPU_FUSION_EXP,
+  THGPU_FUSION_COS,
+  THGPU_FUSION_ACOS,
+  THGPU_FUSION_COSH,
+  THGPU_FUSION_SIN,
+  THGPU_FUSION_ASIN,
+  THGPU_FUSION_SINH,
+  THGPU_FUSION_TAN,
+  THGPU_FUSION_ATAN,
+  THGPU_FUSION_TANH,
+  THGPU_FUSION_SQRT,
+  THGPU_FUSION_CEIL,
+  THGPU_FUSION_FLOOR,
+  THGPU_FUSION_ABS,
+  THGPU_FUSION_ROUND,
+  THGPU_FUSION_SIGN,
+  THGPU_FUSION_SIGMOID,
+  // binary
+  THGPU_FUSION_ADD,
+  THGPU_FUSION_SUB,
+  THGPU_FUSION_MUL,
+  THGPU_FUSION_DIV,
+  THGPU_FUSION_ATAN2,
+  THGPU_FUSION_MAX,
+  THGPU_FUSION_MIN,
+  THGPU_FUSION_NUM_OPS
+} THGPUFusionOp;
+
+typedef struct THGPUFusion THGPUFusion;
+
+THC_API THGPUFusion* THGPUFusion_new(void);
+THC_API void THGPUFusion_free(THGPUFusion *self);
+
+// Leaf reading 'tensor' (retained until the fusion is freed)
+THC_API int THGPUFusion_input(THGPUFusion *self, THGPUTensor *tensor);
+THC_API int THGPUFusion_unary(THGPUFusion *self, THGPUFusionOp op, int x, float value1, float value2);
+THC_API int THGPUFusion_binary(THGPUFusion *self, THGPUFusionOp op, int x, int y);
+// Marks 'node' to be written to 'tensor' by THGPUFusion_run
+THC_API void THGPUFusion_output(THGPUFusion *self, int node, THGPUTensor *tensor);
+
+// Evaluates every output on the device
+THC_API void THGPUFusion_run(THGPUFusion *self);
+// Evaluates every output on the host, one op at a time on copies of the
+// inputs; result[i] receives output i. For testing the fused kernels.
+THC_API void THGPUFusion_runReference(THGPUFusion *self, THFloatTensor **result);
+THC_API int THGPUFusion_nOutputs(THGPUFusion *self);
+// Number of kernels launched by the last THGPUFusion_run
+THC_API int THGPUFusion_nGroups(THGPUFusion *self);
+
+#endif
@@ -1,6 +1,8 @@
 #include "THCGeneral.h"
 #include "TH.h"
 #include "THCTensorRandom.h"
+#include "THCTensorCopy.h"
+#include "copyHelpers.h"
 #include "cl_manage.h"
 
 
@@ -10,8 +12,16 @@ void THGPUInit()
 }
 
 void THGPUShutdown()
-{ 
-   // To Be implemented
+{
+  // Releases the page-locked staging buffers once no copy uses them
+  THGPUEvent_synchronizeAll();
+  THGPUPinnedBuffer_trim(0);
+}
+
+void THGPUSynchronize()
+{
+  THGPUCheck(gpuDeviceSynchronize());
+  THGPUEvent_synchronizeAll();
 }
 
 void __THGPUCheck(int err, const char *file, const int line)
@@ -25,6 +25,8 @@ THC_API void THGPUBlas_shutdown();
 
 THC_API void THGPUInit(void);
 THC_API void THGPUShutdown(void);
+/* Waits for all enqueued device work, including asynchronous copies */
+THC_API void THGPUSynchronize(void);
 
 #define THGPUCheck(err)  __THGPUCheck(err, __FILE__, __LINE__)
 
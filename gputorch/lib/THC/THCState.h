@@ -0,0 +1,31 @@
+#ifndef THC_STATE_INC
+#define THC_STATE_INC
+
+#include "luaT.h"
+#include "THCTensorRandom.h"
+
+// gputorch._state, created by luaopen_libgputorch and read by the wrappers
+// of gputorch and gpunn which need the random generator.
+typedef struct THGPUState
+{
+  THGPURNGState* rngState;
+} THGPUState;
+
+static inline THGPUState* THGPUState_get(lua_State *L)
+{
+  THGPUState *state;
+  lua_getglobal(L, "gputorch");
+  lua_getfield(L, -1, "_state");
+  state = (THGPUState*)lua_touserdata(L, -1);
+  lua_pop(L, 2);
+  if (state == NULL)
+    luaL_error(L, "gputorch state is not initialized");
+  return state;
+}
+
+static inline THGPURNGState* THGPUState_rngState(lua_State *L)
+{
+  return THGPUState_get(L)->rngState;
+}
+
+#endif
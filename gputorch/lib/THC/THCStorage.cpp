@@ -3,6 +3,7 @@
 #include "copyHelpers.h"
 #include "cl_manage.h"
 #include "THCBolt.h"
+#include "THCCachingAllocator.h"
 
 void THGPUStorage_set(THGPUStorage *self, long index, float value)
 {
@@ -22,12 +23,13 @@ float THGPUStorage_get(const THGPUStorage *self, long index)
 
 THGPUStorage* THGPUStorage_new(void)
 {
-  int default_size = 0;
   THGPUStorage *storage = (THGPUStorage *)THAlloc(sizeof(THGPUStorage));
-  storage->allocatorContext = new Concurrency::array_view<float, 1>(Concurrency::extent<1>(default_size));
-  Concurrency::array_view<float>* avData = static_cast<Concurrency::array_view<float, 1>* >(storage->allocatorContext);
+  // An empty storage still holds a buffer (the smallest cached bucket), so
+  // that its array_view is valid: a zero extent is not allowed
+  Concurrency::array_view<float>* avData = THGPUCachingAllocator_malloc(0);
+  storage->allocatorContext = (void*)avData;
   storage->data = avData->data();
-  storage->size = default_size;
+  storage->size = 0;
   storage->refcount = 1;
   storage->flag = TH_STORAGE_REFCOUNTED | TH_STORAGE_RESIZABLE | TH_STORAGE_FREEMEM;
   return storage;
@@ -40,9 +42,8 @@ THGPUStorage* THGPUStorage_newWithSize(long size)
   if (size > 0)
   {
     THGPUStorage *storage = (THGPUStorage *)THAlloc(sizeof(THGPUStorage));
-    Concurrency::extent<1> eA(size);
-    // Allocating device array of given size
-    Concurrency::array_view<float>* avData = new Concurrency::array_view<float>(eA);
+    // Device array of at least the given size, recycled when possible
+    Concurrency::array_view<float>* avData = THGPUCachingAllocator_malloc(size);
     storage->allocatorContext = (void*)avData;
     storage->data = avData->data();
     storage->size = size;
@@ -99,6 +100,9 @@ THGPUStorage* THGPUStorage_newWithMapping(const char *fileName, long size, int i
 // Note that 'data' is on host
 THGPUStorage* THGPUStorage_newWithData(float *data, long size)
 {
+  if (size == 0)
+    return THGPUStorage_new();
+
   THGPUStorage *storage = (THGPUStorage *)THAlloc(sizeof(THGPUStorage));
   Concurrency::array_view<float>* avData  = new Concurrency::array_view<float>(Concurrency::extent<1>(size), data);
   storage->allocatorContext = (void*)avData;
@@ -126,7 +130,7 @@ void THGPUStorage_free(THGPUStorage *self)
     {
       if (self->allocatorContext)
       {
-        delete (Concurrency::array_view<float> *)self->allocatorContext;
+        THGPUCachingAllocator_free((Concurrency::array_view<float> *)self->allocatorContext);
         self->allocatorContext = NULL;
       }
 
@@ -141,6 +145,10 @@ void THGPUStorage_free(THGPUStorage *self)
 
 void THGPUStorage_fill(THGPUStorage *self, float value)
 {
+  // Nothing to fill in an empty storage
+  if (self->size == 0)
+    return;
+
   // Make sure every changes need to be made to its array_view
   Concurrency::array_view<float,1> *pavSelf = static_cast<Concurrency::array_view<float, 1> *>(self->allocatorContext);
   
@@ -159,36 +167,36 @@ void THGPUStorage_resize(THGPUStorage *self, long size)
 
   if (size == 0)
   {
+    // Give the buffer back and keep the smallest bucket, as THGPUStorage_new
     if (self->flag & TH_STORAGE_FREEMEM)
     {
-      if (self->allocatorContext)
-      {
-        Concurrency::array_view<float, 1> delSelf (*(static_cast<Concurrency::array_view<float,1>*>(self->allocatorContext)));
-        delSelf.~array_view();
-      }
-      else
-      {
-        Concurrency::array_view<float, 1> delSelf (Concurrency::extent<1>(self->size), self->data);
-        delSelf.~array_view();
-      }
+      THGPUCachingAllocator_free(static_cast<Concurrency::array_view<float, 1>* >(self->allocatorContext));
+      Concurrency::array_view<float, 1> *avEmpty = THGPUCachingAllocator_malloc(0);
+      self->allocatorContext = (void *)avEmpty;
+      self->data = avEmpty->data();
     }
-    self->data = NULL;
     self->size = 0;
   }
   else if (self->size != size)
   {
-    // Resizing the extent
-    Concurrency::extent<1> eA(size);
+    Concurrency::array_view<float, 1>* avSrc = static_cast<Concurrency::array_view<float, 1>* >(self->allocatorContext);
+    // The cached buffer behind the storage may already be large enough
+    long capacity = THGPUCachingAllocator_capacity(avSrc);
+    if (size <= capacity && size > capacity / 2)
+    {
+      self->size = size;
+      return;
+    }
+
     // Allocating device array of resized value
-    Concurrency::array_view<float, 1> *avDest = new Concurrency::array_view<float>(eA);
+    Concurrency::array_view<float, 1> *avDest = THGPUCachingAllocator_malloc(size);
     float* dest_ptr = static_cast<float*>(Concurrency::getAllocator().device_data(avDest->data()));
-    Concurrency::array_view<float, 1>* avSrc = static_cast<Concurrency::array_view<float, 1>* >(self->allocatorContext);
     float* src_ptr = static_cast<float*>(Concurrency::getAllocator().device_data(self->data));
     // TODO: Async copy
-    if (src_ptr)
+    if (self->size > 0)
       THGPUCheck(gpuMemcpy(dest_ptr, 0, src_ptr, 0, THMin(self->size, size) * sizeof(float), gpuMemcpyDeviceToDevice));
 
-    avSrc->~array_view();
+    THGPUCachingAllocator_free(avSrc);
     self->allocatorContext = (void *)avDest;
     self->data = avDest->data();
     self->size = size;
@@ -26,6 +26,7 @@ TH_GPU_STORAGE_IMPLEMENT_COPY(Short)
 TH_GPU_STORAGE_IMPLEMENT_COPY(Int)
 TH_GPU_STORAGE_IMPLEMENT_COPY(Long)
 TH_GPU_STORAGE_IMPLEMENT_COPY(Double)
+TH_GPU_STORAGE_IMPLEMENT_COPY(Half)
 
 void THFloatStorage_copyGPU(THFloatStorage *self, struct THGPUStorage *src)
 {
@@ -51,6 +52,7 @@ TH_GPU_STORAGE_IMPLEMENT_COPYTO(Short)
 TH_GPU_STORAGE_IMPLEMENT_COPYTO(Int)
 TH_GPU_STORAGE_IMPLEMENT_COPYTO(Long)
 TH_GPU_STORAGE_IMPLEMENT_COPYTO(Double)
+TH_GPU_STORAGE_IMPLEMENT_COPYTO(Half)
 
 // FIXME: device2device. 'src' is on device
 void THGPUStorage_rawCopy(THGPUStorage *self, float *src)
@@ -15,6 +15,7 @@ THC_API void THGPUStorage_copyInt(THGPUStorage *storage, struct THIntStorage *sr
 THC_API void THGPUStorage_copyLong(THGPUStorage *storage, struct THLongStorage *src);
 THC_API void THGPUStorage_copyFloat(THGPUStorage *storage, struct THFloatStorage *src);
 THC_API void THGPUStorage_copyDouble(THGPUStorage *storage, struct THDoubleStorage *src);
+THC_API void THGPUStorage_copyHalf(THGPUStorage *storage, struct THHalfStorage *src);
 
 THC_API void THByteStorage_copyGPU(THByteStorage *self, struct THGPUStorage *src);
 THC_API void THCharStorage_copyGPU(THCharStorage *self, struct THGPUStorage *src);
@@ -23,6 +24,7 @@ THC_API void THIntStorage_copyGPU(THIntStorage *self, struct THGPUStorage *src);
 THC_API void THLongStorage_copyGPU(THLongStorage *self, struct THGPUStorage *src);
 THC_API void THFloatStorage_copyGPU(THFloatStorage *self, struct THGPUStorage *src);
 THC_API void THDoubleStorage_copyGPU(THDoubleStorage *self, struct THGPUStorage *src);
+THC_API void THHalfStorage_copyGPU(THHalfStorage *self, struct THGPUStorage *src);
 THC_API void THGPUStorage_copyGPU(THGPUStorage *self, THGPUStorage *src);
 
 #endif
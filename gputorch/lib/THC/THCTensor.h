@@ -25,7 +25,9 @@ typedef struct THGPUTensor
   int refcount;
   char flag;
   
-  // Function to return array_view associated with Tensor
+  // Function to return array_view associated with Tensor. Every storage holds
+  // a buffer, empty ones included (see THGPUStorage_new), so the view is valid
+  // even when the tensor has no element.
   Concurrency::array_view<float,1> get_array_view()
   {
     Concurrency::array_view<float,1>* avPtr = static_cast<Concurrency::array_view<float>*>
@@ -6,6 +6,9 @@
 #include "amp_math.h"
 #include "THCBolt.h"
 #include "copyHelpers.h"
+#include "THCCachingAllocator.h"
+#include <set>
+#include <vector>
 
 // FIXME: suggest to call the same bolt::amp APIs in this file to avoid multiple definition error
 // introduced by the Compiler. Will fix.
@@ -16,23 +19,266 @@ using namespace std;
 // Maximum number of dimensions allowed for gputorch
 #define MAX_DIMS 25
 
+#ifndef DIVUP
+#define DIVUP(x, y) (((x) + (y) - 1) / (y))
+#endif
+
+// Host/device copies of non-contiguous tensors are done in pieces of this
+// many elements, so no full-size temporary is ever allocated
+#define THGPU_COPY_CHUNK (1L << 20)
+
+static void THGPUTensor_computesz(THGPUTensor *self, Concurrency::array_view<long,1> **sz_,
+                                  Concurrency::array_view<long> **st_, int *dim_, long *innermostdim);
+
+// Drops the dims of size 1 and merges the dims laid out contiguously in both
+// tensors. Sizes and strides are returned innermost first; returns the number
+// of dims left, or -1 if the shapes differ or more than 3 dims remain.
+static int THGPUTensor_collapseRect(THGPUTensor *gpu, THFloatTensor *host, long *size, long *gst, long *hst)
+{
+  int d, n = 0;
+
+  if (gpu->nDimension != host->nDimension)
+    return -1;
+
+  for (d = gpu->nDimension - 1; d >= 0; d--)
+  {
+    if (gpu->size[d] != host->size[d])
+      return -1;
+    if (gpu->size[d] == 1)
+      continue;
+
+    if (n > 0 && gst[n-1] * size[n-1] == gpu->stride[d] && hst[n-1] * size[n-1] == host->stride[d])
+    {
+      size[n-1] *= gpu->size[d];
+      continue;
+    }
+
+    if (n == 3)
+      return -1;
+    size[n] = gpu->size[d];
+    gst[n] = gpu->stride[d];
+    hst[n] = host->stride[d];
+    n++;
+  }
+
+  return n;
+}
+
+static int THGPUTensor_isRectPitch(int n, long *size, long *stride)
+{
+  if (stride[0] != 1)
+    return 0;
+  if (n >= 2 && stride[1] < size[0])
+    return 0;
+  if (n == 3 && (stride[2] % stride[1] != 0 || stride[2] < size[1] * stride[1]))
+    return 0;
+  return 1;
+}
+
+// Transfers tensors of the same shape whose rows are contiguous on both sides
+// with a single 2D/3D rectangular copy. Returns 0 if the layout does not allow it.
+static int THGPUTensor_copyRect(THGPUTensor *gpu, THFloatTensor *host, gpuMemcpyKind kind)
+{
+  long size[3], gst[3], hst[3];
+  int n = THGPUTensor_collapseRect(gpu, host, size, gst, hst);
+
+  if (n < 1 || !THGPUTensor_isRectPitch(n, size, gst) || !THGPUTensor_isRectPitch(n, size, hst))
+    return 0;
+
+  size_t width = size[0] * sizeof(float);
+  size_t height = (n >= 2) ? size[1] : 1;
+  size_t depth = (n == 3) ? size[2] : 1;
+  size_t grow = (n >= 2) ? gst[1] * sizeof(float) : 0;
+  size_t gslice = (n == 3) ? gst[2] * sizeof(float) : 0;
+  size_t hrow = (n >= 2) ? hst[1] * sizeof(float) : 0;
+  size_t hslice = (n == 3) ? hst[2] * sizeof(float) : 0;
+
+  float* gpu_ptr = static_cast<float*>(Concurrency::getAllocator().device_data(gpu->storage->data));
+  float* host_ptr = host->storage->data + host->storageOffset;
+
+  if (kind == gpuMemcpyHostToDevice)
+    THGPUCheck(gpuMemcpy3D(gpu_ptr, gpu->storageOffset * sizeof(float), grow, gslice,
+                           host_ptr, 0, hrow, hslice, width, height, depth, kind));
+  else
+    THGPUCheck(gpuMemcpy3D(host_ptr, 0, hrow, hslice,
+                           gpu_ptr, gpu->storageOffset * sizeof(float), grow, gslice,
+                           width, height, depth, kind));
+  return 1;
+}
+
+// Copies the elements [start, start+n) of 'self', in row-major order, to 'buf'
+// (gather) or from 'buf' (scatter).
+static void THFloatTensor_rangeCopy(THFloatTensor *self, long start, long n, float *buf, int gather)
+{
+  int nDim = self->nDimension;
+  long *counter = (long*)THAlloc(sizeof(long) * nDim);
+  long offset = self->storageOffset;
+  long rest = start;
+  int d;
+
+  for (d = nDim - 1; d >= 0; d--)
+  {
+    counter[d] = rest % self->size[d];
+    rest /= self->size[d];
+    offset += counter[d] * self->stride[d];
+  }
+
+  long innerSize = self->size[nDim - 1];
+  long innerStride = self->stride[nDim - 1];
+  float *data = self->storage->data;
+
+  while (n > 0)
+  {
+    long len = THMin(innerSize - counter[nDim - 1], n);
+    float *ptr = data + offset;
+    long i;
+
+    if (gather)
+      for (i = 0; i < len; i++)
+        buf[i] = ptr[i * innerStride];
+    else
+      for (i = 0; i < len; i++)
+        ptr[i * innerStride] = buf[i];
+
+    buf += len;
+    n -= len;
+    offset += len * innerStride;
+    counter[nDim - 1] += len;
+
+    for (d = nDim - 1; d > 0 && counter[d] == self->size[d]; d--)
+    {
+      offset += self->stride[d-1] - counter[d] * self->stride[d];
+      counter[d] = 0;
+      counter[d-1]++;
+    }
+  }
+
+  THFree(counter);
+}
+
+// Device counterpart of THFloatTensor_rangeCopy, using the size/stride arrays
+// uploaded by THGPUTensor_computesz.
+static void THGPUTensor_kernel_rangeCopy(Concurrency::array_view<float, 1> &av_self, long selfOffset,
+                                         Concurrency::array_view<long, 1> &av_sz,
+                                         Concurrency::array_view<long, 1> &av_st, int dim,
+                                         Concurrency::array_view<float, 1> &av_buf,
+                                         long start, long n, int gather)
+{
+  Concurrency::extent<1> copyExt(DIVUP(n, 256) * 256);
+  Concurrency::tiled_extent<256> t_ext(copyExt);
+
+  Concurrency::parallel_for_each(t_ext, [=] (Concurrency::tiled_index<256> tidx) restrict(amp)
+  {
+    long i = tidx.global[0];
+    if (i < n)
+    {
+      long idx = 0;
+      long rest = start + i;
+      for (int d = 0; d < dim; d++)
+      {
+        idx += (rest / av_sz[Concurrency::index<1>(d)]) * av_st[Concurrency::index<1>(d)];
+        rest = rest % av_sz[Concurrency::index<1>(d)];
+      }
+      if (gather)
+        av_buf[Concurrency::index<1>(i)] = av_self[Concurrency::index<1>(selfOffset + idx)];
+      else
+        av_self[Concurrency::index<1>(selfOffset + idx)] = av_buf[Concurrency::index<1>(i)];
+    }
+  });
+}
+
+// Chunked host <-> device copy for layouts the rectangular copy cannot express.
+// Contiguous sides are read or written in place; a non-contiguous host side goes
+// through a chunk-sized host buffer, a non-contiguous device side through a
+// chunk-sized device buffer and the range copy kernel.
+static void THGPUTensor_copyStrided(THGPUTensor *gpu, THFloatTensor *host, gpuMemcpyKind kind)
+{
+  long nElement = THGPUTensor_nElement(gpu);
+  long chunk = THMin(nElement, THGPU_COPY_CHUNK);
+  int hostContiguous = THFloatTensor_isContiguous(host);
+  int gpuContiguous = THGPUTensor_isContiguous(gpu);
+  float *hostBuf = hostContiguous ? NULL : (float*)THAlloc(sizeof(float) * chunk);
+  Concurrency::array_view<float, 1> *deviceBuf = NULL;
+  Concurrency::array_view<long, 1> *d_sz = NULL, *d_st = NULL;
+  int dim = 0;
+  long innermostdim;
+
+  if (!gpuContiguous)
+  {
+    THGPUTensor_computesz(gpu, &d_sz, &d_st, &dim, &innermostdim);
+    d_sz->discard_data();
+    d_st->discard_data();
+    deviceBuf = THGPUCachingAllocator_malloc(chunk);
+  }
+
+  float* gpu_ptr = static_cast<float*>(Concurrency::getAllocator().device_data(gpu->storage->data));
+  float* buf_ptr = deviceBuf ? static_cast<float*>(Concurrency::getAllocator().device_data(deviceBuf->data())) : NULL;
+  auto avGpu = gpu->get_array_view();
+
+  for (long start = 0; start < nElement; start += chunk)
+  {
+    long len = THMin(chunk, nElement - start);
+    float *hostPtr = hostContiguous ? THFloatTensor_data(host) + start : hostBuf;
+
+    if (kind == gpuMemcpyHostToDevice)
+    {
+      if (!hostContiguous)
+        THFloatTensor_rangeCopy(host, start, len, hostBuf, 1);
+
+      if (gpuContiguous)
+        THGPUCheck(gpuMemcpy(gpu_ptr, (gpu->storageOffset + start) * sizeof(float),
+                             hostPtr, 0, len * sizeof(float), gpuMemcpyHostToDevice));
+      else
+      {
+        THGPUCheck(gpuMemcpy(buf_ptr, 0, hostPtr, 0, len * sizeof(float), gpuMemcpyHostToDevice));
+        deviceBuf->discard_data();
+        THGPUTensor_kernel_rangeCopy(avGpu, gpu->storageOffset, *d_sz, *d_st, dim, *deviceBuf, start, len, 0);
+      }
+    }
+    else
+    {
+      if (gpuContiguous)
+        THGPUCheck(gpuMemcpy(hostPtr, 0, gpu_ptr, (gpu->storageOffset + start) * sizeof(float),
+                             len * sizeof(float), gpuMemcpyDeviceToHost));
+      else
+      {
+        THGPUTensor_kernel_rangeCopy(avGpu, gpu->storageOffset, *d_sz, *d_st, dim, *deviceBuf, start, len, 1);
+        THGPUCheck(gpuMemcpy(hostPtr, 0, buf_ptr, 0, len * sizeof(float), gpuMemcpyDeviceToHost));
+      }
+
+      if (!hostContiguous)
+        THFloatTensor_rangeCopy(host, start, len, hostBuf, 0);
+    }
+  }
+
+  if (deviceBuf)
+  {
+    THGPUCachingAllocator_free(deviceBuf);
+    delete d_sz;
+    delete d_st;
+  }
+  THFree(hostBuf);
+}
+
 /* specific methods */
 void THGPUTensor_copyFloat(THGPUTensor *self, struct THFloatTensor *src)
 {
-  THArgCheck(THGPUTensor_nElement(self) == THFloatTensor_nElement(src), 2, "sizes do not match");
+  long nElement = THGPUTensor_nElement(self);
+  THArgCheck(nElement == THFloatTensor_nElement(src), 2, "sizes do not match");
+  if (nElement == 0)
+    return;
+
+  if (THGPUTensor_isContiguous(self) && THFloatTensor_isContiguous(src))
   {
-    THGPUTensor *selfc = THGPUTensor_newContiguous(self);
-    src = THFloatTensor_newContiguous(src);
-    float* selfc_ptr = static_cast<float*>(Concurrency::getAllocator().device_data(selfc->storage->data));
+    float* self_ptr = static_cast<float*>(Concurrency::getAllocator().device_data(self->storage->data));
 
-    THGPUCheck(gpuMemcpy(selfc_ptr, selfc->storageOffset * sizeof(float),
+    THGPUCheck(gpuMemcpy(self_ptr, self->storageOffset * sizeof(float),
                          src->storage->data + src->storageOffset, 0,
-                         THGPUTensor_nElement(self) * sizeof(float),
+                         nElement * sizeof(float),
                          gpuMemcpyHostToDevice));
-
-    THFloatTensor_free(src);
-    THGPUTensor_freeCopyTo(selfc, self);
   }
+  else if (!THGPUTensor_copyRect(self, src, gpuMemcpyHostToDevice))
+    THGPUTensor_copyStrided(self, src, gpuMemcpyHostToDevice);
 }
 
 /* everything comes down to copy to a tensor of floats */
@@ -63,20 +309,22 @@ IMPLEMENT_TH_GPU_TENSOR_COPY(Double)
 /* copyGPU */
 void THFloatTensor_copyGPU(THFloatTensor *self, struct THGPUTensor *src)
 {
-  THArgCheck(THFloatTensor_nElement(self) == THGPUTensor_nElement(src), 2, "sizes do not match"); 
+  long nElement = THGPUTensor_nElement(src);
+  THArgCheck(THFloatTensor_nElement(self) == nElement, 2, "sizes do not match");
+  if (nElement == 0)
+    return;
+
+  if (THFloatTensor_isContiguous(self) && THGPUTensor_isContiguous(src))
   {
-    THFloatTensor *selfc = THFloatTensor_newContiguous(self);
-    src = THGPUTensor_newContiguous(src);
     float* src_ptr = static_cast<float*>(Concurrency::getAllocator().device_data(src->storage->data));
 
-    THGPUCheck(gpuMemcpy(selfc->storage->data + selfc->storageOffset, 0,
-                       src_ptr, src->storageOffset * sizeof(float),
-                       THGPUTensor_nElement(src) * sizeof(float),
-                       gpuMemcpyDeviceToHost));
-
-    THGPUTensor_free(src);
-    THFloatTensor_freeCopyTo(selfc, self);
+    THGPUCheck(gpuMemcpy(self->storage->data + self->storageOffset, 0,
+                         src_ptr, src->storageOffset * sizeof(float),
+                         nElement * sizeof(float),
+                         gpuMemcpyDeviceToHost));
   }
+  else if (!THGPUTensor_copyRect(src, self, gpuMemcpyDeviceToHost))
+    THGPUTensor_copyStrided(src, self, gpuMemcpyDeviceToHost);
 }
 
 #define IMPLEMENT_TH_GPU_TENSOR_COPY_TO(TYPEC)                                                        \
@@ -108,9 +356,169 @@ void THGPUTensor_copyGPU(THGPUTensor *self, THGPUTensor *src)
   THGPUTensor_copy(self, src);
 }
 
-#ifndef DIVUP
-#define DIVUP(x, y) (((x) + (y) - 1) / (y))
-#endif
+/* Half tensors cross the bus as they are, two 16 bit values per 32 bit word
+   (little endian), and are expanded or packed on the device. The conversions
+   are those of TH_half2float and TH_float2half. */
+static inline float THGPUHalf_toFloat(unsigned int h) restrict(amp)
+{
+  unsigned int sign = (h & 0x8000) << 16;
+  unsigned int exponent = (h >> 10) & 0x1f;
+  unsigned int mantissa = h & 0x3ff;
+  unsigned int x;
+
+  if (exponent == 0x1f)
+    x = sign | 0x7f800000 | (mantissa ? 0x400000 | (mantissa << 13) : 0);
+  else if (exponent != 0)
+    x = sign | ((exponent + 112) << 23) | (mantissa << 13);
+  else if (mantissa == 0)
+    x = sign;
+  else
+  {
+    exponent = 113;
+    while (!(mantissa & 0x400))
+    {
+      mantissa <<= 1;
+      exponent--;
+    }
+    x = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+  }
+  return *(float*)&x;
+}
+
+static inline unsigned int THGPUHalf_fromFloat(float f) restrict(amp)
+{
+  unsigned int x = *(unsigned int*)&f;
+  unsigned int sign = (x >> 16) & 0x8000;
+
+  x &= 0x7fffffff;
+  if (x >= 0x7f800000)
+    return sign | 0x7c00 | (x > 0x7f800000 ? 0x200 | ((x >> 13) & 0x3ff) : 0);
+  if (x >= 0x477ff000)
+    return sign | 0x7c00;
+  if (x < 0x38800000)
+  {
+    unsigned int mantissa = (x & 0x7fffff) | 0x800000;
+    int shift = 126 - (int)(x >> 23);
+    if (shift > 24)
+      return sign;
+    unsigned int m = mantissa >> shift;
+    unsigned int rem = mantissa & ((1u << shift) - 1);
+    unsigned int half = 1u << (shift - 1);
+    if (rem > half || (rem == half && (m & 1)))
+      m++;
+    return sign | m;
+  }
+  x -= 112u << 23;
+  x += 0xfff + ((x >> 13) & 1);
+  return sign | (x >> 13);
+}
+
+#define THGPU_HALF_THREADS 256
+
+static void THGPUTensor_kernel_halfToFloat(Concurrency::array_view<float, 1> &avDst, long dstOffset,
+                                           Concurrency::array_view<unsigned int, 1> &avSrc, long n)
+{
+  unsigned grdSz = (n + (THGPU_HALF_THREADS - 1)) & ~(THGPU_HALF_THREADS - 1);
+  Concurrency::extent<1> grdExt(grdSz);
+  Concurrency::tiled_extent<THGPU_HALF_THREADS> t_ext(grdExt);
+
+  Concurrency::parallel_for_each(t_ext, [=] (Concurrency::tiled_index<THGPU_HALF_THREADS> tidx) restrict(amp)
+  {
+    long i = tidx.global[0];
+    if (i < n)
+    {
+      unsigned int word = avSrc[i >> 1];
+      avDst[dstOffset + i] = THGPUHalf_toFloat((i & 1) ? word >> 16 : word & 0xffff);
+    }
+  });
+}
+
+// one thread per word, so that no two threads write the same word
+static void THGPUTensor_kernel_floatToHalf(Concurrency::array_view<unsigned int, 1> &avDst,
+                                           Concurrency::array_view<float, 1> &avSrc, long srcOffset, long n)
+{
+  long nWord = (n + 1) / 2;
+  unsigned grdSz = (nWord + (THGPU_HALF_THREADS - 1)) & ~(THGPU_HALF_THREADS - 1);
+  Concurrency::extent<1> grdExt(grdSz);
+  Concurrency::tiled_extent<THGPU_HALF_THREADS> t_ext(grdExt);
+
+  Concurrency::parallel_for_each(t_ext, [=] (Concurrency::tiled_index<THGPU_HALF_THREADS> tidx) restrict(amp)
+  {
+    long w = tidx.global[0];
+    if (w < nWord)
+    {
+      unsigned int word = THGPUHalf_fromFloat(avSrc[srcOffset + 2 * w]);
+      if (2 * w + 1 < n)
+        word |= THGPUHalf_fromFloat(avSrc[srcOffset + 2 * w + 1]) << 16;
+      avDst[w] = word;
+    }
+  });
+}
+
+void THGPUTensor_copyHalf(THGPUTensor *self, struct THHalfTensor *src)
+{
+  long nElement = THGPUTensor_nElement(self);
+  THArgCheck(nElement == THHalfTensor_nElement(src), 2, "sizes do not match");
+  if (nElement == 0)
+    return;
+
+  long nWord = (nElement + 1) / 2;
+  std::vector<unsigned int> packed(nWord, 0);
+  THHalfTensor *srcc = THHalfTensor_newContiguous(src);
+  memcpy(&packed[0], THHalfTensor_data(srcc), nElement * sizeof(THHalf));
+  THHalfTensor_free(srcc);
+
+  Concurrency::array_view<unsigned int, 1> avPacked(Concurrency::extent<1>(nWord));
+  unsigned int* packed_ptr = static_cast<unsigned int*>(Concurrency::getAllocator().device_data(avPacked.data()));
+  THGPUCheck(gpuMemcpy(packed_ptr, 0, &packed[0], 0, nWord * sizeof(unsigned int), gpuMemcpyHostToDevice));
+  avPacked.discard_data();
+
+  THGPUTensor *selfc = self;
+  if (!THGPUTensor_isContiguous(self))
+  {
+    THLongStorage *size = THGPUTensor_newSizeOf(self);
+    selfc = THGPUTensor_newWithSize(size, NULL);
+    THLongStorage_free(size);
+  }
+  auto avSelf = selfc->get_array_view();
+  THGPUTensor_kernel_halfToFloat(avSelf, selfc->storageOffset, avPacked, nElement);
+  if (selfc != self)
+  {
+    THGPUTensor_copy(self, selfc);
+    THGPUTensor_free(selfc);
+  }
+}
+
+void THHalfTensor_copyGPU(THHalfTensor *self, struct THGPUTensor *src)
+{
+  long nElement = THGPUTensor_nElement(src);
+  THArgCheck(THHalfTensor_nElement(self) == nElement, 2, "sizes do not match");
+  if (nElement == 0)
+    return;
+
+  long nWord = (nElement + 1) / 2;
+  THGPUTensor *srcc = THGPUTensor_newContiguous(src);
+  Concurrency::array_view<unsigned int, 1> avPacked(Concurrency::extent<1>(nWord));
+  auto avSrc = srcc->get_array_view();
+  THGPUTensor_kernel_floatToHalf(avPacked, avSrc, srcc->storageOffset, nElement);
+  THGPUTensor_free(srcc);
+
+  std::vector<unsigned int> packed(nWord);
+  unsigned int* packed_ptr = static_cast<unsigned int*>(Concurrency::getAllocator().device_data(avPacked.data()));
+  THGPUCheck(gpuMemcpy(&packed[0], 0, packed_ptr, 0, nWord * sizeof(unsigned int), gpuMemcpyDeviceToHost));
+
+  if (THHalfTensor_isContiguous(self))
+    memcpy(THHalfTensor_data(self), &packed[0], nElement * sizeof(THHalf));
+  else
+  {
+    THLongStorage *size = THHalfTensor_newSizeOf(self);
+    THHalfTensor *selfc = THHalfTensor_newWithSize(size, NULL);
+    memcpy(THHalfTensor_data(selfc), &packed[0], nElement * sizeof(THHalf));
+    THHalfTensor_copy(self, selfc);
+    THHalfTensor_free(selfc);
+    THLongStorage_free(size);
+  }
+}
 
 // Copy self->size to device and remove all dims of size=1
 static void THGPUTensor_computesz(THGPUTensor *self, Concurrency::array_view<long,1> **sz_,
@@ -288,3 +696,346 @@ THC_API void THGPUTensor_copy(THGPUTensor *self, THGPUTensor *src)
     delete d_src_sz;
   }
 }
+
+/* Asynchronous copies */
+
+// Page-locked staging buffer, reused across asynchronous copies
+typedef struct THGPUPinnedBuffer
+{
+  float *host;
+  void *handle;
+  long size;
+  int busy;
+} THGPUPinnedBuffer;
+
+struct THGPUEvent
+{
+  gpuEvent_t event;
+  THGPUPinnedBuffer *staging;
+  THFloatTensor *hostDst;    // device to host: filled from staging on completion
+  THGPUTensor *deviceSrc;    // device tensors kept alive until the transfer is done
+  THGPUTensor *deviceDst;
+  int complete;
+};
+
+#define THGPU_PINNED_MIN_SIZE (1L << 18)
+
+static std::vector<THGPUPinnedBuffer*> pinnedBuffers;
+static long pinnedBytes = 0;   // held by idle and busy buffers
+static std::set<THGPUEvent*> pendingEvents;
+
+// Releases idle buffers, largest first, until at most 'bytes' are held
+static void THGPUPinnedBuffer_trimTo(long bytes)
+{
+  while (pinnedBytes > bytes)
+  {
+    THGPUPinnedBuffer *largest = NULL;
+    size_t largestIndex = 0;
+    for (size_t i = 0; i < pinnedBuffers.size(); i++)
+    {
+      THGPUPinnedBuffer *buf = pinnedBuffers[i];
+      if (!buf->busy && (!largest || buf->size > largest->size))
+      {
+        largest = buf;
+        largestIndex = i;
+      }
+    }
+    if (!largest)
+      return;
+
+    THGPUCheck(gpuHostFree(largest->host, largest->handle));
+    pinnedBytes -= largest->size * sizeof(float);
+    pinnedBuffers.erase(pinnedBuffers.begin() + largestIndex);
+    THFree(largest);
+  }
+}
+
+static THGPUPinnedBuffer* THGPUPinnedBuffer_acquire(long size)
+{
+  THGPUPinnedBuffer *best = NULL;
+  for (size_t i = 0; i < pinnedBuffers.size(); i++)
+  {
+    THGPUPinnedBuffer *buf = pinnedBuffers[i];
+    if (!buf->busy && buf->size >= size && (!best || buf->size < best->size))
+      best = buf;
+  }
+
+  if (!best)
+  {
+    long capacity = THGPU_PINNED_MIN_SIZE;
+    long limit = THGPUCachingAllocator_getLimit();
+    while (capacity < size)
+      capacity <<= 1;
+
+    // Idle buffers too small for this copy make room for the new one
+    if (limit >= 0)
+      THGPUPinnedBuffer_trimTo(THMax(limit - (long)(capacity * sizeof(float)), 0L));
+
+    best = (THGPUPinnedBuffer*)THAlloc(sizeof(THGPUPinnedBuffer));
+    THGPUCheck(gpuHostAlloc((void**)&best->host, &best->handle, capacity * sizeof(float)));
+    best->size = capacity;
+    pinnedBuffers.push_back(best);
+    pinnedBytes += capacity * sizeof(float);
+  }
+
+  best->busy = 1;
+  return best;
+}
+
+// A float tensor of the given size, viewing the staging buffer
+static THFloatTensor* THGPUPinnedBuffer_newTensor(THGPUPinnedBuffer *self, THLongStorage *size)
+{
+  THFloatStorage *storage = THFloatStorage_newWithData(self->host, self->size);
+  storage->flag = TH_STORAGE_REFCOUNTED;
+  THFloatTensor *tensor = THFloatTensor_newWithStorage(storage, 0, size, NULL);
+  THFloatStorage_free(storage);
+  return tensor;
+}
+
+static void THGPUPinnedBuffer_load(THGPUPinnedBuffer *self, THFloatTensor *src)
+{
+  if (THFloatTensor_isContiguous(src))
+    memcpy(self->host, THFloatTensor_data(src), THFloatTensor_nElement(src) * sizeof(float));
+  else
+  {
+    THLongStorage *size = THFloatTensor_newSizeOf(src);
+    THFloatTensor *staged = THGPUPinnedBuffer_newTensor(self, size);
+    THFloatTensor_copy(staged, src);
+    THFloatTensor_free(staged);
+    THLongStorage_free(size);
+  }
+}
+
+static void THGPUPinnedBuffer_store(THGPUPinnedBuffer *self, THFloatTensor *dst)
+{
+  if (THFloatTensor_isContiguous(dst))
+    memcpy(THFloatTensor_data(dst), self->host, THFloatTensor_nElement(dst) * sizeof(float));
+  else
+  {
+    THLongStorage *size = THFloatTensor_newSizeOf(dst);
+    THFloatTensor *staged = THGPUPinnedBuffer_newTensor(self, size);
+    THFloatTensor_copy(dst, staged);
+    THFloatTensor_free(staged);
+    THLongStorage_free(size);
+  }
+}
+
+static THGPUEvent* THGPUEvent_new(gpuEvent_t event, THGPUPinnedBuffer *staging)
+{
+  THGPUEvent *self = (THGPUEvent*)THAlloc(sizeof(THGPUEvent));
+  self->event = event;
+  self->staging = staging;
+  self->hostDst = NULL;
+  self->deviceSrc = NULL;
+  self->deviceDst = NULL;
+  self->complete = 0;
+  pendingEvents.insert(self);
+  return self;
+}
+
+static void THGPUEvent_finish(THGPUEvent *self);
+
+// For copies done synchronously
+static THGPUEvent* THGPUEvent_newComplete(void)
+{
+  THGPUEvent *self = THGPUEvent_new(NULL, NULL);
+  THGPUEvent_finish(self);
+  return self;
+}
+
+static void THGPUEvent_finish(THGPUEvent *self)
+{
+  if (self->hostDst)
+  {
+    THGPUPinnedBuffer_store(self->staging, self->hostDst);
+    THFloatTensor_free(self->hostDst);
+    self->hostDst = NULL;
+  }
+
+  if (self->deviceSrc)
+  {
+    THGPUTensor_free(self->deviceSrc);
+    self->deviceSrc = NULL;
+  }
+
+  if (self->deviceDst)
+  {
+    THGPUTensor_free(self->deviceDst);
+    self->deviceDst = NULL;
+  }
+
+  if (self->staging)
+  {
+    long limit = THGPUCachingAllocator_getLimit();
+    self->staging->busy = 0;
+    self->staging = NULL;
+    if (limit >= 0)
+      THGPUPinnedBuffer_trimTo(limit);
+  }
+
+  THGPUCheck(gpuEventDestroy(self->event));
+  self->event = NULL;
+  self->complete = 1;
+  pendingEvents.erase(self);
+}
+
+int THGPUEvent_query(THGPUEvent *self)
+{
+  if (!self->complete && gpuEventQuery(self->event) == 0)
+    THGPUEvent_finish(self);
+  return self->complete;
+}
+
+void THGPUEvent_synchronize(THGPUEvent *self)
+{
+  if (self->complete)
+    return;
+
+  THGPUCheck(gpuEventSynchronize(self->event));
+  THGPUEvent_finish(self);
+}
+
+void THGPUEvent_free(THGPUEvent *self)
+{
+  THGPUEvent_synchronize(self);
+  THFree(self);
+}
+
+void THGPUEvent_synchronizeAll(void)
+{
+  while (!pendingEvents.empty())
+    THGPUEvent_synchronize(*pendingEvents.begin());
+}
+
+void THGPUPinnedBuffer_trim(long bytes)
+{
+  THGPUPinnedBuffer_trimTo(bytes);
+}
+
+long THGPUPinnedBuffer_cachedBytes(void)
+{
+  long bytes = 0;
+  for (size_t i = 0; i < pinnedBuffers.size(); i++)
+    if (!pinnedBuffers[i]->busy)
+      bytes += pinnedBuffers[i]->size * sizeof(float);
+  return bytes;
+}
+
+THGPUEvent* THGPUTensor_copyAsyncFloat(THGPUTensor *self, struct THFloatTensor *src)
+{
+  long nElement = THGPUTensor_nElement(self);
+  THArgCheck(nElement == THFloatTensor_nElement(src), 2, "sizes do not match");
+  if (nElement == 0)
+    return THGPUEvent_newComplete();
+
+  THGPUPinnedBuffer *staging = THGPUPinnedBuffer_acquire(nElement);
+  THGPUPinnedBuffer_load(staging, src);
+
+  // The strided scatter needs the data on the device first
+  THGPUTensor *selfc = self;
+  if (!THGPUTensor_isContiguous(self))
+  {
+    THLongStorage *size = THGPUTensor_newSizeOf(self);
+    selfc = THGPUTensor_newWithSize(size, NULL);
+    THLongStorage_free(size);
+  }
+
+  gpuEvent_t event = NULL;
+  float* selfc_ptr = static_cast<float*>(Concurrency::getAllocator().device_data(selfc->storage->data));
+  THGPUCheck(gpuMemcpyAsync(selfc_ptr, selfc->storageOffset * sizeof(float),
+                            staging->host, 0, nElement * sizeof(float),
+                            gpuMemcpyHostToDevice, &event));
+  THGPUEvent *copyEvent = THGPUEvent_new(event, staging);
+
+  if (selfc != self)
+  {
+    THGPUEvent_synchronize(copyEvent);
+    THGPUTensor_copy(self, selfc);
+    THGPUTensor_free(selfc);
+  }
+  else
+  {
+    THGPUTensor_retain(self);
+    copyEvent->deviceDst = self;
+  }
+
+  return copyEvent;
+}
+
+#define IMPLEMENT_TH_GPU_TENSOR_COPY_ASYNC(TYPEC)                                                     \
+THGPUEvent* THGPUTensor_copyAsync##TYPEC(THGPUTensor *self, struct TH##TYPEC##Tensor *src)            \
+{                                                                                                     \
+  THArgCheck(THGPUTensor_nElement(self) == TH##TYPEC##Tensor_nElement(src), 2, "sizes do not match"); \
+                                                                                                      \
+  {                                                                                                   \
+    THLongStorage *size = TH##TYPEC##Tensor_newSizeOf(src);                                           \
+    THFloatTensor *srcf = THFloatTensor_newWithSize(size, NULL);                                      \
+    THGPUEvent *event;                                                                                \
+                                                                                                      \
+    THFloatTensor_copy##TYPEC(srcf, src);                                                             \
+    event = THGPUTensor_copyAsyncFloat(self, srcf);                                                   \
+                                                                                                      \
+    THLongStorage_free(size);                                                                         \
+    THFloatTensor_free(srcf);                                                                         \
+    return event;                                                                                     \
+  }                                                                                                   \
+}
+
+IMPLEMENT_TH_GPU_TENSOR_COPY_ASYNC(Byte)
+IMPLEMENT_TH_GPU_TENSOR_COPY_ASYNC(Char)
+IMPLEMENT_TH_GPU_TENSOR_COPY_ASYNC(Short)
+IMPLEMENT_TH_GPU_TENSOR_COPY_ASYNC(Int)
+IMPLEMENT_TH_GPU_TENSOR_COPY_ASYNC(Long)
+IMPLEMENT_TH_GPU_TENSOR_COPY_ASYNC(Double)
+IMPLEMENT_TH_GPU_TENSOR_COPY_ASYNC(Half)
+
+THGPUEvent* THFloatTensor_copyAsyncGPU(THFloatTensor *self, struct THGPUTensor *src)
+{
+  long nElement = THGPUTensor_nElement(src);
+  THArgCheck(THFloatTensor_nElement(self) == nElement, 2, "sizes do not match");
+  if (nElement == 0)
+    return THGPUEvent_newComplete();
+
+  THGPUPinnedBuffer *staging = THGPUPinnedBuffer_acquire(nElement);
+  src = THGPUTensor_newContiguous(src);
+
+  gpuEvent_t event = NULL;
+  float* src_ptr = static_cast<float*>(Concurrency::getAllocator().device_data(src->storage->data));
+  THGPUCheck(gpuMemcpyAsync(staging->host, 0,
+                            src_ptr, src->storageOffset * sizeof(float),
+                            nElement * sizeof(float),
+                            gpuMemcpyDeviceToHost, &event));
+
+  THGPUEvent *copyEvent = THGPUEvent_new(event, staging);
+  THFloatTensor_retain(self);
+  copyEvent->hostDst = self;
+  copyEvent->deviceSrc = src;
+  return copyEvent;
+}
+
+THGPUEvent* THGPUTensor_copyAsyncGPU(THGPUTensor *self, THGPUTensor *src)
+{
+  long nElement = THGPUTensor_nElement(self);
+  THArgCheck(nElement == THGPUTensor_nElement(src), 2, "sizes do not match");
+
+  if (self != src && THGPUTensor_isContiguous(self) && THGPUTensor_isContiguous(src) && nElement > 0)
+  {
+    gpuEvent_t event = NULL;
+    float* self_ptr = static_cast<float*>(Concurrency::getAllocator().device_data(self->storage->data));
+    float* src_ptr = static_cast<float*>(Concurrency::getAllocator().device_data(src->storage->data));
+    THGPUCheck(gpuMemcpyAsync(self_ptr, self->storageOffset * sizeof(float),
+                              src_ptr, src->storageOffset * sizeof(float),
+                              nElement * sizeof(float),
+                              gpuMemcpyDeviceToDevice, &event));
+    THGPUEvent *copyEvent = THGPUEvent_new(event, NULL);
+    THGPUTensor_retain(src);
+    THGPUTensor_retain(self);
+    copyEvent->deviceSrc = src;
+    copyEvent->deviceDst = self;
+    return copyEvent;
+  }
+
+  // strided copies go through the copy kernel
+  THGPUTensor_copy(self, src);
+  return THGPUEvent_newComplete();
+}
@@ -12,6 +12,8 @@ THC_API void THGPUTensor_copyInt(THGPUTensor *self, THIntTensor *src);
 THC_API void THGPUTensor_copyLong(THGPUTensor *self, THLongTensor *src);
 THC_API void THGPUTensor_copyFloat(THGPUTensor *self, THFloatTensor *src);
 THC_API void THGPUTensor_copyDouble(THGPUTensor *self, THDoubleTensor *src);
+/* the halves cross the bus packed, at half the bandwidth of floats */
+THC_API void THGPUTensor_copyHalf(THGPUTensor *self, THHalfTensor *src);
 
 THC_API void THByteTensor_copyGPU(THByteTensor *self, THGPUTensor *src);
 THC_API void THCharTensor_copyGPU(THCharTensor *self, THGPUTensor *src);
@@ -20,6 +22,38 @@ THC_API void THIntTensor_copyGPU(THIntTensor *self, THGPUTensor *src);
 THC_API void THLongTensor_copyGPU(THLongTensor *self, THGPUTensor *src);
 THC_API void THFloatTensor_copyGPU(THFloatTensor *self, THGPUTensor *src);
 THC_API void THDoubleTensor_copyGPU(THDoubleTensor *self, THGPUTensor *src);
+THC_API void THHalfTensor_copyGPU(THHalfTensor *self, THGPUTensor *src);
 THC_API void THGPUTensor_copyGPU(THGPUTensor *self, THGPUTensor *src);
 
+/* Asynchronous copies. They return as soon as the transfer is enqueued; the
+   returned event must be waited on (or freed, which waits) before reading
+   the destination. Host sources are staged through reused page-locked
+   buffers, so they may be modified as soon as the call returns. */
+typedef struct THGPUEvent THGPUEvent;
+
+THC_API THGPUEvent* THGPUTensor_copyAsyncByte(THGPUTensor *self, THByteTensor *src);
+THC_API THGPUEvent* THGPUTensor_copyAsyncChar(THGPUTensor *self, THCharTensor *src);
+THC_API THGPUEvent* THGPUTensor_copyAsyncShort(THGPUTensor *self, THShortTensor *src);
+THC_API THGPUEvent* THGPUTensor_copyAsyncInt(THGPUTensor *self, THIntTensor *src);
+THC_API THGPUEvent* THGPUTensor_copyAsyncLong(THGPUTensor *self, THLongTensor *src);
+THC_API THGPUEvent* THGPUTensor_copyAsyncFloat(THGPUTensor *self, THFloatTensor *src);
+THC_API THGPUEvent* THGPUTensor_copyAsyncDouble(THGPUTensor *self, THDoubleTensor *src);
+THC_API THGPUEvent* THGPUTensor_copyAsyncHalf(THGPUTensor *self, THHalfTensor *src);
+THC_API THGPUEvent* THGPUTensor_copyAsyncGPU(THGPUTensor *self, THGPUTensor *src);
+THC_API THGPUEvent* THFloatTensor_copyAsyncGPU(THFloatTensor *self, THGPUTensor *src);
+
+/* returns 1 once the copy is complete, 0 otherwise */
+THC_API int THGPUEvent_query(THGPUEvent *self);
+THC_API void THGPUEvent_synchronize(THGPUEvent *self);
+/* waits for the copy, then releases the event */
+THC_API void THGPUEvent_free(THGPUEvent *self);
+/* completes every outstanding asynchronous copy */
+THC_API void THGPUEvent_synchronizeAll(void);
+
+/* The idle staging buffers are kept within the caching allocator limit
+   (THGPUCachingAllocator_setLimit). trim releases idle ones, largest first,
+   until at most 'bytes' are held; buffers of pending copies are kept. */
+THC_API void THGPUPinnedBuffer_trim(long bytes);
+THC_API long THGPUPinnedBuffer_cachedBytes(void);
+
 #endif
@@ -8,6 +8,7 @@
 #include<utility>
 #include<numeric>
 #include "THCBolt.h"
+#include "THCCachingAllocator.h"
 
 #define NB_THREADS_PER_BLOCK 256
 
@@ -661,9 +662,8 @@ void THGPUTensor_addmv(THGPUTensor *r_, float beta, THGPUTensor *t, float alpha,
   int len_X = (lenX + 255) & ~255;
   int numBlocks = len_X / 256;
 
-  float* tempBuf = (float*)malloc(numBlocks*lenY*sizeof(float));
-  Concurrency::extent<1> ext(numBlocks*lenY);
-  Concurrency::array_view<float,1> temp_buf(ext, tempBuf);
+  Concurrency::array_view<float,1>* pavTempBuf = THGPUCachingAllocator_malloc(numBlocks*lenY);
+  Concurrency::array_view<float,1> &temp_buf = *pavTempBuf;
 
   if (mat->stride[0] == 1)
   {
@@ -692,6 +692,8 @@ void THGPUTensor_addmv(THGPUTensor *r_, float beta, THGPUTensor *t, float alpha,
 
     THGPUTensor_free(cmat);
   }
+
+  THGPUCachingAllocator_free(pavTempBuf);
 }
 
 void THGPUTensor_addmm(THGPUTensor *r_, float beta, THGPUTensor *t, float alpha, THGPUTensor *m1, THGPUTensor *m2)
@@ -806,6 +808,120 @@ void THGPUTensor_addmm(THGPUTensor *r_, float beta, THGPUTensor *t, float alpha,
     THGPUTensor_freeCopyTo(r__, r_);
 }
 
+/* The strides are the same for all the matrices of a batch: the layout is
+   settled once as in addmm, and the whole batch goes in one gemm launch */
+void THGPUTensor_baddbmm(THGPUTensor *r_, float beta, THGPUTensor *t, float alpha, THGPUTensor *batch1, THGPUTensor *batch2)
+{
+  char transpose_r, transpose_m1, transpose_m2;
+  THGPUTensor *r__, *m1_, *m2_;
+
+  if( (batch1->nDimension != 3) || (batch2->nDimension != 3) )
+    THError("batch of matrices expected");
+
+  if(t->nDimension != 3)
+    THError("size mismatch");
+
+  if( (t->size[0] != batch1->size[0]) || (batch2->size[0] != batch1->size[0]) ||
+      (t->size[1] != batch1->size[1]) || (t->size[2] != batch2->size[2]) || (batch1->size[2] != batch2->size[1]) )
+    THError("size mismatch");
+
+  if(t != r_)
+  {
+    THGPUTensor_resizeAs(r_, t);
+    THGPUTensor_copy(r_, t);
+  }
+
+  /* r_ */
+  if(r_->stride[1] == 1)
+  {
+    transpose_r = 'n';
+    r__ = r_;
+  }
+  else if(r_->stride[2] == 1)
+  {
+    THGPUTensor *swap = batch2;
+    batch2 = batch1;
+    batch1 = swap;
+    transpose_r = 't';
+    r__ = r_;
+  }
+  else
+  {
+    transpose_r = 'n';
+
+    r__ = THGPUTensor_newWithSize3d(r_->size[0], r_->size[2], r_->size[1]);
+    THGPUTensor_transpose(r__, NULL, 1, 2);
+    THGPUTensor_copy(r__, r_);
+  }
+
+  /* batch1 */
+  if(batch1->stride[(transpose_r == 'n' ? 1 : 2)] == 1)
+  {
+    transpose_m1 = 'n';
+    m1_ = batch1;
+  }
+  else if(batch1->stride[(transpose_r == 'n' ? 2 : 1)] == 1)
+  {
+    transpose_m1 = 't';
+    m1_ = batch1;
+  }
+  else
+  {
+    transpose_m1 = (transpose_r == 'n' ? 't' : 'n');
+    m1_ = THGPUTensor_newContiguous(batch1);
+  }
+
+  /* batch2 */
+  if(batch2->stride[(transpose_r == 'n' ? 1 : 2)] == 1)
+  {
+    transpose_m2 = 'n';
+    m2_ = batch2;
+  }
+  else if(batch2->stride[(transpose_r == 'n' ? 2 : 1)] == 1)
+  {
+    transpose_m2 = 't';
+    m2_ = batch2;
+  }
+  else
+  {
+    transpose_m2 = (transpose_r == 'n' ? 't' : 'n');
+    m2_ = THGPUTensor_newContiguous(batch2);
+  }
+
+  auto avM1Mat = m1_->get_array_view();
+  auto avM2Mat = m2_->get_array_view();
+  auto avRMat = r__->get_array_view();
+
+  /* do the operation */
+  THGPUBlas_gemmBatched(transpose_m1,
+                        transpose_m2,
+                        r__->size[0],
+                        r__->size[(transpose_r == 'n' ? 1 : 2)],
+                        r__->size[(transpose_r == 'n' ? 2 : 1)],
+                        m1_->size[(transpose_r == 'n' ? 2 : 1)],
+                        alpha,
+                        avM1Mat, m1_->storageOffset,
+                        (transpose_m1 == 'n' ? m1_->stride[(transpose_r == 'n' ? 2 : 1)] : m1_->stride[(transpose_r == 'n' ? 1 : 2)]),
+                        m1_->stride[0],
+                        avM2Mat, m2_->storageOffset,
+                        (transpose_m2 == 'n' ? m2_->stride[(transpose_r == 'n' ? 2 : 1)] : m2_->stride[(transpose_r == 'n' ? 1 : 2)]),
+                        m2_->stride[0],
+                        beta,
+                        avRMat, r__->storageOffset,
+                        r__->stride[(transpose_r == 'n' ? 2 : 1)],
+                        r__->stride[0]);
+
+  /* free intermediate variables */
+  if(m1_ != batch1)
+    THGPUTensor_free(m1_);
+
+  if(m2_ != batch2)
+    THGPUTensor_free(m2_);
+
+  if(r__ != r_)
+    THGPUTensor_freeCopyTo(r__, r_);
+}
+
 void THGPUTensor_addr(THGPUTensor *r_, float beta, THGPUTensor *t, float alpha, THGPUTensor *vec1, THGPUTensor *vec2)
 {
   if( (vec1->nDimension != 1) || (vec2->nDimension != 1) )
@@ -1463,3 +1579,143 @@ void THGPUTensor_indexSelect(THGPUTensor *res_, THGPUTensor *src, int dim, THLon
 
   delete stride_;
 }
+
+#define HISTC_THREADS 256
+#define HISTC_TILE_BINS 1024
+#define HISTC_MAX_TILES 256
+
+// Each tile bins its share of the elements (weighted or not) into the bins
+// [binStart, binStart+nBin) of a histogram in tile_static memory, then
+// writes it to its row of avPartial. There is no atomic float add: the
+// adds go through a compare-exchange loop on the bits of the float.
+void THGPUTensor_kernel_histcTiles(Concurrency::array_view<float,1> &avPartial,
+                                   Concurrency::array_view<float,1> &avSrc, long srcOffset,
+                                   Concurrency::array_view<float,1> &avWeights, long weightsOffset,
+                                   int weighted, long n, long binStart, int nBin,
+                                   float minval, float range, float bins, int nTile)
+{
+  Concurrency::extent<1> grdExt(nTile * HISTC_THREADS);
+  Concurrency::tiled_extent<HISTC_THREADS> t_ext(grdExt);
+
+  Concurrency::parallel_for_each(t_ext, [=] (Concurrency::tiled_index<HISTC_THREADS> tidx) restrict(amp)
+  {
+    tile_static unsigned int hist[HISTC_TILE_BINS];
+    int tx = tidx.local[0];
+
+    for (int b = tx; b < nBin; b += HISTC_THREADS)
+      hist[b] = 0; // the bits of 0.0f
+    tidx.barrier.wait();
+
+    for (long i = tidx.global[0]; i < n; i += (long)nTile * HISTC_THREADS)
+    {
+      float bin = Concurrency::fast_math::floor((avSrc[srcOffset + i] - minval) / range * bins) - binStart;
+      if (bin >= 0 && bin < nBin)
+      {
+        int b = (int)bin;
+        float w = weighted ? avWeights[weightsOffset + i] : 1.0f;
+        unsigned int expected = hist[b];
+        for (;;)
+        {
+          float sum = *(float*)&expected + w;
+          if (Concurrency::atomic_compare_exchange(&hist[b], &expected, *(unsigned int*)&sum))
+            break;
+        }
+      }
+    }
+    tidx.barrier.wait();
+
+    for (int b = tx; b < nBin; b += HISTC_THREADS)
+      avPartial[tidx.tile[0] * nBin + b] = *(float*)&hist[b];
+  });
+}
+
+// hist[binStart + b] = sum of the rows of avPartial, one thread per bin
+void THGPUTensor_kernel_histcMerge(Concurrency::array_view<float,1> &avHist, long histOffset, long histStride,
+                                   Concurrency::array_view<float,1> &avPartial,
+                                   long binStart, int nBin, int nTile)
+{
+  unsigned grdSz = (nBin + (HISTC_THREADS - 1)) & ~(HISTC_THREADS - 1);
+  Concurrency::extent<1> grdExt(grdSz);
+  Concurrency::tiled_extent<HISTC_THREADS> t_ext(grdExt);
+
+  Concurrency::parallel_for_each(t_ext, [=] (Concurrency::tiled_index<HISTC_THREADS> tidx) restrict(amp)
+  {
+    int b = tidx.global[0];
+    if (b < nBin)
+    {
+      float sum = 0;
+      for (int t = 0; t < nTile; t++)
+        sum += avPartial[t * nBin + b];
+      avHist[histOffset + (binStart + b) * histStride] = sum;
+    }
+  });
+}
+
+static void THGPUTensor_histcPass(THGPUTensor *hist, THGPUTensor *src, THGPUTensor *weights,
+                                  long nbins, float minval, float maxval)
+{
+  long n = THGPUTensor_nElement(src);
+  float bins = (float)nbins - 1e-6;
+
+  THGPUTensor_resize1d(hist, nbins);
+  if (n == 0)
+  {
+    THGPUTensor_zero(hist);
+    return;
+  }
+
+  src = THGPUTensor_newContiguous(src);
+  weights = (weights ? THGPUTensor_newContiguous(weights) : src);
+  int nTile = (int)std::min((long)HISTC_MAX_TILES, (n + HISTC_THREADS - 1) / HISTC_THREADS);
+  THGPUTensor *partial = THGPUTensor_newWithSize1d(nTile * std::min(nbins, (long)HISTC_TILE_BINS));
+
+  auto avHist = hist->get_array_view();
+  auto avSrc = src->get_array_view();
+  auto avWeights = weights->get_array_view();
+  auto avPartial = partial->get_array_view();
+
+  // the bins are done by ranges that fit in tile_static memory
+  for (long binStart = 0; binStart < nbins; binStart += HISTC_TILE_BINS)
+  {
+    int nBin = (int)std::min(nbins - binStart, (long)HISTC_TILE_BINS);
+    THGPUTensor_kernel_histcTiles(avPartial, avSrc, src->storageOffset,
+                                  avWeights, weights->storageOffset, weights != src,
+                                  n, binStart, nBin, minval, maxval - minval, bins, nTile);
+    THGPUTensor_kernel_histcMerge(avHist, hist->storageOffset, hist->stride[0],
+                                  avPartial, binStart, nBin, nTile);
+  }
+
+  THGPUTensor_free(partial);
+  if (weights != src)
+    THGPUTensor_free(weights);
+  THGPUTensor_free(src);
+}
+
+static void THGPUTensor_histcRange(THGPUTensor *src, float *minval, float *maxval)
+{
+  if (*minval == *maxval && THGPUTensor_nElement(src) > 0)
+  {
+    *minval = THGPUTensor_minall(src);
+    *maxval = THGPUTensor_maxall(src);
+  }
+  if (*minval == *maxval)
+  {
+    *minval = *minval - 1;
+    *maxval = *maxval + 1;
+  }
+}
+
+void THGPUTensor_histc(THGPUTensor *hist, THGPUTensor *src, long nbins, float minvalue, float maxvalue)
+{
+  THArgCheck(nbins > 0, 3, "number of bins must be positive");
+  THGPUTensor_histcRange(src, &minvalue, &maxvalue);
+  THGPUTensor_histcPass(hist, src, NULL, nbins, minvalue, maxvalue);
+}
+
+void THGPUTensor_histcw(THGPUTensor *hist, THGPUTensor *src, THGPUTensor *weights, long nbins, float minvalue, float maxvalue)
+{
+  THArgCheck(THGPUTensor_nElement(src) == THGPUTensor_nElement(weights), 3, "tensor and weights must have the same number of elements");
+  THArgCheck(nbins > 0, 4, "number of bins must be positive");
+  THGPUTensor_histcRange(src, &minvalue, &maxvalue);
+  THGPUTensor_histcPass(hist, src, weights, nbins, minvalue, maxvalue);
+}
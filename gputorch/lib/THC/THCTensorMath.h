@@ -38,6 +38,7 @@ THC_API void THGPUTensor_prod(THGPUTensor *self, THGPUTensor *src, long dim);
 
 THC_API void THGPUTensor_addmv(THGPUTensor *self, float beta, THGPUTensor *t, float alpha, THGPUTensor *mat, THGPUTensor *vec);
 THC_API void THGPUTensor_addmm(THGPUTensor *self, float beta, THGPUTensor *t, float alpha, THGPUTensor *mat1, THGPUTensor *mat2);
+THC_API void THGPUTensor_baddbmm(THGPUTensor *self, float beta, THGPUTensor *t, float alpha, THGPUTensor *batch1, THGPUTensor *batch2);
 THC_API void THGPUTensor_addr(THGPUTensor *self, float beta, THGPUTensor *t, float alpha, THGPUTensor *vec1, THGPUTensor *vec2);
 
 THC_API void THGPUTensor_log(THGPUTensor *self, THGPUTensor *src);
@@ -84,6 +85,8 @@ THC_API float THGPUTensor_normall(THGPUTensor *self, float value);
 THC_API void  THGPUTensor_norm(THGPUTensor* self, THGPUTensor* src, float value, long dimension);
 THC_API void  THGPUTensor_renorm(THGPUTensor* self, THGPUTensor* src, float value, long dimension, float max_norm);
 THC_API float THGPUTensor_dist(THGPUTensor *self, THGPUTensor *src, float value);
+THC_API void  THGPUTensor_histc(THGPUTensor *hist, THGPUTensor *src, long nbins, float minvalue, float maxvalue);
+THC_API void  THGPUTensor_histcw(THGPUTensor *hist, THGPUTensor *src, THGPUTensor *weights, long nbins, float minvalue, float maxvalue);
 
 THC_API void THGPUTensor_rand(THGPURNGState* rng_state,THGPUTensor *r_, THLongStorage *size);
 THC_API void THGPUTensor_randn(THGPURNGState* rng_state,THGPUTensor *r_, THLongStorage *size);
@@ -8,22 +8,92 @@
 #define DIVUP(x, y) (((x) + (y) - 1) / (y))
 #endif
 
+/* 32x32 -> 64 bit product in 16-bit halves (no 64-bit integers on device) */
+static inline void philoxMulHiLo(unsigned int a, unsigned int b, unsigned int &hi, unsigned int &lo) restrict(amp,cpu)
+{
+  unsigned int al = a & 0xFFFF, ah = a >> 16;
+  unsigned int bl = b & 0xFFFF, bh = b >> 16;
+  unsigned int ll = al * bl, lh = al * bh, hl = ah * bl, hh = ah * bh;
+  unsigned int mid = (ll >> 16) + (lh & 0xFFFF) + (hl & 0xFFFF);
+  hi = hh + (lh >> 16) + (hl >> 16) + (mid >> 16);
+  lo = a * b;
+}
+
+/* Philox4x32-10: the four random words of block ctr under key */
+static inline void philox(const unsigned int ctr[4], const unsigned int key[2], unsigned int out[4]) restrict(amp,cpu)
+{
+  unsigned int c0 = ctr[0], c1 = ctr[1], c2 = ctr[2], c3 = ctr[3];
+  unsigned int k0 = key[0], k1 = key[1];
+  for (int r = 0; r < 10; r++)
+  {
+    unsigned int hi0, lo0, hi1, lo1;
+    philoxMulHiLo(0xD2511F53, c0, hi0, lo0);
+    philoxMulHiLo(0xCD9E8D57, c2, hi1, lo1);
+    c0 = hi1 ^ c1 ^ k0;
+    c1 = lo1;
+    c2 = hi0 ^ c3 ^ k1;
+    c3 = lo0;
+    k0 += 0x9E3779B9;
+    k1 += 0xBB67AE85;
+  }
+  out[0] = c0; out[1] = c1; out[2] = c2; out[3] = c3;
+}
+
+/* Moves a counter n blocks ahead (the block index is its low 64 bits) */
+static inline void philoxAdvance(unsigned int ctr[4], unsigned int n) restrict(amp,cpu)
+{
+  ctr[0] += n;
+  if (ctr[0] < n)
+    ctr[1]++;
+}
+
+/* Uniform float in [0, 1), exact in float arithmetic */
+static inline float philoxUniform(unsigned int x) restrict(amp,cpu)
+{
+  return (float)(x >> 8) * (1.0f / 16777216.0f);
+}
+
+/* Blocks every thread consumes for a fill of size values, valuesPerBlock per block */
+static unsigned int philoxBlocks(long size, int valuesPerBlock)
+{
+  long perThread = DIVUP(size, THC_RNG_THREADS);
+  return (unsigned int)DIVUP(perThread, valuesPerBlock);
+}
+
 /* Sets up generator. Allocates but does not create the generator states. */
 void initializeGenerator(Generator* gen)
 {
-  //TODO : To be implemented.
+  if (gen->gen_states == NULL)
+    gen->gen_states = new Concurrency::array<unsigned int, 1>(THC_RNG_THREADS * THC_RNG_STATE_WORDS);
 }
 
 /* Frees memory allocated during setup. */
 void destroyGenerator(Generator* gen)
 {
-  //TODO : To be implemented.
+  delete gen->gen_states;
+  gen->gen_states = NULL;
 }
 
-/* Creates a new generator state given the seed. */
+/* Creates a new generator state given the seed: thread t starts at block 0
+   of stream t (counter word 2), keyed by the seed */
 void createGeneratorState(Generator* gen, unsigned long seed)
 {
-  //TODO : To be implemented.
+  Concurrency::array<unsigned int, 1> &states = *gen->gen_states;
+  unsigned int seedLo = (unsigned int)(seed & 0xFFFFFFFFUL);
+  unsigned int seedHi = (unsigned int)((unsigned long long)seed >> 32);
+  Concurrency::extent<1> grdExt(THC_RNG_THREADS);
+  Concurrency::tiled_extent<BLOCK_SIZE> t_ext(grdExt);
+
+  Concurrency::parallel_for_each(t_ext, [=, &states] (Concurrency::tiled_index<BLOCK_SIZE> tidx) restrict(amp)
+  {
+    int t = tidx.global[0];
+    states[t * THC_RNG_STATE_WORDS + 0] = 0;
+    states[t * THC_RNG_STATE_WORDS + 1] = 0;
+    states[t * THC_RNG_STATE_WORDS + 2] = t;
+    states[t * THC_RNG_STATE_WORDS + 3] = 0;
+    states[t * THC_RNG_STATE_WORDS + 4] = seedLo;
+    states[t * THC_RNG_STATE_WORDS + 5] = seedHi;
+  });
 }
 
 /* Initialize generator array (must be called before any other function) */
@@ -106,7 +176,14 @@ void THCRandom_manualSeed(THGPURNGState* state, unsigned long seed)
 
 void THCRandom_manualSeedAll(THGPURNGState* state, unsigned long seed)
 {
-  //TODO : To be implemented.
+  Generator* current = state->current_gen;
+  for (int i = 0; i < state->num_devices; ++i)
+  {
+    state->current_gen = &state->gen[i];
+    initializeGenerator(state->current_gen);
+    THCRandom_manualSeed(state, seed);
+  }
+  state->current_gen = current;
 }
 
 /* Get the initial seed */
@@ -115,73 +192,186 @@ unsigned long THCRandom_initialSeed(THGPURNGState* state)
   return state->current_gen->initial_seed;
 }
 
+/* The state is the initial seed followed by the state words of every thread */
 void THCRandom_getRNGState(THGPURNGState* state, THByteTensor *rng_state)
 {
-  //TODO : To be implemented.
+  static const size_t seed_size = sizeof(unsigned long);
+  static const size_t states_size = THC_RNG_THREADS * THC_RNG_STATE_WORDS * sizeof(unsigned int);
+  THByteTensor_resize1d(rng_state, seed_size + states_size);
+  THArgCheck(THByteTensor_nElement(rng_state) == seed_size + states_size, 1, "RNG state is wrong size");
+  THArgCheck(THByteTensor_isContiguous(rng_state), 1, "RNG state must be contiguous");
+  unsigned char *data = THByteTensor_data(rng_state);
+  memcpy(data, &state->current_gen->initial_seed, seed_size);
+  Concurrency::copy(*state->current_gen->gen_states, (unsigned int*)(data + seed_size));
 }
 
 void THCRandom_setRNGState(THGPURNGState* state, THByteTensor *rng_state)
 {
-  //TODO : To be implemented.
+  static const size_t seed_size = sizeof(unsigned long);
+  static const size_t states_size = THC_RNG_THREADS * THC_RNG_STATE_WORDS * sizeof(unsigned int);
+  THArgCheck(THByteTensor_nElement(rng_state) == seed_size + states_size, 1, "RNG state is wrong size");
+  THArgCheck(THByteTensor_isContiguous(rng_state), 1, "RNG state must be contiguous");
+  unsigned char *data = THByteTensor_data(rng_state);
+  memcpy(&state->current_gen->initial_seed, data, seed_size);
+  unsigned int *words = (unsigned int*)(data + seed_size);
+  Concurrency::copy(words, words + THC_RNG_THREADS * THC_RNG_STATE_WORDS, *state->current_gen->gen_states);
 }
 
-// TODO: currently can't use pfe since no kernel versions of all CURAND_FUNC from underlying AMP
-// Just prepare data on host and then copy to device side of the array
-#define GENERATE_KERNEL1(NAME, ARG1, CURAND_FUNC, TRANSFORM)                                               \
-void NAME(int size, THGPUTensor *result, ARG1)                                                             \
+/* Thread t writes elements t, t + THC_RNG_THREADS, ... : the j-th one gets
+   value j of its stream, word j%4 of block j/4 for the uniform-based
+   distributions. TRANSFORM maps the uniform x in [0, 1) to the result. */
+#define GENERATE_KERNEL_BODY(TRANSFORM)                                                                    \
+  Concurrency::array<unsigned int, 1> &states = *gen->gen_states;                                          \
+  Concurrency::array_view<float, 1> avResult = result->get_array_view();                                   \
+  long offset = result->storageOffset;                                                                     \
+  unsigned int blocks = philoxBlocks(size, 4);                                                             \
+  Concurrency::extent<1> grdExt(THC_RNG_THREADS);                                                          \
+  Concurrency::tiled_extent<BLOCK_SIZE> t_ext(grdExt);                                                     \
+  Concurrency::parallel_for_each(t_ext, [=, &states] (Concurrency::tiled_index<BLOCK_SIZE> tidx) restrict(amp) \
+  {                                                                                                        \
+    int t = tidx.global[0];                                                                                \
+    unsigned int ctr[4], key[2], r[4];                                                                     \
+    for (int w = 0; w < 4; w++)                                                                            \
+      ctr[w] = states[t * THC_RNG_STATE_WORDS + w];                                                        \
+    key[0] = states[t * THC_RNG_STATE_WORDS + 4];                                                          \
+    key[1] = states[t * THC_RNG_STATE_WORDS + 5];                                                          \
+    for (long j = 0, i = t; i < size; j++, i += THC_RNG_THREADS)                                           \
+    {                                                                                                      \
+      if ((j & 3) == 0)                                                                                    \
+      {                                                                                                    \
+        philox(ctr, key, r);                                                                               \
+        philoxAdvance(ctr, 1);                                                                             \
+      }                                                                                                    \
+      float x = philoxUniform(r[j & 3]);                                                                   \
+      avResult[offset + i] = TRANSFORM;                                                                    \
+    }                                                                                                      \
+    for (int w = 0; w < 4; w++)                                                                            \
+      ctr[w] = states[t * THC_RNG_STATE_WORDS + w];                                                        \
+    philoxAdvance(ctr, blocks);                                                                            \
+    for (int w = 0; w < 4; w++)                                                                            \
+      states[t * THC_RNG_STATE_WORDS + w] = ctr[w];                                                        \
+  });
+
+#define GENERATE_KERNEL1(NAME, ARG1, TRANSFORM)                                                            \
+void NAME(Generator* gen, long size, THGPUTensor *result, ARG1)                                            \
 {                                                                                                          \
-  std::mt19937 gen;                                                                                        \
-  float vec[size];                                                                                         \
-  for (int i = 0; i < size; i++) {                                                                         \
-    std::CURAND_FUNC<float> rand(0.0, 0.9);                                                                \
-    float x = rand(gen);                                                                                   \
-    x = TRANSFORM;                                                                                         \
-    vec[i] = x;                                                                                            \
-  }                                                                                                        \
-  float* device_ptr = static_cast<float*>(Concurrency::getAllocator().device_data(result->storage->data)); \
-  THGPUCheck(gpuMemcpy(device_ptr, result->storageOffset * sizeof(float), vec, 0, size * sizeof(float), gpuMemcpyHostToDevice));\
+  GENERATE_KERNEL_BODY(TRANSFORM)                                                                          \
 }
 
-// TODO: currently can't use pfe since no kernel versions of all CURAND_FUNC from underlying AMP
-// Just prepare data on host and then copy to device side of the array
-#define GENERATE_KERNEL2(NAME, ARG1, ARG2, CURAND_FUNC, TRANSFORM)                                         \
-void NAME(int size, THGPUTensor *result, ARG1, ARG2)                                                       \
+#define GENERATE_KERNEL2(NAME, ARG1, ARG2, TRANSFORM)                                                      \
+void NAME(Generator* gen, long size, THGPUTensor *result, ARG1, ARG2)                                      \
 {                                                                                                          \
-  std::mt19937 gen;                                                                                        \
-  float vec[size];                                                                                         \
-  for (int i = 0; i < size; i++) {                                                                         \
-    std::CURAND_FUNC<float> rand(0, 0.9);                                                                  \
-    float x = rand(gen);                                                                                   \
-    x = TRANSFORM;                                                                                         \
-    vec[i] = x;                                                                                            \
-  }                                                                                                        \
-  float* device_ptr = static_cast<float*>(Concurrency::getAllocator().device_data(result->storage->data)); \
-  THGPUCheck(gpuMemcpy(device_ptr, result->storageOffset * sizeof(float), vec, 0, size * sizeof(float), gpuMemcpyHostToDevice));\
+  GENERATE_KERNEL_BODY(TRANSFORM)                                                                          \
 }
 
-GENERATE_KERNEL2(generate_uniform, double a, double b, uniform_real_distribution, x * (b - a) + a)
-GENERATE_KERNEL1(generate_bernoulli, double p, uniform_real_distribution, (float)x <= p)
-GENERATE_KERNEL2(generate_normal, double mean, double stdv, normal_distribution,(float)((x * stdv) + mean))
-GENERATE_KERNEL1(generate_geometric, double p, uniform_real_distribution, (log(1 - x) / log(p)) + 1)
-GENERATE_KERNEL1(generate_exponential, double lambda, uniform_real_distribution, (float)(-1. / lambda * log(1 - x)))
-GENERATE_KERNEL2(generate_cauchy, double median, double sigma, uniform_real_distribution, (float)(median + sigma * tan(M_PI*(x-0.5))))
+GENERATE_KERNEL2(generate_uniform, float a, float b, x * (b - a) + a)
+GENERATE_KERNEL1(generate_bernoulli, float p, (float)(x < p))
+GENERATE_KERNEL1(generate_geometric, float p, Concurrency::fast_math::floor(Concurrency::fast_math::log(1 - x) / Concurrency::fast_math::log(p)) + 1)
+GENERATE_KERNEL1(generate_exponential, float lambda, -1.0f / lambda * Concurrency::fast_math::log(1 - x))
+GENERATE_KERNEL2(generate_cauchy, float median, float sigma, median + sigma * Concurrency::fast_math::tan(3.14159265358979323846f * (x - 0.5f)))
 
+#undef GENERATE_KERNEL_BODY
 #undef GENERATE_KERNEL1
 #undef GENERATE_KERNEL2
 
-/* Separate kernel because curand_log_normal gets extra parameters. */
-void generate_log_normal(int size, THGPUTensor *self_, float mean, float stddev)
+/* Box-Muller on words (2k, 2k+1) of a block: one normal value each, two per
+   block. The first uniform is taken in (0, 1] to keep the log finite. */
+static inline float philoxNormal(unsigned int x, unsigned int y) restrict(amp)
+{
+  float u = philoxUniform(x) + (1.0f / 16777216.0f);
+  float v = philoxUniform(y);
+  return Concurrency::fast_math::sqrt(-2.0f * Concurrency::fast_math::log(u)) *
+         Concurrency::fast_math::cos(6.28318530717958647692f * v);
+}
+
+static inline float philoxNormalHost(unsigned int x, unsigned int y)
 {
-  std::mt19937 gen;
-  float vec[size];
-  for (int i = 0; i < size; i++)
+  float u = philoxUniform(x) + (1.0f / 16777216.0f);
+  float v = philoxUniform(y);
+  return sqrtf(-2.0f * logf(u)) * cosf(6.28318530717958647692f * v);
+}
+
+/* LOGNORMAL: exponentiate the normal values */
+static void generate_normal_kernel(Generator* gen, long size, THGPUTensor *result, float mean, float stdv, int lognormal)
+{
+  Concurrency::array<unsigned int, 1> &states = *gen->gen_states;
+  Concurrency::array_view<float, 1> avResult = result->get_array_view();
+  long offset = result->storageOffset;
+  unsigned int blocks = philoxBlocks(size, 2);
+  Concurrency::extent<1> grdExt(THC_RNG_THREADS);
+  Concurrency::tiled_extent<BLOCK_SIZE> t_ext(grdExt);
+
+  Concurrency::parallel_for_each(t_ext, [=, &states] (Concurrency::tiled_index<BLOCK_SIZE> tidx) restrict(amp)
+  {
+    int t = tidx.global[0];
+    unsigned int ctr[4], key[2], r[4];
+    for (int w = 0; w < 4; w++)
+      ctr[w] = states[t * THC_RNG_STATE_WORDS + w];
+    key[0] = states[t * THC_RNG_STATE_WORDS + 4];
+    key[1] = states[t * THC_RNG_STATE_WORDS + 5];
+    for (long j = 0, i = t; i < size; j++, i += THC_RNG_THREADS)
+    {
+      if ((j & 1) == 0)
+      {
+        philox(ctr, key, r);
+        philoxAdvance(ctr, 1);
+      }
+      float x = philoxNormal(r[2 * (j & 1)], r[2 * (j & 1) + 1]) * stdv + mean;
+      avResult[offset + i] = lognormal ? Concurrency::fast_math::exp(x) : x;
+    }
+    for (int w = 0; w < 4; w++)
+      ctr[w] = states[t * THC_RNG_STATE_WORDS + w];
+    philoxAdvance(ctr, blocks);
+    for (int w = 0; w < 4; w++)
+      states[t * THC_RNG_STATE_WORDS + w] = ctr[w];
+  });
+}
+
+void generate_normal(Generator* gen, long size, THGPUTensor *result, float mean, float stdv)
+{
+  generate_normal_kernel(gen, size, result, mean, stdv, 0);
+}
+
+void generate_log_normal(Generator* gen, long size, THGPUTensor *result, float mean, float stdv)
+{
+  generate_normal_kernel(gen, size, result, mean, stdv, 1);
+}
+
+/* Host replica of what the next fill of the current generator would write,
+   without advancing it: uniform on [0, 1) and bernoulli match the device bit
+   for bit, normal up to the device's transcendental functions */
+void THCRandom_referenceFill(THGPURNGState* state, THFloatTensor *self, int distribution, double a, double b)
+{
+  THArgCheck(THFloatTensor_isContiguous(self), 2, "contiguous tensor expected");
+  long size = THFloatTensor_nElement(self);
+  float *data = THFloatTensor_data(self);
+  unsigned int *words = (unsigned int*)THAlloc(THC_RNG_THREADS * THC_RNG_STATE_WORDS * sizeof(unsigned int));
+  Concurrency::copy(*state->current_gen->gen_states, words);
+
+  for (int t = 0; t < THC_RNG_THREADS; t++)
   {
-    std::lognormal_distribution<float> rand(mean, stddev);
-    float x = rand(gen);
-    vec[i] = x;
+    unsigned int ctr[4], key[2], r[4];
+    unsigned int *w = words + t * THC_RNG_STATE_WORDS;
+    int perBlock = (distribution == THC_RNG_NORMAL) ? 2 : 4;
+    ctr[0] = w[0]; ctr[1] = w[1]; ctr[2] = w[2]; ctr[3] = w[3];
+    key[0] = w[4]; key[1] = w[5];
+    for (long j = 0, i = t; i < size; j++, i += THC_RNG_THREADS)
+    {
+      if (j % perBlock == 0)
+      {
+        philox(ctr, key, r);
+        philoxAdvance(ctr, 1);
+      }
+      if (distribution == THC_RNG_NORMAL)
+        data[i] = philoxNormalHost(r[2 * (j & 1)], r[2 * (j & 1) + 1]) * (float)b + (float)a;
+      else
+      {
+        float x = philoxUniform(r[j & 3]);
+        data[i] = (distribution == THC_RNG_UNIFORM) ? x * ((float)b - (float)a) + (float)a : (float)(x < (float)a);
+      }
+    }
   }
-  float* device_ptr = static_cast<float*>(Concurrency::getAllocator().device_data(self_->storage->data));
-  THGPUCheck(gpuMemcpy(device_ptr, self_->storageOffset * sizeof(float), vec, 0, size * sizeof(float), gpuMemcpyHostToDevice));
+  THFree(words);
 }
 
 #define NUM_BLOCKS min((int)DIVUP(size, BLOCK_SIZE), MAX_NUM_BLOCKS)
@@ -190,7 +380,7 @@ void THGPUTensor_uniform(THGPURNGState* state, THGPUTensor *self_, double a, dou
   THGPUTensor *self = THGPUTensor_newContiguous(self_);
   long size = THGPUTensor_nElement(self);
 
-  generate_uniform(size, self, a, b);
+  generate_uniform(state->current_gen, size, self, a, b);
 
   THGPUTensor_freeCopyTo(self, self_);
 };
@@ -200,7 +390,7 @@ void THGPUTensor_bernoulli(THGPURNGState* state, THGPUTensor *self_, double p)
   THGPUTensor *self = THGPUTensor_newContiguous(self_);
   long size = THGPUTensor_nElement(self);
 
-  generate_bernoulli(size, self, p);
+  generate_bernoulli(state->current_gen, size, self, p);
 
   THGPUTensor_freeCopyTo(self, self_);
 };
@@ -210,7 +400,7 @@ void THGPUTensor_normal(THGPURNGState* state, THGPUTensor *self_, double mean, d
   THGPUTensor *self = THGPUTensor_newContiguous(self_);
   long size = THGPUTensor_nElement(self);
 
-  generate_normal(size, self, mean, stdv);
+  generate_normal(state->current_gen, size, self, mean, stdv);
 
   THGPUTensor_freeCopyTo(self, self_);
 };
@@ -219,7 +409,7 @@ void THGPUTensor_logNormal(THGPURNGState* state, THGPUTensor *self_, double mean
 {
   THGPUTensor *self = THGPUTensor_newContiguous(self_);
   long size = THGPUTensor_nElement(self);
-  generate_log_normal(size, self_, mean, stdv);
+  generate_log_normal(state->current_gen, size, self, mean, stdv);
 
   THGPUTensor_freeCopyTo(self, self_);
 };
@@ -229,7 +419,7 @@ void THGPUTensor_geometric(THGPURNGState* state, THGPUTensor *self_, double p)
   THGPUTensor *self = THGPUTensor_newContiguous(self_);
   long size = THGPUTensor_nElement(self);
 
-  generate_geometric(size, self, p);
+  generate_geometric(state->current_gen, size, self, p);
 
   THGPUTensor_freeCopyTo(self, self_);
 };
@@ -239,7 +429,7 @@ void THGPUTensor_exponential(THGPURNGState* state, THGPUTensor *self_, double la
   THGPUTensor *self = THGPUTensor_newContiguous(self_);
   long size = THGPUTensor_nElement(self);
 
-  generate_exponential(size, self, lambda);
+  generate_exponential(state->current_gen, size, self, lambda);
 
   THGPUTensor_freeCopyTo(self, self_);
 };
@@ -249,8 +439,110 @@ void THGPUTensor_cauchy(THGPURNGState* state, THGPUTensor *self_, double median,
   THGPUTensor *self = THGPUTensor_newContiguous(self_);
   long size = THGPUTensor_nElement(self);
 
-  generate_cauchy(size, self, median, sigma);
+  generate_cauchy(state->current_gen, size, self, median, sigma);
 
   THGPUTensor_freeCopyTo(self, self_);
 };
 #undef NUM_BLOCKS
+
+/* Element i is kept with probability 1-p: bit i%24 of word i/24 of mask is
+   set and output[i] = input[i]*scale, 0 if dropped. Each word is a float
+   holding an integer below 2^24, exact under any float copy. Thread t draws
+   the words t, t + THC_RNG_THREADS, ..., 24 uniforms (6 blocks) each, so that
+   no two threads write the same word. */
+void THGPUTensor_dropout(THGPURNGState* state, THGPUTensor *output_, THGPUTensor *mask, THGPUTensor *input_, double p, double scale)
+{
+  THGPUTensor *input = THGPUTensor_newContiguous(input_);
+  long size = THGPUTensor_nElement(input);
+  long nWord = DIVUP(size, THGPU_DROPOUT_MASK_BITS);
+  THGPUTensor_resizeAs(output_, input);
+  THGPUTensor_resize1d(mask, nWord);
+  THGPUTensor *output = THGPUTensor_newContiguous(output_);
+
+  if (size > 0)
+  {
+    Concurrency::array<unsigned int, 1> &states = *state->current_gen->gen_states;
+    Concurrency::array_view<float, 1> avInput = input->get_array_view();
+    Concurrency::array_view<float, 1> avOutput = output->get_array_view();
+    Concurrency::array_view<float, 1> avMask = mask->get_array_view();
+    long inputOffset = input->storageOffset, outputOffset = output->storageOffset;
+    long maskOffset = mask->storageOffset;
+    float keep = (float)(1 - p), fscale = (float)scale;
+    unsigned int blocks = THGPU_DROPOUT_MASK_BITS / 4 * philoxBlocks(nWord, 1);
+    Concurrency::extent<1> grdExt(THC_RNG_THREADS);
+    Concurrency::tiled_extent<BLOCK_SIZE> t_ext(grdExt);
+
+    Concurrency::parallel_for_each(t_ext, [=, &states] (Concurrency::tiled_index<BLOCK_SIZE> tidx) restrict(amp)
+    {
+      int t = tidx.global[0];
+      unsigned int ctr[4], key[2], r[4];
+      for (int w = 0; w < 4; w++)
+        ctr[w] = states[t * THC_RNG_STATE_WORDS + w];
+      key[0] = states[t * THC_RNG_STATE_WORDS + 4];
+      key[1] = states[t * THC_RNG_STATE_WORDS + 5];
+      for (long w = t; w < nWord; w += THC_RNG_THREADS)
+      {
+        unsigned int bits = 0;
+        for (int k = 0; k < THGPU_DROPOUT_MASK_BITS; k++)
+        {
+          if ((k & 3) == 0)
+          {
+            philox(ctr, key, r);
+            philoxAdvance(ctr, 1);
+          }
+          long i = THGPU_DROPOUT_MASK_BITS * w + k;
+          if (i < size)
+          {
+            unsigned int kept = philoxUniform(r[k & 3]) < keep;
+            bits |= kept << k;
+            avOutput[outputOffset + i] = kept ? avInput[inputOffset + i] * fscale : 0;
+          }
+        }
+        avMask[maskOffset + w] = (float)bits;
+      }
+      for (int w = 0; w < 4; w++)
+        ctr[w] = states[t * THC_RNG_STATE_WORDS + w];
+      philoxAdvance(ctr, blocks);
+      for (int w = 0; w < 4; w++)
+        states[t * THC_RNG_STATE_WORDS + w] = ctr[w];
+    });
+  }
+
+  THGPUTensor_free(input);
+  THGPUTensor_freeCopyTo(output, output_);
+}
+
+/* gradInput[i] = gradOutput[i]*scale where bit i of the mask of
+   THGPUTensor_dropout is set, 0 elsewhere */
+void THGPUTensor_dropoutBackward(THGPUTensor *gradInput_, THGPUTensor *mask, THGPUTensor *gradOutput_, double scale)
+{
+  THGPUTensor *gradOutput = THGPUTensor_newContiguous(gradOutput_);
+  long size = THGPUTensor_nElement(gradOutput);
+  THArgCheck(THGPUTensor_nElement(mask) == DIVUP(size, THGPU_DROPOUT_MASK_BITS), 2, "mask does not match gradOutput");
+  THGPUTensor_resizeAs(gradInput_, gradOutput);
+  THGPUTensor *gradInput = THGPUTensor_newContiguous(gradInput_);
+
+  if (size > 0)
+  {
+    Concurrency::array_view<float, 1> avGradOutput = gradOutput->get_array_view();
+    Concurrency::array_view<float, 1> avGradInput = gradInput->get_array_view();
+    Concurrency::array_view<float, 1> avMask = mask->get_array_view();
+    long gradOutputOffset = gradOutput->storageOffset, gradInputOffset = gradInput->storageOffset;
+    long maskOffset = mask->storageOffset;
+    float fscale = (float)scale;
+    Concurrency::extent<1> grdExt(DIVUP(size, BLOCK_SIZE) * BLOCK_SIZE);
+    Concurrency::tiled_extent<BLOCK_SIZE> t_ext(grdExt);
+
+    Concurrency::parallel_for_each(t_ext, [=] (Concurrency::tiled_index<BLOCK_SIZE> tidx) restrict(amp)
+    {
+      long i = tidx.global[0];
+      if (i >= size) return;
+      unsigned int word = (unsigned int)avMask[maskOffset + i / THGPU_DROPOUT_MASK_BITS];
+      unsigned int kept = (word >> (i % THGPU_DROPOUT_MASK_BITS)) & 1;
+      avGradInput[gradInputOffset + i] = kept ? avGradOutput[gradOutputOffset + i] * fscale : 0;
+    });
+  }
+
+  THGPUTensor_free(gradOutput);
+  THGPUTensor_freeCopyTo(gradInput, gradInput_);
+}
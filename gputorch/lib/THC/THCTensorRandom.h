@@ -2,11 +2,21 @@
 #define TH_GPU_TENSOR_RANDOM_INC
 
 #include "THCTensor.h"
-#include <random>
+
+/* Counter-based Philox4x32-10 generator [Salmon et al., SC'11]. Each of the
+   THC_RNG_THREADS device threads owns a 128-bit counter and a 64-bit key in
+   device memory. A fill draws from the streams of all threads and advances
+   every counter by the same number of blocks, so a seed fixes the values of
+   every later fill. */
+#define THC_RNG_THREADS (64 * 256)
+#define THC_RNG_STATE_WORDS 6  /* counter[4], key[2] */
+
+/* Distributions with a host reference (THCRandom_referenceFill) */
+enum { THC_RNG_UNIFORM, THC_RNG_NORMAL, THC_RNG_BERNOULLI };
 
 /* Generator */
 typedef struct _Generator {
-  std::mt19937* gen_states;
+  Concurrency::array<unsigned int, 1>* gen_states;
   int initf;
   unsigned long initial_seed;
 } Generator;
@@ -29,6 +39,7 @@ THC_API void THCRandom_manualSeedAll(THGPURNGState* state, unsigned long the_see
 THC_API unsigned long THCRandom_initialSeed(THGPURNGState* state);
 THC_API void THCRandom_getRNGState(THGPURNGState* state, THByteTensor *rng_state);
 THC_API void THCRandom_setRNGState(THGPURNGState* state, THByteTensor *rng_state);
+THC_API void THCRandom_referenceFill(THGPURNGState* state, THFloatTensor *self, int distribution, double a, double b);
 THC_API void THGPUTensor_geometric(THGPURNGState* state, THGPUTensor *self, double p);
 THC_API void THGPUTensor_bernoulli(THGPURNGState* state, THGPUTensor *self, double p);
 THC_API void THGPUTensor_uniform(THGPURNGState* state, THGPUTensor *self, double a, double b);
@@ -37,5 +48,11 @@ THC_API void THGPUTensor_exponential(THGPURNGState* state, THGPUTensor *self, do
 THC_API void THGPUTensor_cauchy(THGPURNGState* state, THGPUTensor *self, double median, double sigma);
 THC_API void THGPUTensor_logNormal(THGPURNGState* state, THGPUTensor *self, double mean, double stdv);
 
+/* Fused dropout: the mask holds one bit per element, THGPU_DROPOUT_MASK_BITS
+   per element of a GPUTensor, each word stored as an integer-valued float */
+#define THGPU_DROPOUT_MASK_BITS 24
+THC_API void THGPUTensor_dropout(THGPURNGState* state, THGPUTensor *output, THGPUTensor *mask, THGPUTensor *input, double p, double scale);
+THC_API void THGPUTensor_dropoutBackward(THGPUTensor *gradInput, THGPUTensor *mask, THGPUTensor *gradOutput, double scale);
+
 #endif
 
@@ -70,84 +70,169 @@ int gpuMemcpy(void* dst, size_t dst_offset, void* src, size_t src_offset,
   return 0;
 }
 
-// FIXME: is it correct?
+int gpuMemcpy3D(void* dst, size_t dst_offset, size_t dst_row_pitch, size_t dst_slice_pitch,
+                void* src, size_t src_offset, size_t src_row_pitch, size_t src_slice_pitch,
+                size_t width, size_t height, size_t depth, gpuMemcpyKind kind)
+{
+  size_t region[3] = {width, height, depth};
+  size_t host_origin[3] = {0, 0, 0};
+  cl_int err = CL_SUCCESS;
+
+  switch(kind)
+  {
+    case gpuMemcpyHostToDevice: {
+      size_t buffer_origin[3] = {dst_offset, 0, 0};
+      err = clEnqueueWriteBufferRect(Concurrency::getAllocator().getQueue(),
+                                     static_cast<cl_mem>(dst), CL_TRUE,
+                                     buffer_origin, host_origin, region,
+                                     dst_row_pitch, dst_slice_pitch,
+                                     src_row_pitch, src_slice_pitch,
+                                     static_cast<char*>(src) + src_offset, 0, NULL, NULL);
+      break;
+    }
+
+    case gpuMemcpyDeviceToHost: {
+      size_t buffer_origin[3] = {src_offset, 0, 0};
+      err = clEnqueueReadBufferRect(Concurrency::getAllocator().getQueue(),
+                                    static_cast<cl_mem>(src), CL_TRUE,
+                                    buffer_origin, host_origin, region,
+                                    src_row_pitch, src_slice_pitch,
+                                    dst_row_pitch, dst_slice_pitch,
+                                    static_cast<char*>(dst) + dst_offset, 0, NULL, NULL);
+      break;
+    }
+
+    default:
+      return 1;
+  }
+
+  if (err != CL_SUCCESS)
+  {
+    printf("Rect copy error = %d\n", err);
+    exit(1);
+  }
+
+  return 0;
+}
+
 int gpuMemcpyAsync(void* dst, size_t dst_offset, void* src, size_t src_offset,
-                   size_t count, gpuMemcpyKind kind)
+                   size_t count, gpuMemcpyKind kind, gpuEvent_t *event)
 {
+  cl_event clEvent = NULL;
+  cl_int err = CL_SUCCESS;
+
   switch(kind)
   {
     case gpuMemcpyHostToHost:
       memcpy(dst, src, count);
       break;
 
-    case gpuMemcpyDeviceToHost: {
-      cl_event event;
-      cl_int err = clEnqueueWriteBuffer(Concurrency::getAllocator().getQueue(),
-                                        static_cast<cl_mem>(src), CL_FALSE, src_offset,
-                                        count, dst, 0, NULL, &event);
+    case gpuMemcpyDeviceToHost:
+      err = clEnqueueReadBuffer(Concurrency::getAllocator().getQueue(),
+                                static_cast<cl_mem>(src), CL_FALSE, src_offset,
+                                count, dst, 0, NULL, &clEvent);
+      break;
 
-      if (err != CL_SUCCESS)
-      {
-        printf("WriteSync error = %d\n", err);
-        exit(1);
-      }
+    case gpuMemcpyHostToDevice:
+      err = clEnqueueWriteBuffer(Concurrency::getAllocator().getQueue(),
+                                 static_cast<cl_mem>(dst), CL_FALSE, dst_offset,
+                                 count, src, 0, NULL, &clEvent);
+      break;
 
-      cl_int status = CL_QUEUED;
-      while(status != CL_COMPLETE)
-      {
-        clGetEventInfo(event, CL_EVENT_COMMAND_EXECUTION_STATUS,
-                       sizeof(cl_int), &status, NULL);
-      }
+    case gpuMemcpyDeviceToDevice:
+      err = clEnqueueCopyBuffer(Concurrency::getAllocator().getQueue(),
+                                static_cast<cl_mem>(src), static_cast<cl_mem>(dst),
+                                src_offset, dst_offset, count, 0, NULL, &clEvent);
+      break;
 
+    case gpuMemcpyDefault:
       break;
-    }
+  }
 
-    case gpuMemcpyHostToDevice: {
-      cl_event event;
-      cl_int err = clEnqueueReadBuffer(Concurrency::getAllocator().getQueue(),
-                                       static_cast<cl_mem>(dst), CL_FALSE, dst_offset,
-                                       count, src, 0, NULL, &event);
+  if (err != CL_SUCCESS)
+  {
+    printf("CopyAsync error = %d\n", err);
+    exit(1);
+  }
 
-      if (err != CL_SUCCESS)
-      {
-        printf("ReadSync error = %d\n", err);
-        exit(1);
-      }
+  // Make sure the command is submitted to the device, not only queued
+  clFlush(Concurrency::getAllocator().getQueue());
 
-      cl_int status = CL_QUEUED;
-      while(status != CL_COMPLETE)
-      {
-        clGetEventInfo(event, CL_EVENT_COMMAND_EXECUTION_STATUS,
-                       sizeof(cl_int), &status, NULL);
-      }
+  if (event)
+    *event = clEvent;
+  else if (clEvent)
+    clReleaseEvent(clEvent);
 
-      break;
-    }
+  return 0;
+}
 
-    case gpuMemcpyDeviceToDevice: {
-      cl_event event;
-      cl_int err = clEnqueueCopyBuffer (Concurrency::getAllocator().getQueue(),
-                                        static_cast<cl_mem>(src), static_cast<cl_mem>(dst),
-                                        src_offset, dst_offset, count, 0, NULL, &event);
+int gpuEventQuery(gpuEvent_t event)
+{
+  cl_int status = CL_COMPLETE;
 
-      if (err != CL_SUCCESS)
-      {
-        printf("CopyAsync error = %d\n", err);
-        exit(1);
-      }
+  if (event)
+    clGetEventInfo(static_cast<cl_event>(event), CL_EVENT_COMMAND_EXECUTION_STATUS,
+                   sizeof(cl_int), &status, NULL);
 
-      cl_int status = CL_QUEUED;
-      while(status != CL_COMPLETE)
-      {
-        clGetEventInfo(event, CL_EVENT_COMMAND_EXECUTION_STATUS,
-                             sizeof(cl_int), &status, NULL);
-      }
+  return (status == CL_COMPLETE) ? 0 : 1;
+}
 
-      break;
-    }
+int gpuEventSynchronize(gpuEvent_t event)
+{
+  if (event)
+  {
+    cl_event clEvent = static_cast<cl_event>(event);
+    return clWaitForEvents(1, &clEvent) == CL_SUCCESS ? 0 : 1;
+  }
+  return 0;
+}
 
-    case gpuMemcpyDefault:
-      break;
+int gpuEventDestroy(gpuEvent_t event)
+{
+  if (event)
+    clReleaseEvent(static_cast<cl_event>(event));
+  return 0;
+}
+
+int gpuDeviceSynchronize(void)
+{
+  return clFinish(Concurrency::getAllocator().getQueue()) == CL_SUCCESS ? 0 : 1;
+}
+
+int gpuHostAlloc(void** host, void** handle, size_t size)
+{
+  cl_command_queue queue = Concurrency::getAllocator().getQueue();
+  cl_context context;
+  cl_int err;
+
+  clGetCommandQueueInfo(queue, CL_QUEUE_CONTEXT, sizeof(cl_context), &context, NULL);
+  cl_mem mem = clCreateBuffer(context, CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR, size, NULL, &err);
+  if (err != CL_SUCCESS)
+  {
+    printf("HostAlloc error = %d\n", err);
+    exit(1);
+  }
+
+  *host = clEnqueueMapBuffer(queue, mem, CL_TRUE, CL_MAP_READ | CL_MAP_WRITE,
+                             0, size, 0, NULL, NULL, &err);
+  if (err != CL_SUCCESS)
+  {
+    printf("HostMap error = %d\n", err);
+    exit(1);
   }
+
+  *handle = mem;
+  return 0;
+}
+
+int gpuHostFree(void* host, void* handle)
+{
+  cl_command_queue queue = Concurrency::getAllocator().getQueue();
+  cl_event event;
+
+  clEnqueueUnmapMemObject(queue, static_cast<cl_mem>(handle), host, 0, NULL, &event);
+  clWaitForEvents(1, &event);
+  clReleaseEvent(event);
+  clReleaseMemObject(static_cast<cl_mem>(handle));
   return 0;
 }
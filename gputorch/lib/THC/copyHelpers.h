@@ -16,8 +16,35 @@ enum gpuMemcpyKind {
 THC_API int gpuMemcpy(void* dst, size_t dst_offset,
                       void* src, size_t src_offset,
                       size_t count, gpuMemcpyKind kind);
+
+// Copies a width x height x depth region (width in bytes) between a host
+// buffer and a device buffer; kind must be gpuMemcpyHostToDevice or
+// gpuMemcpyDeviceToHost. Pitches are in bytes, 0 meaning tightly packed.
+THC_API int gpuMemcpy3D(void* dst, size_t dst_offset, size_t dst_row_pitch, size_t dst_slice_pitch,
+                        void* src, size_t src_offset, size_t src_row_pitch, size_t src_slice_pitch,
+                        size_t width, size_t height, size_t depth, gpuMemcpyKind kind);
+
+// Opaque handle on an enqueued command (a cl_event)
+typedef void* gpuEvent_t;
+
+// Enqueues the copy and returns without waiting for it. If 'event' is not
+// NULL it receives a handle to wait on, to be released with gpuEventDestroy.
+// Host buffers must stay valid until the copy has completed.
 THC_API int gpuMemcpyAsync(void* dst, size_t dst_offset,
                            void* src, size_t src_offset,
-                           size_t count, gpuMemcpyKind kind);
+                           size_t count, gpuMemcpyKind kind,
+                           gpuEvent_t *event);
+
+// Returns 0 once the command is complete, 1 while it is still pending
+THC_API int gpuEventQuery(gpuEvent_t event);
+THC_API int gpuEventSynchronize(gpuEvent_t event);
+THC_API int gpuEventDestroy(gpuEvent_t event);
+// Waits for every command enqueued so far
+THC_API int gpuDeviceSynchronize(void);
+
+// Page-locked host memory, suitable for asynchronous transfers. 'handle'
+// receives the backing buffer object, needed to release it.
+THC_API int gpuHostAlloc(void** host, void** handle, size_t size);
+THC_API int gpuHostFree(void* host, void* handle);
 
 #endif
@@ -0,0 +1,45 @@
+/* The factor the kept elements are multiplied by: 1/(1-p) for version 2,
+   1 for version 1 */
+static double gpunn_Dropout_scale(lua_State *L)
+{
+  double p = luaT_getfieldchecknumber(L, 1, "p");
+  int v2 = luaT_getfieldcheckboolean(L, 1, "v2");
+  return (v2 ? 1 / (1 - p) : 1);
+}
+
+static int gpunn_Dropout_updateOutput(lua_State *L)
+{
+  THGPUTensor *input = (THGPUTensor*)luaT_checkudata(L, 2, "torch.GPUTensor");
+  double p = luaT_getfieldchecknumber(L, 1, "p");
+  THGPUTensor *mask = (THGPUTensor*)luaT_getfieldcheckudata(L, 1, "mask", "torch.GPUTensor");
+  THGPUTensor *output = (THGPUTensor*)luaT_getfieldcheckudata(L, 1, "output", "torch.GPUTensor");
+
+  THGPUTensor_dropout(THGPUState_rngState(L), output, mask, input, p, gpunn_Dropout_scale(L));
+  return 1;
+}
+
+static int gpunn_Dropout_updateGradInput(lua_State *L)
+{
+  THGPUTensor *gradOutput = (THGPUTensor*)luaT_checkudata(L, 3, "torch.GPUTensor");
+  THGPUTensor *mask = (THGPUTensor*)luaT_getfieldcheckudata(L, 1, "mask", "torch.GPUTensor");
+  THGPUTensor *gradInput = (THGPUTensor*)luaT_getfieldcheckudata(L, 1, "gradInput", "torch.GPUTensor");
+
+  luaL_argcheck(L, THGPUTensor_nElement(mask) ==
+                   (THGPUTensor_nElement(gradOutput) + THGPU_DROPOUT_MASK_BITS - 1) / THGPU_DROPOUT_MASK_BITS, 3,
+                "gradOutput does not match the last input");
+  THGPUTensor_dropoutBackward(gradInput, mask, gradOutput, gpunn_Dropout_scale(L));
+  return 1;
+}
+
+static const struct luaL_Reg gpunn_Dropout__ [] = {
+  {"Dropout_updateOutput", gpunn_Dropout_updateOutput},
+  {"Dropout_updateGradInput", gpunn_Dropout_updateGradInput},
+  {NULL, NULL}
+};
+
+static void gpunn_Dropout_init(lua_State *L)
+{
+  luaT_pushmetatable(L, "torch.GPUTensor");
+  luaT_registeratname(L, gpunn_Dropout__, "nn");
+  lua_pop(L,1);
+}
@@ -0,0 +1,277 @@
+#include "amp_math.h"
+#include <algorithm>
+#include <vector>
+
+/*
+ * Description:
+ *    moves the tensors of table 1 into one new contiguous tensor, which is
+ *    returned; each keeps its size and strides. The storages are laid out one
+ *    after the other, in order of first appearance, without the parts no
+ *    tensor covers. The layout is computed on the host from the sizes and
+ *    strides, and the data is copied on the device, one copy per run of
+ *    overlapping tensors.
+ */
+struct FlatParametersSpan
+{
+  long start, end, storage, tensor;
+  bool operator<(const FlatParametersSpan &other) const { return start < other.start; }
+};
+
+static int gpunn_FlatParameters_flatten(lua_State *L)
+{
+  luaL_checktype(L, 1, LUA_TTABLE);
+  long nTensor = lua_objlen(L, 1);
+
+  // Lua errors longjmp over destructors: check the table before building the vectors
+  for (long i = 0; i < nTensor; i++)
+  {
+    lua_rawgeti(L, 1, i + 1);
+    bool isTensor = luaT_toudata(L, -1, "torch.GPUTensor") != NULL;
+    lua_pop(L, 1);
+    if (!isTensor)
+      luaL_error(L, "parameter %d is not a torch.GPUTensor", (int)(i + 1));
+  }
+
+  std::vector<THGPUTensor*> tensors(nTensor);
+  std::vector<THGPUStorage*> storages;
+  std::vector<long> bases(1, 0);
+  std::vector<FlatParametersSpan> spans;
+  std::vector<long> offsets(nTensor);
+
+  for (long i = 0; i < nTensor; i++)
+  {
+    lua_rawgeti(L, 1, i + 1);
+    THGPUTensor *t = (THGPUTensor *)luaT_toudata(L, -1, "torch.GPUTensor");
+    lua_pop(L, 1);
+    tensors[i] = t;
+    if (!t->storage || THGPUTensor_nElement(t) == 0)
+      continue;
+
+    long s = std::find(storages.begin(), storages.end(), t->storage) - storages.begin();
+    if (s == (long)storages.size())
+    {
+      storages.push_back(t->storage);
+      bases.push_back(bases.back() + t->storage->size);
+    }
+
+    FlatParametersSpan span;
+    span.start = bases[s] + t->storageOffset;
+    span.end = span.start + 1;
+    for (int d = 0; d < t->nDimension; d++)
+      span.end += (t->size[d] - 1) * t->stride[d];
+    span.storage = s;
+    span.tensor = i;
+    spans.push_back(span);
+  }
+
+  // overlapping spans merge into runs, packed one after the other
+  std::sort(spans.begin(), spans.end());
+  std::vector<FlatParametersSpan> runs;
+  long nFlat = 0;
+  for (size_t i = 0; i < spans.size(); )
+  {
+    FlatParametersSpan run = spans[i];
+    size_t j;
+    for (j = i + 1; j < spans.size() && spans[j].start < run.end; j++)
+      run.end = std::max(run.end, spans[j].end);
+    for (; i < j; i++)
+      offsets[spans[i].tensor] = nFlat + spans[i].start - run.start;
+    runs.push_back(run);
+    nFlat += run.end - run.start;
+  }
+
+  THGPUTensor *flat = THGPUTensor_newWithSize1d(nFlat);
+  long flatOffset = 0;
+  for (size_t i = 0; i < runs.size(); i++)
+  {
+    long n = runs[i].end - runs[i].start;
+    THGPUTensor *src = THGPUTensor_newWithStorage1d(storages[runs[i].storage],
+                                                    runs[i].start - bases[runs[i].storage], n, 1);
+    THGPUTensor *dst = THGPUTensor_newWithStorage1d(flat->storage, flatOffset, n, 1);
+    THGPUTensor_copy(dst, src);
+    THGPUTensor_free(src);
+    THGPUTensor_free(dst);
+    flatOffset += n;
+  }
+
+  for (long i = 0; i < nTensor; i++)
+  {
+    THGPUTensor *t = tensors[i];
+    if (!t->storage || THGPUTensor_nElement(t) == 0)
+      continue;
+    THLongStorage *size = THGPUTensor_newSizeOf(t);
+    THLongStorage *stride = THGPUTensor_newStrideOf(t);
+    THGPUTensor_setStorage(t, flat->storage, offsets[i], size, stride);
+    THLongStorage_free(size);
+    THLongStorage_free(stride);
+  }
+
+  luaT_pushudata(L, flat, "torch.GPUTensor");
+  return 1;
+}
+
+static void gpunn_FlatParameters_check(lua_State *L, THGPUTensor *x, int index, THGPUTensor *t)
+{
+  luaL_argcheck(L, THGPUTensor_isContiguous(t), index, "contiguous tensor expected");
+  luaL_argcheck(L, THGPUTensor_nElement(t) == THGPUTensor_nElement(x), index, "inconsistent size");
+}
+
+/*
+ * Description:
+ *    x -= lr*d, with g = dfdx + weightDecay*x, v = momentum*v + (1-dampening)*g
+ *    (v = g on the first step), and d = g + momentum*v with nesterov, v without
+ *    (g without momentum)
+ */
+static int gpunn_FlatParameters_sgd(lua_State *L)
+{
+  THGPUTensor *x = (THGPUTensor *)luaT_checkudata(L, 1, "torch.GPUTensor");
+  THGPUTensor *dfdx = (THGPUTensor *)luaT_checkudata(L, 2, "torch.GPUTensor");
+  THGPUTensor *v = (THGPUTensor *)luaT_toudata(L, 3, "torch.GPUTensor");
+  float lr = luaL_checknumber(L, 4);
+  float weightDecay = luaL_checknumber(L, 5);
+  float momentum = luaL_checknumber(L, 6);
+  float dampening = luaL_checknumber(L, 7);
+  int nesterov = lua_toboolean(L, 8);
+  int first = lua_toboolean(L, 9);
+  long n = THGPUTensor_nElement(x);
+
+  luaL_argcheck(L, THGPUTensor_isContiguous(x), 1, "contiguous tensor expected");
+  gpunn_FlatParameters_check(L, x, 2, dfdx);
+  luaL_argcheck(L, v || momentum == 0, 3, "momentum buffer expected");
+  if (v)
+    gpunn_FlatParameters_check(L, x, 3, v);
+  if (n == 0)
+    return 0;
+
+  auto avX = x->get_array_view();
+  auto avDfdx = dfdx->get_array_view();
+  long xOffset = x->storageOffset, dfdxOffset = dfdx->storageOffset;
+  Concurrency::extent<1> grdExt((n + 255) / 256 * 256);
+  Concurrency::tiled_extent<256> t_ext(grdExt);
+
+  // without momentum there is no buffer: no view aliases x in the kernel
+  if (momentum == 0)
+  {
+    Concurrency::parallel_for_each(t_ext, [=] (Concurrency::tiled_index<256> tidx) restrict(amp)
+    {
+      long i = tidx.global[0];
+      if (i >= n) return;
+
+      float g = avDfdx[dfdxOffset + i] + weightDecay * avX[xOffset + i];
+      avX[xOffset + i] -= lr * g;
+    });
+    return 0;
+  }
+
+  auto avV = v->get_array_view();
+  long vOffset = v->storageOffset;
+  Concurrency::parallel_for_each(t_ext, [=] (Concurrency::tiled_index<256> tidx) restrict(amp)
+  {
+    long i = tidx.global[0];
+    if (i >= n) return;
+
+    float g = avDfdx[dfdxOffset + i] + weightDecay * avX[xOffset + i];
+    float vi = (first ? g : momentum * avV[vOffset + i] + (1 - dampening) * g);
+    avV[vOffset + i] = vi;
+    g = (nesterov ? g + momentum * vi : vi);
+    avX[xOffset + i] -= lr * g;
+  });
+  return 0;
+}
+
+/*
+ * Description:
+ *    variance += g^2, x -= lr*g/(sqrt(variance)+1e-10), with g = dfdx + weightDecay*x
+ */
+static int gpunn_FlatParameters_adagrad(lua_State *L)
+{
+  THGPUTensor *x = (THGPUTensor *)luaT_checkudata(L, 1, "torch.GPUTensor");
+  THGPUTensor *dfdx = (THGPUTensor *)luaT_checkudata(L, 2, "torch.GPUTensor");
+  THGPUTensor *variance = (THGPUTensor *)luaT_checkudata(L, 3, "torch.GPUTensor");
+  float lr = luaL_checknumber(L, 4);
+  float weightDecay = luaL_checknumber(L, 5);
+  long n = THGPUTensor_nElement(x);
+
+  luaL_argcheck(L, THGPUTensor_isContiguous(x), 1, "contiguous tensor expected");
+  gpunn_FlatParameters_check(L, x, 2, dfdx);
+  gpunn_FlatParameters_check(L, x, 3, variance);
+  if (n == 0)
+    return 0;
+
+  auto avX = x->get_array_view();
+  auto avDfdx = dfdx->get_array_view();
+  auto avVariance = variance->get_array_view();
+  long xOffset = x->storageOffset, dfdxOffset = dfdx->storageOffset;
+  long varianceOffset = variance->storageOffset;
+
+  Concurrency::extent<1> grdExt((n + 255) / 256 * 256);
+  Concurrency::tiled_extent<256> t_ext(grdExt);
+  Concurrency::parallel_for_each(t_ext, [=] (Concurrency::tiled_index<256> tidx) restrict(amp)
+  {
+    long i = tidx.global[0];
+    if (i >= n) return;
+
+    float g = avDfdx[dfdxOffset + i] + weightDecay * avX[xOffset + i];
+    float s = avVariance[varianceOffset + i] + g * g;
+    avVariance[varianceOffset + i] = s;
+    avX[xOffset + i] -= lr * g / (Concurrency::fast_math::sqrt(s) + 1e-10f);
+  });
+  return 0;
+}
+
+/*
+ * Description:
+ *    m = alpha*m + (1-alpha)*g^2, x -= lr*g/(sqrt(m)+epsilon), with g = dfdx + weightDecay*x
+ */
+static int gpunn_FlatParameters_rmsprop(lua_State *L)
+{
+  THGPUTensor *x = (THGPUTensor *)luaT_checkudata(L, 1, "torch.GPUTensor");
+  THGPUTensor *dfdx = (THGPUTensor *)luaT_checkudata(L, 2, "torch.GPUTensor");
+  THGPUTensor *m = (THGPUTensor *)luaT_checkudata(L, 3, "torch.GPUTensor");
+  float lr = luaL_checknumber(L, 4);
+  float alpha = luaL_checknumber(L, 5);
+  float epsilon = luaL_checknumber(L, 6);
+  float weightDecay = luaL_checknumber(L, 7);
+  long n = THGPUTensor_nElement(x);
+
+  luaL_argcheck(L, THGPUTensor_isContiguous(x), 1, "contiguous tensor expected");
+  gpunn_FlatParameters_check(L, x, 2, dfdx);
+  gpunn_FlatParameters_check(L, x, 3, m);
+  if (n == 0)
+    return 0;
+
+  auto avX = x->get_array_view();
+  auto avDfdx = dfdx->get_array_view();
+  auto avM = m->get_array_view();
+  long xOffset = x->storageOffset, dfdxOffset = dfdx->storageOffset;
+  long mOffset = m->storageOffset;
+
+  Concurrency::extent<1> grdExt((n + 255) / 256 * 256);
+  Concurrency::tiled_extent<256> t_ext(grdExt);
+  Concurrency::parallel_for_each(t_ext, [=] (Concurrency::tiled_index<256> tidx) restrict(amp)
+  {
+    long i = tidx.global[0];
+    if (i >= n) return;
+
+    float g = avDfdx[dfdxOffset + i] + weightDecay * avX[xOffset + i];
+    float s = alpha * avM[mOffset + i] + (1 - alpha) * g * g;
+    avM[mOffset + i] = s;
+    avX[xOffset + i] -= lr * g / (Concurrency::fast_math::sqrt(s) + epsilon);
+  });
+  return 0;
+}
+
+static const struct luaL_Reg gpunn_FlatParameters__ [] = {
+  {"FlatParameters_flatten", gpunn_FlatParameters_flatten},
+  {"FlatParameters_sgd", gpunn_FlatParameters_sgd},
+  {"FlatParameters_adagrad", gpunn_FlatParameters_adagrad},
+  {"FlatParameters_rmsprop", gpunn_FlatParameters_rmsprop},
+  {NULL, NULL}
+};
+
+static void gpunn_FlatParameters_init(lua_State *L)
+{
+  luaT_pushmetatable(L, "torch.GPUTensor");
+  luaT_registeratname(L, gpunn_FlatParameters__, "nn");
+  lua_pop(L,1);
+}
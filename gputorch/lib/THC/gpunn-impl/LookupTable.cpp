@@ -0,0 +1,231 @@
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include "copyHelpers.h"
+
+#define LOOKUPTABLE_THREADS 256
+
+static Concurrency::array_view<int, 1>* gpunn_LookupTable_upload(const std::vector<int> &host)
+{
+  Concurrency::array_view<int, 1> *av = new Concurrency::array_view<int, 1>(Concurrency::extent<1>(host.size()));
+  int* av_ptr = static_cast<int*>(Concurrency::getAllocator().device_data(av->data()));
+  THGPUCheck(gpuMemcpy(av_ptr, 0, (void*)&host[0], 0, host.size() * sizeof(int), gpuMemcpyHostToDevice));
+  av->discard_data();
+  return av;
+}
+
+// One thread per (distinct row, column): the thread sums the gradOutput rows
+// of its run, so every destination element has a single writer. avRuns holds
+// the nRow destination rows, the nRow+1 run offsets, then the gradOutput row
+// of each sorted index.
+static void gpunn_LookupTable_accRowsKernel(Concurrency::array_view<float,1> &avDst, long dstOffset,
+                                            Concurrency::array_view<float,1> &avSrc, long srcOffset,
+                                            Concurrency::array_view<int,1> &avRuns,
+                                            int nRow, int rowSize, float scale)
+{
+  int n = nRow * rowSize;
+  unsigned grdSz = (n + (LOOKUPTABLE_THREADS - 1)) & ~(LOOKUPTABLE_THREADS - 1);
+  Concurrency::extent<1> grdExt(grdSz);
+  Concurrency::tiled_extent<LOOKUPTABLE_THREADS> t_ext(grdExt);
+
+  Concurrency::parallel_for_each(t_ext, [=] (Concurrency::tiled_index<LOOKUPTABLE_THREADS> tidx) restrict(amp)
+  {
+    int i = tidx.global[0];
+    if (i < n)
+    {
+      int r = i / rowSize;
+      int d = i % rowSize;
+      float sum = 0;
+      for (int j = avRuns[nRow + r]; j < avRuns[nRow + r + 1]; j++)
+        sum += avSrc[srcOffset + (long)avRuns[2 * nRow + 1 + j] * rowSize + d];
+      avDst[dstOffset + (long)avRuns[r] * rowSize + d] += scale * sum;
+    }
+  });
+}
+
+// dst[row] = zero ? 0 : dst[row] + scale * src[row] for each of the nRow rows
+static void gpunn_LookupTable_rowsKernel(Concurrency::array_view<float,1> &avDst, long dstOffset,
+                                         Concurrency::array_view<float,1> &avSrc, long srcOffset,
+                                         Concurrency::array_view<int,1> &avRows,
+                                         int nRow, int rowSize, float scale, int zero)
+{
+  int n = nRow * rowSize;
+  unsigned grdSz = (n + (LOOKUPTABLE_THREADS - 1)) & ~(LOOKUPTABLE_THREADS - 1);
+  Concurrency::extent<1> grdExt(grdSz);
+  Concurrency::tiled_extent<LOOKUPTABLE_THREADS> t_ext(grdExt);
+
+  Concurrency::parallel_for_each(t_ext, [=] (Concurrency::tiled_index<LOOKUPTABLE_THREADS> tidx) restrict(amp)
+  {
+    int i = tidx.global[0];
+    if (i < n)
+    {
+      long k = dstOffset + (long)avRows[i / rowSize] * rowSize + i % rowSize;
+      if (zero)
+        avDst[k] = 0;
+      else
+        avDst[k] += scale * avSrc[srcOffset + (long)avRows[i / rowSize] * rowSize + i % rowSize];
+    }
+  });
+}
+
+// The indices stay on the host: they are sorted there so that the duplicates
+// of a row are adjacent, and self.inputs counts the uses of each row.
+static void gpunn_LookupTable_accRows(lua_State *L, THGPUTensor *dst, THLongTensor *input,
+                                      THGPUTensor *gradOutput, float scale)
+{
+  long *input_data = THLongTensor_data(input);
+  long n = THLongTensor_nElement(input);
+  long nIndex = dst->size[0];
+  long rowSize = THGPUTensor_nElement(dst) / nIndex;
+
+  luaL_argcheck(L, THGPUTensor_isContiguous(dst), 1, "weight must be contiguous");
+  luaL_argcheck(L, THGPUTensor_nElement(gradOutput) == n * rowSize, 3, "inconsistent gradOutput size");
+  for (long i = 0; i < n; i++)
+  {
+    if (input_data[i] < 1 || input_data[i] > nIndex)
+    {
+      printf("\nLookupTable: %ld not between 1 and %ld\n", input_data[i], nIndex);
+      luaL_error(L, "index out of bound");
+    }
+  }
+  if (n == 0)
+    return;
+
+  std::vector<std::pair<long, int> > pairs(n);
+  for (long i = 0; i < n; i++)
+    pairs[i] = std::make_pair(input_data[i] - 1, (int)i);
+  std::sort(pairs.begin(), pairs.end());
+
+  std::vector<int> rows, offsets;
+  for (long i = 0; i < n; i++)
+  {
+    if (i == 0 || pairs[i].first != pairs[i - 1].first)
+    {
+      rows.push_back((int)pairs[i].first);
+      offsets.push_back((int)i);
+    }
+  }
+  offsets.push_back((int)n);
+  int nRow = (int)rows.size();
+
+  std::vector<int> runs(rows);
+  runs.insert(runs.end(), offsets.begin(), offsets.end());
+  for (long i = 0; i < n; i++)
+    runs.push_back(pairs[i].second);
+
+  gradOutput = THGPUTensor_newContiguous(gradOutput);
+  auto avDst = dst->get_array_view();
+  auto avSrc = gradOutput->get_array_view();
+  Concurrency::array_view<int, 1> *avRuns = gpunn_LookupTable_upload(runs);
+  gpunn_LookupTable_accRowsKernel(avDst, dst->storageOffset, avSrc, gradOutput->storageOffset,
+                                  *avRuns, nRow, (int)rowSize, scale);
+  delete avRuns;
+  THGPUTensor_free(gradOutput);
+
+  lua_getfield(L, 1, "inputs");
+  for (int r = 0; r < nRow; r++)
+  {
+    lua_rawgeti(L, -1, rows[r] + 1);
+    lua_pushnumber(L, luaL_optnumber(L, -1, 0) + (offsets[r + 1] - offsets[r]));
+    lua_rawseti(L, -3, rows[r] + 1);
+    lua_pop(L, 1);
+  }
+  lua_pop(L, 1);
+}
+
+// The rows touched since zeroGradParameters, i.e. the keys of self.inputs
+static std::vector<int> gpunn_LookupTable_touchedRows(lua_State *L, long nIndex)
+{
+  std::vector<int> rows;
+
+  lua_getfield(L, 1, "inputs");
+  lua_pushnil(L);
+  while (lua_next(L, -2) != 0)
+  {
+    long k = (long)lua_tonumber(L, -2);
+    lua_pop(L, 1);
+    if (k >= 1 && k <= nIndex)
+      rows.push_back((int)(k - 1));
+  }
+  lua_pop(L, 1);
+  return rows;
+}
+
+static int gpunn_LookupTable_accGradParameters(lua_State *L)
+{
+  THLongTensor *input = (THLongTensor*)luaT_checkudata(L, 2, "torch.LongTensor");
+  THGPUTensor *gradOutput = (THGPUTensor*)luaT_checkudata(L, 3, "torch.GPUTensor");
+  float scale = luaL_optnumber(L, 4, 1);
+  THGPUTensor *gradWeight = (THGPUTensor*)luaT_getfieldcheckudata(L, 1, "gradWeight", "torch.GPUTensor");
+
+  luaL_argcheck(L, THLongTensor_isContiguous(input), 2, "input must be contiguous");
+  gpunn_LookupTable_accRows(L, gradWeight, input, gradOutput, scale);
+  return 0;
+}
+
+static int gpunn_LookupTable_accUpdateGradParameters(lua_State *L)
+{
+  THLongTensor *input = (THLongTensor*)luaT_checkudata(L, 2, "torch.LongTensor");
+  THGPUTensor *gradOutput = (THGPUTensor*)luaT_checkudata(L, 3, "torch.GPUTensor");
+  float lr = luaL_checknumber(L, 4);
+  THGPUTensor *weight = (THGPUTensor*)luaT_getfieldcheckudata(L, 1, "weight", "torch.GPUTensor");
+
+  luaL_argcheck(L, THLongTensor_isContiguous(input), 2, "input must be contiguous");
+  gpunn_LookupTable_accRows(L, weight, input, gradOutput, -lr);
+  return 0;
+}
+
+static int gpunn_LookupTable_updateParameters(lua_State *L)
+{
+  float lr = luaL_checknumber(L, 2);
+  THGPUTensor *weight = (THGPUTensor*)luaT_getfieldcheckudata(L, 1, "weight", "torch.GPUTensor");
+  THGPUTensor *gradWeight = (THGPUTensor*)luaT_getfieldcheckudata(L, 1, "gradWeight", "torch.GPUTensor");
+  long rowSize = THGPUTensor_nElement(weight) / weight->size[0];
+
+  luaL_argcheck(L, THGPUTensor_isContiguous(weight) && THGPUTensor_isContiguous(gradWeight), 1,
+                "weight and gradWeight must be contiguous");
+  std::vector<int> rows = gpunn_LookupTable_touchedRows(L, weight->size[0]);
+  if (rows.empty())
+    return 0;
+
+  auto avWeight = weight->get_array_view();
+  auto avGradWeight = gradWeight->get_array_view();
+  Concurrency::array_view<int, 1> *avRows = gpunn_LookupTable_upload(rows);
+  gpunn_LookupTable_rowsKernel(avWeight, weight->storageOffset, avGradWeight, gradWeight->storageOffset,
+                               *avRows, (int)rows.size(), (int)rowSize, -lr, 0);
+  delete avRows;
+  return 0;
+}
+
+static int gpunn_LookupTable_zeroGradParameters(lua_State *L)
+{
+  THGPUTensor *gradWeight = (THGPUTensor*)luaT_getfieldcheckudata(L, 1, "gradWeight", "torch.GPUTensor");
+  long rowSize = THGPUTensor_nElement(gradWeight) / gradWeight->size[0];
+
+  luaL_argcheck(L, THGPUTensor_isContiguous(gradWeight), 1, "gradWeight must be contiguous");
+  std::vector<int> rows = gpunn_LookupTable_touchedRows(L, gradWeight->size[0]);
+  if (rows.empty())
+    return 0;
+
+  auto avGradWeight = gradWeight->get_array_view();
+  Concurrency::array_view<int, 1> *avRows = gpunn_LookupTable_upload(rows);
+  gpunn_LookupTable_rowsKernel(avGradWeight, gradWeight->storageOffset, avGradWeight, gradWeight->storageOffset,
+                               *avRows, (int)rows.size(), (int)rowSize, 0, 1);
+  delete avRows;
+  return 0;
+}
+
+static const struct luaL_Reg gpunn_LookupTable__ [] = {
+  {"LookupTable_accGradParameters", gpunn_LookupTable_accGradParameters},
+  {"LookupTable_accUpdateGradParameters", gpunn_LookupTable_accUpdateGradParameters},
+  {"LookupTable_updateParameters", gpunn_LookupTable_updateParameters},
+  {"LookupTable_zeroGradParameters", gpunn_LookupTable_zeroGradParameters},
+  {NULL, NULL}
+};
+
+static void gpunn_LookupTable_init(lua_State *L)
+{
+  luaT_pushmetatable(L, "torch.GPUTensor");
+  luaT_registeratname(L, gpunn_LookupTable__, "nn");
+  lua_pop(L,1);
+}
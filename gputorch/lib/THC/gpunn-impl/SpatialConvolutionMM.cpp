@@ -107,6 +107,282 @@ void col2im(Concurrency::array_view<float,1> &avData_col, long colOffset,
                  pad_h, pad_w, stride_h, stride_w, height_col, width_col, avData_im, imOffset, inp_stride, elt);
 }
 
+// Winograd F(m x m, 3x3) for m = 2 or 4: tiles of alpha = m+2 input points
+// are transformed (B^T d B), multiplied with the transformed filters
+// (G g G^T) by alpha^2 GEMMs over channels, and transformed back (A^T M A).
+// The 1-D transforms read x[i*xs] and write y[i*ys]; the kernels apply them
+// along columns then rows.
+#define WINOGRAD_BUDGET (256L*1024*1024)
+
+static inline void winogradInput(int m, const float *x, int xs, float *y, int ys) restrict(amp,cpu)
+{
+  if (m == 2)
+  {
+    y[0]    = x[0]    - x[2*xs];
+    y[ys]   = x[xs]   + x[2*xs];
+    y[2*ys] = x[2*xs] - x[xs];
+    y[3*ys] = x[xs]   - x[3*xs];
+  }
+  else
+  {
+    float x0 = x[0], x1 = x[xs], x2 = x[2*xs], x3 = x[3*xs], x4 = x[4*xs], x5 = x[5*xs];
+    y[0]    = 4*x0 - 5*x2 + x4;
+    y[ys]   = -4*x1 - 4*x2 + x3 + x4;
+    y[2*ys] = 4*x1 - 4*x2 - x3 + x4;
+    y[3*ys] = -2*x1 - x2 + 2*x3 + x4;
+    y[4*ys] = 2*x1 - x2 - 2*x3 + x4;
+    y[5*ys] = 4*x1 - 5*x3 + x5;
+  }
+}
+
+static inline void winogradFilter(int m, const float *x, int xs, float *y, int ys) restrict(amp,cpu)
+{
+  float x0 = x[0], x1 = x[xs], x2 = x[2*xs];
+  if (m == 2)
+  {
+    y[0]    = x0;
+    y[ys]   = (x0 + x1 + x2) * 0.5f;
+    y[2*ys] = (x0 - x1 + x2) * 0.5f;
+    y[3*ys] = x2;
+  }
+  else
+  {
+    y[0]    = x0 / 4;
+    y[ys]   = -(x0 + x1 + x2) / 6;
+    y[2*ys] = -(x0 - x1 + x2) / 6;
+    y[3*ys] = x0 / 24 + x1 / 12 + x2 / 6;
+    y[4*ys] = x0 / 24 - x1 / 12 + x2 / 6;
+    y[5*ys] = x2;
+  }
+}
+
+static inline void winogradOutput(int m, const float *x, int xs, float *y, int ys) restrict(amp,cpu)
+{
+  if (m == 2)
+  {
+    y[0]  = x[0] + x[xs] + x[2*xs];
+    y[ys] = x[xs] - x[2*xs] - x[3*xs];
+  }
+  else
+  {
+    float x0 = x[0], x1 = x[xs], x2 = x[2*xs], x3 = x[3*xs], x4 = x[4*xs], x5 = x[5*xs];
+    y[0]    = x0 + x1 + x2 + x3 + x4;
+    y[ys]   = x1 - x2 + 2*x3 - 2*x4;
+    y[2*ys] = x1 + x2 + 4*x3 + 4*x4;
+    y[3*ys] = x1 - x2 + 8*x3 - 8*x4 + x5;
+  }
+}
+
+// U[xi][k][c] = (G g G^T)[xi] for the kernel g of output plane k, input
+// plane c; with flip, g is the rotated weight[c][k] (the correlation that
+// computes gradInput)
+void winogradFilterTransform(Concurrency::array_view<float,1> &avWeight, long weightOffset,
+                             Concurrency::array_view<float,1> &avU, long UOffset,
+                             int nOutputPlane, int nInputPlane, int m, int flip)
+{
+  int n = nOutputPlane * nInputPlane;
+  unsigned grdSz = (n + (NUMTHREADS - 1)) & ~(NUMTHREADS - 1);
+  Concurrency::extent<1> grdExt(grdSz);
+  Concurrency::tiled_extent<NUMTHREADS> t_ext(grdExt);
+
+  Concurrency::parallel_for_each(t_ext, [=] (Concurrency::tiled_index<NUMTHREADS> tidx) restrict(amp)
+  {
+    int i = tidx.global[0];
+    if (i < n)
+    {
+      int alpha = m + 2;
+      int k = i / nInputPlane;
+      int c = i % nInputPlane;
+      long w = weightOffset + (flip ? c * nOutputPlane + k : k * nInputPlane + c) * 9;
+      float g[9], tmp[6*3], u[6*6];
+
+      for (int y = 0; y < 9; y++)
+        g[y] = avWeight[w + (flip ? 8 - y : y)];
+      for (int x = 0; x < 3; x++)
+        winogradFilter(m, g + x, 3, tmp + x, 3);
+      for (int y = 0; y < alpha; y++)
+        winogradFilter(m, tmp + y * 3, 1, u + y * alpha, 1);
+      for (int y = 0; y < alpha * alpha; y++)
+        avU[UOffset + (y * nOutputPlane + k) * nInputPlane + c] = u[y];
+    }
+  });
+}
+
+// V[xi][c][b*P+p] = (B^T d B)[xi] for tile p of plane c in frame b
+void winogradInputTransform(Concurrency::array_view<float,1> &avInput, long inputOffset,
+                            Concurrency::array_view<float,1> &avV, long VOffset,
+                            int nFrame, int nInputPlane, int inputHeight, int inputWidth,
+                            int tilesW, int P, int padding, int m)
+{
+  int n = nFrame * nInputPlane * P;
+  unsigned grdSz = (n + (NUMTHREADS - 1)) & ~(NUMTHREADS - 1);
+  Concurrency::extent<1> grdExt(grdSz);
+  Concurrency::tiled_extent<NUMTHREADS> t_ext(grdExt);
+
+  Concurrency::parallel_for_each(t_ext, [=] (Concurrency::tiled_index<NUMTHREADS> tidx) restrict(amp)
+  {
+    int i = tidx.global[0];
+    if (i < n)
+    {
+      int alpha = m + 2;
+      int p = i % P;
+      int c = (i / P) % nInputPlane;
+      int b = i / (P * nInputPlane);
+      int y0 = (p / tilesW) * m - padding;
+      int x0 = (p % tilesW) * m - padding;
+      long plane = inputOffset + (long)(b * nInputPlane + c) * inputHeight * inputWidth;
+      long ncol = (long)nFrame * P;
+      float d[6*6], tmp[6*6], v[6*6];
+
+      for (int y = 0; y < alpha; y++)
+      {
+        for (int x = 0; x < alpha; x++)
+        {
+          int iy = y0 + y, ix = x0 + x;
+          d[y * alpha + x] = (iy >= 0 && iy < inputHeight && ix >= 0 && ix < inputWidth) ? avInput[plane + iy * inputWidth + ix] : 0;
+        }
+      }
+      for (int x = 0; x < alpha; x++)
+        winogradInput(m, d + x, alpha, tmp + x, alpha);
+      for (int y = 0; y < alpha; y++)
+        winogradInput(m, tmp + y * alpha, 1, v + y * alpha, 1);
+      for (int y = 0; y < alpha * alpha; y++)
+        avV[VOffset + (y * nInputPlane + c) * ncol + b * P + p] = v[y];
+    }
+  });
+}
+
+// Each m x m output tile is A^T M A plus the bias, clipped to the plane
+void winogradOutputTransform(Concurrency::array_view<float,1> &avM, long MOffset,
+                             Concurrency::array_view<float,1> &avOutput, long outputOffset,
+                             Concurrency::array_view<float,1> &avBias, long biasOffset, int hasBias,
+                             int nFrame, int nOutputPlane, int outputHeight, int outputWidth,
+                             int tilesW, int P, int m)
+{
+  int n = nFrame * nOutputPlane * P;
+  unsigned grdSz = (n + (NUMTHREADS - 1)) & ~(NUMTHREADS - 1);
+  Concurrency::extent<1> grdExt(grdSz);
+  Concurrency::tiled_extent<NUMTHREADS> t_ext(grdExt);
+
+  Concurrency::parallel_for_each(t_ext, [=] (Concurrency::tiled_index<NUMTHREADS> tidx) restrict(amp)
+  {
+    int i = tidx.global[0];
+    if (i < n)
+    {
+      int alpha = m + 2;
+      int p = i % P;
+      int k = (i / P) % nOutputPlane;
+      int b = i / (P * nOutputPlane);
+      int y0 = (p / tilesW) * m;
+      int x0 = (p % tilesW) * m;
+      long plane = outputOffset + (long)(b * nOutputPlane + k) * outputHeight * outputWidth;
+      long ncol = (long)nFrame * P;
+      float biask = hasBias ? avBias[biasOffset + k] : 0;
+      float mm[6*6], tmp[4*6], z[4*4];
+
+      for (int y = 0; y < alpha * alpha; y++)
+        mm[y] = avM[MOffset + (y * nOutputPlane + k) * ncol + b * P + p];
+      for (int x = 0; x < alpha; x++)
+        winogradOutput(m, mm + x, alpha, tmp + x, alpha);
+      for (int y = 0; y < m; y++)
+        winogradOutput(m, tmp + y * alpha, 1, z + y * m, 1);
+      for (int y = 0; y < m && y0 + y < outputHeight; y++)
+        for (int x = 0; x < m && x0 + x < outputWidth; x++)
+          avOutput[plane + (y0 + y) * outputWidth + x0 + x] = z[y * m + x] + biask;
+    }
+  });
+}
+
+// Tile size m of the Winograd path, 0 for im2col+GEMM; the module's
+// winograd field can force it (false, 2 or 4), as on the CPU
+static int winogradTile(lua_State *L, int kW, int kH, int dW, int dH, long outputHeight, long outputWidth)
+{
+  int m;
+
+  if (kW != 3 || kH != 3 || dW != 1 || dH != 1)
+    return 0;
+
+  lua_getfield(L, 1, "winograd");
+  if (lua_isnoneornil(L, -1) || (lua_isboolean(L, -1) && lua_toboolean(L, -1)))
+    m = (outputHeight >= 8 && outputWidth >= 8) ? 4 : 2;
+  else if (lua_isboolean(L, -1))
+    m = 0;
+  else
+  {
+    m = lua_tointeger(L, -1);
+    luaL_argcheck(L, m == 2 || m == 4, 1, "winograd must be false, 2 or 4");
+  }
+  lua_pop(L, 1);
+
+  return m;
+}
+
+// 3x3 stride 1 convolution of a contiguous 4D input by Winograd
+// F(m x m, 3x3), in chunks of frames whose transformed input (kept in
+// columns) fits the module's memoryBudget
+static void winogradConvolution(lua_State *L, THGPUTensor *input, THGPUTensor *output,
+                                THGPUTensor *weight, THGPUTensor *bias, THGPUTensor *columns,
+                                int m, int flip, int padding,
+                                int nInputPlane, int inputHeight, int inputWidth,
+                                int nOutputPlane, int outputHeight, int outputWidth)
+{
+  int alpha = m + 2;
+  long batchSize = input->size[0];
+  int tilesW = (outputWidth + m - 1) / m;
+  int P = tilesW * ((outputHeight + m - 1) / m);
+
+  lua_getfield(L, 1, "memoryBudget");
+  long budget = (long)luaL_optnumber(L, -1, WINOGRAD_BUDGET);
+  lua_pop(L, 1);
+  long chunk = budget / ((long)alpha * alpha * nInputPlane * P * sizeof(float));
+  chunk = (chunk < 1) ? 1 : (chunk > batchSize ? batchSize : chunk);
+
+  weight = THGPUTensor_newContiguous(weight);
+  THGPUTensor *U = THGPUTensor_newWithSize3d(alpha * alpha, nOutputPlane, nInputPlane);
+  THGPUTensor *M = THGPUTensor_new();
+  THGPUTensor_resize3d(columns, alpha * alpha, nInputPlane, chunk * P);
+  THGPUTensor_resize3d(M, alpha * alpha, nOutputPlane, chunk * P);
+
+  auto avData_input = input->get_array_view();
+  auto avData_output = output->get_array_view();
+  auto avData_weight = weight->get_array_view();
+  auto avData_U = U->get_array_view();
+  auto avData_V = columns->get_array_view();
+  auto avData_M = M->get_array_view();
+  auto avData_bias = bias ? bias->get_array_view() : avData_weight;
+
+  winogradFilterTransform(avData_weight, weight->storageOffset, avData_U, U->storageOffset,
+                          nOutputPlane, nInputPlane, m, flip);
+
+  for (long t = 0; t < batchSize; t += chunk)
+  {
+    int nFrame = (int)((batchSize - t < chunk) ? batchSize - t : chunk);
+    long ncol = (long)nFrame * P;
+
+    winogradInputTransform(avData_input, input->storageOffset + input->stride[0] * t,
+                           avData_V, columns->storageOffset,
+                           nFrame, nInputPlane, inputHeight, inputWidth, tilesW, P, padding, m);
+
+    // M[xi] = U[xi] V[xi] (column-major gemm, hence the swapped operands)
+    for (int xi = 0; xi < alpha * alpha; xi++)
+    {
+      THGPUBlas_gemm('n', 'n', ncol, nOutputPlane, nInputPlane, 1,
+                     avData_V, columns->storageOffset + xi * nInputPlane * ncol, ncol,
+                     avData_U, U->storageOffset + xi * nOutputPlane * nInputPlane, nInputPlane, 0,
+                     avData_M, M->storageOffset + xi * nOutputPlane * ncol, ncol);
+    }
+
+    winogradOutputTransform(avData_M, M->storageOffset,
+                            avData_output, output->storageOffset + output->stride[0] * t,
+                            avData_bias, bias ? bias->storageOffset : 0, bias != NULL,
+                            nFrame, nOutputPlane, outputHeight, outputWidth, tilesW, P, m);
+  }
+
+  THGPUTensor_free(weight);
+  THGPUTensor_free(U);
+  THGPUTensor_free(M);
+}
+
 static int gpunn_SpatialConvolutionMM_updateOutput(lua_State *L)
 {
   // Input
@@ -153,6 +429,22 @@ static int gpunn_SpatialConvolutionMM_updateOutput(lua_State *L)
   // Resize output
   THGPUTensor_resize4d(output, batchSize, nOutputPlane, outputHeight, outputWidth);
 
+  int tile = winogradTile(L, kW, kH, dW, dH, outputHeight, outputWidth);
+  if (tile)
+  {
+    THGPUTensor *input_ = THGPUTensor_newContiguous(input);
+    winogradConvolution(L, input_, output, weight, bias, columns, tile, 0, padding,
+                        nInputPlane, inputHeight, inputWidth,
+                        nOutputPlane, outputHeight, outputWidth);
+    THGPUTensor_free(input_);
+    if (batch == 0)
+    {
+      THGPUTensor_resize3d(output, nOutputPlane, outputHeight, outputWidth);
+      THGPUTensor_resize3d(input, nInputPlane, inputHeight, inputWidth);
+    }
+    return 1;
+  }
+
   // Resize temporary columns
   THGPUTensor_resize2d(columns, nInputPlane*kW*kH, outputHeight*outputWidth);
 
@@ -265,6 +557,25 @@ static int gpunn_SpatialConvolutionMM_updateGradInput(lua_State *L)
   // Resize output
   THGPUTensor_resize4d(gradInput, batchSize, nInputPlane, inputHeight, inputWidth);
 
+  // gradInput is the full correlation of gradOutput with the rotated kernel,
+  // a 3x3 convolution again when the padding allows it
+  int tile = (padding <= 2) ? winogradTile(L, kW, kH, dW, dH, inputHeight, inputWidth) : 0;
+  if (tile)
+  {
+    THGPUTensor *gradOutput_ = THGPUTensor_newContiguous(gradOutput);
+    winogradConvolution(L, gradOutput_, gradInput, weight, NULL, gradColumns, tile, 1, kW - 1 - padding,
+                        nOutputPlane, outputHeight, outputWidth,
+                        nInputPlane, inputHeight, inputWidth);
+    THGPUTensor_free(gradOutput_);
+    if (batch == 0)
+    {
+      THGPUTensor_resize3d(gradOutput, nOutputPlane, outputHeight, outputWidth);
+      THGPUTensor_resize3d(input, nInputPlane, inputHeight, inputWidth);
+      THGPUTensor_resize3d(gradInput, nInputPlane, inputHeight, inputWidth);
+    }
+    return 1;
+  }
+
   // Resize temporary columns
   THGPUTensor_resize2d(gradColumns, nInputPlane*kW*kH, outputHeight*outputWidth);
 
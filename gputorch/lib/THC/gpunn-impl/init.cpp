@@ -1,5 +1,6 @@
 #include "luaT.h"
 #include "THC.h"
+#include "THCState.h"
 #include "THLogAdd.h" /* DEBUG: WTF */
 
 #include "HardTanh.cpp"
@@ -30,6 +31,9 @@
 #include "SpatialUpSamplingNearest.cpp"
 #include "SpatialAveragePooling.cpp"
 #include "ClassNLLCriterion.cpp"
+#include "LookupTable.cpp"
+#include "FlatParameters.cpp"
+#include "Dropout.cpp"
 
 int open_libgpunn(lua_State *L)
 {
@@ -61,5 +65,8 @@ int open_libgpunn(lua_State *L)
   gpunn_SpatialUpSamplingNearest_init(L);
   gpunn_SpatialAveragePooling_init(L);
   gpunn_ClassNLLCriterion_init(L);
+  gpunn_LookupTable_init(L);
+  gpunn_FlatParameters_init(L);
+  gpunn_Dropout_init(L);
   return 1;
 }
@@ -731,6 +731,33 @@ function test.index()
    compareFloatAndGPU(x, 'index', index, longIndex)
 end
 
+function test.copyStridedHostDevice()
+   local sz1 = math.floor(torch.uniform(minsize,maxsize))
+   local sz2 = math.floor(torch.uniform(minsize,maxsize))
+   local x = torch.FloatTensor(sz1, sz2, 4):uniform()
+
+   -- narrowed rows on both sides (rectangular transfers)
+   local src = x:narrow(2, 2, sz2 - 1)
+   local y = torch.GPUTensor(sz1, sz2 + 3, 4):zero()
+   y:narrow(2, 3, sz2 - 1):copy(src)
+   tester:assertTensorEq(y:narrow(2, 3, sz2 - 1):float(), src, 1e-6, "Error in narrowed host to device copy")
+   local z = torch.FloatTensor(sz1, sz2 + 1, 4):zero()
+   z:narrow(2, 1, sz2 - 1):copy(y:narrow(2, 3, sz2 - 1))
+   tester:assertTensorEq(z:narrow(2, 1, sz2 - 1), src, 1e-6, "Error in narrowed device to host copy")
+
+   -- transposed sides and differing shapes (chunked gather/scatter)
+   local xt = x:transpose(1, 3)
+   local yt = torch.GPUTensor(4, sz2, sz1):copy(xt)
+   tester:assertTensorEq(yt:float(), xt, 1e-6, "Error in transposed host to device copy")
+   local g = torch.GPUTensor(sz1, 4, sz2):copy(x:transpose(2, 3))
+   local h = torch.FloatTensor(sz2, sz1 * 4):zero()
+   h:t():copy(g:view(sz1 * 4, sz2))
+   tester:assertTensorEq(h:t(), x:transpose(2, 3):contiguous():view(sz1 * 4, sz2), 1e-6, "Error in transposed device to host copy")
+   local v = torch.FloatTensor(sz1 * sz2 * 4):zero()
+   v:copy(yt:transpose(1, 3))
+   tester:assertTensorEq(v, x:contiguous():view(sz1 * sz2 * 4), 1e-6, "Error in reshaping device to host copy")
+end
+
 function test.indexCopy()
    local sz1 = math.floor(torch.uniform(minsize,maxsize)) -- dim1
    local sz2 = math.floor(torch.uniform(minsize,maxsize)) -- dim2
@@ -799,6 +826,22 @@ function test.renorm()
    compareFloatAndGPU(x, 'renorm', 4, 2, maxnorm)
 end
 
+function test.histc()
+   local x = torch.randn(100, 1000):float()
+   compareFloatAndGPU(x, 'histc')
+   compareFloatAndGPU(x, 'histc', 10, -1, 1)
+   -- more bins than fit in one tile
+   compareFloatAndGPU(x, 'histc', 3000, -2, 2)
+   compareFloatAndGPU(x:t(), 'histc', 7)
+end
+
+function test.histcw()
+   local x = torch.randn(20, 30):float()
+   local w = torch.rand(20, 30):float()
+   compareFloatAndGPUTensorArgs(x, 'histcw', w, 10, -1, 1)
+   compareFloatAndGPUTensorArgs(x, 'histcw', w:t():contiguous():t(), 5)
+end
+
 function test.indexSelect()
    --  test for speed
    local n_row = math.random(minsize,maxsize)
@@ -935,6 +978,102 @@ function test.mm()
    end
 end
 
+function test.baddbmm()
+   --[[ Size ]]--
+   local sizes = {
+      {1, 16, 3, 1},
+      {5, 1, 12, 1},
+      {3, 24, 23, 22},
+      {4, 1, 1, 1},
+      {7, 12, 1, 12},
+      {2, 65, 33, 70},
+   }
+   for _, size in pairs(sizes) do
+      local b, n, k, m = unpack(size)
+      local c = torch.zeros(b, n, m)
+      local x = torch.randn(b, n, k)
+      local y = torch.randn(b, k, m)
+      compareFloatAndGPUTensorArgs(c, 'baddbmm', torch.normal(), torch.normal(), x, y)
+      -- transposed operands
+      local alpha, beta = torch.normal(), torch.normal()
+      compareFloatAndGPUTensorArgs(c,
+         function(z, xt, yt)
+            return z:baddbmm(beta, alpha, xt:transpose(2, 3), yt:transpose(2, 3))
+         end, torch.randn(b, k, n), torch.randn(b, m, k))
+   end
+end
+
+function test.bmm()
+   --[[ Size ]]--
+   local sizes = {
+      {1, 16, 3, 1},
+      {5, 1, 12, 1},
+      {3, 24, 23, 22},
+      {4, 1, 1, 1},
+      {7, 12, 1, 12},
+      {2, 65, 33, 70},
+   }
+   for _, size in pairs(sizes) do
+      local b, n, k, m = unpack(size)
+      local c = torch.zeros(b, n, m)
+      local x = torch.randn(b, n, k)
+      local y = torch.randn(b, k, m)
+      compareFloatAndGPUTensorArgs(c, 'bmm', x, y)
+   end
+end
+
+function test.gemmKernels()
+   local sizes = {
+      {1, 1, 1},
+      {16, 3, 1},
+      {24, 23, 22},
+      {65, 70, 33},
+      {130, 64, 17},
+   }
+   -- transposed operands and leading dimensions larger than the matrices
+   local function addmmStrided(c, a, b, bt)
+      c:addmm(0.5, 2, a:t(), b:narrow(2, 2, c:size(2)))
+      return c:addmm(bt:t(), b:narrow(2, 2, c:size(2)))
+   end
+   for _, name in ipairs(gputorch.gemmKernels()) do
+      gputorch.setGemmKernel(name)
+      for _, size in pairs(sizes) do
+         local n, k, m = unpack(size)
+         local c = torch.randn(n, m)
+         local a = torch.randn(k, n)
+         local b = torch.randn(k, m + 3)
+         local bt = torch.randn(k, n)
+         compareFloatAndGPUTensorArgs(c, 'addmm', 1, 1, a:t(), b:narrow(2, 1, m))
+         compareFloatAndGPUTensorArgs(c, addmmStrided, a, b, bt)
+      end
+   end
+   gputorch.setGemmKernel()
+end
+
+function test.gemmTuningCache()
+   local file = os.tmpname()
+   local cacheFile = gputorch.getGemmCacheFile()
+   local tuning = gputorch.getGemmTuning()
+   gputorch.setGemmCacheFile(file)
+   gputorch.setGemmTuning(true)
+
+   compareFloatAndGPUTensorArgs(torch.zeros(96, 160), 'addmm', torch.randn(96, 112), torch.randn(112, 160))
+   local f = io.open(file)
+   local transa, transb, m, n, k, name = f:read('*a'):match('([nt]) ([nt]) (%d+) (%d+) (112) (%S+)')
+   f:close()
+   tester:assertne(name, nil, "tuned kernel not saved")
+
+   -- a later run starts from the file
+   gputorch.resetGemmTuning()
+   tester:asserteq(gputorch.getGemmKernel(transa, transb, m, n, k), nil, "resetGemmTuning kept a kernel")
+   gputorch.setGemmCacheFile(file)
+   tester:asserteq(gputorch.getGemmKernel(transa, transb, m, n, k), name, "tuned kernel not read back")
+
+   gputorch.setGemmCacheFile(cacheFile)
+   gputorch.setGemmTuning(tuning)
+   os.remove(file)
+end
+
 function test.ger()
    --[[ Size ]]--
    local sizes = {
@@ -966,6 +1105,163 @@ function test.isSameSizeAs()
    tester:assert(t1:isSameSizeAs(t4) == true, "wrong answer ")
 end
 
+function test.copyAsync()
+   local sz1 = math.floor(torch.uniform(minsize,maxsize))
+   local sz2 = math.floor(torch.uniform(minsize,maxsize))
+   local x = torch.FloatTensor(sz1, sz2):uniform()
+   local y = torch.GPUTensor(sz1, sz2)
+   local _, event = y:copyAsync(x)
+   -- the source may be reused as soon as copyAsync returns
+   local expected = x:clone()
+   x:zero()
+   event:wait()
+   tester:assert(event:query(), "event not complete after wait")
+   tester:assertTensorEq(y:float(), expected, 1e-6, "Error in host to device copyAsync")
+
+   local z = torch.FloatTensor(sz1, sz2):zero()
+   local _, event2 = z:copyAsync(y)
+   event2:wait()
+   tester:assertTensorEq(z, expected, 1e-6, "Error in device to host copyAsync")
+
+   -- strided on both ends, completed by synchronize
+   local zt = torch.FloatTensor(sz2, sz1):zero()
+   local yt = torch.GPUTensor(sz2, sz1)
+   yt:t():copyAsync(expected)
+   gputorch.synchronize()
+   zt:t():copyAsync(yt:t())
+   gputorch.synchronize()
+   tester:assertTensorEq(zt:t(), expected, 1e-6, "Error in strided copyAsync")
+
+   local w = torch.GPUTensor(sz1, sz2)
+   local _, event3 = w:copyAsync(y)
+   event3:wait()
+   tester:assertTensorEq(w:float(), expected, 1e-6, "Error in device to device copyAsync")
+end
+
+function test.copyAsyncPinnedLimit()
+   local limit = gputorch.getCacheLimit()
+   local x = torch.FloatTensor(1024, 1024):uniform()
+   local y = torch.GPUTensor(1024, 1024)
+   y:copyAsync(x)
+   gputorch.synchronize()
+   tester:assertgt(gputorch.getPinnedBytes(), 0, "staging buffer was not kept")
+
+   -- the idle staging buffers follow the allocator limit
+   gputorch.setCacheLimit(1024)
+   tester:assertle(gputorch.getPinnedBytes(), 1024, "pinned limit not enforced")
+   local z = torch.FloatTensor(1024, 1024)
+   z:copyAsync(y)
+   gputorch.synchronize()
+   tester:assertTensorEq(z, x, 1e-6, "Error in copyAsync under the limit")
+   tester:assertle(gputorch.getPinnedBytes(), 1024, "pinned buffer kept beyond the limit")
+   gputorch.setCacheLimit(limit)
+
+   y:copyAsync(x)
+   gputorch.synchronize()
+   gputorch.trimCache()
+   tester:asserteq(gputorch.getPinnedBytes(), 0, "trimCache did not release the staging buffers")
+end
+
+-- Counts the device allocations made per "training iteration" once the
+-- caching allocator is warm: temporaries should all come from the cache.
+function test.cachingAllocatorReuse()
+   local input = torch.randn(64, 128):gpu()
+   local weight = torch.randn(32, 128):gpu()
+   local vec = torch.randn(64):gpu()
+   local iteration = function()
+      local output = torch.GPUTensor(64, 32):zero()
+      output:addmm(1, input, weight:t())
+      local y = torch.GPUTensor(128):zero()
+      y:addmv(1, input:t(), vec)
+      local tmp = output:t():contiguous()
+      tmp:mul(2)
+      output = nil
+      y = nil
+      tmp = nil
+      collectgarbage()
+   end
+
+   iteration()
+   gputorch.resetAllocatorStats()
+   local niter = 5
+   for i = 1, niter do
+      iteration()
+   end
+   local stats = gputorch.getAllocatorStats()
+   tester:asserteq(stats.nDeviceAllocs / niter, 0, "device allocations in steady-state iterations")
+   tester:assertgt(stats.nCacheHits, 0, "no allocation was served from the cache")
+end
+
+function test.cachingAllocatorLimit()
+   local limit = gputorch.getCacheLimit()
+   local t = torch.GPUTensor(1024, 1024)
+   t = nil
+   collectgarbage()
+   tester:assertgt(gputorch.getCachedBytes(), 0, "freed storage was not cached")
+
+   gputorch.setCacheLimit(1024)
+   tester:assertle(gputorch.getCachedBytes(), 1024, "cache limit not enforced")
+   gputorch.setCacheLimit(limit)
+
+   local u = torch.GPUTensor(1024)
+   u = nil
+   collectgarbage()
+   gputorch.trimCache()
+   tester:asserteq(gputorch.getCachedBytes(), 0, "trimCache did not empty the cache")
+   tester:asserteq(gputorch.getAllocatorStats().cachedBytes, 0, "stats disagree with getCachedBytes")
+end
+
+-- A storage resized to 0 keeps a valid buffer: kernels may take its view
+-- before checking the number of elements.
+function test.emptyStorage()
+   local s = torch.GPUStorage(1000):fill(1)
+   s:resize(0)
+   tester:asserteq(s:size(), 0, "storage not resized to 0")
+   s:fill(2)
+
+   local t = torch.GPUTensor(s)
+   tester:asserteq(t:nElement(), 0, "tensor on an empty storage is not empty")
+   t:add(1)
+   tester:asserteq(t:sum(), 0, "sum of an empty tensor")
+
+   s:resize(10):fill(3)
+   tester:asserteq(torch.GPUTensor(s):sum(), 30, "storage grown back from 0")
+end
+
+function test.fusion()
+   local sz1 = math.floor(torch.uniform(minsize,maxsize))
+   local sz2 = math.floor(torch.uniform(minsize,maxsize))
+   local x = torch.FloatTensor(sz1, sz2):uniform(-1, 1)
+   local y = torch.FloatTensor(sz1, sz2):uniform(0.5, 1)
+   local gx, gy = x:gpu(), y:gpu()
+
+   -- x:mul(a):add(b):tanh() and (x * y) / y in one kernel
+   local f = torch.GPUFusion()
+   local ix, iy = f:input(gx), f:input(gy)
+   local r1 = torch.GPUTensor(sz1, sz2)
+   local r2 = torch.GPUTensor(sz1, sz2)
+   f:output(f:tanh(f:addvalue(f:mulvalue(ix, 0.5), 0.25)), r1)
+   f:output(f:cdiv(f:cmul(ix, iy), iy), r2)
+   f:run()
+   tester:asserteq(f:nGroups(), 1, "expression not fused into one kernel")
+   local ref1, ref2 = f:runReference()
+   tester:assertTensorEq(r1:float(), x:clone():mul(0.5):add(0.25):tanh(), 1e-5, "Error in fused chain")
+   tester:assertTensorEq(r1:float(), ref1, 1e-5, "Error in fused chain reference")
+   tester:assertTensorEq(r2:float(), ref2, 1e-5, "Error in fused binary ops")
+
+   -- in place, and long enough to need several groups
+   local g = torch.GPUFusion()
+   local node = g:input(gx)
+   for i = 1, 40 do
+      node = g:addvalue(g:mulvalue(node, 0.9), 0.01)
+   end
+   g:output(g:sigmoid(node), gx)
+   local ref = g:runReference()
+   g:run()
+   tester:assert(g:nGroups() > 1, "long expression not split")
+   tester:assertTensorEq(gx:float(), ref, 1e-4, "Error in split fused expression")
+end
+
 -- Test random number generation.
 local function checkIfUniformlyDistributed(t, min, max)
    tester:assertge(t:min(), min - 1e-6, "values are too low")
@@ -1059,7 +1355,7 @@ function test.cauchy()
    checkIfUniformlyDistributed(u, 0, 1)
 end
 
---[[function test.random_seed()
+function test.random_seed()
    local sz1 = math.floor(torch.uniform(minsize,maxsize))
    local sz2 = math.floor(torch.uniform(minsize,maxsize))
    local mean, std = torch.uniform(), torch.uniform()
@@ -1072,9 +1368,9 @@ end
    gputorch.manualSeed(seed)
    u:normal(mean, std)
    tester:assertTensorEq(t:float(), u:float(), 1e-6, "values not equal after resetting the seed")
-end]]--
+end
 
---[[function test.restore_rng()
+function test.restore_rng()
    local sz1 = math.floor(torch.uniform(minsize,maxsize))
    local sz2 = math.floor(torch.uniform(minsize,maxsize))
    local mean, std = torch.uniform(), torch.uniform()
@@ -1091,8 +1387,46 @@ end]]--
    u:normal(mean, std)
    tester:assertTensorEq(t:float(), u:float(), 1e-6, "values not equal after restoring the RNG state")
    tester:asserteq(gputorch.initialSeed(), seed, "seed was not restored")
-end]]--
+end
+
+function test.referenceFill()
+   local sz1 = math.floor(torch.uniform(minsize,maxsize))
+   local sz2 = math.floor(torch.uniform(minsize,maxsize))
+   local p = torch.uniform()
+   local mean, std = torch.uniform(), torch.uniform()
+   local t = torch.GPUTensor(sz1, sz2)
+   local ref = torch.FloatTensor(sz1, sz2)
+
+   gputorch.manualSeed(1234)
+   gputorch.referenceFill(ref, 'uniform')
+   t:uniform(0, 1)
+   tester:assertTensorEq(t:float(), ref, 0, "uniform differs from the host reference")
+
+   gputorch.referenceFill(ref, 'bernoulli', p)
+   t:bernoulli(p)
+   tester:assertTensorEq(t:float(), ref, 0, "bernoulli differs from the host reference")
 
+   gputorch.referenceFill(ref, 'normal', mean, std)
+   t:normal(mean, std)
+   tester:assertTensorEq(t:float(), ref, 1e-4, "normal differs from the host reference")
+end
+
+
+function test.copyHalf()
+   local sz1 = math.floor(torch.uniform(minsize,maxsize))
+   local sz2 = math.floor(torch.uniform(minsize,maxsize))
+   local x = torch.randn(sz1, sz2):float():half():float()
+   local h = x:half()
+
+   local g = h:gpu()
+   tester:assertTensorEq(g:float(), x, 0, "HalfTensor to GPU copy error")
+   tester:assertTensorEq(g:half():float(), x, 0, "GPU to HalfTensor copy error")
+   tester:assertTensorEq(h:t():gpu():float(), x:t(), 0, "non-contiguous HalfTensor to GPU copy error")
+
+   local gt = torch.GPUTensor(sz2, sz1):copy(x:t())
+   tester:assertTensorEq(gt:half():float(), x:t(), 0, "non-contiguous GPU to HalfTensor copy error")
+   tester:assertTensorEq(torch.HalfTensor(sz2, sz1):copy(gt:t():t()):float(), x:t(), 0, "GPU to HalfTensor copy error")
+end
 
 
 function gputorch.test(tests)
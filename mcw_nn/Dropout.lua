@@ -9,28 +9,35 @@ function Dropout:__init(p,v1)
    if self.p >= 1 or self.p < 0 then
       error('<Dropout> illegal percentage, must be 0 <= p < 1')
    end
-   self.noise = torch.Tensor()
+end
+
+-- the mask holds one bit per element, packed in words: a torch.IntTensor
+-- of 32-bit words, or a torch.GPUTensor whose floats hold 24 bits each
+local function newMask(input)
+   if torch.typename(input) == 'torch.GPUTensor' then
+      return input.new()
+   end
+   return torch.IntTensor()
 end
 
 function Dropout:updateOutput(input)
-   self.output:resizeAs(input):copy(input)
    if self.train then
-      self.noise:resizeAs(input)
-      self.noise:bernoulli(1-self.p)
-      if self.v2 then
-         self.noise:div(1-self.p)
+      self.mask = self.mask or newMask(input)
+      -- draws the mask, scales and writes the output in one pass
+      input.nn.Dropout_updateOutput(self, input)
+   else
+      self.output:resizeAs(input):copy(input)
+      if not self.v2 then
+         self.output:mul(1-self.p)
       end
-      self.output:cmul(self.noise)
-   elseif not self.v2 then
-      self.output:mul(1-self.p)
    end
    return self.output
 end
 
 function Dropout:updateGradInput(input, gradOutput)
    if self.train then
-      self.gradInput:resizeAs(gradOutput):copy(gradOutput)
-      self.gradInput:cmul(self.noise) -- simply mask the gradients with the noise vector
+      -- simply mask the gradients with the bits of the last forward
+      input.nn.Dropout_updateGradInput(self, input, gradOutput)
    else
       error('backprop only defined while training')
    end
@@ -40,3 +47,9 @@ end
 function Dropout:setp(p)
    self.p = p
 end
+
+function Dropout:type(type)
+   -- the bits of the mask do not convert
+   self.mask = nil
+   return Parent.type(self, type)
+end
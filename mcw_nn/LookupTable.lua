@@ -52,13 +52,18 @@ function LookupTable:reset(stdv)
    end
 end
 
-function LookupTable:updateOutput(input)
+function LookupTable:makeInputContiguous(input)
    -- make sure input is a contiguous torch.LongTensor
    if (not input:isContiguous()) or torch.type(input) ~= 'torch.LongTensor' then
       self._indices = self._indices or torch.LongTensor()
       self._indices:resize(input:size()):copy(input)
-      input = self._indices
+      return self._indices
    end
+   return input
+end
+
+function LookupTable:updateOutput(input)
+   input = self:makeInputContiguous(input)
    
    if input:dim() == 1 then
       local nIndex = input:size(1)
@@ -79,63 +84,52 @@ function LookupTable:updateOutput(input)
    return self.output
 end
 
+-- the row updates run in C unless scaleUpdateByKey is overridden
+function LookupTable:scalesByKey()
+   return self.scaleUpdateByKey ~= LookupTable.scaleUpdateByKey
+end
+
 function LookupTable:zeroGradParameters()
    if not self.accUpdate then
-      for k,_ in pairs(self.inputs) do
-         self.gradWeight:select(1, k):zero()
-      end
+      self.weight.nn.LookupTable_zeroGradParameters(self)
    end
    self.inputs = {}
    self.nBackward = 0
 end
 
 function LookupTable:accGradParameters(input, gradOutput, scale)
-   scale = scale or 1
+   input = self:makeInputContiguous(input)
    if input:dim() == 1 then
       self.nBackward = self.nBackward + 1
-      for i=1,input:size(1) do
-         local k = input[i]
-         self.inputs[k] = (self.inputs[k] or 0) + 1
-         self.gradWeight:select(1, k):add(scale, gradOutput:select(1, i))
-      end
    elseif input:dim() == 2 then
       self.nBackward = self.nBackward + input:size(1)
-      for i=1,input:size(1) do
-         local input = input:select(1, i)
-         local gradOutput = gradOutput:select(1, i)
-         for j=1,input:size(1) do
-            local k = input[j]
-            self.inputs[k] = (self.inputs[k] or 0) + 1
-            self.gradWeight:select(1, k):add(scale, gradOutput:select(1, j))
-         end
-      end
    end
+   -- duplicate indices are summed into their row before the update
+   self.weight.nn.LookupTable_accGradParameters(self, input, gradOutput, scale or 1)
 end
 
 function LookupTable:accUpdateGradParameters(input, gradOutput, lr)
-   if input:dim() == 1 then
-      for i=1,input:size(1) do
-         local k = input[i]
-         local kscale = self:scaleUpdateByKey(k)
-         self.inputs[k] = (self.inputs[k] or 0) + 1
-         self.weight:select(1, input[i]):add(-lr*kscale, gradOutput:select(1, i))
-      end
-   elseif input:dim() == 2 then 
-      for i=1,input:size(1) do
-         local input = input:select(1, i)
-         local gradOutput = gradOutput:select(1, i)
-         for j=1,input:size(1) do
-            local k = input[j]
-            local kscale = self:scaleUpdateByKey(k)
-            self.inputs[k] = (self.inputs[k] or 0) + 1
-            self.weight:select(1, k):add(-lr*kscale, gradOutput:select(1, j))
-         end
-      end
+   input = self:makeInputContiguous(input)
+   if not self:scalesByKey() then
+      self.weight.nn.LookupTable_accUpdateGradParameters(self, input, gradOutput, lr)
+      return
+   end
+   local gradOutput = gradOutput:contiguous():view(input:nElement(), -1)
+   local input = input:view(-1)
+   for i=1,input:size(1) do
+      local k = input[i]
+      local kscale = self:scaleUpdateByKey(k)
+      self.inputs[k] = (self.inputs[k] or 0) + 1
+      self.weight:select(1, k):add(-lr*kscale, gradOutput:select(1, i):viewAs(self.weight:select(1, k)))
    end
 end
 
 function LookupTable:updateParameters(learningRate)
    assert(not self.accUpdate, "use accUpdateGradParameters instead")
+   if not self:scalesByKey() then
+      self.weight.nn.LookupTable_updateParameters(self, learningRate)
+      return
+   end
    for k,nBackward in pairs(self.inputs) do
       local kscale = self:scaleUpdateByKey(k)
       self.weight:select(1, k):add(-learningRate*kscale, self.gradWeight:select(1, k))
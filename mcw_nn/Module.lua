@@ -166,86 +166,24 @@ end
 function Module:reset()
 end
 
+-- Moves the tensors of the list parameters into one new flat tensor, which
+-- is returned: each tensor becomes a view of it, and tensors sharing a
+-- storage still share it. The parts of the storages no tensor covers are
+-- left out.
+function Module.flatten(parameters)
+   if not parameters or #parameters == 0 then
+      return torch.Tensor()
+   end
+   return parameters[1].nn.FlatParameters_flatten(parameters)
+end
+
 function Module:getParameters()
    -- get parameters
    local parameters,gradParameters = self:parameters()
 
-   local function storageInSet(set, storage)
-      local storageAndOffset = set[torch.pointer(storage)]
-      if storageAndOffset == nil then
-          return nil
-      end
-      local _, offset = unpack(storageAndOffset)
-      return offset
-   end
-
-   -- this function flattens arbitrary lists of parameters,
-   -- even complex shared ones
-   local function flatten(parameters)
-      if not parameters or #parameters == 0 then
-         return torch.Tensor()
-      end
-      local Tensor = parameters[1].new
-
-      local storages = {}
-      local nParameters = 0
-      for k = 1,#parameters do
-         local storage = parameters[k]:storage()
-         if not storageInSet(storages, storage) then
-            storages[torch.pointer(storage)] = {storage, nParameters}
-            nParameters = nParameters + storage:size()
-         end
-      end
-      
-      local flatParameters = Tensor(nParameters):fill(1)
-      local flatStorage = flatParameters:storage()
-
-      for k = 1,#parameters do
-         local storageOffset = storageInSet(storages, parameters[k]:storage())
-         parameters[k]:set(flatStorage,
-                           storageOffset + parameters[k]:storageOffset(),
-                           parameters[k]:size(),
-                           parameters[k]:stride())
-         parameters[k]:zero()
-      end
-
-      local maskParameters=  flatParameters:float():clone()
-      local cumSumOfHoles = flatParameters:float():cumsum(1)
-      local nUsedParameters = nParameters - cumSumOfHoles[#cumSumOfHoles]
-      local flatUsedParameters = Tensor(nUsedParameters)
-      local flatUsedStorage = flatUsedParameters:storage()
-
-      for k = 1,#parameters do
-         local offset = cumSumOfHoles[parameters[k]:storageOffset()]
-         parameters[k]:set(flatUsedStorage,
-         parameters[k]:storageOffset() - offset,
-         parameters[k]:size(),
-         parameters[k]:stride())
-      end
-
-      for _, storageAndOffset in pairs(storages) do
-         local k, v = unpack(storageAndOffset)
-         flatParameters[{{v+1,v+k:size()}}]:copy(Tensor():set(k))
-      end
-
-      if cumSumOfHoles:sum() == 0 then
-         flatUsedParameters:copy(flatParameters)
-      else
-         local counter = 0
-         for k = 1,flatParameters:nElement() do
-            if maskParameters[k] == 0 then
-               counter = counter + 1
-               flatUsedParameters[counter] = flatParameters[counter+cumSumOfHoles[k]]
-            end
-         end
-         assert (counter == nUsedParameters)
-      end
-      return flatUsedParameters
-   end
-
    -- flatten parameters and gradients
-   local flatParameters = flatten(parameters)
-   local flatGradParameters = flatten(gradParameters)
+   local flatParameters = Module.flatten(parameters)
+   local flatGradParameters = Module.flatten(gradParameters)
 
    -- return new flat vector that contains all discrete parameters
    return flatParameters, flatGradParameters
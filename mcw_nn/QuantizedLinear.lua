@@ -0,0 +1,48 @@
+local QuantizedLinear, parent = torch.class('nn.QuantizedLinear', 'nn.Module')
+
+-- Inference-only int8 copy of a trained nn.Linear (see nn.quantize). The
+-- weights are quantized once, with one scale per output unit; the inputs
+-- at every forward, with one scale per sample, or the single inputScale
+-- set by nn.calibrate. Products are accumulated in int32, then scaled
+-- back, biased and, if relu is true, clamped at 0 in the same pass.
+function QuantizedLinear:__init(linear, relu)
+   parent.__init(self)
+   assert(torch.typename(linear) == 'nn.Linear', 'nn.Linear expected')
+
+   self.inputSize = linear.weight:size(2)
+   self.outputSize = linear.weight:size(1)
+   self.relu = relu or false
+
+   self.bias = linear.bias:clone()
+   self.qweight = torch.CharTensor()
+   self.weightScale = linear.weight.new()
+   self.bias.nn.Quantized_quantizeWeight(self, linear.weight)
+
+   self.qinput = torch.CharTensor()
+   self.qinputScale = linear.weight.new()
+   self.output = linear.weight.new()
+end
+
+function QuantizedLinear:updateOutput(input)
+   if self.calibrating then
+      self.inputMax = math.max(self.inputMax or 0, input:max(), -input:min())
+   end
+   return input.nn.QuantizedLinear_updateOutput(self, input)
+end
+
+function QuantizedLinear:updateGradInput(input, gradOutput)
+   error('nn.QuantizedLinear is an inference module')
+end
+
+function QuantizedLinear:accGradParameters(input, gradOutput, scale)
+   error('nn.QuantizedLinear is an inference module')
+end
+
+-- the int8 buffers stay CharTensors
+function QuantizedLinear:type(type)
+   local qweight, qinput = self.qweight, self.qinput
+   self.qweight, self.qinput = nil, nil
+   parent.type(self, type)
+   self.qweight, self.qinput = qweight, qinput
+   return self
+end
@@ -0,0 +1,52 @@
+local QuantizedSpatialConvolutionMM, parent = torch.class('nn.QuantizedSpatialConvolutionMM', 'nn.Module')
+
+-- Inference-only int8 copy of a trained nn.SpatialConvolutionMM (see
+-- nn.quantize), quantized as nn.QuantizedLinear: one weight scale per
+-- output plane, and one input scale per patch (output position) unless
+-- nn.calibrate fixed self.inputScale. Strides other than 1 are supported.
+function QuantizedSpatialConvolutionMM:__init(conv, relu)
+   parent.__init(self)
+   assert(torch.typename(conv) == 'nn.SpatialConvolutionMM', 'nn.SpatialConvolutionMM expected')
+
+   self.nInputPlane = conv.nInputPlane
+   self.nOutputPlane = conv.nOutputPlane
+   self.kW = conv.kW
+   self.kH = conv.kH
+   self.dW = conv.dW
+   self.dH = conv.dH
+   self.padding = conv.padding
+   self.relu = relu or false
+
+   self.bias = conv.bias:clone()
+   self.qweight = torch.CharTensor()
+   self.weightScale = conv.weight.new()
+   self.bias.nn.Quantized_quantizeWeight(self, conv.weight)
+
+   self.qfinput = torch.CharTensor()
+   self.qfinputScale = conv.weight.new()
+   self.output = conv.weight.new()
+end
+
+function QuantizedSpatialConvolutionMM:updateOutput(input)
+   if self.calibrating then
+      self.inputMax = math.max(self.inputMax or 0, input:max(), -input:min())
+   end
+   return input.nn.QuantizedSpatialConvolutionMM_updateOutput(self, input)
+end
+
+function QuantizedSpatialConvolutionMM:updateGradInput(input, gradOutput)
+   error('nn.QuantizedSpatialConvolutionMM is an inference module')
+end
+
+function QuantizedSpatialConvolutionMM:accGradParameters(input, gradOutput, scale)
+   error('nn.QuantizedSpatialConvolutionMM is an inference module')
+end
+
+-- the int8 buffers stay CharTensors
+function QuantizedSpatialConvolutionMM:type(type)
+   local qweight, qfinput = self.qweight, self.qfinput
+   self.qweight, self.qfinput = nil, nil
+   parent.type(self, type)
+   self.qweight, self.qfinput = qweight, qfinput
+   return self
+end
@@ -1,5 +1,59 @@
 local Sequential, parent = torch.class('nn.Sequential', 'nn.Module')
 
+-- Bytes per element, for the figures of memoryUsage
+local elementSize = {
+   ['torch.ByteTensor'] = 1, ['torch.CharTensor'] = 1, ['torch.ShortTensor'] = 2,
+   ['torch.IntTensor'] = 4, ['torch.LongTensor'] = 8, ['torch.HalfTensor'] = 2,
+   ['torch.FloatTensor'] = 4, ['torch.DoubleTensor'] = 8,
+   ['torch.GPUTensor'] = 4,
+}
+
+local function storagePointer(tensor)
+   local storage = tensor:storage()
+   return storage and torch.pointer(storage)
+end
+
+-- Adds the storages of x, a tensor or a table of them, to the set
+local function addStorages(set, x)
+   if torch.isTensor(x) then
+      local pointer = storagePointer(x)
+      if pointer then
+         set[pointer] = true
+      end
+   elseif type(x) == 'table' then
+      for _, v in pairs(x) do
+         addStorages(set, v)
+      end
+   end
+   return set
+end
+
+local function nBytes(x)
+   if torch.isTensor(x) then
+      return x:nElement() * (elementSize[torch.typename(x)] or 4)
+   elseif type(x) == 'table' then
+      local n = 0
+      for _, v in pairs(x) do
+         n = n + nBytes(v)
+      end
+      return n
+   end
+   return 0
+end
+
+-- Pointwise modules which can overwrite their input
+local function canRunInPlace(module)
+   local name = torch.typename(module)
+   return name == 'nn.Threshold' or name == 'nn.ReLU' or name == 'nn.Tanh'
+      or name == 'nn.Sigmoid' or (name == 'nn.Dropout' and not module.train)
+end
+
+local function checkBackward(self)
+   if self.memoryOptimized then
+      error('backward is not available with optimizeMemory, call optimizeMemory(false) first')
+   end
+end
+
 function Sequential:__init()
    parent.__init(self)
    self.modules = {}
@@ -33,6 +87,9 @@ function Sequential:get(index)
 end
 
 function Sequential:updateOutput(input)
+   if self.memoryOptimized then
+      return self:updatePlannedOutput(input)
+   end
    local currentOutput = input
    for i=1,#self.modules do 
       currentOutput = self.modules[i]:updateOutput(currentOutput)
@@ -41,7 +98,108 @@ function Sequential:updateOutput(input)
    return currentOutput
 end
 
+-- Forward of optimizeMemory. Each module writes its output to a buffer
+-- of self.memoryPool which holds neither its input nor the input of the
+-- container, so that a chain of modules runs in two buffers; pointwise
+-- modules overwrite their input when it is such a buffer.
+function Sequential:updatePlannedOutput(input)
+   local pool = self.memoryPool
+   local inPool = {}
+   for _, buffer in ipairs(pool) do
+      inPool[storagePointer(buffer)] = true
+   end
+   local pinned = addStorages({}, input)
+   local planned, naive = 0, 0
+
+   local currentOutput = input
+   for i=1,#self.modules do
+      local module = self.modules[i]
+      local previousOutput = currentOutput
+      if module.memoryOptimized then
+         currentOutput = module:updateOutput(previousOutput)
+         local p, n = module:memoryUsage()
+         planned, naive = planned + p, naive + n
+      elseif canRunInPlace(module) and torch.isTensor(previousOutput)
+         and torch.type(module.output) == torch.type(previousOutput)
+         and inPool[storagePointer(previousOutput)] and not pinned[storagePointer(previousOutput)] then
+         module.output:set(previousOutput)
+         currentOutput = module:updateOutput(previousOutput)
+         naive = naive + nBytes(currentOutput)
+      else
+         local buffer
+         if torch.isTensor(module.output) then
+            local live = addStorages(addStorages({}, input), previousOutput)
+            for _, b in ipairs(pool) do
+               if torch.type(b) == torch.type(module.output) and not live[storagePointer(b)] then
+                  buffer = b
+                  break
+               end
+            end
+            if not buffer then
+               buffer = module.output.new(1)
+               table.insert(pool, buffer)
+               inPool[storagePointer(buffer)] = true
+            end
+            module.output:set(buffer:storage())
+         end
+         currentOutput = module:updateOutput(previousOutput)
+         -- views of the input take no memory, and outputs the module did
+         -- not put in the buffer are left where they are
+         if not (torch.isTensor(currentOutput)
+                 and addStorages({}, previousOutput)[storagePointer(currentOutput)]) then
+            local n = nBytes(currentOutput)
+            naive = naive + n
+            if not (buffer and torch.isTensor(currentOutput)
+                    and storagePointer(currentOutput) == storagePointer(buffer)) then
+               planned = planned + n
+            end
+         end
+      end
+   end
+
+   for _, buffer in ipairs(pool) do
+      planned = planned + buffer:storage():size() * (elementSize[torch.typename(buffer)] or 4)
+   end
+   self.plannedBytes, self.naiveBytes = planned, naive
+   self.output = currentOutput
+   return currentOutput
+end
+
+-- Inference mode: the outputs of the modules share a few buffers instead
+-- of each keeping its own, and the gradInputs are released. The output
+-- of a module is only valid until the next module has run; backward is
+-- not available. Nested Sequentials are switched too, with their own
+-- buffers. optimizeMemory(false) goes back to the usual mode.
+function Sequential:optimizeMemory(enable)
+   enable = (enable ~= false)
+   self.memoryOptimized = enable or nil
+   self.memoryPool = enable and {} or nil
+   self.plannedBytes, self.naiveBytes = nil, nil
+   for i=1,#self.modules do
+      local module = self.modules[i]
+      if torch.typename(module) == 'nn.Sequential' then
+         module:optimizeMemory(enable)
+      elseif torch.isTensor(module.output) then
+         module.output = module.output.new()
+      end
+      if enable and torch.isTensor(module.gradInput) then
+         module.gradInput = module.gradInput.new()
+      end
+   end
+   if enable and torch.isTensor(self.gradInput) then
+      self.gradInput = self.gradInput.new()
+   end
+   return self
+end
+
+-- Bytes taken by the outputs of the modules during the last forward with
+-- optimizeMemory, and the bytes they would take without it
+function Sequential:memoryUsage()
+   return self.plannedBytes, self.naiveBytes
+end
+
 function Sequential:updateGradInput(input, gradOutput)
+   checkBackward(self)
    local currentGradOutput = gradOutput
    local currentModule = self.modules[#self.modules]
    for i=#self.modules-1,1,-1 do
@@ -55,6 +213,7 @@ function Sequential:updateGradInput(input, gradOutput)
 end
 
 function Sequential:accGradParameters(input, gradOutput, scale)
+   checkBackward(self)
    scale = scale or 1
 
    local currentGradOutput = gradOutput
@@ -70,6 +229,7 @@ function Sequential:accGradParameters(input, gradOutput, scale)
 end
 
 function Sequential:accUpdateGradParameters(input, gradOutput, lr)
+   checkBackward(self)
    local currentGradOutput = gradOutput
    local currentModule = self.modules[#self.modules]
    for i=#self.modules-1,1,-1 do
@@ -9,6 +9,9 @@ function SparseLinear:__init(inputSize, outputSize)
    self.gradWeight = torch.Tensor(outputSize, inputSize)
    self.gradBias = torch.Tensor(outputSize)
    self.lastInput = torch.Tensor()
+   -- batched (CSR) mode only zeroes and updates the columns it touched
+   self.gradWeight:zero()
+   self.gradBias:zero()
    -- state
    self.gradInput:resize(inputSize)
    self.output:resize(outputSize)
@@ -35,16 +38,38 @@ function SparseLinear:reset(stdv)
    end
 end
 
+-- A batch is given as a table {rowPtr, colIdx, values} in CSR form: row i
+-- of the batch holds the non-zeros rowPtr[i]..rowPtr[i+1]-1 (counted from
+-- rowPtr[1]) of the LongTensor colIdx and of values. The output is then
+-- batchSize x outputSize, and gradInput {rowPtr, colIdx, gradValues}.
 function SparseLinear:updateOutput(input)
+   if type(input) == 'table' then
+      return self.weight.nn.SparseLinear_updateOutputCSR(self, input[1], input[2], input[3])
+   end
    return input.nn.SparseLinear_updateOutput(self, input)
 end
 
 function SparseLinear:accGradParameters(input, gradOutput, scale)
+   if type(input) == 'table' then
+      -- the weight decay is only added to the columns the batch touches
+      self.touchedColumns = self.touchedColumns or torch.LongTensor()
+      return self.weight.nn.SparseLinear_accGradParametersCSR(self, input[1], input[2], input[3], gradOutput, scale)
+   end
+   self.touchedColumns = nil
    return input.nn.SparseLinear_accGradParameters(self, input, gradOutput, scale)
 end
 
 function SparseLinear:updateGradInput(input, gradOutput)
    if self.gradInput then
+      if type(input) == 'table' then
+         self.gradValues = self.gradValues or input[3].new()
+         self.weight.nn.SparseLinear_updateGradInputCSR(self, input[1], input[2], input[3], gradOutput)
+         self.gradInput = {input[1], input[2], self.gradValues}
+         return self.gradInput
+      end
+      if type(self.gradInput) == 'table' then
+         self.gradInput = input.new()
+      end
       self.gradInput:resize(input:size())
       self.gradInput:copy(input)
       local numNonzero = self.gradInput:size(1)
@@ -58,4 +83,33 @@ function SparseLinear:updateGradInput(input, gradOutput)
       end
       return self.gradInput
    end
-end
\ No newline at end of file
+end
+
+function SparseLinear:zeroGradParameters()
+   if self.touchedColumns then
+      self.weight.nn.SparseLinear_zeroGradParametersCSR(self)
+   else
+      parent.zeroGradParameters(self)
+   end
+end
+
+function SparseLinear:updateParameters(learningRate)
+   if self.touchedColumns then
+      self.weight.nn.SparseLinear_updateParametersCSR(self, learningRate)
+   else
+      parent.updateParameters(self, learningRate)
+   end
+end
+
+function SparseLinear:type(type)
+   -- the touched columns stay a LongTensor
+   local touchedColumns = self.touchedColumns
+   self.touchedColumns = nil
+   self.gradValues = nil
+   if torch.type(self.gradInput) == 'table' then
+      self.gradInput = self.weight.new()
+   end
+   parent.type(self, type)
+   self.touchedColumns = touchedColumns
+   return self
+end
@@ -20,6 +20,10 @@ function SpatialConvolutionMM:__init(nInputPlane, nOutputPlane, kW, kH, dW, dH,
    self.gradWeight = torch.Tensor(nOutputPlane, nInputPlane*kH*kW)
    self.gradBias = torch.Tensor(nOutputPlane)
 
+   -- batches are unfolded into finput several frames at a time, each group
+   -- going through one GEMM; set self.memoryBudget (bytes) to bound finput
+   -- 3x3 stride 1 kernels go through Winograd F(2x2,3x3) or F(4x4,3x3);
+   -- self.winograd = false keeps im2col+GEMM, 2 or 4 forces the tile size
    self.finput = torch.Tensor()
    self.fgradInput = torch.Tensor()
    
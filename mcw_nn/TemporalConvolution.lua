@@ -14,6 +14,12 @@ function TemporalConvolution:__init(inputFrameSize, outputFrameSize, kW, dW)
    self.bias = torch.Tensor(outputFrameSize)
    self.gradWeight = torch.Tensor(outputFrameSize, inputFrameSize*kW)
    self.gradBias = torch.Tensor(outputFrameSize)
+
+   -- finput has one row per output frame of the batch, holding the kW
+   -- input frames it reads; past self.memoryBudget bytes, it only holds a
+   -- chunk of consecutive rows, which may span several sequences
+   self.finput = torch.Tensor()
+   self.fgradInput = torch.Tensor()
    
    self:reset()
 end
@@ -38,6 +44,9 @@ function TemporalConvolution:reset(stdv)
 end
 
 function TemporalConvolution:updateOutput(input)
+   -- modules saved before the buffers existed
+   self.finput = self.finput or input.new()
+   self.fgradInput = self.fgradInput or input.new()
    return input.nn.TemporalConvolution_updateOutput(self, input)
 end
 
@@ -0,0 +1,94 @@
+require 'sys'
+require 'nn'
+
+-- usage: th TemporalConvolution.lua [nThreads] [memoryBudget in MB]
+local nThreads = tonumber(arg[1])
+local memoryBudget = tonumber(arg[2])
+if nThreads then
+   torch.setnumthreads(nThreads)
+end
+torch.setdefaulttensortype('torch.FloatTensor')
+
+steps = 4 -- nb of steps in loop to average perf
+ops = 2 -- ops per point
+
+runs = {
+   {
+      -- speech, filterbank features
+      bs = 32,
+      nf = 1000,
+      ni = 120,
+      no = 256,
+      kw = 5,
+      dw = 1,
+   },
+   {
+      -- text, word embeddings
+      bs = 64,
+      nf = 200,
+      ni = 300,
+      no = 256,
+      kw = 3,
+      dw = 1,
+   },
+   {
+      -- speech, spectrogram with a strided first layer
+      bs = 16,
+      nf = 1500,
+      ni = 161,
+      no = 512,
+      kw = 11,
+      dw = 2,
+   },
+   {
+      -- upper layer
+      bs = 32,
+      nf = 500,
+      ni = 512,
+      no = 512,
+      kw = 5,
+      dw = 1,
+   },
+}
+
+print('threads = ' .. torch.getnumthreads() .. ', memoryBudget = ' .. (memoryBudget and memoryBudget .. 'MB' or 'default'))
+
+for i,run in ipairs(runs) do
+   local bs,nf,ni,no,kw,dw = run.bs,run.nf,run.ni,run.no,run.kw,run.dw
+   local nOutputFrame = math.floor((nf-kw)/dw)+1
+   local flops = ni*no*kw*nOutputFrame*bs*ops
+   print('')
+   print('CONFIG: input = ' .. bs..'x'..nf..'x'..ni .. ' * ker = ' .. ni..'x'..no..'x'..kw .. ' (stride = ' .. dw .. ')')
+
+   local module = nn.TemporalConvolution(ni,no,kw,dw)
+   if memoryBudget then
+      module.memoryBudget = memoryBudget*1024*1024
+   end
+   local input = torch.randn(bs, nf, ni)
+   local output = module:forward(input)
+   local gradOutput = torch.randn(output:size())
+   module:backward(input, gradOutput)
+
+   sys.tic()
+   for t = 1,steps do
+      module:updateOutput(input)
+   end
+   tm = sys.toc()/steps
+   print('updateOutput(): ' .. (flops / tm / 1e9) .. ' GFLOP/s (tm = ' .. tm .. ')')
+
+   sys.tic()
+   for t = 1,steps do
+      module:updateGradInput(input, gradOutput)
+   end
+   tm = sys.toc()/steps
+   print('updateGradInput(): ' .. (flops / tm / 1e9) .. ' GFLOP/s (tm = ' .. tm .. ')')
+
+   sys.tic()
+   for t = 1,steps do
+      module:accGradParameters(input, gradOutput)
+   end
+   tm = sys.toc()/steps
+   print('accGradParameters(): ' .. (flops / tm / 1e9) .. ' GFLOP/s (tm = ' .. tm .. ')')
+
+   collectgarbage()
+end
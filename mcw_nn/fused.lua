@@ -0,0 +1,69 @@
+----------------------------------------------------------------------
+-- fused.lua: optimizer steps over the flat parameters x and gradients
+-- dfdx returned by getParameters. Each step updates x (and its state)
+-- in one pass, touching every parameter once. config holds the
+-- hyper-parameters and state the buffers, as in the optim package;
+-- state defaults to config.
+----------------------------------------------------------------------
+
+local function learningRate(config, state, default)
+   local lr = config.learningRate or default
+   local lrd = config.learningRateDecay or 0
+   state.evalCounter = state.evalCounter or 0
+   local clr = lr / (1 + state.evalCounter*lrd)
+   state.evalCounter = state.evalCounter + 1
+   return clr
+end
+
+-- SGD with config.learningRate (1e-3), learningRateDecay (0),
+-- weightDecay (0), momentum (0), dampening (momentum) and nesterov
+-- (false). The momentum buffer is state.dfdx.
+function nn.fusedSGD(x, dfdx, config, state)
+   config = config or {}
+   state = state or config
+   local wd = config.weightDecay or 0
+   local mom = config.momentum or 0
+   local damp = config.dampening or mom
+   local nesterov = config.nesterov or false
+   assert(not nesterov or (mom > 0 and damp == 0), 'Nesterov momentum requires a momentum and zero dampening')
+   local clr = learningRate(config, state, 1e-3)
+   local first = false
+   if mom ~= 0 and not state.dfdx then
+      state.dfdx = dfdx.new(dfdx:nElement())
+      first = true
+   end
+   x.nn.FlatParameters_sgd(x, dfdx, state.dfdx, clr, wd, mom, damp, nesterov, first)
+   return x
+end
+
+-- Adagrad with config.learningRate (1e-3), learningRateDecay (0) and
+-- weightDecay (0). The sums of the squared gradients are
+-- state.paramVariance.
+function nn.fusedAdagrad(x, dfdx, config, state)
+   config = config or {}
+   state = state or config
+   local wd = config.weightDecay or 0
+   local clr = learningRate(config, state, 1e-3)
+   if not state.paramVariance then
+      state.paramVariance = dfdx.new(dfdx:nElement()):zero()
+   end
+   x.nn.FlatParameters_adagrad(x, dfdx, state.paramVariance, clr, wd)
+   return x
+end
+
+-- RMSProp with config.learningRate (1e-2), alpha (0.99), epsilon (1e-8)
+-- and weightDecay (0). The moving average of the squared gradients is
+-- state.m.
+function nn.fusedRMSProp(x, dfdx, config, state)
+   config = config or {}
+   state = state or config
+   local lr = config.learningRate or 1e-2
+   local alpha = config.alpha or 0.99
+   local epsilon = config.epsilon or 1e-8
+   local wd = config.weightDecay or 0
+   if not state.m then
+      state.m = dfdx.new(dfdx:nElement()):zero()
+   end
+   x.nn.FlatParameters_rmsprop(x, dfdx, state.m, lr, alpha, epsilon, wd)
+   return x
+end
@@ -0,0 +1,116 @@
+#ifndef TH_GENERIC_FILE
+#define TH_GENERIC_FILE "generic/Dropout.c"
+#else
+
+/* The factor the kept elements are multiplied by: 1/(1-p) for version 2,
+   1 for version 1 */
+static real nn_(Dropout_scale)(lua_State *L)
+{
+  real p = luaT_getfieldchecknumber(L, 1, "p");
+  int v2 = luaT_getfieldcheckboolean(L, 1, "v2");
+  return (v2 ? 1/(1-p) : 1);
+}
+
+/* Draws the mask and writes the output in one pass. Element i is kept with
+   probability 1-p, which sets bit i%32 of word i/32 of self.mask
+   (torch.IntTensor). The generator is sequential, so is the loop. */
+static int nn_(Dropout_updateOutput)(lua_State *L)
+{
+  THTensor *input = luaT_checkudata(L, 2, torch_Tensor);
+  real p = luaT_getfieldchecknumber(L, 1, "p");
+  real scale = nn_(Dropout_scale)(L);
+  THIntTensor *mask = luaT_getfieldcheckudata(L, 1, "mask", "torch.IntTensor");
+  THTensor *output = luaT_getfieldcheckudata(L, 1, "output", torch_Tensor);
+  THGenerator *generator;
+  real *input_data, *output_data;
+  unsigned int *mask_data;
+  long n, nWord, w;
+
+  lua_getglobal(L, "torch");
+  generator = luaT_getfieldcheckudata(L, -1, "_gen", "torch.Generator");
+  lua_pop(L, 2);
+
+  input = THTensor_(newContiguous)(input);
+  THTensor_(resizeAs)(output, input);
+  n = THTensor_(nElement)(input);
+  nWord = (n + 31)/32;
+  THIntTensor_resize1d(mask, nWord);
+  input_data = THTensor_(data)(input);
+  output_data = THTensor_(data)(output);
+  mask_data = (unsigned int*)THIntTensor_data(mask);
+
+  for(w = 0; w < nWord; w++)
+  {
+    long i0 = w*32;
+    long i1 = (i0 + 32 < n ? i0 + 32 : n);
+    unsigned int bits = 0;
+    long i;
+
+    for(i = i0; i < i1; i++)
+    {
+      if(THRandom_bernoulli(generator, 1-p))
+      {
+        bits |= 1u << (i - i0);
+        output_data[i] = input_data[i]*scale;
+      }
+      else
+        output_data[i] = 0;
+    }
+    mask_data[w] = bits;
+  }
+
+  THTensor_(free)(input);
+  return 1;
+}
+
+/* gradInput = gradOutput*scale where the bit of self.mask is set, 0 elsewhere */
+static int nn_(Dropout_updateGradInput)(lua_State *L)
+{
+  THTensor *gradOutput = luaT_checkudata(L, 3, torch_Tensor);
+  real scale = nn_(Dropout_scale)(L);
+  THIntTensor *mask = luaT_getfieldcheckudata(L, 1, "mask", "torch.IntTensor");
+  THTensor *gradInput = luaT_getfieldcheckudata(L, 1, "gradInput", torch_Tensor);
+  real *gradOutput_data, *gradInput_data;
+  unsigned int *mask_data;
+  long n, nWord, w;
+
+  n = THTensor_(nElement)(gradOutput);
+  nWord = (n + 31)/32;
+  luaL_argcheck(L, THIntTensor_nElement(mask) == nWord, 3, "gradOutput does not match the last input");
+
+  gradOutput = THTensor_(newContiguous)(gradOutput);
+  THTensor_(resizeAs)(gradInput, gradOutput);
+  gradOutput_data = THTensor_(data)(gradOutput);
+  gradInput_data = THTensor_(data)(gradInput);
+  mask_data = (unsigned int*)THIntTensor_data(mask);
+
+#pragma omp parallel for private(w)
+  for(w = 0; w < nWord; w++)
+  {
+    long i0 = w*32;
+    long i1 = (i0 + 32 < n ? i0 + 32 : n);
+    unsigned int bits = mask_data[w];
+    long i;
+
+    for(i = i0; i < i1; i++)
+      gradInput_data[i] = ((bits >> (i - i0)) & 1) ? gradOutput_data[i]*scale : 0;
+  }
+
+  THTensor_(free)(gradOutput);
+  return 1;
+}
+
+static const struct luaL_Reg nn_(Dropout__) [] = {
+  {"Dropout_updateOutput", nn_(Dropout_updateOutput)},
+  {"Dropout_updateGradInput", nn_(Dropout_updateGradInput)},
+  {NULL, NULL}
+};
+
+static void nn_(Dropout_init)(lua_State *L)
+{
+  luaT_pushmetatable(L, torch_Tensor);
+  luaT_registeratname(L, nn_(Dropout__), "nn");
+  lua_pop(L,1);
+}
+
+#endif
@@ -0,0 +1,246 @@
+#ifndef TH_GENERIC_FILE
+#define TH_GENERIC_FILE "generic/FlatParameters.c"
+#else
+
+/* spans are (start, end, storage, tensor) in the concatenation of the storages */
+static int nn_(FlatParameters_compareSpans)(const void *a, const void *b)
+{
+  long sa = ((const long*)a)[0], sb = ((const long*)b)[0];
+  return (sa > sb) - (sa < sb);
+}
+
+/* Moves the tensors of table 1 into one new contiguous tensor, which is
+   returned; each keeps its size and strides. The storages of the tensors are
+   laid out one after the other, in order of first appearance, without the
+   parts no tensor covers. Tensors sharing a storage still share it after. */
+static int nn_(FlatParameters_flatten)(lua_State *L)
+{
+  long nTensor, nStorage = 0, nSpan = 0, nRun = 0, nFlat = 0;
+  long i, j, d;
+  THTensor **tensors;
+  THStorage **storages;
+  long *bases, *spans, *runs, *offsets;
+  THTensor *flat;
+  real *flatData;
+
+  luaL_checktype(L, 1, LUA_TTABLE);
+  nTensor = lua_objlen(L, 1);
+  tensors = THAlloc(sizeof(THTensor*)*nTensor);
+  storages = THAlloc(sizeof(THStorage*)*nTensor);
+  bases = THAlloc(sizeof(long)*(nTensor+1));
+  spans = THAlloc(sizeof(long)*4*nTensor);
+  runs = THAlloc(sizeof(long)*3*nTensor);
+  offsets = THAlloc(sizeof(long)*nTensor);
+
+  bases[0] = 0;
+  for(i = 0; i < nTensor; i++)
+  {
+    THTensor *t;
+    lua_rawgeti(L, 1, i+1);
+    t = luaT_toudata(L, -1, torch_Tensor);
+    lua_pop(L, 1);
+    if(!t)
+    {
+      THFree(tensors); THFree(storages); THFree(bases); THFree(spans); THFree(runs); THFree(offsets);
+      luaL_error(L, "parameter %d is not a %s", (int)(i+1), torch_Tensor);
+    }
+    tensors[i] = t;
+    if(!t->storage || THTensor_(nElement)(t) == 0)
+      continue;
+
+    for(j = 0; j < nStorage && storages[j] != t->storage; j++);
+    if(j == nStorage)
+    {
+      storages[nStorage] = t->storage;
+      bases[nStorage+1] = bases[nStorage] + t->storage->size;
+      nStorage++;
+    }
+
+    spans[4*nSpan] = bases[j] + t->storageOffset;
+    spans[4*nSpan+1] = spans[4*nSpan] + 1;
+    for(d = 0; d < t->nDimension; d++)
+      spans[4*nSpan+1] += (t->size[d]-1)*t->stride[d];
+    spans[4*nSpan+2] = j;
+    spans[4*nSpan+3] = i;
+    nSpan++;
+  }
+
+  /* overlapping spans merge into runs (start, end, storage), packed one after
+     the other */
+  qsort(spans, nSpan, 4*sizeof(long), nn_(FlatParameters_compareSpans));
+  for(i = 0; i < nSpan; )
+  {
+    long *run = runs + 3*nRun++;
+    run[0] = spans[4*i];
+    run[1] = spans[4*i+1];
+    run[2] = spans[4*i+2];
+    for(j = i+1; j < nSpan && spans[4*j] < run[1]; j++)
+      run[1] = THMax(run[1], spans[4*j+1]);
+    for(; i < j; i++)
+      offsets[spans[4*i+3]] = nFlat + spans[4*i] - run[0];
+    nFlat += run[1] - run[0];
+  }
+
+  flat = THTensor_(newWithSize1d)(nFlat);
+  flatData = THTensor_(data)(flat);
+  for(i = 0; i < nRun; i++)
+  {
+    long *run = runs + 3*i;
+    memcpy(flatData, storages[run[2]]->data + run[0] - bases[run[2]], sizeof(real)*(run[1] - run[0]));
+    flatData += run[1] - run[0];
+  }
+
+  for(i = 0; i < nTensor; i++)
+  {
+    THTensor *t = tensors[i];
+    THLongStorage *size, *stride;
+    if(!t->storage || THTensor_(nElement)(t) == 0)
+      continue;
+    size = THTensor_(newSizeOf)(t);
+    stride = THTensor_(newStrideOf)(t);
+    THTensor_(setStorage)(t, flat->storage, offsets[i], size, stride);
+    THLongStorage_free(size);
+    THLongStorage_free(stride);
+  }
+
+  THFree(tensors);
+  THFree(storages);
+  THFree(bases);
+  THFree(spans);
+  THFree(runs);
+  THFree(offsets);
+  luaT_pushudata(L, flat, torch_Tensor);
+  return 1;
+}
+
+static void nn_(FlatParameters_check)(lua_State *L, THTensor *x, int index, THTensor *t)
+{
+  luaL_argcheck(L, THTensor_(isContiguous)(t), index, "contiguous tensor expected");
+  luaL_argcheck(L, THTensor_(nElement)(t) == THTensor_(nElement)(x), index, "inconsistent size");
+}
+
+/* x -= lr*d, with g = dfdx + weightDecay*x, v = momentum*v + (1-dampening)*g
+   (v = g on the first step), and d = g + momentum*v with nesterov, v without
+   (g without momentum) */
+static int nn_(FlatParameters_sgd)(lua_State *L)
+{
+  THTensor *x = luaT_checkudata(L, 1, torch_Tensor);
+  THTensor *dfdx = luaT_checkudata(L, 2, torch_Tensor);
+  THTensor *v = luaT_toudata(L, 3, torch_Tensor);
+  real lr = luaL_checknumber(L, 4);
+  real weightDecay = luaL_checknumber(L, 5);
+  real momentum = luaL_checknumber(L, 6);
+  real dampening = luaL_checknumber(L, 7);
+  int nesterov = lua_toboolean(L, 8);
+  int first = lua_toboolean(L, 9);
+  real *x_data, *dfdx_data, *v_data;
+  long n = THTensor_(nElement)(x);
+  long i;
+
+  luaL_argcheck(L, THTensor_(isContiguous)(x), 1, "contiguous tensor expected");
+  nn_(FlatParameters_check)(L, x, 2, dfdx);
+  luaL_argcheck(L, v || momentum == 0, 3, "momentum buffer expected");
+  if(v)
+    nn_(FlatParameters_check)(L, x, 3, v);
+  x_data = THTensor_(data)(x);
+  dfdx_data = THTensor_(data)(dfdx);
+  v_data = (v ? THTensor_(data)(v) : NULL);
+
+  if(momentum == 0)
+  {
+#pragma omp parallel for private(i)
+    for(i = 0; i < n; i++)
+      x_data[i] -= lr*(dfdx_data[i] + weightDecay*x_data[i]);
+  }
+  else
+  {
+#pragma omp parallel for private(i)
+    for(i = 0; i < n; i++)
+    {
+      real g = dfdx_data[i] + weightDecay*x_data[i];
+      real vi = (first ? g : momentum*v_data[i] + (1-dampening)*g);
+      v_data[i] = vi;
+      x_data[i] -= lr*(nesterov ? g + momentum*vi : vi);
+    }
+  }
+  return 0;
+}
+
+/* variance += g^2, x -= lr*g/(sqrt(variance)+1e-10), with g = dfdx + weightDecay*x */
+static int nn_(FlatParameters_adagrad)(lua_State *L)
+{
+  THTensor *x = luaT_checkudata(L, 1, torch_Tensor);
+  THTensor *dfdx = luaT_checkudata(L, 2, torch_Tensor);
+  THTensor *variance = luaT_checkudata(L, 3, torch_Tensor);
+  real lr = luaL_checknumber(L, 4);
+  real weightDecay = luaL_checknumber(L, 5);
+  real *x_data, *dfdx_data, *variance_data;
+  long n = THTensor_(nElement)(x);
+  long i;
+
+  luaL_argcheck(L, THTensor_(isContiguous)(x), 1, "contiguous tensor expected");
+  nn_(FlatParameters_check)(L, x, 2, dfdx);
+  nn_(FlatParameters_check)(L, x, 3, variance);
+  x_data = THTensor_(data)(x);
+  dfdx_data = THTensor_(data)(dfdx);
+  variance_data = THTensor_(data)(variance);
+
+#pragma omp parallel for private(i)
+  for(i = 0; i < n; i++)
+  {
+    real g = dfdx_data[i] + weightDecay*x_data[i];
+    real s = variance_data[i] + g*g;
+    variance_data[i] = s;
+    x_data[i] -= lr*g/(sqrt(s) + 1e-10);
+  }
+  return 0;
+}
+
+/* m = alpha*m + (1-alpha)*g^2, x -= lr*g/(sqrt(m)+epsilon), with g = dfdx + weightDecay*x */
+static int nn_(FlatParameters_rmsprop)(lua_State *L)
+{
+  THTensor *x = luaT_checkudata(L, 1, torch_Tensor);
+  THTensor *dfdx = luaT_checkudata(L, 2, torch_Tensor);
+  THTensor *m = luaT_checkudata(L, 3, torch_Tensor);
+  real lr = luaL_checknumber(L, 4);
+  real alpha = luaL_checknumber(L, 5);
+  real epsilon = luaL_checknumber(L, 6);
+  real weightDecay = luaL_checknumber(L, 7);
+  real *x_data, *dfdx_data, *m_data;
+  long n = THTensor_(nElement)(x);
+  long i;
+
+  luaL_argcheck(L, THTensor_(isContiguous)(x), 1, "contiguous tensor expected");
+  nn_(FlatParameters_check)(L, x, 2, dfdx);
+  nn_(FlatParameters_check)(L, x, 3, m);
+  x_data = THTensor_(data)(x);
+  dfdx_data = THTensor_(data)(dfdx);
+  m_data = THTensor_(data)(m);
+
+#pragma omp parallel for private(i)
+  for(i = 0; i < n; i++)
+  {
+    real g = dfdx_data[i] + weightDecay*x_data[i];
+    real s = alpha*m_data[i] + (1-alpha)*g*g;
+    m_data[i] = s;
+    x_data[i] -= lr*g/(sqrt(s) + epsilon);
+  }
+  return 0;
+}
+
+static const struct luaL_Reg nn_(FlatParameters__) [] = {
+  {"FlatParameters_flatten", nn_(FlatParameters_flatten)},
+  {"FlatParameters_sgd", nn_(FlatParameters_sgd)},
+  {"FlatParameters_adagrad", nn_(FlatParameters_adagrad)},
+  {"FlatParameters_rmsprop", nn_(FlatParameters_rmsprop)},
+  {NULL, NULL}
+};
+
+static void nn_(FlatParameters_init)(lua_State *L)
+{
+  luaT_pushmetatable(L, torch_Tensor);
+  luaT_registeratname(L, nn_(FlatParameters__), "nn");
+  lua_pop(L,1);
+}
+
+#endif
@@ -0,0 +1,211 @@
+#ifndef TH_GENERIC_FILE
+#define TH_GENERIC_FILE "generic/LookupTable.c"
+#else
+
+static int nn_(LookupTable_comparePairs)(const void *a, const void *b)
+{
+  const long *x = (const long*)a;
+  const long *y = (const long*)b;
+  if(x[0] != y[0])
+    return x[0] < y[0] ? -1 : 1;
+  return x[1] < y[1] ? -1 : (x[1] > y[1]);
+}
+
+/* Sorts the (row, position) pairs of the 1-based indices in input so
+   that the duplicates of a row are adjacent, in input order. Returns the
+   number of distinct rows; run r covers pairs offsets[r]..offsets[r+1]-1 */
+static long nn_(LookupTable_sortIndices)(THLongTensor *input, long *pairs, long *offsets)
+{
+  long *input_data = THLongTensor_data(input);
+  long n = THLongTensor_nElement(input);
+  long i, nRow = 0;
+
+  for(i = 0; i < n; i++)
+  {
+    pairs[2*i] = input_data[i]-1;
+    pairs[2*i+1] = i;
+  }
+  qsort(pairs, n, 2*sizeof(long), nn_(LookupTable_comparePairs));
+
+  for(i = 0; i < n; i++)
+  {
+    if(i == 0 || pairs[2*i] != pairs[2*i-2])
+      offsets[nRow++] = i;
+  }
+  offsets[nRow] = n;
+  return nRow;
+}
+
+static void nn_(LookupTable_checkIndices)(lua_State *L, THLongTensor *input, long nIndex)
+{
+  long *input_data = THLongTensor_data(input);
+  long n = THLongTensor_nElement(input);
+  long i;
+
+  for(i = 0; i < n; i++)
+  {
+    if(input_data[i] < 1 || input_data[i] > nIndex)
+    {
+      printf("\nLookupTable: %ld not between 1 and %ld\n", input_data[i], nIndex);
+      luaL_error(L, "index out of bound");
+    }
+  }
+}
+
+/* dst[row] += scale * (sum of the gradOutput rows of its run), one thread
+   per distinct row so that no two threads write the same row */
+static void nn_(LookupTable_accRows)(lua_State *L, THTensor *dst, THLongTensor *input, THTensor *gradOutput, real scale)
+{
+  long n = THLongTensor_nElement(input);
+  long rowSize = THTensor_(nElement)(dst)/dst->size[0];
+  long *pairs, *offsets;
+  long nRow, r;
+  real *dst_data, *gradOutput_data;
+
+  luaL_argcheck(L, THTensor_(isContiguous)(dst), 1, "weight must be contiguous");
+  luaL_argcheck(L, THTensor_(nElement)(gradOutput) == n*rowSize, 3, "inconsistent gradOutput size");
+  nn_(LookupTable_checkIndices)(L, input, dst->size[0]);
+
+  gradOutput = THTensor_(newContiguous)(gradOutput);
+  dst_data = THTensor_(data)(dst);
+  gradOutput_data = THTensor_(data)(gradOutput);
+
+  pairs = THAlloc(sizeof(long)*2*n);
+  offsets = THAlloc(sizeof(long)*(n+1));
+  nRow = nn_(LookupTable_sortIndices)(input, pairs, offsets);
+
+#pragma omp parallel for private(r)
+  for(r = 0; r < nRow; r++)
+  {
+    real *row = dst_data + pairs[2*offsets[r]]*rowSize;
+    long j;
+    for(j = offsets[r]; j < offsets[r+1]; j++)
+      THVector_(add)(row, gradOutput_data + pairs[2*j+1]*rowSize, scale, rowSize);
+  }
+
+  /* self.inputs[k] counts the uses of row k since zeroGradParameters */
+  lua_getfield(L, 1, "inputs");
+  for(r = 0; r < nRow; r++)
+  {
+    long k = pairs[2*offsets[r]]+1;
+    lua_rawgeti(L, -1, k);
+    lua_pushnumber(L, luaL_optnumber(L, -1, 0) + (offsets[r+1]-offsets[r]));
+    lua_rawseti(L, -3, k);
+    lua_pop(L, 1);
+  }
+  lua_pop(L, 1);
+
+  THFree(pairs);
+  THFree(offsets);
+  THTensor_(free)(gradOutput);
+}
+
+/* The rows touched since zeroGradParameters, i.e. the keys of self.inputs */
+static long nn_(LookupTable_touchedRows)(lua_State *L, long nIndex, long **rows)
+{
+  long nRow = 0, size = 16;
+
+  *rows = THAlloc(sizeof(long)*size);
+  lua_getfield(L, 1, "inputs");
+  lua_pushnil(L);
+  while(lua_next(L, -2) != 0)
+  {
+    long k = (long)lua_tonumber(L, -2);
+    lua_pop(L, 1);
+    if(k < 1 || k > nIndex)
+      continue;
+    if(nRow == size)
+    {
+      size *= 2;
+      *rows = THRealloc(*rows, sizeof(long)*size);
+    }
+    (*rows)[nRow++] = k-1;
+  }
+  lua_pop(L, 1);
+  return nRow;
+}
+
+static int nn_(LookupTable_accGradParameters)(lua_State *L)
+{
+  THLongTensor *input = luaT_checkudata(L, 2, "torch.LongTensor");
+  THTensor *gradOutput = luaT_checkudata(L, 3, torch_Tensor);
+  real scale = luaL_optnumber(L, 4, 1);
+  THTensor *gradWeight = luaT_getfieldcheckudata(L, 1, "gradWeight", torch_Tensor);
+
+  luaL_argcheck(L, THLongTensor_isContiguous(input), 2, "input must be contiguous");
+  nn_(LookupTable_accRows)(L, gradWeight, input, gradOutput, scale);
+  return 0;
+}
+
+static int nn_(LookupTable_accUpdateGradParameters)(lua_State *L)
+{
+  THLongTensor *input = luaT_checkudata(L, 2, "torch.LongTensor");
+  THTensor *gradOutput = luaT_checkudata(L, 3, torch_Tensor);
+  real lr = luaL_checknumber(L, 4);
+  THTensor *weight = luaT_getfieldcheckudata(L, 1, "weight", torch_Tensor);
+
+  luaL_argcheck(L, THLongTensor_isContiguous(input), 2, "input must be contiguous");
+  nn_(LookupTable_accRows)(L, weight, input, gradOutput, -lr);
+  return 0;
+}
+
+static int nn_(LookupTable_updateParameters)(lua_State *L)
+{
+  real lr = luaL_checknumber(L, 2);
+  THTensor *weight = luaT_getfieldcheckudata(L, 1, "weight", torch_Tensor);
+  THTensor *gradWeight = luaT_getfieldcheckudata(L, 1, "gradWeight", torch_Tensor);
+  long rowSize = THTensor_(nElement)(weight)/weight->size[0];
+  real *weight_data, *gradWeight_data;
+  long *rows;
+  long nRow, r;
+
+  luaL_argcheck(L, THTensor_(isContiguous)(weight) && THTensor_(isContiguous)(gradWeight), 1,
+                "weight and gradWeight must be contiguous");
+  weight_data = THTensor_(data)(weight);
+  gradWeight_data = THTensor_(data)(gradWeight);
+
+  nRow = nn_(LookupTable_touchedRows)(L, weight->size[0], &rows);
+#pragma omp parallel for private(r)
+  for(r = 0; r < nRow; r++)
+    THVector_(add)(weight_data + rows[r]*rowSize, gradWeight_data + rows[r]*rowSize, -lr, rowSize);
+
+  THFree(rows);
+  return 0;
+}
+
+static int nn_(LookupTable_zeroGradParameters)(lua_State *L)
+{
+  THTensor *gradWeight = luaT_getfieldcheckudata(L, 1, "gradWeight", torch_Tensor);
+  long rowSize = THTensor_(nElement)(gradWeight)/gradWeight->size[0];
+  real *gradWeight_data;
+  long *rows;
+  long nRow, r;
+
+  luaL_argcheck(L, THTensor_(isContiguous)(gradWeight), 1, "gradWeight must be contiguous");
+  gradWeight_data = THTensor_(data)(gradWeight);
+
+  nRow = nn_(LookupTable_touchedRows)(L, gradWeight->size[0], &rows);
+#pragma omp parallel for private(r)
+  for(r = 0; r < nRow; r++)
+    THVector_(fill)(gradWeight_data + rows[r]*rowSize, 0, rowSize);
+
+  THFree(rows);
+  return 0;
+}
+
+static const struct luaL_Reg nn_(LookupTable__) [] = {
+  {"LookupTable_accGradParameters", nn_(LookupTable_accGradParameters)},
+  {"LookupTable_accUpdateGradParameters", nn_(LookupTable_accUpdateGradParameters)},
+  {"LookupTable_updateParameters", nn_(LookupTable_updateParameters)},
+  {"LookupTable_zeroGradParameters", nn_(LookupTable_zeroGradParameters)},
+  {NULL, NULL}
+};
+
+void nn_(LookupTable_init)(lua_State *L)
+{
+  luaT_pushmetatable(L, torch_Tensor);
+  luaT_registeratname(L, nn_(LookupTable__), "nn");
+  lua_pop(L,1);
+}
+
+#endif
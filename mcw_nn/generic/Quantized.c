@@ -0,0 +1,235 @@
+#ifndef TH_GENERIC_FILE
+#define TH_GENERIC_FILE "generic/Quantized.c"
+#else
+
+/* The input scale fixed by nn.calibrate (self.inputScale), 0 if the
+   inputs are quantized with scales of their own */
+static real nn_(Quantized_inputScale)(lua_State *L)
+{
+  real scale;
+
+  lua_getfield(L, 1, "inputScale");
+  scale = (real)luaL_optnumber(L, -1, 0);
+  lua_pop(L, 1);
+  return scale;
+}
+
+/* self.qweight (torch.CharTensor) receives the rows of weight (one per
+   output unit or plane) in int8, zero padded to TH_QUANT_PADDED columns,
+   and self.weightScale their scales */
+static int nn_(Quantized_quantizeWeight)(lua_State *L)
+{
+  THTensor *weight = luaT_checkudata(L, 2, torch_Tensor);
+  THCharTensor *qweight = luaT_getfieldcheckudata(L, 1, "qweight", "torch.CharTensor");
+  THTensor *weightScale = luaT_getfieldcheckudata(L, 1, "weightScale", torch_Tensor);
+  long nRow, k, ldk;
+
+  luaL_argcheck(L, THTensor_(nElement)(weight) > 0, 2, "non-empty tensor expected");
+  weight = THTensor_(newContiguous)(weight);
+  nRow = weight->size[0];
+  k = THTensor_(nElement)(weight)/nRow;
+  ldk = TH_QUANT_PADDED(k);
+
+  THCharTensor_resize2d(qweight, nRow, ldk);
+  THTensor_(resize1d)(weightScale, nRow);
+  THQuant_(quantizeRows)((signed char*)THCharTensor_data(qweight), ldk, THTensor_(data)(weightScale),
+                         THTensor_(data)(weight), nRow, k, k, 0);
+
+  THTensor_(free)(weight);
+  return 0;
+}
+
+static int nn_(QuantizedLinear_updateOutput)(lua_State *L)
+{
+  THTensor *input = luaT_checkudata(L, 2, torch_Tensor);
+  long inputSize = luaT_getfieldcheckint(L, 1, "inputSize");
+  int relu = luaT_getfieldcheckboolean(L, 1, "relu");
+  real inputScale = nn_(Quantized_inputScale)(L);
+  THCharTensor *qweight = luaT_getfieldcheckudata(L, 1, "qweight", "torch.CharTensor");
+  THTensor *weightScale = luaT_getfieldcheckudata(L, 1, "weightScale", torch_Tensor);
+  THTensor *bias = luaT_getfieldcheckudata(L, 1, "bias", torch_Tensor);
+  THCharTensor *qinput = luaT_getfieldcheckudata(L, 1, "qinput", "torch.CharTensor");
+  THTensor *qinputScale = luaT_getfieldcheckudata(L, 1, "qinputScale", torch_Tensor);
+  THTensor *output = luaT_getfieldcheckudata(L, 1, "output", torch_Tensor);
+  long nOutput = qweight->size[0];
+  long ldk = qweight->size[1];
+  long nFrame;
+
+  luaL_argcheck(L, input->nDimension == 1 || input->nDimension == 2, 2, "vector or matrix expected");
+  luaL_argcheck(L, input->size[input->nDimension-1] == inputSize, 2, "inconsistent input size");
+  nFrame = (input->nDimension == 1 ? 1 : input->size[0]);
+
+  if(input->nDimension == 1)
+    THTensor_(resize1d)(output, nOutput);
+  else
+    THTensor_(resize2d)(output, nFrame, nOutput);
+
+  /* one int8 row (and scale) per sample */
+  input = THTensor_(newContiguous)(input);
+  THCharTensor_resize2d(qinput, nFrame, ldk);
+  THTensor_(resize1d)(qinputScale, nFrame);
+  THQuant_(quantizeRows)((signed char*)THCharTensor_data(qinput), ldk, THTensor_(data)(qinputScale),
+                         THTensor_(data)(input), nFrame, inputSize, inputSize, inputScale);
+
+  /* output^T = qweight qinput^T */
+  THQuant_(gemm)(nOutput, nFrame, ldk,
+                 (signed char*)THCharTensor_data(qweight), ldk, THTensor_(data)(weightScale), THTensor_(data)(bias),
+                 (signed char*)THCharTensor_data(qinput), ldk, THTensor_(data)(qinputScale),
+                 relu, THTensor_(data)(output), 1, nOutput);
+
+  THTensor_(free)(input);
+  return 1;
+}
+
+/* Row p of qfinput (HW x ldk) receives the patch under output position p,
+   in int8 with its own scale (or fixedScale if not 0) */
+static void nn_(QuantizedSpatialConvolutionMM_unfold)(signed char *qfinput, long ldk, real *scale, real fixedScale,
+                                                      real *input_data,
+                                                      int kW, int kH,
+                                                      int dW, int dH,
+                                                      int padding,
+                                                      long nInputPlane,
+                                                      long inputWidth, long inputHeight,
+                                                      long outputWidth, long outputHeight)
+{
+  long K = nInputPlane*kH*kW;
+
+#pragma omp parallel
+  {
+    real *patch = THAlloc(sizeof(real)*K);
+    long p;
+
+#pragma omp for
+    for(p = 0; p < outputHeight*outputWidth; p++)
+    {
+      long oy = p / outputWidth;
+      long ox = p % outputWidth;
+      real *dst = patch;
+      long nip;
+      int kh, kw;
+
+      for(nip = 0; nip < nInputPlane; nip++)
+      {
+        for(kh = 0; kh < kH; kh++)
+        {
+          long iy = oy*dH - padding + kh;
+          if(iy < 0 || iy >= inputHeight)
+          {
+            memset(dst, 0, sizeof(real)*kW);
+            dst += kW;
+            continue;
+          }
+          for(kw = 0; kw < kW; kw++)
+          {
+            long ix = ox*dW - padding + kw;
+            *dst++ = (ix < 0 || ix >= inputWidth ? 0 : input_data[(nip*inputHeight + iy)*inputWidth + ix]);
+          }
+        }
+      }
+
+      scale[p] = (fixedScale != 0 ? fixedScale : THQuant_(scale)(patch, K));
+      THQuant_(quantize)(qfinput + p*ldk, patch, K, scale[p]);
+      memset(qfinput + p*ldk + K, 0, ldk-K);
+    }
+
+    THFree(patch);
+  }
+}
+
+static int nn_(QuantizedSpatialConvolutionMM_updateOutput)(lua_State *L)
+{
+  THTensor *input = luaT_checkudata(L, 2, torch_Tensor);
+  int kW = luaT_getfieldcheckint(L, 1, "kW");
+  int kH = luaT_getfieldcheckint(L, 1, "kH");
+  int dW = luaT_getfieldcheckint(L, 1, "dW");
+  int dH = luaT_getfieldcheckint(L, 1, "dH");
+  int padding = luaT_getfieldcheckint(L, 1, "padding");
+  long nInputPlane = luaT_getfieldcheckint(L, 1, "nInputPlane");
+  int relu = luaT_getfieldcheckboolean(L, 1, "relu");
+  real inputScale = nn_(Quantized_inputScale)(L);
+
+  THCharTensor *qweight = luaT_getfieldcheckudata(L, 1, "qweight", "torch.CharTensor");
+  THTensor *weightScale = luaT_getfieldcheckudata(L, 1, "weightScale", torch_Tensor);
+  THTensor *bias = luaT_getfieldcheckudata(L, 1, "bias", torch_Tensor);
+  THCharTensor *qfinput = luaT_getfieldcheckudata(L, 1, "qfinput", "torch.CharTensor");
+  THTensor *qfinputScale = luaT_getfieldcheckudata(L, 1, "qfinputScale", torch_Tensor);
+  THTensor *output = luaT_getfieldcheckudata(L, 1, "output", torch_Tensor);
+
+  int dimf = 0;
+  int dimw = 2;
+  int dimh = 1;
+
+  long nOutputPlane = qweight->size[0];
+  long ldk = qweight->size[1];
+  long inputWidth, inputHeight;
+  long outputWidth, outputHeight;
+  long T, t, HW;
+  real *input_data, *output_data;
+
+  luaL_argcheck(L, input->nDimension == 3 || input->nDimension == 4, 2, "3D or 4D(batch mode) tensor expected");
+
+  if (input->nDimension == 4) {
+    dimf++;
+    dimw++;
+    dimh++;
+  }
+
+  luaL_argcheck(L, input->size[dimf] == nInputPlane, 2, "invalid number of input planes");
+  inputWidth   = input->size[dimw];
+  inputHeight  = input->size[dimh];
+  outputWidth  = (inputWidth + 2*padding - kW) / dW + 1;
+  outputHeight = (inputHeight + 2*padding - kH) / dH + 1;
+  luaL_argcheck(L, outputWidth >= 1 && outputHeight >= 1, 2, "input image smaller than kernel size");
+  HW = outputHeight*outputWidth;
+
+  input = THTensor_(newContiguous)(input);
+  if(input->nDimension == 3)
+  {
+    T = 1;
+    THTensor_(resize3d)(output, nOutputPlane, outputHeight, outputWidth);
+  }
+  else
+  {
+    T = input->size[0];
+    THTensor_(resize4d)(output, T, nOutputPlane, outputHeight, outputWidth);
+  }
+
+  THCharTensor_resize2d(qfinput, HW, ldk);
+  THTensor_(resize1d)(qfinputScale, HW);
+  input_data = THTensor_(data)(input);
+  output_data = THTensor_(data)(output);
+
+  for(t = 0; t < T; t++)
+  {
+    nn_(QuantizedSpatialConvolutionMM_unfold)((signed char*)THCharTensor_data(qfinput), ldk,
+                                              THTensor_(data)(qfinputScale), inputScale,
+                                              input_data + t*nInputPlane*inputHeight*inputWidth,
+                                              kW, kH, dW, dH, padding, nInputPlane,
+                                              inputWidth, inputHeight, outputWidth, outputHeight);
+
+    /* output[t] (nOutputPlane x HW) = qweight qfinput^T */
+    THQuant_(gemm)(nOutputPlane, HW, ldk,
+                   (signed char*)THCharTensor_data(qweight), ldk, THTensor_(data)(weightScale), THTensor_(data)(bias),
+                   (signed char*)THCharTensor_data(qfinput), ldk, THTensor_(data)(qfinputScale),
+                   relu, output_data + t*nOutputPlane*HW, HW, 1);
+  }
+
+  THTensor_(free)(input);
+  return 1;
+}
+
+static const struct luaL_Reg nn_(Quantized__) [] = {
+  {"Quantized_quantizeWeight", nn_(Quantized_quantizeWeight)},
+  {"QuantizedLinear_updateOutput", nn_(QuantizedLinear_updateOutput)},
+  {"QuantizedSpatialConvolutionMM_updateOutput", nn_(QuantizedSpatialConvolutionMM_updateOutput)},
+  {NULL, NULL}
+};
+
+static void nn_(Quantized_init)(lua_State *L)
+{
+  luaT_pushmetatable(L, torch_Tensor);
+  luaT_registeratname(L, nn_(Quantized__), "nn");
+  lua_pop(L,1);
+}
+
+#endif
@@ -9,8 +9,21 @@ static int nn_(Sigmoid_updateOutput)(lua_State *L)
 
   THTensor_(resizeAs)(output, input);
 
-  TH_TENSOR_APPLY2(real, output, real, input, \
-                   *output_data = 1./(1.+ exp(- *input_data));)
+  if (input->nDimension == 1 || !THTensor_(isContiguous)(input) || !THTensor_(isContiguous)(output))
+  {
+    TH_TENSOR_APPLY2(real, output, real, input, \
+                     *output_data = 1./(1.+ exp(- *input_data));)
+  }
+  else
+  {
+    real* ptr_output = THTensor_(data)(output);
+    real* ptr_input  = THTensor_(data)(input);
+    long n = THTensor_(nElement)(input);
+    long i;
+#pragma omp parallel for private(i)
+    for(i = 0; i < n; i += NN_VECTOR_CHUNK)
+      THVector_(sigmoid)(ptr_output+i, ptr_input+i, THMin(NN_VECTOR_CHUNK, n-i));
+  }
 
   return 1;
 }
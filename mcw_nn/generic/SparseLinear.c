@@ -112,10 +112,350 @@ int nn_(SparseLinear_updateParameters)(lua_State *L)
   return 0;
 }
 
+/* Batched input in CSR form: row b of the batch holds the non-zeros
+   rowPtr[b]..rowPtr[b+1]-1 of colIdx (1-based input indices) and values,
+   rowPtr being counted from rowPtr[0]. Returns the batch size. */
+static long nn_(SparseLinear_checkCSR)(lua_State *L, THLongTensor *rowPtr, THLongTensor *colIdx, THTensor *values, long inputSize)
+{
+  long nBatch = THLongTensor_nElement(rowPtr)-1;
+  long nnz = THLongTensor_nElement(colIdx);
+  long *rowPtr_data, *colIdx_data;
+  long b, j;
+
+  luaL_argcheck(L, nBatch >= 0 && THLongTensor_isContiguous(rowPtr), 2, "contiguous row pointers expected");
+  luaL_argcheck(L, THLongTensor_isContiguous(colIdx), 3, "contiguous column indices expected");
+  luaL_argcheck(L, THTensor_(nElement)(values) == nnz && THTensor_(isContiguous)(values), 4,
+                "contiguous values expected, one per column index");
+
+  rowPtr_data = THLongTensor_data(rowPtr);
+  colIdx_data = THLongTensor_data(colIdx);
+  for(b = 0; b < nBatch; b++)
+  {
+    if(rowPtr_data[b+1] < rowPtr_data[b])
+      luaL_error(L, "row pointers must be non-decreasing");
+  }
+  if(nBatch > 0 && rowPtr_data[nBatch]-rowPtr_data[0] != nnz)
+  {
+    printf("\nSparseLinear: row pointers cover %ld non-zeros, %ld given\n", rowPtr_data[nBatch]-rowPtr_data[0], nnz);
+    luaL_error(L, "inconsistent row pointers");
+  }
+
+  for(j = 0; j < nnz; j++)
+  {
+    if(colIdx_data[j] < 1 || colIdx_data[j] > inputSize)
+    {
+      printf("\nSparseLinear: %ld not between 1 and %ld\n", colIdx_data[j], inputSize);
+      luaL_error(L, "index out of bound");
+    }
+  }
+  return nBatch;
+}
+
+static int nn_(SparseLinear_updateOutputCSR)(lua_State *L)
+{
+  THLongTensor *rowPtr = luaT_checkudata(L, 2, "torch.LongTensor");
+  THLongTensor *colIdx = luaT_checkudata(L, 3, "torch.LongTensor");
+  THTensor *values = luaT_checkudata(L, 4, torch_Tensor);
+  THTensor *weight = luaT_getfieldcheckudata(L, 1, "weight", torch_Tensor);
+  THTensor *bias = luaT_getfieldcheckudata(L, 1, "bias", torch_Tensor);
+  THTensor *output = luaT_getfieldcheckudata(L, 1, "output", torch_Tensor);
+  long outputSize = weight->size[0];
+  long inputSize = weight->size[1];
+  long nBatch = nn_(SparseLinear_checkCSR)(L, rowPtr, colIdx, values, inputSize);
+  long *rowPtr_data = THLongTensor_data(rowPtr);
+  long *colIdx_data = THLongTensor_data(colIdx);
+  real *values_data = THTensor_(data)(values);
+  real *weight_data, *bias_data, *output_data;
+  long b;
+
+  luaL_argcheck(L, THTensor_(isContiguous)(weight) && THTensor_(isContiguous)(bias), 1,
+                "weight and bias must be contiguous");
+  THTensor_(resize2d)(output, nBatch, outputSize);
+  weight_data = THTensor_(data)(weight);
+  bias_data = THTensor_(data)(bias);
+  output_data = THTensor_(data)(output);
+
+  /* one row of the batch per thread; the non-zeros of a row gather from
+     each row of the weight in turn */
+#pragma omp parallel for private(b)
+  for(b = 0; b < nBatch; b++)
+  {
+    long start = rowPtr_data[b]-rowPtr_data[0];
+    long end = rowPtr_data[b+1]-rowPtr_data[0];
+    long o, j;
+    for(o = 0; o < outputSize; o++)
+    {
+      real *weight_o = weight_data + o*inputSize - 1;
+      accreal sum = bias_data[o];
+      for(j = start; j < end; j++)
+        sum += values_data[j]*weight_o[colIdx_data[j]];
+      output_data[b*outputSize+o] = sum;
+    }
+  }
+  return 1;
+}
+
+static int nn_(SparseLinear_updateGradInputCSR)(lua_State *L)
+{
+  THLongTensor *rowPtr = luaT_checkudata(L, 2, "torch.LongTensor");
+  THLongTensor *colIdx = luaT_checkudata(L, 3, "torch.LongTensor");
+  THTensor *values = luaT_checkudata(L, 4, torch_Tensor);
+  THTensor *gradOutput = luaT_checkudata(L, 5, torch_Tensor);
+  THTensor *weight = luaT_getfieldcheckudata(L, 1, "weight", torch_Tensor);
+  THTensor *gradValues = luaT_getfieldcheckudata(L, 1, "gradValues", torch_Tensor);
+  long outputSize = weight->size[0];
+  long inputSize = weight->size[1];
+  long nBatch = nn_(SparseLinear_checkCSR)(L, rowPtr, colIdx, values, inputSize);
+  long *rowPtr_data = THLongTensor_data(rowPtr);
+  long *colIdx_data = THLongTensor_data(colIdx);
+  real *weight_data, *gradOutput_data, *gradValues_data;
+  long b;
+
+  luaL_argcheck(L, THTensor_(nElement)(gradOutput) == nBatch*outputSize, 5, "inconsistent gradOutput size");
+  luaL_argcheck(L, THTensor_(isContiguous)(weight), 1, "weight must be contiguous");
+  gradOutput = THTensor_(newContiguous)(gradOutput);
+  THTensor_(resizeAs)(gradValues, values);
+  weight_data = THTensor_(data)(weight);
+  gradOutput_data = THTensor_(data)(gradOutput);
+  gradValues_data = THTensor_(data)(gradValues);
+
+  /* d output[b] / d values[j] is the column colIdx[j] of the weight */
+#pragma omp parallel for private(b)
+  for(b = 0; b < nBatch; b++)
+  {
+    real *gradOutput_b = gradOutput_data + b*outputSize;
+    long j;
+    for(j = rowPtr_data[b]-rowPtr_data[0]; j < rowPtr_data[b+1]-rowPtr_data[0]; j++)
+    {
+      real *weight_c = weight_data + colIdx_data[j]-1;
+      accreal sum = 0;
+      long o;
+      for(o = 0; o < outputSize; o++)
+        sum += weight_c[o*inputSize]*gradOutput_b[o];
+      gradValues_data[j] = sum;
+    }
+  }
+
+  THTensor_(free)(gradOutput);
+  return 1;
+}
+
+static int nn_(SparseLinear_comparePairs)(const void *a, const void *b)
+{
+  const long *x = (const long*)a;
+  const long *y = (const long*)b;
+  if(x[0] != y[0])
+    return x[0] < y[0] ? -1 : 1;
+  return x[1] < y[1] ? -1 : (x[1] > y[1]);
+}
+
+static int nn_(SparseLinear_isTouched)(long *touched, long nTouched, long c)
+{
+  long lo = 0, hi = nTouched;
+  while(lo < hi)
+  {
+    long mid = (lo+hi)/2;
+    if(touched[mid] < c)
+      lo = mid+1;
+    else
+      hi = mid;
+  }
+  return lo < nTouched && touched[lo] == c;
+}
+
+/* The non-zeros are sorted by column so that one thread owns each distinct
+   column of gradWeight. self.touchedColumns keeps the sorted (1-based)
+   columns accumulated since zeroGradParameters: the weight decay of a
+   column is added once, the first time the column is touched. */
+static int nn_(SparseLinear_accGradParametersCSR)(lua_State *L)
+{
+  THLongTensor *rowPtr = luaT_checkudata(L, 2, "torch.LongTensor");
+  THLongTensor *colIdx = luaT_checkudata(L, 3, "torch.LongTensor");
+  THTensor *values = luaT_checkudata(L, 4, torch_Tensor);
+  THTensor *gradOutput = luaT_checkudata(L, 5, torch_Tensor);
+  real scale = luaL_optnumber(L, 6, 1);
+  THTensor *weight = luaT_getfieldcheckudata(L, 1, "weight", torch_Tensor);
+  THTensor *gradWeight = luaT_getfieldcheckudata(L, 1, "gradWeight", torch_Tensor);
+  THTensor *gradBias = luaT_getfieldcheckudata(L, 1, "gradBias", torch_Tensor);
+  THLongTensor *touchedColumns = luaT_getfieldcheckudata(L, 1, "touchedColumns", "torch.LongTensor");
+  real weightDecay = luaT_getfieldchecknumber(L, 1, "weightDecay");
+  long outputSize = weight->size[0];
+  long inputSize = weight->size[1];
+  long nBatch = nn_(SparseLinear_checkCSR)(L, rowPtr, colIdx, values, inputSize);
+  long nnz = THLongTensor_nElement(colIdx);
+  long *rowPtr_data = THLongTensor_data(rowPtr);
+  long *colIdx_data = THLongTensor_data(colIdx);
+  real *values_data = THTensor_(data)(values);
+  real *weight_data, *gradWeight_data, *gradBias_data, *gradOutput_data;
+  long *pairs, *offsets, *rowOf, *touched, *merged;
+  long nTouched, nColumn, nMerged, b, j, o, r;
+
+  luaL_argcheck(L, THTensor_(nElement)(gradOutput) == nBatch*outputSize, 5, "inconsistent gradOutput size");
+  luaL_argcheck(L, THTensor_(isContiguous)(weight) && THTensor_(isContiguous)(gradWeight) &&
+                THTensor_(isContiguous)(gradBias), 1, "weight, gradWeight and gradBias must be contiguous");
+  luaL_argcheck(L, THLongTensor_isContiguous(touchedColumns), 1, "touchedColumns must be contiguous");
+  gradOutput = THTensor_(newContiguous)(gradOutput);
+  weight_data = THTensor_(data)(weight);
+  gradWeight_data = THTensor_(data)(gradWeight);
+  gradBias_data = THTensor_(data)(gradBias);
+  gradOutput_data = THTensor_(data)(gradOutput);
+  touched = THLongTensor_data(touchedColumns);
+  nTouched = THLongTensor_nElement(touchedColumns);
+
+  /* (column, non-zero) pairs by column, and the row of each non-zero */
+  pairs = THAlloc(sizeof(long)*2*(nnz+1));
+  offsets = THAlloc(sizeof(long)*(nnz+1));
+  rowOf = THAlloc(sizeof(long)*(nnz+1));
+  for(b = 0; b < nBatch; b++)
+  {
+    for(j = rowPtr_data[b]-rowPtr_data[0]; j < rowPtr_data[b+1]-rowPtr_data[0]; j++)
+    {
+      pairs[2*j] = colIdx_data[j];
+      pairs[2*j+1] = j;
+      rowOf[j] = b;
+    }
+  }
+  qsort(pairs, nnz, 2*sizeof(long), nn_(SparseLinear_comparePairs));
+  for(j = 0, nColumn = 0; j < nnz; j++)
+  {
+    if(j == 0 || pairs[2*j] != pairs[2*j-2])
+      offsets[nColumn++] = j;
+  }
+  offsets[nColumn] = nnz;
+
+#pragma omp parallel for private(r)
+  for(r = 0; r < nColumn; r++)
+  {
+    long c = pairs[2*offsets[r]];
+    real *gradWeight_c = gradWeight_data + c-1;
+    long k, i;
+
+    if(weightDecay != 0 && !nn_(SparseLinear_isTouched)(touched, nTouched, c))
+    {
+      for(i = 0; i < outputSize; i++)
+        gradWeight_c[i*inputSize] += weightDecay*weight_data[i*inputSize+c-1];
+    }
+    for(k = offsets[r]; k < offsets[r+1]; k++)
+    {
+      long nz = pairs[2*k+1];
+      real val = scale*values_data[nz];
+      real *gradOutput_b = gradOutput_data + rowOf[nz]*outputSize;
+      for(i = 0; i < outputSize; i++)
+        gradWeight_c[i*inputSize] += val*gradOutput_b[i];
+    }
+  }
+
+#pragma omp parallel for private(o)
+  for(o = 0; o < outputSize; o++)
+  {
+    accreal sum = 0;
+    long i;
+    for(i = 0; i < nBatch; i++)
+      sum += gradOutput_data[i*outputSize+o];
+    gradBias_data[o] += scale*sum;
+  }
+
+  /* merge the new columns into the sorted touched set */
+  merged = THAlloc(sizeof(long)*(nTouched+nColumn+1));
+  for(j = 0, r = 0, nMerged = 0; j < nTouched || r < nColumn; )
+  {
+    long c;
+    if(r == nColumn || (j < nTouched && touched[j] <= pairs[2*offsets[r]]))
+    {
+      c = touched[j++];
+      if(r < nColumn && pairs[2*offsets[r]] == c)
+        r++;
+    }
+    else
+      c = pairs[2*offsets[r++]];
+    merged[nMerged++] = c;
+  }
+  THLongTensor_resize1d(touchedColumns, nMerged);
+  memcpy(THLongTensor_data(touchedColumns), merged, sizeof(long)*nMerged);
+
+  THFree(merged);
+  THFree(rowOf);
+  THFree(pairs);
+  THFree(offsets);
+  THTensor_(free)(gradOutput);
+  return 0;
+}
+
+static int nn_(SparseLinear_updateParametersCSR)(lua_State *L)
+{
+  real learningRate = luaL_checknumber(L, 2);
+  THTensor *weight = luaT_getfieldcheckudata(L, 1, "weight", torch_Tensor);
+  THTensor *bias = luaT_getfieldcheckudata(L, 1, "bias", torch_Tensor);
+  THTensor *gradWeight = luaT_getfieldcheckudata(L, 1, "gradWeight", torch_Tensor);
+  THTensor *gradBias = luaT_getfieldcheckudata(L, 1, "gradBias", torch_Tensor);
+  THLongTensor *touchedColumns = luaT_getfieldcheckudata(L, 1, "touchedColumns", "torch.LongTensor");
+  long outputSize = weight->size[0];
+  long inputSize = weight->size[1];
+  long nTouched = THLongTensor_nElement(touchedColumns);
+  real *weight_data, *gradWeight_data;
+  long *touched;
+  long o;
+
+  luaL_argcheck(L, THTensor_(isContiguous)(weight) && THTensor_(isContiguous)(gradWeight), 1,
+                "weight and gradWeight must be contiguous");
+  luaL_argcheck(L, THLongTensor_isContiguous(touchedColumns), 1, "touchedColumns must be contiguous");
+  touched = THLongTensor_data(touchedColumns);
+  weight_data = THTensor_(data)(weight);
+  gradWeight_data = THTensor_(data)(gradWeight);
+
+  THTensor_(cadd)(bias, bias, -learningRate, gradBias);
+#pragma omp parallel for private(o)
+  for(o = 0; o < outputSize; o++)
+  {
+    real *weight_o = weight_data + o*inputSize - 1;
+    real *gradWeight_o = gradWeight_data + o*inputSize - 1;
+    long k;
+    for(k = 0; k < nTouched; k++)
+      weight_o[touched[k]] -= learningRate*gradWeight_o[touched[k]];
+  }
+  return 0;
+}
+
+static int nn_(SparseLinear_zeroGradParametersCSR)(lua_State *L)
+{
+  THTensor *gradWeight = luaT_getfieldcheckudata(L, 1, "gradWeight", torch_Tensor);
+  THTensor *gradBias = luaT_getfieldcheckudata(L, 1, "gradBias", torch_Tensor);
+  THLongTensor *touchedColumns = luaT_getfieldcheckudata(L, 1, "touchedColumns", "torch.LongTensor");
+  long outputSize = gradWeight->size[0];
+  long inputSize = gradWeight->size[1];
+  long nTouched = THLongTensor_nElement(touchedColumns);
+  real *gradWeight_data;
+  long *touched;
+  long o;
+
+  luaL_argcheck(L, THTensor_(isContiguous)(gradWeight), 1, "gradWeight must be contiguous");
+  luaL_argcheck(L, THLongTensor_isContiguous(touchedColumns), 1, "touchedColumns must be contiguous");
+  touched = THLongTensor_data(touchedColumns);
+  gradWeight_data = THTensor_(data)(gradWeight);
+
+  THTensor_(zero)(gradBias);
+#pragma omp parallel for private(o)
+  for(o = 0; o < outputSize; o++)
+  {
+    real *gradWeight_o = gradWeight_data + o*inputSize - 1;
+    long k;
+    for(k = 0; k < nTouched; k++)
+      gradWeight_o[touched[k]] = 0;
+  }
+
+  THLongTensor_resize1d(touchedColumns, 0);
+  return 0;
+}
+
 static const struct luaL_Reg nn_(SparseLinear__) [] = {
   {"SparseLinear_updateOutput", nn_(SparseLinear_updateOutput)},
   {"SparseLinear_accGradParameters", nn_(SparseLinear_accGradParameters)},
   {"SparseLinear_updateParameters", nn_(SparseLinear_updateParameters)},
+  {"SparseLinear_updateOutputCSR", nn_(SparseLinear_updateOutputCSR)},
+  {"SparseLinear_updateGradInputCSR", nn_(SparseLinear_updateGradInputCSR)},
+  {"SparseLinear_accGradParametersCSR", nn_(SparseLinear_accGradParametersCSR)},
+  {"SparseLinear_updateParametersCSR", nn_(SparseLinear_updateParametersCSR)},
+  {"SparseLinear_zeroGradParametersCSR", nn_(SparseLinear_zeroGradParametersCSR)},
   {NULL, NULL}
 };
 
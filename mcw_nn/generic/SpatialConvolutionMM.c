@@ -2,8 +2,11 @@
 #define TH_GENERIC_FILE "generic/SpatialConvolutionMM.c"
 #else
 
-/* note: due to write issues, this one cannot be parallelized as well as unfolded_copy */
-static void nn_(unfolded_acc)(THTensor *finput, THTensor *input,
+/* col2im written as a gather: every input row sums the columns that read
+   it, so frames, planes and rows can all be split between threads without
+   write conflicts. finput holds frame b at column b*outputHeight*outputWidth,
+   with ldf elements between rows. */
+static void nn_(unfolded_acc)(real *finput_data, long ldf, real *input_data, long nFrame,
                                int kW, int kH,
                                int dW, int dH,
                                int padding,
@@ -11,45 +14,38 @@ static void nn_(unfolded_acc)(THTensor *finput, THTensor *input,
                                int inputWidth, int inputHeight,
                                int outputWidth, int outputHeight)
 {
-  int nip;
-  real *input_data = THTensor_(data)(input);
-  real *finput_data = THTensor_(data)(finput);
+  long k;
 
-#pragma omp parallel for private(nip)
-  for(nip = 0; nip < nInputPlane; nip++)
+#pragma omp parallel for private(k)
+  for(k = 0; k < nFrame*nInputPlane*inputHeight; k++)
   {
-    int kw, kh, y, ix, iy;
+    long b = k / (nInputPlane*inputHeight);
+    int nip = (k / inputHeight) % nInputPlane;
+    int iy = k % inputHeight;
+    int kw, kh, y;
+    real *dst = input_data + (b*nInputPlane + nip)*(inputHeight*inputWidth) + iy*inputWidth;
+
+    memset(dst, 0, sizeof(real)*inputWidth);
     for(kh = 0; kh < kH; kh++)
     {
+      y = iy + padding - kh;
+      if (y < 0 || y >= outputHeight)
+        continue;
       for(kw = 0; kw < kW; kw++)
       {
-        real *src = finput_data + nip*(kH*kW*outputHeight*outputWidth) + kh*(kW*outputHeight*outputWidth) + kw*(outputHeight*outputWidth);
-        real *dst = input_data + nip*(inputHeight*inputWidth);
-        if (padding > 0) {
-          int lpad,rpad;
-          for(y = 0; y < outputHeight; y++) {
-            iy = y - padding + kh;
-            ix = 0 - padding + kw;
-            if (iy < 0 || iy >= inputHeight) {
-            } else {
-              lpad = fmaxf(0,padding-kw);
-              rpad = fmaxf(0,padding-(kW-kw-1));
-              THVector_(add)(dst+iy*inputWidth+ix+lpad, src+y*outputWidth+lpad, 1, outputWidth - lpad - rpad); /* note: THVector_add could handle 1 value better */
-            }
-          }
-        } else {
-          for(y = 0; y < outputHeight; y++) {
-            iy = y + kh;
-            ix = 0 + kw;
-            THVector_(add)(dst+iy*inputWidth+ix, src+y*outputWidth, 1, outputWidth); /* note: THVector_add could handle 1 value better */
-          }
-        }
+        real *src = finput_data + (nip*kH*kW + kh*kW + kw)*ldf + b*(outputHeight*outputWidth) + y*outputWidth;
+        int lpad = THMax(0, padding-kw);
+        int rpad = THMax(0, padding-(kW-kw-1));
+        if (outputWidth - lpad - rpad > 0)
+          THVector_(add)(dst+lpad-padding+kw, src+lpad, 1, outputWidth - lpad - rpad);
       }
     }
   }
 }
 
-static void nn_(unfolded_copy)(THTensor *finput, THTensor *input,
+/* im2col of nFrame consecutive frames into the columns of finput, laid out
+   as for unfolded_acc */
+static void nn_(unfolded_copy)(real *finput_data, long ldf, real *input_data, long nFrame,
                                int kW, int kH,
                                int dW, int dH,
                                int padding,
@@ -58,18 +54,17 @@ static void nn_(unfolded_copy)(THTensor *finput, THTensor *input,
                                int outputWidth, int outputHeight)
 {
   long k;
-  real *input_data = THTensor_(data)(input);
-  real *finput_data = THTensor_(data)(finput);
 
 #pragma omp parallel for private(k)
-  for(k = 0; k < nInputPlane*kH*kW; k++) {
-    int nip = k / (kH*kW);
+  for(k = 0; k < nFrame*nInputPlane*kH*kW; k++) {
+    long b = k / (nInputPlane*kH*kW);
+    int nip = (k / (kH*kW)) % nInputPlane;
     int rest = k % (kH*kW);
     int kh = rest / kW;
     int kw = rest % kW;
-    int x,y,ix,iy;
-    real *dst = finput_data + nip*(kH*kW*outputHeight*outputWidth) + kh*(kW*outputHeight*outputWidth) + kw*(outputHeight*outputWidth);
-    real *src = input_data + nip*(inputHeight*inputWidth);
+    int y,ix,iy;
+    real *dst = finput_data + (nip*kH*kW + kh*kW + kw)*ldf + b*(outputHeight*outputWidth);
+    real *src = input_data + (b*nInputPlane + nip)*(inputHeight*inputWidth);
     if (padding > 0) {
       int lpad,rpad;
       for(y = 0; y < outputHeight; y++) {
@@ -95,26 +90,280 @@ static void nn_(unfolded_copy)(THTensor *finput, THTensor *input,
   }
 }
 
-static void nn_(SpatialConvolutionMM_updateOutput_frame)(THTensor *input, THTensor *output, THTensor *weight, THTensor *bias, THTensor *finput,
-                                                         int kW, int kH, int dW, int dH, int padding,
-                                                         long nInputPlane, long inputWidth, long inputHeight,
-                                                         long nOutputPlane, long outputWidth, long outputHeight)
+/* Frames per GEMM: as many as keep the unfolded input within the module's
+   memoryBudget (bytes, NN_SPATIAL_CONVOLUTION_MM_BUDGET if unset) */
+static long nn_(SpatialConvolutionMM_batchSize)(lua_State *L, long T, long frameColumns)
 {
+  long budget, B;
+
+  lua_getfield(L, 1, "memoryBudget");
+  budget = (long)luaL_optnumber(L, -1, NN_SPATIAL_CONVOLUTION_MM_BUDGET);
+  lua_pop(L, 1);
+
+  B = budget / THMax(1, frameColumns*(long)sizeof(real));
+  return THMax(1, THMin(B, T));
+}
+
+/* Frames [t, t+nFrame) of a contiguous nPlane x HW batch as one
+   nPlane x nFrame*HW matrix: a view for a single frame, else a copy into
+   buffer */
+static THTensor* nn_(SpatialConvolutionMM_framesToColumns)(THTensor *frames, THTensor *buffer,
+                                                           long t, long nFrame, long nPlane, long HW)
+{
+  long offset = frames->storageOffset + t*nPlane*HW;
+  real *frames_data = frames->storage->data + offset;
+  real *buffer_data;
   long i;
-  THTensor *output2d;
 
-  nn_(unfolded_copy)(finput, input, kW, kH, dW, dH, padding, nInputPlane, inputWidth, inputHeight, outputWidth, outputHeight);
+  if(nFrame == 1)
+    return THTensor_(newWithStorage2d)(frames->storage, offset, nPlane, HW, HW, 1);
 
-  output2d = THTensor_(newWithStorage2d)(output->storage, output->storageOffset,
-                                         nOutputPlane, -1,
-                                         outputHeight*outputWidth, -1);
+  THTensor_(resize2d)(buffer, nPlane, nFrame*HW);
+  buffer_data = THTensor_(data)(buffer);
 
-  for(i = 0; i < nOutputPlane; i++)
-    THVector_(fill)(output->storage->data+output->storageOffset+output->stride[0]*i, THTensor_(get1d)(bias, i), outputHeight*outputWidth);
+#pragma omp parallel for private(i)
+  for(i = 0; i < nPlane*nFrame; i++)
+  {
+    long p = i / nFrame;
+    long b = i % nFrame;
+    memcpy(buffer_data + p*nFrame*HW + b*HW, frames_data + (b*nPlane + p)*HW, sizeof(real)*HW);
+  }
 
-  THTensor_(addmm)(output2d, 1, output2d, 1, weight, finput);
+  THTensor_(retain)(buffer);
+  return buffer;
+}
 
-  THTensor_(free)(output2d);
+/* Winograd F(m x m, 3x3) for m = 2 or 4 [Lavin & Gray]: tiles of
+   alpha = m+2 input points are transformed (B^T d B), multiplied in the
+   transformed domain with the transformed filters (G g G^T) by alpha^2
+   GEMMs over channels, and transformed back (A^T M A). The 1-D transforms
+   below read n = alpha (or 3) values x[i*xs] and write y[i*ys]; 2-D ones
+   apply them along columns then rows. */
+static void nn_(winograd_input)(int m, const real *x, long xs, real *y, long ys)
+{
+  if(m == 2)
+  {
+    y[0]    = x[0]    - x[2*xs];
+    y[ys]   = x[xs]   + x[2*xs];
+    y[2*ys] = x[2*xs] - x[xs];
+    y[3*ys] = x[xs]   - x[3*xs];
+  }
+  else
+  {
+    real x0 = x[0], x1 = x[xs], x2 = x[2*xs], x3 = x[3*xs], x4 = x[4*xs], x5 = x[5*xs];
+    y[0]    = 4*x0 - 5*x2 + x4;
+    y[ys]   = -4*x1 - 4*x2 + x3 + x4;
+    y[2*ys] = 4*x1 - 4*x2 - x3 + x4;
+    y[3*ys] = -2*x1 - x2 + 2*x3 + x4;
+    y[4*ys] = 2*x1 - x2 - 2*x3 + x4;
+    y[5*ys] = 4*x1 - 5*x3 + x5;
+  }
+}
+
+static void nn_(winograd_filter)(int m, const real *x, long xs, real *y, long ys)
+{
+  real x0 = x[0], x1 = x[xs], x2 = x[2*xs];
+  if(m == 2)
+  {
+    y[0]    = x0;
+    y[ys]   = (x0 + x1 + x2)/2;
+    y[2*ys] = (x0 - x1 + x2)/2;
+    y[3*ys] = x2;
+  }
+  else
+  {
+    y[0]    = x0/4;
+    y[ys]   = -(x0 + x1 + x2)/6;
+    y[2*ys] = -(x0 - x1 + x2)/6;
+    y[3*ys] = x0/24 + x1/12 + x2/6;
+    y[4*ys] = x0/24 - x1/12 + x2/6;
+    y[5*ys] = x2;
+  }
+}
+
+static void nn_(winograd_output)(int m, const real *x, long xs, real *y, long ys)
+{
+  if(m == 2)
+  {
+    y[0]  = x[0] + x[xs] + x[2*xs];
+    y[ys] = x[xs] - x[2*xs] - x[3*xs];
+  }
+  else
+  {
+    real x0 = x[0], x1 = x[xs], x2 = x[2*xs], x3 = x[3*xs], x4 = x[4*xs], x5 = x[5*xs];
+    y[0]    = x0 + x1 + x2 + x3 + x4;
+    y[ys]   = x1 - x2 + 2*x3 - 2*x4;
+    y[2*ys] = x1 + x2 + 4*x3 + 4*x4;
+    y[3*ys] = x1 - x2 + 8*x3 - 8*x4 + x5;
+  }
+}
+
+/* Tile size m of the Winograd path, 0 for im2col+GEMM. The module's
+   winograd field can force it (false, 2 or 4); by default 3x3 stride 1
+   kernels use F(4x4, 3x3) on planes of at least 8x8 outputs, where the
+   partial tiles waste little, and F(2x2, 3x3) otherwise */
+static int nn_(SpatialConvolutionMM_winogradTile)(lua_State *L, int kW, int kH, int dW, int dH,
+                                                  long outputHeight, long outputWidth)
+{
+  int m;
+
+  if(kW != 3 || kH != 3 || dW != 1 || dH != 1)
+    return 0;
+
+  lua_getfield(L, 1, "winograd");
+  if(lua_isnoneornil(L, -1) || (lua_isboolean(L, -1) && lua_toboolean(L, -1)))
+    m = (outputHeight >= 8 && outputWidth >= 8 ? 4 : 2);
+  else if(lua_isboolean(L, -1))
+    m = 0;
+  else
+  {
+    m = lua_tointeger(L, -1);
+    luaL_argcheck(L, m == 2 || m == 4, 1, "winograd must be false, 2 or 4");
+  }
+  lua_pop(L, 1);
+
+  return m;
+}
+
+/* 3x3 stride 1 convolution of a contiguous 3D or 4D input by Winograd
+   F(m x m, 3x3), in chunks of frames bounded by the memoryBudget. With
+   flip, weight is read as the transposed, rotated kernel of the module
+   (the correlation computing gradInput from gradOutput). The transformed
+   input goes to columns. */
+static void nn_(SpatialConvolutionMM_winograd)(lua_State *L, THTensor *input, THTensor *output,
+                                               THTensor *weight, THTensor *bias, THTensor *columns,
+                                               int m, int flip, int padding,
+                                               long nInputPlane, long inputHeight, long inputWidth,
+                                               long nOutputPlane, long outputHeight, long outputWidth)
+{
+  int alpha = m+2;
+  long T = (input->nDimension == 4 ? input->size[0] : 1);
+  long tilesW = (outputWidth + m-1) / m;
+  long P = tilesW * ((outputHeight + m-1) / m);
+  long B, t, i;
+  real *input_data = THTensor_(data)(input);
+  real *output_data = THTensor_(data)(output);
+  real *weight_data, *U_data;
+  THTensor *U = THTensor_(newWithSize3d)(alpha*alpha, nOutputPlane, nInputPlane);
+  THTensor *M = THTensor_(new)();
+
+  weight = THTensor_(newContiguous)(weight);
+  weight_data = THTensor_(data)(weight);
+  U_data = THTensor_(data)(U);
+
+  /* U[xi] = (G g G^T)[xi], one nOutputPlane x nInputPlane matrix per point */
+#pragma omp parallel for private(i)
+  for(i = 0; i < nOutputPlane*nInputPlane; i++)
+  {
+    long k = i / nInputPlane;
+    long c = i % nInputPlane;
+    real *w = weight_data + (flip ? c*nOutputPlane + k : k*nInputPlane + c)*9;
+    real g[9], tmp[6*3], u[6*6];
+    int x, y;
+
+    for(y = 0; y < 9; y++)
+      g[y] = (flip ? w[8-y] : w[y]);
+    for(x = 0; x < 3; x++)
+      nn_(winograd_filter)(m, g+x, 3, tmp+x, 3);
+    for(y = 0; y < alpha; y++)
+      nn_(winograd_filter)(m, tmp+y*3, 1, u+y*alpha, 1);
+    for(y = 0; y < alpha*alpha; y++)
+      U_data[(y*nOutputPlane + k)*nInputPlane + c] = u[y];
+  }
+
+  B = nn_(SpatialConvolutionMM_batchSize)(L, T, alpha*alpha*nInputPlane*P);
+  for(t = 0; t < T; t += B)
+  {
+    long nFrame = THMin(B, T-t);
+    long ncol = nFrame*P;
+    real *V_data, *M_data;
+
+    THTensor_(resize3d)(columns, alpha*alpha, nInputPlane, ncol);
+    THTensor_(resize3d)(M, alpha*alpha, nOutputPlane, ncol);
+    V_data = THTensor_(data)(columns);
+    M_data = THTensor_(data)(M);
+
+    /* V[xi][c][b*P+p] = (B^T d B)[xi] for tile p of plane c in frame b */
+#pragma omp parallel for private(i)
+    for(i = 0; i < nFrame*nInputPlane; i++)
+    {
+      long b = i / nInputPlane;
+      long c = i % nInputPlane;
+      real *plane = input_data + ((t+b)*nInputPlane + c)*inputHeight*inputWidth;
+      real d[6*6], tmp[6*6], v[6*6];
+      long p;
+
+      for(p = 0; p < P; p++)
+      {
+        long y0 = (p / tilesW)*m - padding;
+        long x0 = (p % tilesW)*m - padding;
+        int x, y;
+
+        for(y = 0; y < alpha; y++)
+        {
+          for(x = 0; x < alpha; x++)
+          {
+            long iy = y0+y, ix = x0+x;
+            d[y*alpha+x] = (iy >= 0 && iy < inputHeight && ix >= 0 && ix < inputWidth ? plane[iy*inputWidth+ix] : 0);
+          }
+        }
+        for(x = 0; x < alpha; x++)
+          nn_(winograd_input)(m, d+x, alpha, tmp+x, alpha);
+        for(y = 0; y < alpha; y++)
+          nn_(winograd_input)(m, tmp+y*alpha, 1, v+y*alpha, 1);
+        for(y = 0; y < alpha*alpha; y++)
+          V_data[(y*nInputPlane + c)*ncol + b*P + p] = v[y];
+      }
+    }
+
+    for(i = 0; i < alpha*alpha; i++)
+    {
+      THTensor *U_i = THTensor_(newSelect)(U, 0, i);
+      THTensor *V_i = THTensor_(newSelect)(columns, 0, i);
+      THTensor *M_i = THTensor_(newSelect)(M, 0, i);
+
+      THTensor_(addmm)(M_i, 0, M_i, 1, U_i, V_i);
+
+      THTensor_(free)(U_i);
+      THTensor_(free)(V_i);
+      THTensor_(free)(M_i);
+    }
+
+    /* each m x m output tile is A^T M A, clipped to the plane */
+#pragma omp parallel for private(i)
+    for(i = 0; i < nFrame*nOutputPlane; i++)
+    {
+      long b = i / nOutputPlane;
+      long k = i % nOutputPlane;
+      real *plane = output_data + ((t+b)*nOutputPlane + k)*outputHeight*outputWidth;
+      real biask = (bias ? THTensor_(get1d)(bias, k) : 0);
+      real mm[6*6], tmp[4*6], z[4*4];
+      long p;
+
+      for(p = 0; p < P; p++)
+      {
+        long y0 = (p / tilesW)*m;
+        long x0 = (p % tilesW)*m;
+        int x, y;
+
+        for(y = 0; y < alpha*alpha; y++)
+          mm[y] = M_data[(y*nOutputPlane + k)*ncol + b*P + p];
+        for(x = 0; x < alpha; x++)
+          nn_(winograd_output)(m, mm+x, alpha, tmp+x, alpha);
+        for(y = 0; y < m; y++)
+          nn_(winograd_output)(m, tmp+y*alpha, 1, z+y*m, 1);
+        for(y = 0; y < m && y0+y < outputHeight; y++)
+        {
+          for(x = 0; x < m && x0+x < outputWidth; x++)
+            plane[(y0+y)*outputWidth + x0+x] = z[y*m+x] + biask;
+        }
+      }
+    }
+  }
+
+  THTensor_(free)(weight);
+  THTensor_(free)(U);
+  THTensor_(free)(M);
 }
 
 static int nn_(SpatialConvolutionMM_updateOutput)(lua_State *L)
@@ -141,6 +390,10 @@ static int nn_(SpatialConvolutionMM_updateOutput)(lua_State *L)
   long nOutputPlane;
   long outputWidth;
   long outputHeight;
+  long T, B, t, HW;
+  int winogradTile;
+  real *input_data, *output_data;
+  THTensor *foutput;
 
   luaL_argcheck(L, input->nDimension == 3 || input->nDimension == 4, 2, "3D or 4D(batch mode) tensor expected");
 
@@ -160,66 +413,90 @@ static int nn_(SpatialConvolutionMM_updateOutput)(lua_State *L)
   nOutputPlane = weight->size[0];
   outputWidth  = (inputWidth + 2*padding - kW) / dW + 1;
   outputHeight = (inputHeight + 2*padding - kH) / dH + 1;
+  HW = outputHeight*outputWidth;
 
+  input = THTensor_(newContiguous)(input);
   if(input->nDimension == 3)
   {
-    THTensor_(resize2d)(finput, kW*kH*nInputPlane, outputHeight*outputWidth);
+    T = 1;
     THTensor_(resize3d)(output, nOutputPlane, outputHeight, outputWidth);
-
-    nn_(SpatialConvolutionMM_updateOutput_frame)(input, output, weight, bias, finput,
-                                                 kW, kH, dW, dH, padding,
-                                                 nInputPlane, inputWidth, inputHeight,
-                                                 nOutputPlane, outputWidth, outputHeight);
   }
   else
   {
-    long T = input->size[0];
-    long t;
-
-    THTensor_(resize3d)(finput, T, kW*kH*nInputPlane, outputHeight*outputWidth);
+    T = input->size[0];
     THTensor_(resize4d)(output, T, nOutputPlane, outputHeight, outputWidth);
+  }
+
+  winogradTile = nn_(SpatialConvolutionMM_winogradTile)(L, kW, kH, dW, dH, outputHeight, outputWidth);
+  if(winogradTile)
+  {
+    nn_(SpatialConvolutionMM_winograd)(L, input, output, weight, bias, finput, winogradTile, 0, padding,
+                                       nInputPlane, inputHeight, inputWidth,
+                                       nOutputPlane, outputHeight, outputWidth);
+    THTensor_(free)(input);
+    return 1;
+  }
+
+  /* B frames unfolded side by side go through one wide GEMM */
+  B = nn_(SpatialConvolutionMM_batchSize)(L, T, kW*kH*nInputPlane*HW);
+  THTensor_(resize2d)(finput, kW*kH*nInputPlane, B*HW);
+
+  input_data = THTensor_(data)(input);
+  output_data = THTensor_(data)(output);
+  foutput = THTensor_(new)();
+
+  for(t = 0; t < T; t += B)
+  {
+    long nFrame = THMin(B, T-t);
+    long i;
+    THTensor *finput_n = THTensor_(newWithStorage2d)(finput->storage, finput->storageOffset,
+                                                     kW*kH*nInputPlane, B*HW,
+                                                     nFrame*HW, 1);
 
-    THStorage_(clearFlag)(input->storage, TH_STORAGE_REFCOUNTED);
-    THStorage_(clearFlag)(output->storage, TH_STORAGE_REFCOUNTED);
-    THStorage_(clearFlag)(finput->storage, TH_STORAGE_REFCOUNTED);
+    nn_(unfolded_copy)(THTensor_(data)(finput), B*HW, input_data + t*nInputPlane*inputHeight*inputWidth, nFrame,
+                       kW, kH, dW, dH, padding, nInputPlane, inputWidth, inputHeight, outputWidth, outputHeight);
 
-#pragma omp parallel for private(t)
-    for(t = 0; t < T; t++)
+    if(nFrame == 1)
     {
-      THTensor *input_t = THTensor_(newSelect)(input, 0, t);
-      THTensor *output_t = THTensor_(newSelect)(output, 0, t);
-      THTensor *finput_t = THTensor_(newSelect)(finput, 0, t);
-
-      nn_(SpatialConvolutionMM_updateOutput_frame)(input_t, output_t, weight, bias, finput_t,
-                                                   kW, kH, dW, dH, padding,
-                                                   nInputPlane, inputWidth, inputHeight,
-                                                   nOutputPlane, outputWidth, outputHeight);
-
-      THTensor_(free)(input_t);
-      THTensor_(free)(output_t);
-      THTensor_(free)(finput_t);
+      THTensor *output2d = THTensor_(newWithStorage2d)(output->storage, output->storageOffset + t*nOutputPlane*HW,
+                                                       nOutputPlane, HW,
+                                                       HW, 1);
+      for(i = 0; i < nOutputPlane; i++)
+        THVector_(fill)(output_data + (t*nOutputPlane + i)*HW, THTensor_(get1d)(bias, i), HW);
+
+      THTensor_(addmm)(output2d, 1, output2d, 1, weight, finput_n);
+      THTensor_(free)(output2d);
     }
-    THStorage_(setFlag)(input->storage, TH_STORAGE_REFCOUNTED);
-    THStorage_(setFlag)(output->storage, TH_STORAGE_REFCOUNTED);
-    THStorage_(setFlag)(finput->storage, TH_STORAGE_REFCOUNTED);
-  }
+    else
+    {
+      real *foutput_data;
 
-  return 1;
-}
+      THTensor_(resize2d)(foutput, nOutputPlane, nFrame*HW);
+      THTensor_(addmm)(foutput, 0, foutput, 1, weight, finput_n);
+      foutput_data = THTensor_(data)(foutput);
 
+      /* back to frame-major order, adding the bias on the way */
+#pragma omp parallel for private(i)
+      for(i = 0; i < nOutputPlane*nFrame; i++)
+      {
+        long p = i / nFrame;
+        long b = i % nFrame;
+        real *src = foutput_data + p*nFrame*HW + b*HW;
+        real *dst = output_data + ((t+b)*nOutputPlane + p)*HW;
+        real biasp = THTensor_(get1d)(bias, p);
+        long k;
+        for(k = 0; k < HW; k++)
+          dst[k] = src[k] + biasp;
+      }
+    }
 
-static void nn_(SpatialConvolutionMM_updateGradInput_frame)(THTensor *gradInput, THTensor *gradOutput, THTensor *weight, THTensor *fgradInput,
-                                                            int kW, int kH, int dW, int dH, int padding)
-{
-  THTensor *gradOutput2d = THTensor_(newWithStorage2d)(gradOutput->storage, gradOutput->storageOffset,
-                                                       gradOutput->size[0], -1,
-                                                       gradOutput->size[1]*gradOutput->size[2], -1);
-  THTensor_(addmm)(fgradInput, 0, fgradInput, 1, weight, gradOutput2d);
-  THTensor_(free)(gradOutput2d);
+    THTensor_(free)(finput_n);
+  }
 
-  THTensor_(zero)(gradInput);
+  THTensor_(free)(foutput);
+  THTensor_(free)(input);
 
-  nn_(unfolded_acc)(fgradInput, gradInput, kW, kH, dW, dH, padding, gradInput->size[0], gradInput->size[2], gradInput->size[1], gradOutput->size[2], gradOutput->size[1]);
+  return 1;
 }
 
 static int nn_(SpatialConvolutionMM_updateGradInput)(lua_State *L)
@@ -233,115 +510,148 @@ static int nn_(SpatialConvolutionMM_updateGradInput)(lua_State *L)
   int padding = luaT_getfieldcheckint(L, 1, "padding");
   int nOutputPlane = luaT_getfieldcheckint(L, 1, "nOutputPlane");
 
-  THTensor *finput = luaT_getfieldcheckudata(L, 1, "finput", torch_Tensor);
   THTensor *fgradInput = luaT_getfieldcheckudata(L, 1, "fgradInput", torch_Tensor);
   THTensor *weight = luaT_getfieldcheckudata(L, 1, "weight", torch_Tensor);
   THTensor *gradInput = luaT_getfieldcheckudata(L, 1, "gradInput", torch_Tensor);
 
-  THArgCheck( nOutputPlane == gradOutput->size[input->nDimension == 4 ? 1 : 0], 1, "Number of output features is not equal to nOutputPlane" );
+  int batch = (input->nDimension == 4);
+  long T = (batch ? input->size[0] : 1);
+  long nInputPlane = input->size[batch];
+  long inputHeight = input->size[batch+1];
+  long inputWidth = input->size[batch+2];
+  long outputHeight, outputWidth, HW, B, t;
+  int winogradTile;
+  THTensor *gradOutputBuffer;
 
+  THArgCheck( nOutputPlane == gradOutput->size[batch], 1, "Number of output features is not equal to nOutputPlane" );
+
+  outputHeight = gradOutput->size[batch+1];
+  outputWidth = gradOutput->size[batch+2];
+  HW = outputHeight*outputWidth;
+
+  gradOutput = THTensor_(newContiguous)(gradOutput);
   THTensor_(resizeAs)(gradInput, input);
-  THTensor_(resizeAs)(fgradInput, finput);
-  THTensor_(transpose)(weight, weight, 0, 1);
 
-  if(input->nDimension == 3)
+  /* gradInput is the full correlation of gradOutput with the rotated
+     kernel: a 3x3 convolution again when the padding allows it */
+  winogradTile = (padding <= 2 ? nn_(SpatialConvolutionMM_winogradTile)(L, kW, kH, dW, dH, inputHeight, inputWidth) : 0);
+  if(winogradTile)
   {
-    nn_(SpatialConvolutionMM_updateGradInput_frame)(gradInput, gradOutput, weight, fgradInput, kW, kH, dW, dH, padding);
+    nn_(SpatialConvolutionMM_winograd)(L, gradOutput, gradInput, weight, NULL, fgradInput, winogradTile, 1, kW-1-padding,
+                                       nOutputPlane, outputHeight, outputWidth,
+                                       nInputPlane, inputHeight, inputWidth);
+    THTensor_(free)(gradOutput);
+    return 1;
   }
-  else
-  {
-    long T = input->size[0];
-    long t;
 
-    THStorage_(clearFlag)(gradInput->storage, TH_STORAGE_REFCOUNTED);
-    THStorage_(clearFlag)(gradOutput->storage, TH_STORAGE_REFCOUNTED);
-    THStorage_(clearFlag)(fgradInput->storage, TH_STORAGE_REFCOUNTED);
+  B = nn_(SpatialConvolutionMM_batchSize)(L, T, kW*kH*nInputPlane*HW);
+  THTensor_(resize2d)(fgradInput, kW*kH*nInputPlane, B*HW);
+  THTensor_(transpose)(weight, weight, 0, 1);
+  gradOutputBuffer = THTensor_(new)();
 
-#pragma omp parallel for private(t)
-    for(t = 0; t < T; t++)
-    {
-      THTensor *gradInput_t = THTensor_(newSelect)(gradInput, 0, t);
-      THTensor *gradOutput_t = THTensor_(newSelect)(gradOutput, 0, t);
-      THTensor *fgradInput_t = THTensor_(newSelect)(fgradInput, 0, t);
+  for(t = 0; t < T; t += B)
+  {
+    long nFrame = THMin(B, T-t);
+    THTensor *gradOutput_n = nn_(SpatialConvolutionMM_framesToColumns)(gradOutput, gradOutputBuffer, t, nFrame, nOutputPlane, HW);
+    THTensor *fgradInput_n = THTensor_(newWithStorage2d)(fgradInput->storage, fgradInput->storageOffset,
+                                                         kW*kH*nInputPlane, B*HW,
+                                                         nFrame*HW, 1);
 
-      nn_(SpatialConvolutionMM_updateGradInput_frame)(gradInput_t, gradOutput_t, weight, fgradInput_t, kW, kH, dW, dH, padding);
+    THTensor_(addmm)(fgradInput_n, 0, fgradInput_n, 1, weight, gradOutput_n);
 
-      THTensor_(free)(gradInput_t);
-      THTensor_(free)(gradOutput_t);
-      THTensor_(free)(fgradInput_t);
-    }
+    nn_(unfolded_acc)(THTensor_(data)(fgradInput), B*HW, THTensor_(data)(gradInput) + t*nInputPlane*inputHeight*inputWidth, nFrame,
+                      kW, kH, dW, dH, padding, nInputPlane, inputWidth, inputHeight, outputWidth, outputHeight);
 
-    THStorage_(setFlag)(gradInput->storage, TH_STORAGE_REFCOUNTED);
-    THStorage_(setFlag)(gradOutput->storage, TH_STORAGE_REFCOUNTED);
-    THStorage_(setFlag)(fgradInput->storage, TH_STORAGE_REFCOUNTED);
+    THTensor_(free)(gradOutput_n);
+    THTensor_(free)(fgradInput_n);
   }
 
   THTensor_(transpose)(weight, weight, 0, 1);
+  THTensor_(free)(gradOutputBuffer);
+  THTensor_(free)(gradOutput);
 
   return 1;
 }
 
-static void nn_(SpatialConvolutionMM_accGradParameters_frame)(THTensor *gradOutput, THTensor *gradWeight, THTensor *gradBias, THTensor *finput,
-                                                              real scale)
-{
-  long i;
-  THTensor *gradOutputPlane = THTensor_(new)();
-  THTensor *gradOutput2d = THTensor_(newWithStorage2d)(gradOutput->storage, gradOutput->storageOffset,
-                                                       gradOutput->size[0], -1,
-                                                       gradOutput->size[1]*gradOutput->size[2], -1);
-
-  THTensor_(transpose)(finput, finput, 0, 1);
-  THTensor_(addmm)(gradWeight, 1, gradWeight, scale, gradOutput2d, finput);
-  THTensor_(transpose)(finput, finput, 0, 1);
-
-  for(i = 0; i < gradBias->size[0]; i++)
-  {
-    long k;
-    real sum = 0;
-    real *data = gradOutput2d->storage->data + gradOutput2d->storageOffset + i*gradOutput2d->stride[0];
-    for(k = 0; k < gradOutput2d->size[1]; k++)
-      sum += data[k];
-    (gradBias->storage->data + gradBias->storageOffset)[i] += scale*sum;
-  }
-
-  THTensor_(free)(gradOutputPlane);
-  THTensor_(free)(gradOutput2d);
-}
-
 static int nn_(SpatialConvolutionMM_accGradParameters)(lua_State *L)
 {
   THTensor *input = luaT_checkudata(L, 2, torch_Tensor);
   THTensor *gradOutput = luaT_checkudata(L, 3, torch_Tensor);
   real scale = luaL_optnumber(L, 4, 1);
+  int kW = luaT_getfieldcheckint(L, 1, "kW");
+  int kH = luaT_getfieldcheckint(L, 1, "kH");
+  int dW = luaT_getfieldcheckint(L, 1, "dW");
+  int dH = luaT_getfieldcheckint(L, 1, "dH");
+  int padding = luaT_getfieldcheckint(L, 1, "padding");
   int nOutputPlane = luaT_getfieldcheckint(L, 1, "nOutputPlane");
 
   THTensor *finput = luaT_getfieldcheckudata(L, 1, "finput", torch_Tensor);
   THTensor *gradWeight = luaT_getfieldcheckudata(L, 1, "gradWeight", torch_Tensor);
   THTensor *gradBias = luaT_getfieldcheckudata(L, 1, "gradBias", torch_Tensor);
 
-  THArgCheck( nOutputPlane == gradOutput->size[input->nDimension == 4 ? 1 : 0], 1, "Number of output features is not equal to nOutputPlane" );
-
-  if(input->nDimension == 3)
+  int batch = (input->nDimension == 4);
+  long T = (batch ? input->size[0] : 1);
+  long nInputPlane = input->size[batch];
+  long inputHeight = input->size[batch+1];
+  long inputWidth = input->size[batch+2];
+  long outputHeight, outputWidth, HW, B, t;
+  int unfold;
+  real *input_data = NULL;
+  real *gradBias_data;
+  THTensor *gradOutputBuffer;
+
+  THArgCheck( nOutputPlane == gradOutput->size[batch], 1, "Number of output features is not equal to nOutputPlane" );
+
+  outputHeight = gradOutput->size[batch+1];
+  outputWidth = gradOutput->size[batch+2];
+  HW = outputHeight*outputWidth;
+
+  gradOutput = THTensor_(newContiguous)(gradOutput);
+
+  /* updateOutput leaves every frame unfolded in finput when the batch fits
+     in one GEMM; otherwise (or after the Winograd path) each chunk is
+     unfolded again */
+  unfold = !(finput->nDimension == 2 && finput->size[0] == kW*kH*nInputPlane && finput->size[1] == T*HW);
+  if(unfold)
   {
-    nn_(SpatialConvolutionMM_accGradParameters_frame)(gradOutput, gradWeight, gradBias, finput, scale);
+    B = nn_(SpatialConvolutionMM_batchSize)(L, T, kW*kH*nInputPlane*HW);
+    THTensor_(resize2d)(finput, kW*kH*nInputPlane, B*HW);
+    input = THTensor_(newContiguous)(input);
+    input_data = THTensor_(data)(input);
   }
   else
+    B = T;
+
+  gradBias_data = THTensor_(data)(gradBias);
+  gradOutputBuffer = THTensor_(new)();
+
+  for(t = 0; t < T; t += B)
   {
-    long T = input->size[0];
-    long t;
+    long nFrame = THMin(B, T-t);
+    long i;
+    THTensor *gradOutput_n = nn_(SpatialConvolutionMM_framesToColumns)(gradOutput, gradOutputBuffer, t, nFrame, nOutputPlane, HW);
+    THTensor *finput_n = THTensor_(newWithStorage2d)(finput->storage, finput->storageOffset,
+                                                     nFrame*HW, 1,
+                                                     kW*kH*nInputPlane, B*HW);
 
-    for(t = 0; t < T; t++)
-    {
-      THTensor *gradOutput_t = THTensor_(newSelect)(gradOutput, 0, t);
-      THTensor *finput_t = THTensor_(newSelect)(finput, 0, t);
+    if(unfold)
+      nn_(unfolded_copy)(THTensor_(data)(finput), B*HW, input_data + t*nInputPlane*inputHeight*inputWidth, nFrame,
+                         kW, kH, dW, dH, padding, nInputPlane, inputWidth, inputHeight, outputWidth, outputHeight);
 
-      nn_(SpatialConvolutionMM_accGradParameters_frame)(gradOutput_t, gradWeight, gradBias, finput_t, scale);
+    THTensor_(addmm)(gradWeight, 1, gradWeight, scale, gradOutput_n, finput_n);
 
-      THTensor_(free)(gradOutput_t);
-      THTensor_(free)(finput_t);
-    }
+    for(i = 0; i < nOutputPlane; i++)
+      gradBias_data[i] += scale*THVector_(sum)(THTensor_(data)(gradOutput_n) + i*gradOutput_n->stride[0], nFrame*HW);
+
+    THTensor_(free)(gradOutput_n);
+    THTensor_(free)(finput_n);
   }
 
+  if(unfold)
+    THTensor_(free)(input);
+  THTensor_(free)(gradOutputBuffer);
+  THTensor_(free)(gradOutput);
+
   return 0;
 }
 
@@ -18,10 +18,11 @@ static int nn_(Tanh_updateOutput)(lua_State *L)
   {
     real* ptr_output = THTensor_(data)(output);
     real* ptr_input  = THTensor_(data)(input);
+    long n = THTensor_(nElement)(input);
     long i;
 #pragma omp parallel for private(i)
-    for(i = 0; i < THTensor_(nElement)(input); i++)
-      ptr_output[i] = tanh(ptr_input[i]);
+    for(i = 0; i < n; i += NN_VECTOR_CHUNK)
+      THVector_(tanh)(ptr_output+i, ptr_input+i, THMin(NN_VECTOR_CHUNK, n-i));
   }
   return 1;
 }
@@ -2,28 +2,97 @@
 #define TH_GENERIC_FILE "generic/TemporalConvolution.c"
 #else
 
+/* The input windows of every sample (kW frames, dW frames apart) are the
+   rows of one unfolded matrix: row r is output frame r % nOutputFrame of
+   sample r / nOutputFrame, so that each pass over a batch is one GEMM
+   (per chunk of rows when memoryBudget is short). */
+
+/* Rows per GEMM: as many as keep the unfolded rows within the module's
+   memoryBudget (bytes, NN_TEMPORAL_CONVOLUTION_BUDGET if unset) */
+static long nn_(TemporalConvolution_chunkRows)(lua_State *L, long nRow, long rowSize)
+{
+  long budget, R;
+
+  lua_getfield(L, 1, "memoryBudget");
+  budget = (long)luaL_optnumber(L, -1, NN_TEMPORAL_CONVOLUTION_BUDGET);
+  lua_pop(L, 1);
+
+  R = budget / THMax(1, rowSize*(long)sizeof(real));
+  return THMax(1, THMin(R, nRow));
+}
+
+/* rows [r0, r0+nRow) of the unfolded input into finput_data */
+static void nn_(TemporalConvolution_unfold)(real *finput_data, real *input_data, long r0, long nRow,
+                                            int kW, int dW, long inputFrameSize,
+                                            long nInputFrame, long nOutputFrame)
+{
+  long rowSize = kW*inputFrameSize;
+  long r;
+
+#pragma omp parallel for private(r)
+  for(r = 0; r < nRow; r++)
+  {
+    long s = (r0+r) / nOutputFrame;
+    long k = (r0+r) % nOutputFrame;
+    memcpy(finput_data + r*rowSize, input_data + (s*nInputFrame + k*dW)*inputFrameSize, sizeof(real)*rowSize);
+  }
+}
+
+/* Adds rows [r0, r0+nRow) of fgradInput_data back to the input frames they
+   were unfolded from. Written as a gather, every input frame summing the
+   rows which read it, so that threads never write the same frame. */
+static void nn_(TemporalConvolution_fold)(real *fgradInput_data, real *gradInput_data, long r0, long nRow,
+                                          int kW, int dW, long inputFrameSize,
+                                          long nInputFrame, long nOutputFrame)
+{
+  long sBegin = r0 / nOutputFrame;
+  long sEnd = (r0+nRow-1) / nOutputFrame + 1;
+  long q;
+
+#pragma omp parallel for private(q)
+  for(q = sBegin*nInputFrame; q < sEnd*nInputFrame; q++)
+  {
+    long s = q / nInputFrame;
+    long j = q % nInputFrame;
+    /* the windows k*dW <= j < k*dW+kW */
+    long kBegin = (j < kW ? 0 : (j-kW)/dW + 1);
+    long kEnd = THMin(j/dW + 1, nOutputFrame);
+    long rBegin = THMax(s*nOutputFrame + kBegin, r0);
+    long rEnd = THMin(s*nOutputFrame + kEnd, r0+nRow);
+    real *dst = gradInput_data + q*inputFrameSize;
+    long r;
+
+    for(r = rBegin; r < rEnd; r++)
+    {
+      long k = r - s*nOutputFrame;
+      THVector_(add)(dst, fgradInput_data + (r-r0)*kW*inputFrameSize + (j-k*dW)*inputFrameSize, 1, inputFrameSize);
+    }
+  }
+}
+
 static int nn_(TemporalConvolution_updateOutput)(lua_State *L)
 {
-  THTensor *input = luaT_checkudata(L, 2, torch_Tensor);  
+  THTensor *input = luaT_checkudata(L, 2, torch_Tensor);
   int kW = luaT_getfieldcheckint(L, 1, "kW");
   int dW = luaT_getfieldcheckint(L, 1, "dW");
   int inputFrameSize = luaT_getfieldcheckint(L, 1, "inputFrameSize");
   int outputFrameSize = luaT_getfieldcheckint(L, 1, "outputFrameSize");
-  
+
   THTensor *weight = luaT_getfieldcheckudata(L, 1, "weight", torch_Tensor);
   THTensor *bias = luaT_getfieldcheckudata(L, 1, "bias", torch_Tensor);
+  THTensor *finput = luaT_getfieldcheckudata(L, 1, "finput", torch_Tensor);
   THTensor *output = luaT_getfieldcheckudata(L, 1, "output", torch_Tensor);
 
-  THTensor *outputWindow, *inputWindow;
-  int nInputFrame, nOutputFrame;
-  long k, i;
-  
+  THTensor *weightT;
+  long nInputFrame, nOutputFrame, T, nRow, rowSize, R, r0;
+  real *input_data, *output_data, *bias_data;
+
   int dimS = 0; // sequence dimension
   int dimF = 1; // feature dimension
-  
+
   luaL_argcheck(L, input->nDimension == 2 || input->nDimension == 3, 2, "2D or 3D(batch mode) tensor expected");
-  
-  if (input->nDimension == 3) 
+
+  if (input->nDimension == 3)
   {
     dimS = 1;
     dimF = 2;
@@ -32,101 +101,57 @@ static int nn_(TemporalConvolution_updateOutput)(lua_State *L)
   luaL_argcheck(L, input->size[dimS] >= kW, 2, "input sequence smaller than kernel size");
 
   input = THTensor_(newContiguous)(input);
-  outputWindow = THTensor_(new)();
-  inputWindow = THTensor_(new)();
+  bias = THTensor_(newContiguous)(bias);
 
   nInputFrame = input->size[dimS];
   nOutputFrame = (nInputFrame - kW) / dW + 1;
 
   if (input->nDimension == 2)
   {
-    THTensor_(resize2d)(output,
-                        nOutputFrame,
-                        outputFrameSize);
-
-    /* bias first */
-    for(k = 0; k < nOutputFrame; k++)
-    {
-      THTensor_(select)(outputWindow, output, 0, k);
-      THTensor_(copy)(outputWindow, bias);
-    }
-
-    /* ouch */
-    for(k = 0; nOutputFrame > 0; k++)
-    {
-      long outputFrameStride = (kW-1)/dW+1;
-      long inputFrameStride = outputFrameStride*dW;
-      long nFrame = (nInputFrame-k*dW-kW)/inputFrameStride + 1;
-      nOutputFrame -= nFrame;
-
-      THTensor_(setStorage2d)(inputWindow, input->storage,
-                              input->storageOffset+k*dW*input->size[1],
-                              nFrame, inputFrameStride*input->size[1],
-                              kW*input->size[1], 1);
-
-      THTensor_(setStorage2d)(outputWindow, output->storage, 
-                              output->storageOffset + k*output->size[1],
-                              nFrame, outputFrameStride*output->size[1],
-                              output->size[1], 1);
-
-      THTensor_(transpose)(weight, NULL, 0, 1);
-      THTensor_(addmm)(outputWindow, 1, outputWindow, 1, inputWindow, weight);
-      THTensor_(transpose)(weight, NULL, 0, 1);
-    }
+    T = 1;
+    THTensor_(resize2d)(output, nOutputFrame, outputFrameSize);
   }
   else
   {
-    THTensor *outputSample = THTensor_(new)();
-    THTensor *inputSample = THTensor_(new)();
-    int nBatchFrame = input->size[0];
-    
-    THTensor_(resize3d)(output,
-                        nBatchFrame,
-                        nOutputFrame,
-                        outputFrameSize);
-    
-    for(i = 0; i < nBatchFrame; i++)
-    {
-      THTensor_(select)(outputSample, output, 0, i);
-      THTensor_(select)(inputSample, input, 0, i);
-      long nOutputSampleFrame = nOutputFrame;
-      
-      /* bias first */
-      for(k = 0; k < nOutputFrame; k++)
-      {
-        THTensor_(select)(outputWindow, outputSample, 0, k);
-        THTensor_(copy)(outputWindow, bias);
-      }
-
-      /* ouch */
-      for(k = 0; nOutputSampleFrame > 0; k++)
-      {
-        long outputFrameStride = (kW-1)/dW+1;
-        long inputFrameStride = outputFrameStride*dW;
-        long nFrame = (nInputFrame-k*dW-kW)/inputFrameStride + 1;
-        nOutputSampleFrame -= nFrame;
-
-        THTensor_(setStorage2d)(inputWindow, inputSample->storage,
-                                inputSample->storageOffset+k*dW*inputSample->size[1],
-                                nFrame, inputFrameStride*inputSample->size[1],
-                                kW*inputSample->size[1], 1);
-
-        THTensor_(setStorage2d)(outputWindow, outputSample->storage, 
-                                outputSample->storageOffset + k*outputSample->size[1],
-                                nFrame, outputFrameStride*outputSample->size[1],
-                                outputSample->size[1], 1);
-
-        THTensor_(transpose)(weight, NULL, 0, 1);
-        THTensor_(addmm)(outputWindow, 1, outputWindow, 1, inputWindow, weight);
-        THTensor_(transpose)(weight, NULL, 0, 1);
-      }
-    }
-    THTensor_(free)(outputSample);
-    THTensor_(free)(inputSample);
+    T = input->size[0];
+    THTensor_(resize3d)(output, T, nOutputFrame, outputFrameSize);
   }
 
-  THTensor_(free)(outputWindow);
-  THTensor_(free)(inputWindow);
+  nRow = T*nOutputFrame;
+  rowSize = kW*inputFrameSize;
+  R = nn_(TemporalConvolution_chunkRows)(L, nRow, rowSize);
+  THTensor_(resize2d)(finput, R, rowSize);
+
+  input_data = THTensor_(data)(input);
+  output_data = THTensor_(data)(output);
+  bias_data = THTensor_(data)(bias);
+  weightT = THTensor_(newTranspose)(weight, 0, 1);
+
+  for(r0 = 0; r0 < nRow; r0 += R)
+  {
+    long n = THMin(R, nRow-r0);
+    long r;
+    THTensor *finput_n = THTensor_(newWithStorage2d)(finput->storage, finput->storageOffset,
+                                                     n, rowSize, rowSize, 1);
+    THTensor *output_n = THTensor_(newWithStorage2d)(output->storage, output->storageOffset + r0*outputFrameSize,
+                                                     n, outputFrameSize, outputFrameSize, 1);
+
+    nn_(TemporalConvolution_unfold)(THTensor_(data)(finput), input_data, r0, n,
+                                    kW, dW, inputFrameSize, nInputFrame, nOutputFrame);
+
+    /* bias first */
+#pragma omp parallel for private(r)
+    for(r = 0; r < n; r++)
+      memcpy(output_data + (r0+r)*outputFrameSize, bias_data, sizeof(real)*outputFrameSize);
+
+    THTensor_(addmm)(output_n, 1, output_n, 1, finput_n, weightT);
+
+    THTensor_(free)(finput_n);
+    THTensor_(free)(output_n);
+  }
+
+  THTensor_(free)(weightT);
+  THTensor_(free)(bias);
   THTensor_(free)(input);
 
   return 1;
@@ -134,218 +159,139 @@ static int nn_(TemporalConvolution_updateOutput)(lua_State *L)
 
 static int nn_(TemporalConvolution_updateGradInput)(lua_State *L)
 {
-  THTensor *input = luaT_checkudata(L, 2, torch_Tensor);  
-  THTensor *gradOutput = luaT_checkudata(L, 3, torch_Tensor);  
+  THTensor *input = luaT_checkudata(L, 2, torch_Tensor);
+  THTensor *gradOutput = luaT_checkudata(L, 3, torch_Tensor);
   int kW = luaT_getfieldcheckint(L, 1, "kW");
   int dW = luaT_getfieldcheckint(L, 1, "dW");
+  int inputFrameSize = luaT_getfieldcheckint(L, 1, "inputFrameSize");
+  int outputFrameSize = luaT_getfieldcheckint(L, 1, "outputFrameSize");
   long nInputFrame;
   long nOutputFrame;
 
   THTensor *weight = luaT_getfieldcheckudata(L, 1, "weight", torch_Tensor);
+  THTensor *fgradInput = luaT_getfieldcheckudata(L, 1, "fgradInput", torch_Tensor);
   THTensor *gradInput = luaT_getfieldcheckudata(L, 1, "gradInput", torch_Tensor);
 
-  THTensor *gradOutputWindow;
-  THTensor *gradInputWindow;
-  long k, i;
-  
+  long T, nRow, rowSize, R, r0;
+  real *gradInput_data;
+
   int dimS = 0; // sequence dimension
-  int dimF = 1; // feature dimension
-  
-  if (gradOutput->nDimension == 3) 
-  {
+
+  if (gradOutput->nDimension == 3)
     dimS = 1;
-    dimF = 2;
-  }
-  
+
   nInputFrame = input->size[dimS];
   nOutputFrame = gradOutput->size[dimS];
+  T = (gradOutput->nDimension == 3 ? gradOutput->size[0] : 1);
 
-  gradOutputWindow = THTensor_(new)();
-  gradInputWindow = THTensor_(new)();
-
+  gradOutput = THTensor_(newContiguous)(gradOutput);
   THTensor_(resizeAs)(gradInput, input);
   THTensor_(zero)(gradInput);
 
-  if (gradOutput->nDimension == 2)
-  {
-    /* ouch */
-    for(k = 0; nOutputFrame > 0; k++)
-    {
-      long outputFrameStride = (kW-1)/dW+1;
-      long inputFrameStride = outputFrameStride*dW;
-      long nFrame = (nInputFrame-k*dW-kW)/inputFrameStride + 1;
-      nOutputFrame -= nFrame;
-
-      THTensor_(setStorage2d)(gradOutputWindow, gradOutput->storage,
-                              gradOutput->storageOffset + k*gradOutput->size[1],
-                              nFrame, outputFrameStride*gradOutput->size[1],
-                              gradOutput->size[1], 1);
-
-      THTensor_(setStorage2d)(gradInputWindow, gradInput->storage,
-                              gradInput->storageOffset+k*dW*gradInput->size[1],
-                              nFrame, inputFrameStride*gradInput->size[1],
-                              kW*gradInput->size[1], 1);
-
-      THTensor_(addmm)(gradInputWindow, 1, gradInputWindow, 1, gradOutputWindow, weight);
-    }
-  }
-  else
+  nRow = T*nOutputFrame;
+  rowSize = kW*inputFrameSize;
+  R = nn_(TemporalConvolution_chunkRows)(L, nRow, rowSize);
+  THTensor_(resize2d)(fgradInput, R, rowSize);
+
+  gradInput_data = THTensor_(data)(gradInput);
+
+  for(r0 = 0; r0 < nRow; r0 += R)
   {
-    THTensor *gradOutputSample = THTensor_(new)();
-    THTensor *gradInputSample = THTensor_(new)();
-    int nBatchFrame = input->size[0];
-    
-    for(i = 0; i < nBatchFrame; i++)
-    {
-      THTensor_(select)(gradOutputSample, gradOutput, 0, i);
-      THTensor_(select)(gradInputSample, gradInput, 0, i);
-      int nOutputSampleFrame = nOutputFrame;
-      
-      /* ouch */
-      for(k = 0; nOutputSampleFrame > 0; k++)
-      {
-        long outputFrameStride = (kW-1)/dW+1;
-        long inputFrameStride = outputFrameStride*dW;
-        long nFrame = (nInputFrame-k*dW-kW)/inputFrameStride + 1;
-        nOutputSampleFrame -= nFrame;
-
-        THTensor_(setStorage2d)(gradOutputWindow, gradOutputSample->storage,
-                                gradOutputSample->storageOffset + k*gradOutputSample->size[1],
-                                nFrame, outputFrameStride*gradOutputSample->size[1],
-                                gradOutputSample->size[1], 1);
-
-        THTensor_(setStorage2d)(gradInputWindow, gradInputSample->storage,
-                                gradInputSample->storageOffset+k*dW*gradInputSample->size[1],
-                                nFrame, inputFrameStride*gradInputSample->size[1],
-                                kW*gradInputSample->size[1], 1);
-
-        THTensor_(addmm)(gradInputWindow, 1, gradInputWindow, 1, gradOutputWindow, weight);
-      }
-    }
-    THTensor_(free)(gradOutputSample);
-    THTensor_(free)(gradInputSample);
+    long n = THMin(R, nRow-r0);
+    THTensor *gradOutput_n = THTensor_(newWithStorage2d)(gradOutput->storage, gradOutput->storageOffset + r0*outputFrameSize,
+                                                         n, outputFrameSize, outputFrameSize, 1);
+    THTensor *fgradInput_n = THTensor_(newWithStorage2d)(fgradInput->storage, fgradInput->storageOffset,
+                                                         n, rowSize, rowSize, 1);
+
+    THTensor_(addmm)(fgradInput_n, 0, fgradInput_n, 1, gradOutput_n, weight);
+
+    nn_(TemporalConvolution_fold)(THTensor_(data)(fgradInput), gradInput_data, r0, n,
+                                  kW, dW, inputFrameSize, nInputFrame, nOutputFrame);
+
+    THTensor_(free)(gradOutput_n);
+    THTensor_(free)(fgradInput_n);
   }
 
-  THTensor_(free)(gradOutputWindow);
-  THTensor_(free)(gradInputWindow);
+  THTensor_(free)(gradOutput);
 
   return 1;
 }
 
 static int nn_(TemporalConvolution_accGradParameters)(lua_State *L)
 {
-  THTensor *input = luaT_checkudata(L, 2, torch_Tensor);  
-  THTensor *gradOutput = luaT_checkudata(L, 3, torch_Tensor);  
+  THTensor *input = luaT_checkudata(L, 2, torch_Tensor);
+  THTensor *gradOutput = luaT_checkudata(L, 3, torch_Tensor);
   real scale = luaL_optnumber(L, 4, 1);
   int kW = luaT_getfieldcheckint(L, 1, "kW");
   int dW = luaT_getfieldcheckint(L, 1, "dW");
+  int inputFrameSize = luaT_getfieldcheckint(L, 1, "inputFrameSize");
+  int outputFrameSize = luaT_getfieldcheckint(L, 1, "outputFrameSize");
   long nInputFrame;
   long nOutputFrame;
 
+  THTensor *finput = luaT_getfieldcheckudata(L, 1, "finput", torch_Tensor);
   THTensor *gradWeight = luaT_getfieldcheckudata(L, 1, "gradWeight", torch_Tensor);
   THTensor *gradBias = luaT_getfieldcheckudata(L, 1, "gradBias", torch_Tensor);
 
-  THTensor *gradOutputWindow;
-  THTensor *inputWindow;
-  long k, i;
-  
+  long T, nRow, rowSize, R, r0;
+  int unfold;
+  real *input_data = NULL;
+  real *gradOutput_data, *gradBias_data;
+
   int dimS = 0; // sequence dimension
-  int dimF = 1; // feature dimension
-  
-  if (gradOutput->nDimension == 3) 
-  {
+
+  if (gradOutput->nDimension == 3)
     dimS = 1;
-    dimF = 2;
-  }
-  
+
   nInputFrame = input->size[dimS];
   nOutputFrame = gradOutput->size[dimS];
+  T = (gradOutput->nDimension == 3 ? gradOutput->size[0] : 1);
+  nRow = T*nOutputFrame;
+  rowSize = kW*inputFrameSize;
 
-  input = THTensor_(newContiguous)(input);
-  gradOutputWindow = THTensor_(new)();
-  inputWindow = THTensor_(new)();
-  
-  if (input->nDimension == 2)
-  {
-    /* bias first */
-    for(k = 0; k < nOutputFrame; k++)
-    {
-      THTensor_(select)(gradOutputWindow, gradOutput, 0, k);
-      THTensor_(cadd)(gradBias, gradBias, scale, gradOutputWindow);
-    }
+  gradOutput = THTensor_(newContiguous)(gradOutput);
 
-    /* ouch */
-    for(k = 0; nOutputFrame > 0; k++)
-    {
-      long outputFrameStride = (kW-1)/dW+1;
-      long inputFrameStride = outputFrameStride*dW;
-      long nFrame = (nInputFrame-k*dW-kW)/inputFrameStride + 1;
-      nOutputFrame -= nFrame;
-
-      THTensor_(setStorage2d)(inputWindow, input->storage,
-                              input->storageOffset+k*dW*input->size[1],
-                              nFrame, inputFrameStride*input->size[1],
-                              kW*input->size[1], 1);
-
-      THTensor_(setStorage2d)(gradOutputWindow, gradOutput->storage, 
-                              gradOutput->storageOffset + k*gradOutput->size[1],
-                              nFrame, outputFrameStride*gradOutput->size[1],
-                              gradOutput->size[1], 1);
-
-      THTensor_(transpose)(gradOutputWindow, NULL, 0, 1);
-      THTensor_(addmm)(gradWeight, 1, gradWeight, scale, gradOutputWindow, inputWindow);
-      THTensor_(transpose)(gradOutputWindow, NULL, 0, 1);
-    }
+  /* updateOutput leaves every row unfolded in finput when the batch fits
+     in one GEMM; otherwise each chunk is unfolded again */
+  unfold = !(finput->nDimension == 2 && finput->size[0] == nRow && finput->size[1] == rowSize);
+  if(unfold)
+  {
+    R = nn_(TemporalConvolution_chunkRows)(L, nRow, rowSize);
+    THTensor_(resize2d)(finput, R, rowSize);
+    input = THTensor_(newContiguous)(input);
+    input_data = THTensor_(data)(input);
   }
   else
+    R = nRow;
+
+  gradOutput_data = THTensor_(data)(gradOutput);
+  gradBias_data = THTensor_(data)(gradBias);
+
+  for(r0 = 0; r0 < nRow; r0 += R)
   {
-    THTensor *gradOutputSample = THTensor_(new)();
-    THTensor *inputSample = THTensor_(new)();
-    int nBatchFrame = input->size[0];
-    
-    for(i = 0; i < nBatchFrame; i++)
-    {
-      THTensor_(select)(gradOutputSample, gradOutput, 0, i);
-      THTensor_(select)(inputSample, input, 0, i);
-      int nOutputSampleFrame = nOutputFrame;
-      
-      /* bias first */
-      for(k = 0; k < nOutputFrame; k++)
-      {
-        THTensor_(select)(gradOutputWindow, gradOutputSample, 0, k);
-        THTensor_(cadd)(gradBias, gradBias, scale, gradOutputWindow);
-      }
-
-      /* ouch */
-      for(k = 0; nOutputSampleFrame > 0; k++)
-      {
-        long outputFrameStride = (kW-1)/dW+1;
-        long inputFrameStride = outputFrameStride*dW;
-        long nFrame = (nInputFrame-k*dW-kW)/inputFrameStride + 1;
-        nOutputSampleFrame -= nFrame;
-
-        THTensor_(setStorage2d)(inputWindow, inputSample->storage,
-                                inputSample->storageOffset+k*dW*inputSample->size[1],
-                                nFrame, inputFrameStride*inputSample->size[1],
-                                kW*inputSample->size[1], 1);
-
-        THTensor_(setStorage2d)(gradOutputWindow, gradOutputSample->storage, 
-                                gradOutputSample->storageOffset + k*gradOutputSample->size[1],
-                                nFrame, outputFrameStride*gradOutputSample->size[1],
-                                gradOutputSample->size[1], 1);
-
-        THTensor_(transpose)(gradOutputWindow, NULL, 0, 1);
-        THTensor_(addmm)(gradWeight, 1, gradWeight, scale, gradOutputWindow, inputWindow);
-        THTensor_(transpose)(gradOutputWindow, NULL, 0, 1);
-      }
-    }
-    THTensor_(free)(gradOutputSample);
-    THTensor_(free)(inputSample);
+    long n = THMin(R, nRow-r0);
+    long r;
+    THTensor *gradOutputT_n = THTensor_(newWithStorage2d)(gradOutput->storage, gradOutput->storageOffset + r0*outputFrameSize,
+                                                          outputFrameSize, 1, n, outputFrameSize);
+    THTensor *finput_n = THTensor_(newWithStorage2d)(finput->storage, finput->storageOffset,
+                                                     n, rowSize, rowSize, 1);
+
+    if(unfold)
+      nn_(TemporalConvolution_unfold)(THTensor_(data)(finput), input_data, r0, n,
+                                      kW, dW, inputFrameSize, nInputFrame, nOutputFrame);
+
+    THTensor_(addmm)(gradWeight, 1, gradWeight, scale, gradOutputT_n, finput_n);
+
+    for(r = r0; r < r0+n; r++)
+      THVector_(add)(gradBias_data, gradOutput_data + r*outputFrameSize, scale, outputFrameSize);
+
+    THTensor_(free)(gradOutputT_n);
+    THTensor_(free)(finput_n);
   }
 
-  THTensor_(free)(gradOutputWindow);
-  THTensor_(free)(inputWindow);
-  THTensor_(free)(input);
+  if(unfold)
+    THTensor_(free)(input);
+  THTensor_(free)(gradOutput);
 
   return 0;
 }
@@ -325,62 +325,7 @@ function nn.hessian.enable()
       -- get parameters
       local parameters,gradParameters,hessianParameters = self:parameters()
 
-      local function storageInSet(set, storage)
-         local storageAndOffset = set[torch.pointer(storage)]
-         if storageAndOffset == nil then
-             return nil
-         end
-         local _, offset = unpack(storageAndOffset)
-         return offset
-      end
-
-      -- this function flattens arbitrary lists of parameters,
-      -- even complex shared ones
-      local function flatten(parameters)
-         local storages = {}
-         local nParameters = 0
-         for k = 1,#parameters do
-            local storage = parameters[k]:storage()
-            if not storageInSet(storages, storage) then
-               storages[torch.pointer(storage)] = {storage, nParameters}
-               nParameters = nParameters + storage:size()
-            end
-         end
-         
-         local flatParameters = torch.Tensor(nParameters):fill(1)
-         local flatStorage = flatParameters:storage()
-
-         for k = 1,#parameters do
-            local storageOffset = storageInSet(storages, parameters[k]:storage())
-            parameters[k]:set(flatStorage,
-                              storageOffset + parameters[k]:storageOffset(),
-                              parameters[k]:size(),
-                              parameters[k]:stride())
-            parameters[k]:zero()
-         end
-
-         local cumSumOfHoles = flatParameters:cumsum(1)
-         local nUsedParameters = nParameters - cumSumOfHoles[#cumSumOfHoles]
-         local flatUsedParameters = torch.Tensor(nUsedParameters)
-         local flatUsedStorage = flatUsedParameters:storage()
-
-         for k = 1,#parameters do
-            local offset = cumSumOfHoles[parameters[k]:storageOffset()]
-            parameters[k]:set(flatUsedStorage,
-                              parameters[k]:storageOffset() - offset,
-                              parameters[k]:size(),
-                              parameters[k]:stride())
-         end
-
-         for _, storageAndOffset in pairs(storages) do
-            local k, v = unpack(storageAndOffset)
-            flatParameters[{{v+1,v+k:size()}}]:copy(torch.Tensor():set(k))
-         end
-         for k = 1,flatUsedParameters:nElement() do
-            flatUsedParameters[k] = flatParameters[k+cumSumOfHoles[k] ]
-         end
-         return flatUsedParameters
-      end
+      local flatten = nn.Module.flatten
 
       -- flatten parameters and gradients
       local flatParameters = flatten(parameters)
@@ -5,6 +5,15 @@
 #define torch_Tensor TH_CONCAT_STRING_3(torch.,Real,Tensor)
 #define nn_(NAME) TH_CONCAT_3(nn_, Real, NAME)
 
+/* elements per THVector call in the OpenMP loops of the pointwise modules */
+#define NN_VECTOR_CHUNK 4096
+
+/* default bytes of unfolded input per SpatialConvolutionMM GEMM */
+#define NN_SPATIAL_CONVOLUTION_MM_BUDGET (256L*1024*1024)
+
+/* default bytes of unfolded input per TemporalConvolution GEMM */
+#define NN_TEMPORAL_CONVOLUTION_BUDGET (256L*1024*1024)
+
 #include "generic/Square.c"
 #include "THGenerateFloatTypes.h"
 
@@ -68,6 +77,9 @@
 #include "generic/SparseLinear.c"
 #include "THGenerateFloatTypes.h"
 
+#include "generic/LookupTable.c"
+#include "THGenerateFloatTypes.h"
+
 #include "generic/TemporalConvolution.c"
 #include "THGenerateFloatTypes.h"
 
@@ -119,6 +131,15 @@
 #include "generic/SpatialUpSamplingNearest.c"
 #include "THGenerateFloatTypes.h"
 
+#include "generic/Quantized.c"
+#include "THGenerateFloatTypes.h"
+
+#include "generic/FlatParameters.c"
+#include "THGenerateFloatTypes.h"
+
+#include "generic/Dropout.c"
+#include "THGenerateFloatTypes.h"
+
 LUA_EXTERNC DLL_EXPORT int luaopen_libnn(lua_State *L);
 
 int luaopen_libnn(lua_State *L)
@@ -148,6 +169,7 @@ int luaopen_libnn(lua_State *L)
   nn_FloatSoftShrink_init(L);
   nn_FloatThreshold_init(L);
   nn_FloatSparseLinear_init(L);
+  nn_FloatLookupTable_init(L);
   nn_FloatTemporalConvolution_init(L);
   nn_FloatTemporalSubSampling_init(L);
   nn_FloatTemporalMaxPooling_init(L);
@@ -165,6 +187,9 @@ int luaopen_libnn(lua_State *L)
   nn_FloatMultiLabelMarginCriterion_init(L);
   nn_FloatL1Cost_init(L);
   nn_FloatSpatialUpSamplingNearest_init(L);
+  nn_FloatQuantized_init(L);
+  nn_FloatFlatParameters_init(L);
+  nn_FloatDropout_init(L);
 
   nn_DoubleMin_init(L);
   nn_DoubleMax_init(L);
@@ -187,6 +212,7 @@ int luaopen_libnn(lua_State *L)
   nn_DoubleSoftShrink_init(L);
   nn_DoubleThreshold_init(L);
   nn_DoubleSparseLinear_init(L);
+  nn_DoubleLookupTable_init(L);
   nn_DoubleTemporalConvolution_init(L);
   nn_DoubleTemporalSubSampling_init(L);
   nn_DoubleTemporalMaxPooling_init(L);
@@ -204,6 +230,9 @@ int luaopen_libnn(lua_State *L)
   nn_DoubleMultiLabelMarginCriterion_init(L);
   nn_DoubleL1Cost_init(L);
   nn_DoubleSpatialUpSamplingNearest_init(L);
+  nn_DoubleQuantized_init(L);
+  nn_DoubleFlatParameters_init(L);
+  nn_DoubleDropout_init(L);
 
   return 1;
 }
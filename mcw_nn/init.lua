@@ -11,6 +11,7 @@ include('DepthConcat.lua')
 
 include('Linear.lua')
 include('SparseLinear.lua')
+include('QuantizedLinear.lua')
 include('Reshape.lua')
 include('View.lua')
 include('Select.lua')
@@ -67,6 +68,7 @@ include('SpatialConvolution.lua')
 include('SpatialFullConvolution.lua')
 include('SpatialFullConvolutionMap.lua')
 include('SpatialConvolutionMM.lua')
+include('QuantizedSpatialConvolutionMM.lua')
 include('SpatialConvolutionMM_BHWD.lua')
 include('SpatialConvolutionCUDA.lua')
 include('SpatialConvolutionGPU.lua')
@@ -122,4 +124,6 @@ include('StochasticGradient.lua')
 include('Jacobian.lua')
 include('SparseJacobian.lua')
 include('hessian.lua')
+include('quantize.lua')
+include('fused.lua')
 include('test.lua')
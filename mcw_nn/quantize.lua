@@ -0,0 +1,85 @@
+----------------------------------------------------------------------
+-- quantize.lua: int8 inference. nn.quantize converts the Linear and
+-- SpatialConvolutionMM layers of a trained network to
+-- nn.QuantizedLinear and nn.QuantizedSpatialConvolutionMM, and
+-- nn.calibrate fixes the scale of their inputs from sample data.
+----------------------------------------------------------------------
+
+local function quantizeLayer(module, relu)
+   local name = torch.typename(module)
+   if name == 'nn.Linear' then
+      return nn.QuantizedLinear(module, relu)
+   elseif name == 'nn.SpatialConvolutionMM' then
+      return nn.QuantizedSpatialConvolutionMM(module, relu)
+   end
+end
+
+local function isReLU(module)
+   return torch.typename(module) == 'nn.ReLU' and module.threshold == 0 and module.val == 0
+end
+
+-- Replaces the convertible layers of module, in place, by their quantized
+-- versions, and returns module (or its replacement if module is such a
+-- layer). Inside a nn.Sequential, a nn.ReLU following a converted layer
+-- is folded into it.
+function nn.quantize(module)
+   local quantized = quantizeLayer(module)
+   if quantized then
+      return quantized
+   end
+   if module.modules then
+      local sequential = (torch.typename(module) == 'nn.Sequential')
+      local modules = {}
+      local i = 1
+      while i <= #module.modules do
+         local m, nextModule = module.modules[i], module.modules[i+1]
+         local fuse = (sequential and nextModule ~= nil and isReLU(nextModule))
+         quantized = quantizeLayer(m, fuse)
+         if quantized then
+            table.insert(modules, quantized)
+            i = i + (fuse and 2 or 1)
+         else
+            table.insert(modules, nn.quantize(m))
+            i = i + 1
+         end
+      end
+      module.modules = modules
+   end
+   return module
+end
+
+-- Forwards the samples (a table of inputs, or a single input) through a
+-- quantized module, and sets the inputScale of each quantized layer to
+-- the largest magnitude its inputs reached, over 127. Those layers then
+-- quantize their inputs with that one scale, saving a pass over each
+-- input; larger values are clamped. Returns module.
+function nn.calibrate(module, samples)
+   local layers = {}
+   local function collect(m)
+      if m.qweight then
+         table.insert(layers, m)
+      end
+      for _, sub in ipairs(m.modules or {}) do
+         collect(sub)
+      end
+   end
+   collect(module)
+
+   for _, layer in ipairs(layers) do
+      layer.inputScale = nil
+      layer.inputMax = 0
+      layer.calibrating = true
+   end
+   if torch.typename(samples) then
+      samples = {samples}
+   end
+   for _, input in ipairs(samples) do
+      module:forward(input)
+   end
+   for _, layer in ipairs(layers) do
+      layer.inputScale = (layer.inputMax > 0 and layer.inputMax/127 or nil)
+      layer.inputMax = nil
+      layer.calibrating = nil
+   end
+   return module
+end
@@ -111,6 +111,15 @@ function nntest.Dropout()
    mytester:assert(math.abs(output:mean() - (1-p)) < 0.05, 'dropout output')
    local gradInput = module:backward(input, input)
    mytester:assert(math.abs(gradInput:mean() - (1-p)) < 0.05, 'dropout gradInput')
+   -- the mask takes one bit per element, and backward drops the same elements
+   local input = torch.rand(10,33):add(1)
+   local module = nn.Dropout(p)
+   local output = module:forward(input)
+   mytester:asserteq(module.mask:nElement(), 11, 'dropout mask size')
+   local kept = output:ne(0):typeAs(input)
+   mytester:assertTensorEq(output, input:clone():cmul(kept):div(1-p), 1e-12, 'dropout output values')
+   local gradInput = module:backward(input, input)
+   mytester:assertTensorEq(gradInput, output, 1e-12, 'dropout gradInput mask')
 end
 
 function nntest.ReLU()
@@ -434,6 +443,196 @@ function nntest.SparseLinear()
    mytester:asserteq(0, berr, torch.typename(module) .. ' - i/o backward err ')
 end
 
+function nntest.SparseLinear_batch()
+   local ini = math.random(50,100)
+   local inj = math.random(5,10)
+   local nBatch = math.random(2,6)
+
+   local module = nn.SparseLinear(ini,inj)
+   local single = module:clone()
+
+   -- CSR batch, and the same rows as (index, value) samples
+   local rowPtr = torch.LongTensor(nBatch+1)
+   local samples = {}
+   rowPtr[1] = 1
+   for b = 1, nBatch do
+      local numNonzero = math.random(1,5)
+      local sample = torch.Tensor(numNonzero, 2)
+      sample:select(2,1):copy(torch.randperm(ini):narrow(1,1,numNonzero))
+      sample:select(2,2):copy(torch.rand(numNonzero)):mul(2):add(-1)
+      samples[b] = sample
+      rowPtr[b+1] = rowPtr[b] + numNonzero
+   end
+   local nnz = rowPtr[nBatch+1] - 1
+   local colIdx = torch.LongTensor(nnz)
+   local values = torch.Tensor(nnz)
+   for b = 1, nBatch do
+      colIdx:narrow(1, rowPtr[b], samples[b]:size(1)):copy(samples[b]:select(2,1))
+      values:narrow(1, rowPtr[b], samples[b]:size(1)):copy(samples[b]:select(2,2))
+   end
+   local input = {rowPtr, colIdx, values}
+   local gradOutput = torch.randn(nBatch, inj)
+
+   module.weightDecay = 0.01
+   module:zeroGradParameters()
+   local output = module:forward(input)
+   local gradInput = module:backward(input, gradOutput)
+
+   single:zeroGradParameters()
+   local decayed = {}
+   for b = 1, nBatch do
+      local err = (single:forward(samples[b]) - output[b]):abs():max()
+      mytester:assertlt(err, precision, 'error on output ')
+      local gradSample = single:updateGradInput(samples[b], gradOutput[b])
+      err = (gradSample:select(2,2) - gradInput[3]:narrow(1, rowPtr[b], samples[b]:size(1))):abs():max()
+      mytester:assertlt(err, precision, 'error on gradInput ')
+      single:accGradParameters(samples[b], gradOutput[b])
+      for i = 1, samples[b]:size(1) do
+         decayed[samples[b][i][1]] = true
+      end
+   end
+   -- the decay is only added once, to the touched columns
+   for c in pairs(decayed) do
+      single.gradWeight:select(2, c):add(0.01, single.weight:select(2, c))
+   end
+   mytester:assertlt((module.gradWeight - single.gradWeight):abs():max(), precision, 'error on gradWeight ')
+   mytester:assertlt((module.gradBias - single.gradBias):abs():max(), precision, 'error on gradBias ')
+
+   module:updateParameters(0.1)
+   for c in pairs(decayed) do
+      single.weight:select(2, c):add(-0.1, single.gradWeight:select(2, c))
+   end
+   mytester:assertlt((module.weight - single.weight):abs():max(), precision, 'error on weight [updateParameters] ')
+
+   module:zeroGradParameters()
+   mytester:asserteq(module.gradWeight:abs():max(), 0, 'gradWeight not zeroed ')
+   mytester:asserteq(module.touchedColumns:nElement(), 0, 'touched columns not reset ')
+end
+
+function nntest.QuantizedLinear()
+   local ini = math.random(30,70)
+   local inj = math.random(5,20)
+   local nBatch = math.random(2,6)
+   local linear = nn.Linear(ini, inj)
+   local input = torch.randn(nBatch, ini)
+
+   -- int8 weights and inputs: errors of a few percent of the output range
+   local module = nn.QuantizedLinear(linear)
+   local expected = linear:forward(input)
+   local output = module:forward(input)
+   local tol = 0.02*expected:clone():abs():max()
+   mytester:assertTableEq(output:size():totable(), expected:size():totable(), 'output size error')
+   mytester:assertlt((output - expected):abs():max(), tol, 'error on output ')
+   mytester:assertlt((module:forward(input[1]) - expected[1]):abs():max(), tol, 'error on vector output ')
+
+   module = nn.QuantizedLinear(linear, true)
+   output = module:forward(input)
+   mytester:assertlt((output - expected:clone():clamp(0, math.huge)):abs():max(), tol, 'error on fused ReLU ')
+
+   -- calibrated: one input scale for every sample
+   nn.calibrate(module, input)
+   mytester:assertlt(math.abs(module.inputScale - input:clone():abs():max()/127), 1e-6, 'error on calibrated scale ')
+   output = module:forward(input)
+   mytester:assertlt((output - expected:clone():clamp(0, math.huge)):abs():max(), 2*tol, 'error on calibrated output ')
+end
+
+function nntest.QuantizedSpatialConvolutionMM()
+   local from = math.random(1,5)
+   local to = math.random(1,5)
+   local ki = math.random(1,3)
+   local kj = math.random(1,3)
+   local outi = math.random(5,9)
+   local outj = math.random(5,9)
+   local ini = outi-1+ki
+   local inj = outj-1+kj
+   local batch = math.random(2,4)
+   local conv = nn.SpatialConvolutionMM(from, to, ki, kj, 1, 1, 1)
+   local input = torch.randn(batch, from, inj, ini)
+
+   local module = nn.QuantizedSpatialConvolutionMM(conv)
+   local expected = conv:forward(input)
+   local output = module:forward(input)
+   local tol = 0.02*expected:clone():abs():max()
+   mytester:assertTableEq(output:size():totable(), expected:size():totable(), 'output size error')
+   mytester:assertlt((output - expected):abs():max(), tol, 'error on batch output ')
+   mytester:assertlt((module:forward(input[2]) - expected[2]):abs():max(), tol, 'error on frame output ')
+
+   -- strides: checked against the unstrided output
+   module.dW, module.dH = 2, 2
+   output = module:forward(input)
+   local strided = expected[{{}, {}, {1, expected:size(3), 2}, {1, expected:size(4), 2}}]
+   mytester:assertlt((output - strided):abs():max(), tol, 'error on strided output ')
+end
+
+function nntest.quantize()
+   local model = nn.Sequential()
+   model:add(nn.SpatialConvolutionMM(3, 8, 3, 3))
+   model:add(nn.ReLU())
+   model:add(nn.Reshape(8*4*4))
+   model:add(nn.Linear(8*4*4, 16))
+   model:add(nn.ReLU())
+   model:add(nn.Linear(16, 10))
+   model:add(nn.LogSoftMax())
+   local input = torch.randn(5, 3, 6, 6)
+   local expected = model:forward(input):clone()
+
+   local qmodel = nn.quantize(model:clone())
+   local types = {}
+   for i, m in ipairs(qmodel.modules) do
+      types[i] = torch.typename(m)
+   end
+   mytester:assertTableEq(types, {'nn.QuantizedSpatialConvolutionMM', 'nn.Reshape', 'nn.QuantizedLinear',
+                                  'nn.QuantizedLinear', 'nn.LogSoftMax'}, 'error on converted modules ')
+   mytester:assert(qmodel.modules[1].relu and qmodel.modules[3].relu and not qmodel.modules[4].relu,
+                   'the ReLUs should be fused ')
+   mytester:assertlt((qmodel:forward(input) - expected):abs():max(), 0.05, 'error on quantized model ')
+
+   nn.calibrate(qmodel, {input:narrow(1, 1, 2), input:narrow(1, 3, 3)})
+   mytester:assert(qmodel.modules[1].inputScale and qmodel.modules[4].inputScale, 'the layers should be calibrated ')
+   mytester:assertlt((qmodel:forward(input) - expected):abs():max(), 0.1, 'error on calibrated model ')
+end
+
+function nntest.Sequential_optimizeMemory()
+   local model = nn.Sequential()
+   model:add(nn.ReLU())
+   model:add(nn.Linear(10, 20))
+   model:add(nn.Tanh())
+   model:add(nn.Linear(20, 30))
+   model:add(nn.Sigmoid())
+   model:add(nn.Dropout(0.3))
+   local inner = nn.Sequential()
+   inner:add(nn.Linear(30, 10))
+   inner:add(nn.ReLU())
+   model:add(inner)
+   model:evaluate()
+
+   local input = torch.randn(4, 10)
+   local inputCopy = input:clone()
+   local expected = model:forward(input):clone()
+
+   local planned = model:clone():optimizeMemory()
+   mytester:assertlt((planned:forward(input) - expected):abs():max(), precision, 'error on output ')
+   mytester:asserteq((input - inputCopy):abs():max(), 0, 'the input should not be modified ')
+   -- two buffers of 4x30 and 4x20 plus one of 4x10 in the inner container,
+   -- against the eight outputs of the usual forward
+   local plannedBytes, naiveBytes = planned:memoryUsage()
+   mytester:asserteq(plannedBytes, (120+80+40)*8, 'error on planned bytes ')
+   mytester:asserteq(naiveBytes, (40+80+80+120+120+120+40+40)*8, 'error on naive bytes ')
+
+   input = torch.randn(7, 10)
+   expected = model:forward(input):clone()
+   mytester:assertlt((planned:forward(input) - expected):abs():max(), precision, 'error on output with another batch size ')
+
+   local gradOutput = torch.randn(7, 10)
+   mytester:assertError(function() planned:backward(input, gradOutput) end, 'backward should be refused ')
+   planned:optimizeMemory(false)
+   mytester:assertlt((planned:forward(input) - expected):abs():max(), precision, 'error on output after optimizeMemory(false) ')
+   local innerInput = model.modules[6].output
+   planned.modules[7]:backward(innerInput, gradOutput)
+   inner:backward(innerInput, gradOutput)
+   mytester:assertlt((planned.modules[7].gradInput - inner.gradInput):abs():max(), precision, 'error on gradInput after optimizeMemory(false) ')
+end
+
 function nntest.Euclidean()
    local ini = math.random(5,7)
    local inj = math.random(5,7)
@@ -992,6 +1191,68 @@ function nntest.SpatialConvolutionMM()
    mytester:asserteq(0, berr, torch.typename(module) .. ' - i/o backward err ')
 end
 
+function nntest.SpatialConvolutionMM_memoryBudget()
+   local from = math.random(1,5)
+   local to = math.random(1,5)
+   local ki = math.random(1,3)
+   local kj = math.random(1,3)
+   local padding = math.random(0,2)
+   local batch = math.random(3,7)
+   local outi = math.random(4,8)
+   local outj = math.random(4,8)
+   local ini = outi-1+ki
+   local inj = outj-1+kj
+   local module = nn.SpatialConvolutionMM(from, to, ki, kj, 1, 1, padding)
+   local input = torch.rand(batch, from, inj, ini)
+   local gradOutput = torch.rand(module:forward(input):size())
+
+   module:zeroGradParameters()
+   local output = module:forward(input):clone()
+   local gradInput = module:backward(input, gradOutput):clone()
+   local gradWeight = module.gradWeight:clone()
+   local gradBias = module.gradBias:clone()
+
+   -- room for two frames of unfolded input: the batch goes in chunks
+   module.memoryBudget = 2*module.finput:nElement()/batch*module.finput:elementSize()
+   module:zeroGradParameters()
+   mytester:assertlt((module:forward(input)-output):abs():max(), precision, 'error on output with memoryBudget ')
+   mytester:assertlt((module:backward(input, gradOutput)-gradInput):abs():max(), precision, 'error on gradInput with memoryBudget ')
+   mytester:assertlt((module.gradWeight-gradWeight):abs():max(), precision, 'error on gradWeight with memoryBudget ')
+   mytester:assertlt((module.gradBias-gradBias):abs():max(), precision, 'error on gradBias with memoryBudget ')
+end
+
+function nntest.SpatialConvolutionMM_winograd()
+   local from = math.random(1,5)
+   local to = math.random(1,5)
+   local padding = math.random(0,2)
+   local batch = math.random(1,4)
+   local ini = math.random(3,13)
+   local inj = math.random(3,13)
+   local module = nn.SpatialConvolutionMM(from, to, 3, 3, 1, 1, padding)
+   local input = torch.rand(batch, from, inj, ini)
+   local gradOutput = torch.rand(module:forward(input):size())
+
+   module.winograd = false
+   module:zeroGradParameters()
+   local output = module:forward(input):clone()
+   local gradInput = module:backward(input, gradOutput):clone()
+   local gradWeight = module.gradWeight:clone()
+   local gradBias = module.gradBias:clone()
+
+   for _,tile in ipairs({2, 4}) do
+      module.winograd = tile
+      module:zeroGradParameters()
+      mytester:assertlt((module:forward(input)-output):abs():max(), precision,
+                        'error on output with F(' .. tile .. 'x' .. tile .. ',3x3) ')
+      mytester:assertlt((module:backward(input, gradOutput)-gradInput):abs():max(), precision,
+                        'error on gradInput with F(' .. tile .. 'x' .. tile .. ',3x3) ')
+      mytester:assertlt((module.gradWeight-gradWeight):abs():max(), precision,
+                        'error on gradWeight with F(' .. tile .. 'x' .. tile .. ',3x3) ')
+      mytester:assertlt((module.gradBias-gradBias):abs():max(), precision,
+                        'error on gradBias with F(' .. tile .. 'x' .. tile .. ',3x3) ')
+   end
+end
+
 function nntest.SpatialConvolutionMap()
    local from = math.random(1,5)
    local fanin = math.random(1, from)
@@ -1631,6 +1892,59 @@ function nntest.TemporalConvolution()
    mytester:assertTensorEq(inputGrad:select(1,2), inputGrad1D, 0.000001, 'error on 2D vs 1D backward)')
 end
 
+function nntest.TemporalConvolution_unfoldChunks()
+   local from = math.random(2,4)
+   local to = math.random(2,4)
+   local batch = 3
+   local outi = 5
+   -- windows with gaps between them (kW < dW), then overlapping ones
+   for _, kd in ipairs{{2, 3}, {5, 2}} do
+      local ki, si = kd[1], kd[2]
+      -- the last si-1 frames are read by no window
+      local ini = outi*si + ki - 1
+      local module = nn.TemporalConvolution(from, to, ki, si)
+      local input = torch.rand(batch, ini, from)
+      local gradOutput = torch.rand(batch, outi, to)
+
+      -- reference: one product per output frame
+      local output = torch.Tensor(batch, outi, to)
+      local gradInput = torch.zeros(batch, ini, from)
+      local gradWeight = torch.zeros(to, from*ki)
+      local gradWeight2 = torch.zeros(to, from*ki)
+      for s = 1, batch do
+         for k = 1, outi do
+            local window = input[s]:narrow(1, (k-1)*si+1, ki):contiguous():view(from*ki)
+            output[s][k]:copy(module.bias):addmv(module.weight, window)
+            gradInput[s]:narrow(1, (k-1)*si+1, ki):add(torch.mv(module.weight:t(), gradOutput[s][k]):view(ki, from))
+            gradWeight:addr(gradOutput[s][k], window)
+            if s == 2 then
+               gradWeight2:addr(gradOutput[s][k], window)
+            end
+         end
+      end
+      local gradBias = gradOutput:sum(1):sum(2):view(to)
+
+      -- chunks of one row, ending inside a sample, at its last frame, or
+      -- one row into the next sample, and the whole batch at once
+      local rowBytes = from*ki*input:elementSize()
+      for _, rows in ipairs{1, outi-1, outi, outi+1, batch*outi} do
+         local msg = string.format(' (kW %d, dW %d, %d rows)', ki, si, rows)
+         module.memoryBudget = rows*rowBytes
+         module:zeroGradParameters()
+         mytester:assertTensorEq(module:forward(input), output, precision, 'error on output' .. msg)
+         mytester:assertTensorEq(module:backward(input, gradOutput), gradInput, precision, 'error on gradInput' .. msg)
+         mytester:assertTensorEq(module.gradWeight, gradWeight, precision, 'error on gradWeight' .. msg)
+         mytester:assertTensorEq(module.gradBias, gradBias, precision, 'error on gradBias' .. msg)
+
+         -- a 2D input is a single sequence
+         module:zeroGradParameters()
+         mytester:assertTensorEq(module:forward(input[2]), output[2], precision, 'error on 2D output' .. msg)
+         mytester:assertTensorEq(module:backward(input[2], gradOutput[2]), gradInput[2], precision, 'error on 2D gradInput' .. msg)
+         mytester:assertTensorEq(module.gradWeight, gradWeight2, precision, 'error on 2D gradWeight' .. msg)
+      end
+   end
+end
+
 function nntest.TemporalSubSampling()
    local from = math.random(1,5)
    local ki = math.random(1,6)
@@ -1955,6 +2269,76 @@ function nntest.Module_getParameters_8()
 
 end
 
+function nntest.Module_getParameters_9()
+   -- overlapping and strided views, with holes between and after them
+   local storage = torch.randn(30):storage()
+   local a = torch.Tensor(storage, 3, torch.LongStorage{2,5})
+   local b = torch.Tensor(storage, 11, torch.LongStorage{5})
+   local c = torch.Tensor(storage, 18, torch.LongStorage{3}, torch.LongStorage{4})
+   local d = torch.randn(4, 2):t()
+   local expected = {a:clone(), b:clone(), c:clone(), d:clone()}
+
+   local p = nn.Module.flatten({a, b, c, d})
+   mytester:asserteq(p:nElement(), 13 + 9 + 8, 'getParameters(): holes left in')
+   for i, t in ipairs({a, b, c, d}) do
+      mytester:asserteq((t - expected[i]):abs():max(), 0, 'getParameters(): values changed')
+      mytester:assert(torch.pointer(t:storage()) == torch.pointer(p:storage()), 'getParameters(): not a view')
+   end
+   mytester:asserteq(c:stride(1), 4, 'getParameters(): strides changed')
+   a:fill(7)
+   mytester:asserteq(b[1], 7, 'getParameters(): overlapping views not shared')
+end
+
+function nntest.fusedOptimizers()
+   local n = 57
+   local x0, dfdx = torch.randn(n), torch.randn(n)
+
+   -- SGD with momentum and weight decay, two steps
+   local x = x0:clone()
+   local config = {learningRate = 0.1, weightDecay = 0.01, momentum = 0.9, dampening = 0.2}
+   nn.fusedSGD(x, dfdx, config)
+   nn.fusedSGD(x, dfdx, config)
+   local xr = x0:clone()
+   local g = dfdx + xr*0.01
+   local v = g:clone()
+   xr:add(-0.1, v)
+   g = dfdx + xr*0.01
+   v:mul(0.9):add(0.8, g)
+   xr:add(-0.1, v)
+   mytester:assertlt((x - xr):abs():max(), precision, 'error on sgd')
+
+   -- Nesterov
+   x = x0:clone()
+   nn.fusedSGD(x, dfdx, {learningRate = 0.1, momentum = 0.5, dampening = 0, nesterov = true})
+   mytester:assertlt((x - (x0 - dfdx*0.15)):abs():max(), precision, 'error on nesterov sgd')
+
+   -- Adagrad, two steps
+   x = x0:clone()
+   config = {learningRate = 0.1}
+   nn.fusedAdagrad(x, dfdx, config)
+   nn.fusedAdagrad(x, dfdx, config)
+   xr = x0 - torch.cdiv(dfdx, torch.abs(dfdx):add(1e-10))*0.1
+   xr:add(-0.1, torch.cdiv(dfdx, torch.abs(dfdx)*math.sqrt(2)))
+   mytester:assertlt((x - xr):abs():max(), precision, 'error on adagrad')
+
+   -- RMSProp, one step
+   x = x0:clone()
+   nn.fusedRMSProp(x, dfdx, {learningRate = 0.01, alpha = 0.9})
+   xr = x0 - torch.cdiv(dfdx, (torch.abs(dfdx)*math.sqrt(0.1)):add(1e-8))*0.01
+   mytester:assertlt((x - xr):abs():max(), precision, 'error on rmsprop')
+
+   -- on the parameters of a network
+   local mlp = nn.Sequential():add(nn.Linear(5, 3)):add(nn.Tanh()):add(nn.Linear(3, 2))
+   local params, gradParams = mlp:getParameters()
+   local input = torch.randn(5)
+   mlp:zeroGradParameters()
+   mlp:backward(input, mlp:forward(input):clone():fill(1))
+   local weight = mlp.modules[1].weight:clone()
+   nn.fusedSGD(params, gradParams, {learningRate = 0.5})
+   mytester:assertlt((mlp.modules[1].weight - (weight - mlp.modules[1].gradWeight*0.5)):abs():max(), precision,
+                     'error on network parameters')
+end
+
 function nntest.PairwiseDistance()
    -- Note: testJacobian doesn't support table inputs, and rather than re-write
    -- it so that it does, I'll just use a split table module on the input.
@@ -2065,6 +2449,55 @@ function nntest.LookupTable()
    module:backwardUpdate(input, output, 0.1)
 end
 
+function nntest.LookupTable_duplicates()
+   local nIndex = math.random(10,20)
+   local entry_size = math.random(2,5)
+   local nframe = math.random(2,5)
+   local seq = math.random(10,30)
+   -- many more indices than rows: every row is hit several times
+   local input = torch.LongTensor(nframe, seq):random(1, nIndex)
+   local gradOutput = torch.randn(nframe, seq, entry_size)
+   local module = nn.LookupTable(nIndex, entry_size)
+   local weight = module.weight:clone()
+
+   -- reference: one row update per index
+   local gradWeight = torch.zeros(nIndex, entry_size)
+   local counts = {}
+   for i=1,nframe do
+      for j=1,seq do
+         local k = input[i][j]
+         gradWeight[k]:add(0.5, gradOutput[i][j])
+         counts[k] = (counts[k] or 0) + 1
+      end
+   end
+
+   module:zeroGradParameters()
+   module:forward(input)
+   module:backward(input, gradOutput, 0.5)
+   mytester:assertlt((module.gradWeight - gradWeight):abs():max(), precision, 'error on gradWeight ')
+   for k,n in pairs(counts) do
+      mytester:asserteq(module.inputs[k], n, 'error on inputs count ')
+   end
+   mytester:asserteq(module.nBackward, nframe, 'error on nBackward ')
+
+   module:updateParameters(0.1)
+   weight:add(-0.1, gradWeight)
+   mytester:assertlt((module.weight - weight):abs():max(), precision, 'error on weight [updateParameters] ')
+
+   module:accUpdateGradParameters(input, gradOutput, 0.1)
+   weight:add(-0.2, gradWeight)
+   mytester:assertlt((module.weight - weight):abs():max(), precision, 'error on weight [accUpdateGradParameters] ')
+
+   -- a key-scaled subclass keeps the per-index path
+   function module:scaleUpdateByKey(k) return 2 end
+   module:accUpdateGradParameters(input, gradOutput, 0.1)
+   weight:add(-0.4, gradWeight)
+   mytester:assertlt((module.weight - weight):abs():max(), precision, 'error on weight [scaleUpdateByKey] ')
+
+   module:zeroGradParameters()
+   mytester:asserteq(module.gradWeight:abs():max(), 0, 'gradWeight not zeroed ')
+end
+
 function nntest.AddConstant()
   local nbatch = torch.random(3, 5)
   local f = torch.random(3, 5)
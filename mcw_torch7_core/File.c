@@ -126,6 +126,70 @@ IMPLEMENT_TORCH_FILE_RW(Long, long)
 IMPLEMENT_TORCH_FILE_RW(Float, float)
 IMPLEMENT_TORCH_FILE_RW(Double, double)
 
+/* Half numbers are read and written as floats on the Lua side */
+static int torch_File_readHalf(lua_State *L)
+{
+  THFile *self = luaT_checkudata(L, 1, "torch.File");
+  int narg = lua_gettop(L);
+
+  if(narg == 1)
+  {
+    THHalf value;
+    THFile_readHalfRaw(self, &value, 1);
+    lua_pushnumber(L, TH_half2float(value));
+    return 1;
+  }
+  else if(narg == 2)
+  {
+    if(lua_isnumber(L, 2))
+    {
+      long size = lua_tonumber(L, 2);
+      long nread;
+
+      THHalfStorage *storage = THHalfStorage_newWithSize(size);
+      luaT_pushudata(L, storage, "torch.HalfStorage");
+      nread = THFile_readHalf(self, storage);
+      if(nread != size)
+        THHalfStorage_resize(storage, size);
+      return 1;
+    }
+    else if(luaT_toudata(L, 2, "torch.HalfStorage"))
+    {
+      THHalfStorage *storage = luaT_toudata(L, 2, "torch.HalfStorage");
+      lua_pushnumber(L, THFile_readHalf(self, storage));
+      return 1;
+    }
+  }
+
+  luaL_error(L, "nothing, number, or HalfStorage expected");
+  return 0;
+}
+
+static int torch_File_writeHalf(lua_State *L)
+{
+  THFile *self = luaT_checkudata(L, 1, "torch.File");
+  int narg = lua_gettop(L);
+
+  if(narg == 2)
+  {
+    if(lua_isnumber(L, 2))
+    {
+      THHalf value = TH_float2half((float)lua_tonumber(L, 2));
+      THFile_writeHalfRaw(self, &value, 1);
+      return 0;
+    }
+    else if(luaT_toudata(L, 2, "torch.HalfStorage"))
+    {
+      THHalfStorage *storage = luaT_toudata(L, 2, "torch.HalfStorage");
+      lua_pushnumber(L, THFile_writeHalf(self, storage));
+      return 1;
+    }
+  }
+
+  luaL_error(L, "number, or HalfStorage expected");
+  return 0;
+}
+
 static int torch_File_readString(lua_State *L)
 {
   THFile *self = luaT_checkudata(L, 1, "torch.File");
@@ -176,6 +240,7 @@ static const struct luaL_Reg torch_File__ [] = {
   {"readLong", torch_File_readLong},
   {"readFloat", torch_File_readFloat},
   {"readDouble", torch_File_readDouble},
+  {"readHalf", torch_File_readHalf},
   {"readString", torch_File_readString},
 
   {"writeByte", torch_File_writeByte},
@@ -185,6 +250,7 @@ static const struct luaL_Reg torch_File__ [] = {
   {"writeLong", torch_File_writeLong},
   {"writeFloat", torch_File_writeFloat},
   {"writeDouble", torch_File_writeDouble},
+  {"writeHalf", torch_File_writeHalf},
   {"writeString", torch_File_writeString},
 
   {"synchronize", torch_File_synchronize},
@@ -21,6 +21,12 @@ local TYPE_BOOLEAN  = 5
 local TYPE_FUNCTION = 6
 local TYPE_RECUR_FUNCTION = 7
 
+-- storages torch.save(filename, object, 'mmap') puts in the data section
+local mappableStorages = {}
+for _,name in ipairs{'Byte', 'Char', 'Short', 'Int', 'Long', 'Float', 'Double', 'Half'} do
+   mappableStorages['torch.' .. name .. 'Storage'] = true
+end
+
 function File:isWritableObject(object)
    local typename = type(object)
    local typeidx
@@ -131,7 +137,12 @@ function File:writeObject(object)
             self:writeChar(version)
             self:writeInt(#className)
             self:writeChar(className)
-            if object.write then
+            local mapped = torch.getenv(self).mappedStorages
+            if mapped and mappableStorages[torch.typename(object)] then
+               -- the data goes to the data section, see torch.save
+               table.insert(mapped, object)
+               self:writeLong(#mapped)
+            elseif object.write then
                object:write(self)
             elseif type(object) == 'table' then
                local var = {}
@@ -226,6 +237,19 @@ function File:readObject()
          if not torch.factory(className) then
             error(string.format('unknown Torch class <%s>', tostring(className)))
          end
+         local env = torch.getenv(self)
+         if env.mappedStorages and mappableStorages[className] then
+            local entry = env.mappedStorages[self:readLong()]
+            local new = torch[string.match(className, '^torch%.(.+)$')]
+            local object
+            if entry.size > 0 then
+               object = new(env.mappedFile, false, entry.size, entry.offset)
+            else
+               object = new()
+            end
+            objects[index] = object
+            return object
+         end
          local object = torch.factory(className)()
          objects[index] = object
          if object.read then
@@ -255,9 +279,86 @@ function File:readObject()
    end
 end
 
+-- Mapped format: a header indexing the storages, the object graph in
+-- binary format with each storage replaced by its index, then the data
+-- of every storage on its own page. Loading maps the storages of the
+-- file (copy-on-write) instead of reading them.
+local MAPPED_MAGIC = 'T7MAPPED'
+local MAPPED_VERSION = 1
+local MAPPED_ALIGNMENT = 4096
+
+local function saveMapped(filename, object)
+   -- the graph goes through memory first: its size fixes where data starts
+   local storages = {}
+   local graph = torch.MemoryFile()
+   graph:binary()
+   torch.setenv(graph, {writeObjects={}, writeObjectsRef={}, readObjects={}, mappedStorages=storages})
+   graph:writeObject(object)
+   local graphSize = graph:position()-1
+   graph:seek(1)
+   local graphData = graph:readChar(graphSize)
+   graph:close()
+
+   local file = torch.DiskFile(filename, 'w')
+   file:binary()
+   file:writeString(MAPPED_MAGIC)
+   file:writeInt(MAPPED_VERSION)
+   file:writeLong(#storages)
+   local indexPosition = file:position()
+   for i=1,#storages do
+      file:writeLong(0)
+      file:writeLong(0)
+   end
+   file:writeLong(graphSize)
+   file:writeChar(graphData)
+
+   local offsets = {}
+   for i,storage in ipairs(storages) do
+      local offset = file:position()-1
+      local aligned = math.ceil(offset/MAPPED_ALIGNMENT)*MAPPED_ALIGNMENT
+      if aligned > offset then
+         file:writeChar(torch.CharStorage(aligned-offset):fill(0))
+      end
+      offsets[i] = aligned
+      file['write' .. string.match(torch.typename(storage), '^torch%.(.+)Storage$')](file, storage)
+   end
+
+   file:seek(indexPosition)
+   for i,storage in ipairs(storages) do
+      file:writeLong(offsets[i])
+      file:writeLong(storage:size())
+   end
+   file:close()
+end
+
+local function loadMapped(filename)
+   local file = torch.DiskFile(filename, 'r')
+   file:binary()
+   if file:readChar(#MAPPED_MAGIC):string() ~= MAPPED_MAGIC then
+      error(string.format('<%s> is not a mapped Torch file', filename))
+   end
+   local version = file:readInt()
+   if version ~= MAPPED_VERSION then
+      error(string.format('unsupported mapped file version <%d>', version))
+   end
+   local storages = {}
+   for i=1,file:readLong() do
+      storages[i] = {offset=file:readLong(), size=file:readLong()}
+   end
+   file:readLong() -- graph size
+   torch.setenv(file, {writeObjects={}, writeObjectsRef={}, readObjects={},
+                       mappedStorages=storages, mappedFile=filename})
+   local object = file:readObject()
+   file:close()
+   return object
+end
+
 -- simple helpers to save/load arbitrary objects/tables
 function torch.save(filename, object, mode)
    mode = mode or 'binary'
+   if mode == 'mmap' then
+      return saveMapped(filename, object)
+   end
    local file = torch.DiskFile(filename, 'w')
    file[mode](file)
    file:writeObject(object)
@@ -266,6 +367,9 @@ end
 
 function torch.load(filename, mode)
    mode = mode or 'binary'
+   if mode == 'mmap' then
+      return loadMapped(filename)
+   end
    local file = torch.DiskFile(filename, 'r')
    file[mode](file)
    local object = file:readObject()
@@ -274,12 +378,19 @@ function torch.load(filename, mode)
 end
 
 -- simple helpers to serialize/deserialize arbitrary objects/tables
+-- (binary objects go through a chunked file: the storages are not copied
+-- before the string is made)
 function torch.serialize(object, mode)
    mode = mode or 'binary'
-   local f = torch.MemoryFile()
-   f = f[mode](f)
+   local f
+   if mode == 'binary' then
+      f = torch.MemoryFile('w', 1024*1024)
+   else
+      f = torch.MemoryFile()
+      f = f[mode](f)
+   end
    f:writeObject(object)
-   local s = f:storage():string()
+   local s = f:string()
    f:close()
    return s
 end
@@ -11,6 +11,11 @@ static int torch_MemoryFile_new(lua_State *L)
     mode = luaL_optstring(L, 2, "rw");
     self = THMemoryFile_newWithStorage(storage, mode);
   }
+  else if(lua_isnumber(L, 2))
+  {
+    mode = luaL_optstring(L, 1, "rw");
+    self = THMemoryFile_newChunked(mode, luaL_checklong(L, 2));
+  }
   else
   {
     mode = luaL_optstring(L, 1, "rw");
@@ -29,6 +34,63 @@ static int torch_MemoryFile_storage(lua_State *L)
   return 1;
 }
 
+static int torch_MemoryFile_chunkIterator(lua_State *L)
+{
+  THFile *self = luaT_toudata(L, lua_upvalueindex(1), "torch.MemoryFile");
+  long index = (long)lua_tonumber(L, lua_upvalueindex(2));
+
+  if(index >= THMemoryFile_nChunks(self))
+    return 0;
+
+  lua_pushnumber(L, index+1);
+  lua_replace(L, lua_upvalueindex(2));
+  luaT_pushudata(L, THMemoryFile_chunkStorage(self, index), "torch.CharStorage");
+  return 1;
+}
+
+static int torch_MemoryFile_chunks(lua_State *L)
+{
+  luaT_checkudata(L, 1, "torch.MemoryFile");
+  lua_settop(L, 1);
+  lua_pushnumber(L, 0);
+  lua_pushcclosure(L, torch_MemoryFile_chunkIterator, 2);
+  return 1;
+}
+
+/* one copy of the chunks, however many there are */
+static int torch_MemoryFile_string(lua_State *L)
+{
+  THFile *self = luaT_checkudata(L, 1, "torch.MemoryFile");
+  long nChunks = THMemoryFile_nChunks(self);
+  long size, total = 0;
+  long i;
+  char *data;
+
+  if(nChunks == 1)
+  {
+    data = THMemoryFile_chunk(self, 0, &size);
+    lua_pushlstring(L, data, size);
+    return 1;
+  }
+
+  for(i = 0; i < nChunks; i++)
+  {
+    THMemoryFile_chunk(self, i, &size);
+    total += size;
+  }
+  data = THAlloc(total);
+  total = 0;
+  for(i = 0; i < nChunks; i++)
+  {
+    char *chunk = THMemoryFile_chunk(self, i, &size);
+    memcpy(data+total, chunk, size);
+    total += size;
+  }
+  lua_pushlstring(L, data, total);
+  THFree(data);
+  return 1;
+}
+
 static int torch_MemoryFile_free(lua_State *L)
 {
   THFile *self = luaT_checkudata(L, 1, "torch.MemoryFile");
@@ -48,6 +110,8 @@ static int torch_MemoryFile___tostring__(lua_State *L)
 
 static const struct luaL_Reg torch_MemoryFile__ [] = {
   {"storage", torch_MemoryFile_storage},
+  {"chunks", torch_MemoryFile_chunks},
+  {"string", torch_MemoryFile_string},
   {"__tostring__", torch_MemoryFile___tostring__},
   {NULL, NULL}
 };
@@ -0,0 +1,116 @@
+#include "general.h"
+
+static int torch_PrefetchFile_new(lua_State *L)
+{
+  const char *name = luaL_checkstring(L, 1);
+  long blockSize = luaL_optlong(L, 2, 4*1024*1024);
+  int nBlocks = luaL_optint(L, 3, 8);
+  int nThreads = luaL_optint(L, 4, 1);
+  int isQuiet = luaT_optboolean(L, 5, 0);
+  THFile *self = THPrefetchFile_new(name, blockSize, nBlocks, nThreads, isQuiet);
+
+  luaT_pushudata(L, self, "torch.PrefetchFile");
+  return 1;
+}
+
+static int torch_PrefetchFile_free(lua_State *L)
+{
+  THFile *self = luaT_checkudata(L, 1, "torch.PrefetchFile");
+  THFile_free(self);
+  return 0;
+}
+
+/* The batch is viewed through a storage which holds a reference to the
+   buffers of the file, so that it stays valid after the file is closed. */
+#define NEXT_BATCH(TYPEC, TYPE)                                         \
+  if((tensor = luaT_toudata(L, 2, "torch." #TYPEC "Tensor")))           \
+  {                                                                     \
+    TH##TYPEC##Storage *storage;                                        \
+    luaL_argcheck(L, size % sizeof(TYPE) == 0, 2, "batch size is not a multiple of the element size"); \
+    storage = TH##TYPEC##Storage_newWithDataAndAllocator((TYPE*)data, size/sizeof(TYPE), \
+                                                         &THPrefetchBatchAllocator, \
+                                                         THPrefetchFile_retainBatch(self)); \
+    storage->flag = TH_STORAGE_REFCOUNTED | TH_STORAGE_FREEMEM;         \
+    TH##TYPEC##Tensor_setStorage1d(tensor, storage, 0, size/sizeof(TYPE), 1); \
+    TH##TYPEC##Storage_free(storage);                                   \
+    lua_settop(L, 2);                                                   \
+    return 1;                                                           \
+  }
+
+static int torch_PrefetchFile_nextBatch(lua_State *L)
+{
+  THFile *self = luaT_checkudata(L, 1, "torch.PrefetchFile");
+  void *tensor;
+  long size;
+  char *data = THPrefetchFile_nextBatch(self, &size);
+
+  if(!data)
+    return 0;
+
+  if(lua_isnoneornil(L, 2))
+  {
+    lua_settop(L, 1);
+    luaT_pushudata(L, THByteTensor_new(), "torch.ByteTensor");
+  }
+
+  NEXT_BATCH(Byte, unsigned char)
+  NEXT_BATCH(Char, char)
+  NEXT_BATCH(Short, short)
+  NEXT_BATCH(Int, int)
+  NEXT_BATCH(Long, long)
+  NEXT_BATCH(Float, float)
+  NEXT_BATCH(Double, double)
+
+  luaL_typerror(L, 2, "torch.*Tensor");
+  return 0;
+}
+
+static int torch_PrefetchFile_stats(lua_State *L)
+{
+  THFile *self = luaT_checkudata(L, 1, "torch.PrefetchFile");
+  THPrefetchFileStats stats;
+
+  THPrefetchFile_stats(self, &stats);
+  lua_newtable(L);
+  lua_pushnumber(L, stats.bytesRead);
+  lua_setfield(L, -2, "bytesRead");
+  lua_pushnumber(L, stats.bytesFetched);
+  lua_setfield(L, -2, "bytesFetched");
+  lua_pushnumber(L, stats.seconds);
+  lua_setfield(L, -2, "seconds");
+  lua_pushnumber(L, stats.seconds > 0 ? stats.bytesRead/stats.seconds : 0);
+  lua_setfield(L, -2, "throughput");
+  lua_pushnumber(L, stats.stallSeconds);
+  lua_setfield(L, -2, "stallSeconds");
+  lua_pushnumber(L, stats.nStalls);
+  lua_setfield(L, -2, "nStalls");
+  lua_pushnumber(L, stats.idleSeconds);
+  lua_setfield(L, -2, "idleSeconds");
+  return 1;
+}
+
+static int torch_PrefetchFile___tostring__(lua_State *L)
+{
+  THFile *self = luaT_checkudata(L, 1, "torch.PrefetchFile");
+  lua_pushfstring(L, "torch.PrefetchFile on <%s> [status: %s -- mode: %c%c]",
+                  THPrefetchFile_name(self),
+                  (THFile_isOpened(self) ? "open" : "closed"),
+                  (THFile_isReadable(self) ? 'r' : ' '),
+                  (THFile_isWritable(self) ? 'w' : ' '));
+  return 1;
+}
+
+static const struct luaL_Reg torch_PrefetchFile__ [] = {
+  {"nextBatch", torch_PrefetchFile_nextBatch},
+  {"stats", torch_PrefetchFile_stats},
+  {"__tostring__", torch_PrefetchFile___tostring__},
+  {NULL, NULL}
+};
+
+void torch_PrefetchFile_init(lua_State *L)
+{
+  luaT_newmetatable(L, "torch.PrefetchFile", "torch.File",
+                    torch_PrefetchFile_new, torch_PrefetchFile_free, NULL);
+  luaL_register(L, NULL, torch_PrefetchFile__);
+  lua_pop(L, 1);
+}
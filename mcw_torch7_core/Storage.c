@@ -3,7 +3,20 @@
 #define torch_Storage_(NAME) TH_CONCAT_4(torch_,Real,Storage_,NAME)
 #define THFile_readRealRaw TH_CONCAT_3(THFile_read, Real, Raw)
 #define THFile_writeRealRaw TH_CONCAT_3(THFile_write, Real, Raw)
+#define THFile_writeReal TH_CONCAT_2(THFile_write, Real)
 #define torch_Storage TH_CONCAT_STRING_3(torch.,Real,Storage)
 
+#define torch_realToNumber(x) ((lua_Number)(x))
+#define torch_numberToReal(x) ((real)(x))
+
 #include "generic/Storage.c"
 #include "THGenerateAllTypes.h"
+
+/* Half values are floats on the Lua side */
+#undef torch_realToNumber
+#undef torch_numberToReal
+#define torch_realToNumber(x) ((lua_Number)TH_half2float(x))
+#define torch_numberToReal(x) TH_float2half((float)(x))
+
+#include "generic/Storage.c"
+#include "THGenerateHalfType.h"
@@ -5,5 +5,17 @@
 #define torch_Tensor_(NAME) TH_CONCAT_4(torch_,Real,Tensor_,NAME)
 #define torch_Tensor TH_CONCAT_STRING_3(torch.,Real,Tensor)
 
+#define torch_realToNumber(x) ((lua_Number)(x))
+#define torch_numberToReal(x) ((real)(x))
+
 #include "generic/Tensor.c"
 #include "THGenerateAllTypes.h"
+
+/* Half values are floats on the Lua side */
+#undef torch_realToNumber
+#undef torch_numberToReal
+#define torch_realToNumber(x) ((lua_Number)TH_half2float(x))
+#define torch_numberToReal(x) TH_float2half((float)(x))
+
+#include "generic/Tensor.c"
+#include "THGenerateHalfType.h"
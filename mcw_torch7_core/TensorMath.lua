@@ -312,6 +312,31 @@ for _,Tensor in ipairs({"ByteTensor", "CharTensor",
          {name=Tensor, dim=2}}
      )
 
+   wrap("bmm",
+        cname("baddbmm"),
+        {{name=Tensor, default=true, returned=true, method={default='nil'},
+          init=function(arg)
+                  return table.concat(
+                     {
+                        arg.__metatable.init(arg),
+                        string.format("TH%s_resize3d(%s, %s->size[0], %s->size[1], %s->size[2]);", Tensor, arg:carg(), arg.args[5]:carg(), arg.args[5]:carg(), arg.args[6]:carg())
+                     }, '\n')
+               end,
+          precall=function(arg)
+                     return table.concat(
+                        {
+                           string.format("TH%s_zero(%s);", Tensor, arg:carg()),
+                           arg.__metatable.precall(arg)
+                        }, '\n')
+                  end
+       },
+         {name=real, default=1, invisible=true},
+         {name=Tensor, default=1, invisible=true},
+         {name=real, default=1, invisible=true},
+         {name=Tensor, dim=3},
+         {name=Tensor, dim=3}}
+     )
+
    wrap("ger",
         cname("addr"),
         {{name=Tensor, default=true, returned=true, method={default='nil'},
@@ -340,6 +365,7 @@ for _,Tensor in ipairs({"ByteTensor", "CharTensor",
    for _,f in ipairs({
                         {name="addmv", dim1=1, dim2=2, dim3=1},
                         {name="addmm", dim1=2, dim2=2, dim3=2},
+                        {name="baddbmm", dim1=3, dim2=3, dim3=3},
                         {name="addr",  dim1=2, dim2=1, dim3=1},
                      }
                   ) do
@@ -465,6 +491,24 @@ for _,Tensor in ipairs({"ByteTensor", "CharTensor",
          {name=Tensor},
          {name="index", default=lastdim(3)},
          {name="boolean", default=0}})
+
+   wrap("topk",
+        cname("topk"),
+        {{name=Tensor, default=true, returned=true},
+         {name="IndexTensor", default=true, returned=true, noreadadd=true},
+         {name=Tensor},
+         {name="long", default=1},
+         {name="index", default=lastdim(3)},
+         {name="boolean", default=0},
+         {name="boolean", default=1}})
+
+   wrap("kthvalue",
+        cname("kthvalue"),
+        {{name=Tensor, default=true, returned=true},
+         {name="IndexTensor", default=true, returned=true, noreadadd=true},
+         {name=Tensor},
+         {name="long"},
+         {name="index", default=lastdim(3)}})
    
    wrap("tril",
         cname("tril"),
@@ -811,6 +855,15 @@ static void THTensor_random1__(THTensor *self, THGenerator *gen, long b)
             {name="double",default=0},
             {name="double",default=0}})
 
+      wrap("histcw",
+           cname("histcw"),
+           {{name=Tensor, default=true, returned=true},
+            {name=Tensor},
+            {name=Tensor},
+            {name="long",default=100},
+            {name="double",default=0},
+            {name="double",default=0}})
+
       wrap("norm",
            cname("normall"),
            {{name=Tensor},
@@ -10,7 +10,8 @@ static int torch_Storage_(new)(lua_State *L)
     const char *fileName = luaL_checkstring(L, 1);
     int isShared = luaT_optboolean(L, 2, 0);
     long size = luaL_optlong(L, 3, 0);
-    storage = THStorage_(newWithMapping)(fileName, size, isShared);
+    long offset = luaL_optlong(L, 4, 0);
+    storage = THStorage_(newWithMappingOffset)(fileName, offset, size, isShared);
   }
   else if(lua_type(L, 1) == LUA_TTABLE)
   {
@@ -25,7 +26,7 @@ static int torch_Storage_(new)(lua_State *L)
         THStorage_(free)(storage);
         luaL_error(L, "element at index %d is not a number", i);
       }
-      THStorage_(set)(storage, i-1, (real)lua_tonumber(L, -1));
+      THStorage_(set)(storage, i-1, torch_numberToReal(lua_tonumber(L, -1)));
       lua_pop(L, 1);
     }
   }
@@ -82,6 +83,8 @@ static int torch_Storage_(copy)(lua_State *L)
     THStorage_(copyFloat)(storage, src);
   else if( (src = luaT_toudata(L, 2, "torch.DoubleStorage")) )
     THStorage_(copyDouble)(storage, src);
+  else if( (src = luaT_toudata(L, 2, "torch.HalfStorage")) )
+    THStorage_(copyHalf)(storage, src);
   else
     luaL_typerror(L, 2, "torch.*Storage");
   lua_settop(L, 1);
@@ -92,7 +95,7 @@ static int torch_Storage_(fill)(lua_State *L)
 {
   THStorage *storage = luaT_checkudata(L, 1, torch_Storage);
   double value = luaL_checknumber(L, 2);
-  THStorage_(fill)(storage, (real)value);
+  THStorage_(fill)(storage, torch_numberToReal(value));
   lua_settop(L, 1);
   return 1;
 }
@@ -111,7 +114,7 @@ static int torch_Storage_(__newindex__)(lua_State *L)
     THStorage *storage = luaT_checkudata(L, 1, torch_Storage);
     long index = luaL_checklong(L, 2) - 1;
     double number = luaL_checknumber(L, 3);
-    THStorage_(set)(storage, index, (real)number);
+    THStorage_(set)(storage, index, torch_numberToReal(number));
     lua_pushboolean(L, 1);
   }
   else
@@ -126,7 +129,7 @@ static int torch_Storage_(__index__)(lua_State *L)
   {
     THStorage *storage = luaT_checkudata(L, 1, torch_Storage);
     long index = luaL_checklong(L, 2) - 1;
-    lua_pushnumber(L, THStorage_(get)(storage, index));
+    lua_pushnumber(L, torch_realToNumber(THStorage_(get)(storage, index)));
     lua_pushboolean(L, 1);
     return 2;
   }
@@ -164,7 +167,7 @@ static int torch_Storage_(totable)(lua_State *L)
   lua_newtable(L);
   for(i = 0; i < storage->size; i++)
   {
-    lua_pushnumber(L, (lua_Number)storage->data[i]);
+    lua_pushnumber(L, torch_realToNumber(storage->data[i]));
     lua_rawseti(L, -2, i+1);
   }
   return 1;
@@ -183,7 +186,7 @@ static int torch_Storage_(write)(lua_State *L)
   THFile *file = luaT_checkudata(L, 2, "torch.File");
  
   THFile_writeLongScalar(file, storage->size);
-  THFile_writeRealRaw(file, storage->data, storage->size);
+  THFile_writeReal(file, storage);
 
   return 0;
 }
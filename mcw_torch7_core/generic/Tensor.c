@@ -133,7 +133,7 @@ static int torch_Tensor_(new)(lua_State *L)
           THTensor_(free)(tensor);
           luaL_error(L, "invalid element (not a number)");
         }
-        THStorage_(set)(THTensor_(storage)(tensor), si++, (real)lua_tonumber(L, -1));
+        THStorage_(set)(THTensor_(storage)(tensor), si++, torch_numberToReal(lua_tonumber(L, -1)));
         lua_pop(L, 1);
       }
     
@@ -369,12 +369,13 @@ static int torch_Tensor_(select)(lua_State *L)
   else
   {
     THArgCheck(tensor->nDimension == 1, 1, "empty Tensor");
-    lua_pushnumber(L, THTensor_(get1d)(tensor, sliceIndex));
+    lua_pushnumber(L, torch_realToNumber(THTensor_(get1d)(tensor, sliceIndex)));
   }
 
   return 1;
 }
 
+#if !defined(TH_REAL_IS_HALF)
 static int torch_Tensor_(indexSelect)(lua_State *L)
 {
   int narg = lua_gettop(L);
@@ -455,6 +456,7 @@ static int torch_Tensor_(indexFill)(lua_State *L)
 
   return 1;
 }
+#endif
 
 static int torch_Tensor_(transpose)(lua_State *L)
 {
@@ -547,17 +549,31 @@ static int torch_Tensor_(copy)(lua_State *L)
     THTensor_(copyFloat)(tensor, src);
   else if( (src = luaT_toudata(L, 2, "torch.DoubleTensor")) )
     THTensor_(copyDouble)(tensor, src);
+  else if( (src = luaT_toudata(L, 2, "torch.HalfTensor")) )
+    THTensor_(copyHalf)(tensor, src);
   else
     luaL_typerror(L, 2, "torch.*Tensor");
   lua_settop(L, 1);
   return 1;
 }
 
+/* THTensor_(fill) belongs to the maths, which Half does not have */
+static void torch_Tensor_(fillValue)(THTensor *tensor, real value)
+{
+#if defined(TH_REAL_IS_HALF)
+  TH_TENSOR_APPLY(real, tensor, *tensor_data = value;);
+#else
+  THTensor_(fill)(tensor, value);
+#endif
+}
+
 static int torch_Tensor_(__newindex__)(lua_State *L)
 {
   THTensor *tensor = luaT_checkudata(L, 1, torch_Tensor);
   THLongStorage *idx = NULL;
+#if !defined(TH_REAL_IS_HALF)
   THByteTensor *mask;
+#endif
 
   if(lua_isnumber(L, 2))
   {
@@ -567,14 +583,14 @@ static int torch_Tensor_(__newindex__)(lua_State *L)
     if (index < 0) index = tensor->size[0] + index + 1;
 
     if (lua_isnumber(L,3)) {
-      real value = (real)luaL_checknumber(L,3);
+      real value = torch_numberToReal(luaL_checknumber(L,3));
       if (tensor->nDimension == 1) {
         luaL_argcheck(L, index >= 0 && index < tensor->size[0], 2, "out of range");
         THStorage_(set)(tensor->storage, tensor->storageOffset+index*tensor->stride[0], value);
       } else {
         tensor = THTensor_(newWithTensor)(tensor);
         THTensor_(narrow)(tensor, NULL, 0, index, 1);
-        THTensor_(fill)(tensor, value);
+        torch_Tensor_(fillValue)(tensor, value);
         THTensor_(free)(tensor);
       }
     } else if( (src = luaT_toudata(L, 3, torch_Tensor)) ) {
@@ -617,6 +633,11 @@ static int torch_Tensor_(__newindex__)(lua_State *L)
       THTensor_(narrow)(tensor, NULL, 0, index, 1);
       THTensor_(copyDouble)(tensor, src);
       THTensor_(free)(tensor);
+    } else if( (src = luaT_toudata(L, 3, "torch.HalfTensor")) ) {
+      tensor = THTensor_(newWithTensor)(tensor);
+      THTensor_(narrow)(tensor, NULL, 0, index, 1);
+      THTensor_(copyHalf)(tensor, src);
+      THTensor_(free)(tensor);
     } else {
       luaL_typerror(L, 3, "torch.*Tensor");
     }
@@ -625,7 +646,7 @@ static int torch_Tensor_(__newindex__)(lua_State *L)
   else if((idx = luaT_toudata(L, 2, "torch.LongStorage")))
   {
     long index = THTensor_(storageOffset)(tensor);
-    real value = (real)luaL_checknumber(L,3);
+    real value = torch_numberToReal(luaL_checknumber(L,3));
     int dim;
 
     luaL_argcheck(L, idx->size == tensor->nDimension, 2, "invalid size");
@@ -660,7 +681,7 @@ static int torch_Tensor_(__newindex__)(lua_State *L)
         if (z < 0) z = tensor->size[cdim] + z + 1;
         luaL_argcheck(L, (z >= 0) && (z < tensor->size[cdim]), 2, "index out of bound");
         if(tensor->nDimension == 1) {
-          real value = (real)luaL_checknumber(L,3);
+          real value = torch_numberToReal(luaL_checknumber(L,3));
           done = 1;
           THStorage_(set)(tensor->storage, tensor->storageOffset+z*tensor->stride[0], value);
         } else {
@@ -701,7 +722,7 @@ static int torch_Tensor_(__newindex__)(lua_State *L)
       /* doing a copy */
       void *src;
       if (lua_isnumber(L,3)) {
-        THTensor_(fill)(tensor, lua_tonumber(L,3));
+        torch_Tensor_(fillValue)(tensor, torch_numberToReal(lua_tonumber(L,3)));
       } else if( (src = luaT_toudata(L, 3, torch_Tensor)) ) {
         THTensor_(copy)(tensor, src);
       } else if( (src = luaT_toudata(L, 3, "torch.ByteTensor")) ) {
@@ -718,6 +739,8 @@ static int torch_Tensor_(__newindex__)(lua_State *L)
         THTensor_(copyFloat)(tensor, src);
       } else if( (src = luaT_toudata(L, 3, "torch.DoubleTensor")) ) {
         THTensor_(copyDouble)(tensor, src);
+      } else if( (src = luaT_toudata(L, 3, "torch.HalfTensor")) ) {
+        THTensor_(copyHalf)(tensor, src);
       } else {
         luaL_typerror(L, 3, "torch.*Tensor");
       }
@@ -725,6 +748,7 @@ static int torch_Tensor_(__newindex__)(lua_State *L)
     THTensor_(free)(tensor);
     lua_pushboolean(L, 1);
   }
+#if !defined(TH_REAL_IS_HALF)
   else if((mask = luaT_toudata(L, 2, "torch.ByteTensor")))
   {
     THTensor *vals;
@@ -741,6 +765,7 @@ static int torch_Tensor_(__newindex__)(lua_State *L)
       luaL_error(L,"number or tensor expected");
     }
   }
+#endif
   else
     lua_pushboolean(L, 0);
 
@@ -751,7 +776,9 @@ static int torch_Tensor_(__index__)(lua_State *L)
 {
   THTensor *tensor = luaT_checkudata(L, 1, torch_Tensor);
   THLongStorage *idx = NULL;
+#if !defined(TH_REAL_IS_HALF)
   THByteTensor *mask;
+#endif
 
   if(lua_isnumber(L, 2))
   {
@@ -763,7 +790,7 @@ static int torch_Tensor_(__index__)(lua_State *L)
 
     if(tensor->nDimension == 1)
     {
-      lua_pushnumber(L, THStorage_(get)(tensor->storage, tensor->storageOffset+index*tensor->stride[0]));
+      lua_pushnumber(L, torch_realToNumber(THStorage_(get)(tensor->storage, tensor->storageOffset+index*tensor->stride[0])));
     }
     else
     {
@@ -788,7 +815,7 @@ static int torch_Tensor_(__index__)(lua_State *L)
       luaL_argcheck(L, (z >= 0) && (z < tensor->size[dim]), 2, "index out of bound");
       index += z*tensor->stride[dim];
     }
-    lua_pushnumber(L, (double)THStorage_(get)(THTensor_(storage)(tensor), index));
+    lua_pushnumber(L, torch_realToNumber(THStorage_(get)(THTensor_(storage)(tensor), index)));
     lua_pushboolean(L, 1);
     return 2;
   }
@@ -814,7 +841,7 @@ static int torch_Tensor_(__index__)(lua_State *L)
         luaL_argcheck(L, (z >= 0) && (z < tensor->size[cdim]), 2, "index out of bound");
         if(tensor->nDimension == 1) {
           done = 1;
-          lua_pushnumber(L, THStorage_(get)(tensor->storage, tensor->storageOffset+z*tensor->stride[0]));
+          lua_pushnumber(L, torch_realToNumber(THStorage_(get)(tensor->storage, tensor->storageOffset+z*tensor->stride[0])));
         } else {
           THTensor_(select)(tensor, NULL, cdim, z);
         }
@@ -857,6 +884,7 @@ static int torch_Tensor_(__index__)(lua_State *L)
     lua_pushboolean(L, 1);
     return 2;
   }
+#if !defined(TH_REAL_IS_HALF)
   else if((mask = luaT_toudata(L, 2, "torch.ByteTensor")))
   {
     THTensor *vals = THTensor_(new)();
@@ -865,6 +893,7 @@ static int torch_Tensor_(__index__)(lua_State *L)
     lua_pushboolean(L, 1);
     return 2;
   }
+#endif
   else
   {
     lua_pushboolean(L, 0);
@@ -1005,11 +1034,11 @@ static int torch_Tensor_(apply)(lua_State *L)
 
   TH_TENSOR_APPLY(real, tensor,
                   lua_pushvalue(L, 2);
-                  lua_pushnumber(L, *tensor_data);
+                  lua_pushnumber(L, torch_realToNumber(*tensor_data));
                   lua_call(L, 1, 1);
                   if(lua_isnumber(L, 3))
                   {
-                    *tensor_data = (real)lua_tonumber(L, 3);
+                    *tensor_data = torch_numberToReal(lua_tonumber(L, 3));
                     lua_pop(L, 1);
                   }
                   else if(lua_isnil(L, 3))
@@ -1030,12 +1059,12 @@ static int torch_Tensor_(map)(lua_State *L)
 
   TH_TENSOR_APPLY2(real, tensor, real, src,
                   lua_pushvalue(L, 3);
-                  lua_pushnumber(L, *tensor_data);
-                  lua_pushnumber(L, *src_data);
+                  lua_pushnumber(L, torch_realToNumber(*tensor_data));
+                  lua_pushnumber(L, torch_realToNumber(*src_data));
                   lua_call(L, 2, 1);
                   if(lua_isnumber(L, 4))
                   {
-                    *tensor_data = (real)lua_tonumber(L, 4);
+                    *tensor_data = torch_numberToReal(lua_tonumber(L, 4));
                     lua_pop(L, 1);
                   }
                   else if(lua_isnil(L, 4))
@@ -1057,13 +1086,13 @@ static int torch_Tensor_(map2)(lua_State *L)
 
   TH_TENSOR_APPLY3(real, tensor, real, src1, real, src2,
                   lua_pushvalue(L, 4);
-                  lua_pushnumber(L, *tensor_data);
-                  lua_pushnumber(L, *src1_data);
-                  lua_pushnumber(L, *src2_data);
+                  lua_pushnumber(L, torch_realToNumber(*tensor_data));
+                  lua_pushnumber(L, torch_realToNumber(*src1_data));
+                  lua_pushnumber(L, torch_realToNumber(*src2_data));
                   lua_call(L, 3, 1);
                   if(lua_isnumber(L, 5))
                   {
-                    *tensor_data = (real)lua_tonumber(L, 5);
+                    *tensor_data = torch_numberToReal(lua_tonumber(L, 5));
                     lua_pop(L, 1);
                   }
                   else if(lua_isnil(L, 5))
@@ -1149,9 +1178,11 @@ static const struct luaL_Reg torch_Tensor_(_) [] = {
   {"narrow", torch_Tensor_(narrow)},
   {"sub", torch_Tensor_(sub)},
   {"select", torch_Tensor_(select)},
+#if !defined(TH_REAL_IS_HALF)
   {"index", torch_Tensor_(indexSelect)},
   {"indexCopy", torch_Tensor_(indexCopy)},
   {"indexFill", torch_Tensor_(indexFill)},
+#endif
   {"transpose", torch_Tensor_(transpose)},
   {"t", torch_Tensor_(t)},
   {"unfold", torch_Tensor_(unfold)},
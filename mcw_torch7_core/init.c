@@ -7,6 +7,7 @@ extern void torch_File_init(lua_State *L);
 extern void torch_DiskFile_init(lua_State *L);
 extern void torch_MemoryFile_init(lua_State *L);
 extern void torch_PipeFile_init(lua_State *L);
+extern void torch_PrefetchFile_init(lua_State *L);
 extern void torch_Timer_init(lua_State *L);
 
 extern void torch_ByteStorage_init(lua_State *L);
@@ -16,6 +17,7 @@ extern void torch_IntStorage_init(lua_State *L);
 extern void torch_LongStorage_init(lua_State *L);
 extern void torch_FloatStorage_init(lua_State *L);
 extern void torch_DoubleStorage_init(lua_State *L);
+extern void torch_HalfStorage_init(lua_State *L);
 
 extern void torch_ByteTensor_init(lua_State *L);
 extern void torch_CharTensor_init(lua_State *L);
@@ -24,6 +26,7 @@ extern void torch_IntTensor_init(lua_State *L);
 extern void torch_LongTensor_init(lua_State *L);
 extern void torch_FloatTensor_init(lua_State *L);
 extern void torch_DoubleTensor_init(lua_State *L);
+extern void torch_HalfTensor_init(lua_State *L);
 
 extern void torch_ByteTensorOperator_init(lua_State *L);
 extern void torch_CharTensorOperator_init(lua_State *L);
@@ -67,6 +70,7 @@ int luaopen_libtorch(lua_State *L)
   torch_LongStorage_init(L);
   torch_FloatStorage_init(L);
   torch_DoubleStorage_init(L);
+  torch_HalfStorage_init(L);
 
   torch_ByteTensor_init(L);
   torch_CharTensor_init(L);
@@ -75,6 +79,7 @@ int luaopen_libtorch(lua_State *L)
   torch_LongTensor_init(L);
   torch_FloatTensor_init(L);
   torch_DoubleTensor_init(L);
+  torch_HalfTensor_init(L);
 
   torch_ByteTensorOperator_init(L);
   torch_CharTensorOperator_init(L);
@@ -88,6 +93,7 @@ int luaopen_libtorch(lua_State *L)
   torch_DiskFile_init(L);
   torch_PipeFile_init(L);
   torch_MemoryFile_init(L);
+  torch_PrefetchFile_init(L);
 
   torch_TensorMath_init(L);
 
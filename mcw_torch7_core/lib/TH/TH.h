@@ -10,6 +10,7 @@
 
 #include "THVector.h"
 #include "THLogAdd.h"
+#include "THQuantize.h"
 #include "THRandom.h"
 #include "THStorage.h"
 #include "THTensor.h"
@@ -19,5 +20,6 @@
 #include "THFile.h"
 #include "THDiskFile.h"
 #include "THMemoryFile.h"
+#include "THPrefetchFile.h"
 
 #endif
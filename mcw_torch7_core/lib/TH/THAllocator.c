@@ -38,16 +38,28 @@ struct THMapAllocatorContext_ {
   char *filename; /* file name */
   int shared; /* is shared or not */
   long size; /* mapped size */
+  long offset; /* offset of the mapping in the file */
+  long delta; /* offset - start of the page holding it */
 };
 
 THMapAllocatorContext *THMapAllocatorContext_new(const char *filename, int shared)
+{
+  return THMapAllocatorContext_newWithOffset(filename, shared, 0);
+}
+
+THMapAllocatorContext *THMapAllocatorContext_newWithOffset(const char *filename, int shared, long offset)
 {
   THMapAllocatorContext *ctx = THAlloc(sizeof(THMapAllocatorContext));
 
+  if(offset < 0)
+    THError("invalid mapping offset <%ld>", offset);
+
   ctx->filename = THAlloc(strlen(filename)+1);
   strcpy(ctx->filename, filename);
   ctx->shared = shared;
   ctx->size = 0;
+  ctx->offset = offset;
+  ctx->delta = 0;
 
   return ctx;
 }
@@ -72,8 +84,9 @@ static void *THMapAllocator_alloc(void* ctx_, long size)
   {
     HANDLE hfile;
     HANDLE hmfile;
-    DWORD size_hi, size_lo;
+    DWORD size_hi, size_lo, offset_hi, offset_lo;
     size_t hfilesz;
+    SYSTEM_INFO sysinfo;
 
     /* open file */
     /* FILE_FLAG_RANDOM_ACCESS ? */
@@ -101,16 +114,16 @@ static void *THMapAllocator_alloc(void* ctx_, long size)
 
     if(size > 0)
     {
-      if(size > hfilesz)
+      if(ctx->offset+size > hfilesz)
       {
         if(ctx->shared)
         {
 #if SIZEOF_SIZE_T > 4
-          size_hi = (DWORD)((size) >> 32);
-          size_lo = (DWORD)((size) & 0xFFFFFFFF);
+          size_hi = (DWORD)((ctx->offset+size) >> 32);
+          size_lo = (DWORD)((ctx->offset+size) & 0xFFFFFFFF);
 #else
           size_hi = 0;
-          size_lo = (DWORD)(size);
+          size_lo = (DWORD)(ctx->offset+size);
 #endif
           if((SetFilePointer(hfile, size_lo, &size_hi, FILE_BEGIN)) == INVALID_SET_FILE_POINTER)
           {
@@ -126,21 +139,36 @@ static void *THMapAllocator_alloc(void* ctx_, long size)
         else
         {
           CloseHandle(hfile);
-          THError("file <%s> size is smaller than the required mapping size <%ld>", ctx->filename, size);
+          THError("file <%s> size is smaller than the required mapping size <%ld>", ctx->filename, ctx->offset+size);
         }
       }
     }
     else
-      size = hfilesz;
+    {
+      if(ctx->offset > (long)hfilesz)
+      {
+        CloseHandle(hfile);
+        THError("mapping offset <%ld> is past the end of file <%s>", ctx->offset, ctx->filename);
+      }
+      size = hfilesz-ctx->offset;
+    }
 
     ctx->size = size; /* if we are here, it must be the right size */
 
+    /* views must start on the allocation granularity */
+    GetSystemInfo(&sysinfo);
+    ctx->delta = ctx->offset % sysinfo.dwAllocationGranularity;
+
 #if SIZEOF_SIZE_T > 4
-    size_hi = (DWORD)((ctx->size) >> 32);
-    size_lo = (DWORD)((ctx->size) & 0xFFFFFFFF);
+    size_hi = (DWORD)((ctx->offset+ctx->size) >> 32);
+    size_lo = (DWORD)((ctx->offset+ctx->size) & 0xFFFFFFFF);
+    offset_hi = (DWORD)((ctx->offset-ctx->delta) >> 32);
+    offset_lo = (DWORD)((ctx->offset-ctx->delta) & 0xFFFFFFFF);
 #else
     size_hi = 0;
-    size_lo = (DWORD)(ctx->size);
+    size_lo = (DWORD)(ctx->offset+ctx->size);
+    offset_hi = 0;
+    offset_lo = (DWORD)(ctx->offset-ctx->delta);
 #endif
 
     /* get map handle */
@@ -157,9 +185,11 @@ static void *THMapAllocator_alloc(void* ctx_, long size)
 
     /* map the stuff */
     if(ctx->shared)
-      data = MapViewOfFile(hmfile, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+      data = MapViewOfFile(hmfile, FILE_MAP_ALL_ACCESS, offset_hi, offset_lo, ctx->delta+ctx->size);
     else
-      data = MapViewOfFile(hmfile, FILE_MAP_COPY, 0, 0, 0);
+      data = MapViewOfFile(hmfile, FILE_MAP_COPY, offset_hi, offset_lo, ctx->delta+ctx->size);
+    if(data)
+      data = (char*)data + ctx->delta;
 
     CloseHandle(hfile); 
     CloseHandle(hmfile); 
@@ -187,11 +217,11 @@ static void *THMapAllocator_alloc(void* ctx_, long size)
     }
     if(size > 0)
     {
-      if(size > fdsz)
+      if(ctx->offset+size > fdsz)
       {
         if(ctx->shared)
         {
-          if((fdsz = lseek(fd, size-1, SEEK_SET)) == -1)
+          if((fdsz = lseek(fd, ctx->offset+size-1, SEEK_SET)) == -1)
           {
             close(fd);
             THError("unable to stretch file <%s> to the right size", ctx->filename);
@@ -205,26 +235,37 @@ static void *THMapAllocator_alloc(void* ctx_, long size)
         else
         {
           close(fd);
-          THError("file <%s> size is smaller than the required mapping size <%ld>", ctx->filename, size);
+          THError("file <%s> size is smaller than the required mapping size <%ld>", ctx->filename, ctx->offset+size);
         }
       }
     }
     else
-      size = fdsz;
+    {
+      if(ctx->offset > fdsz)
+      {
+        close(fd);
+        THError("mapping offset <%ld> is past the end of file <%s>", ctx->offset, ctx->filename);
+      }
+      size = fdsz-ctx->offset;
+    }
 
     ctx->size = size; /* if we are here, it must be the right size */
-    
+
+    /* mmap wants a page aligned offset */
+    ctx->delta = ctx->offset % sysconf(_SC_PAGESIZE);
+
     /* map it */
     if(ctx->shared)
-      data = mmap(NULL, ctx->size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+      data = mmap(NULL, ctx->delta+ctx->size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, ctx->offset-ctx->delta);
     else
-      data = mmap(NULL, ctx->size, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, 0);
+      data = mmap(NULL, ctx->delta+ctx->size, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, ctx->offset-ctx->delta);
 
     close(fd);
     if(data == MAP_FAILED) {
       data = NULL; /* let's be sure it is NULL */
       THError("$ Torch: unable to mmap memory: you tried to mmap %dGB.", ctx->size/1073741824);
     }
+    data = (char*)data + ctx->delta;
   }
 #endif
 
@@ -240,10 +281,10 @@ static void THMapAllocator_free(void* ctx_, void* data) {
   THMapAllocatorContext *ctx = ctx_;
 
 #ifdef _WIN32
-  if(!UnmapViewOfFile((LPINT)data))
+  if(!UnmapViewOfFile((LPINT)((char*)data - ctx->delta)))
     THError("could not unmap the shared memory file");
 #else
-  if (munmap(data, ctx->size))
+  if (munmap((char*)data - ctx->delta, ctx->delta+ctx->size))
     THError("could not unmap the shared memory file");
 #endif
 
@@ -257,6 +298,11 @@ THMapAllocatorContext *THMapAllocatorContext_new(const char *filename, int share
   return NULL;
 }
 
+THMapAllocatorContext *THMapAllocatorContext_newWithOffset(const char *filename, int shared, long offset) {
+  THError("file mapping not supported on your system");
+  return NULL;
+}
+
 void THMapAllocatorContext_free(THMapAllocatorContext *ctx) {
   THError("file mapping not supported on your system");
 }
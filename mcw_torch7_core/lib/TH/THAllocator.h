@@ -20,6 +20,8 @@ extern THAllocator THDefaultAllocator;
  */
 typedef struct THMapAllocatorContext_  THMapAllocatorContext;
 THMapAllocatorContext *THMapAllocatorContext_new(const char *filename, int shared);
+/* maps the file from byte offset on; the offset needs no alignment */
+THMapAllocatorContext *THMapAllocatorContext_newWithOffset(const char *filename, int shared, long offset);
 long THMapAllocatorContext_size(THMapAllocatorContext *ctx);
 void THMapAllocatorContext_free(THMapAllocatorContext *ctx);
 
@@ -1,4 +1,15 @@
 #include "THBlas.h"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "THVector.h"
+#include "vector/THVectorKernels.h"
+
+#if defined(USE_SSE2)
+#include <emmintrin.h>
+#endif
+
 #include "generic/THBlas.c"
 #include "THGenerateAllTypes.h"
@@ -450,7 +450,9 @@ THFile *THDiskFile_new(const char *name, const char *mode, int isQuiet)
     THDiskFile_seekEnd,
     THDiskFile_position,
     THDiskFile_close,
-    THDiskFile_free
+    THDiskFile_free,
+
+    NULL
   };
 
   int isReadable;
@@ -561,7 +563,9 @@ THFile *THPipeFile_new(const char *name, const char *mode, int isQuiet)
     THDiskFile_seekEnd,
     THDiskFile_position,
     THDiskFile_close,
-    THPipeFile_free
+    THPipeFile_free,
+
+    NULL
   };
 
   int isReadable;
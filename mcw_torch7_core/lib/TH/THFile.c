@@ -20,6 +20,16 @@ IMPLEMENT_THFILE_RW(Long, long)
 IMPLEMENT_THFILE_RW(Float, float)
 IMPLEMENT_THFILE_RW(Double, double)
 
+long THFile_readHalfRaw(THFile *self, THHalf *data, long n)
+{
+  return (*self->vtable->readShort)(self, (short*)data, n);
+}
+
+long THFile_writeHalfRaw(THFile *self, THHalf *data, long n)
+{
+  return (*self->vtable->writeShort)(self, (short*)data, n);
+}
+
 long THFile_readStringRaw(THFile *self, const char *format, char **str_)
 {
   return self->vtable->readString(self, format, str_);
@@ -134,7 +144,25 @@ IMPLEMENT_THFILE_SCALAR(Long, long)
 IMPLEMENT_THFILE_SCALAR(Float, float)
 IMPLEMENT_THFILE_SCALAR(Double, double)
 
+/* Files which can (writeShared) keep a reference to the storage instead of
+   copying it when binary */
 #define IMPLEMENT_THFILE_STORAGE(TYPEC, TYPE)                           \
+  static void THFile_retain##TYPEC##Storage(void *storage)              \
+  {                                                                     \
+    TH##TYPEC##Storage_retain(storage);                                 \
+  }                                                                     \
+                                                                        \
+  static void THFile_free##TYPEC##Storage(void *storage)                \
+  {                                                                     \
+    TH##TYPEC##Storage_free(storage);                                   \
+  }                                                                     \
+                                                                        \
+  static int THFile_check##TYPEC##Storage(void *storage_, char *data, long nByte) \
+  {                                                                     \
+    TH##TYPEC##Storage *storage = storage_;                             \
+    return (char*)storage->data == data && (long)sizeof(TYPE)*storage->size >= nByte; \
+  }                                                                     \
+                                                                        \
   long THFile_read##TYPEC(THFile *self, TH##TYPEC##Storage *storage)    \
   {                                                                     \
     return THFile_read##TYPEC##Raw(self, storage->data, storage->size); \
@@ -142,6 +170,11 @@ IMPLEMENT_THFILE_SCALAR(Double, double)
                                                                         \
   long THFile_write##TYPEC(THFile *self, TH##TYPEC##Storage *storage)   \
   {                                                                     \
+    if(self->vtable->writeShared && self->isBinary &&                   \
+       self->vtable->writeShared(self, (char*)storage->data, sizeof(TYPE)*storage->size, storage, \
+                                 THFile_retain##TYPEC##Storage, THFile_free##TYPEC##Storage, \
+                                 THFile_check##TYPEC##Storage))         \
+      return storage->size;                                             \
     return THFile_write##TYPEC##Raw(self, storage->data, storage->size); \
   }
 
@@ -152,3 +185,4 @@ IMPLEMENT_THFILE_STORAGE(Int, int)
 IMPLEMENT_THFILE_STORAGE(Long, long)
 IMPLEMENT_THFILE_STORAGE(Float, float)
 IMPLEMENT_THFILE_STORAGE(Double, double)
+IMPLEMENT_THFILE_STORAGE(Half, THHalf)
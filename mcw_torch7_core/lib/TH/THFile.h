@@ -46,6 +46,7 @@ TH_API long THFile_readInt(THFile *self, THIntStorage *storage);
 TH_API long THFile_readLong(THFile *self, THLongStorage *storage);
 TH_API long THFile_readFloat(THFile *self, THFloatStorage *storage);
 TH_API long THFile_readDouble(THFile *self, THDoubleStorage *storage);
+TH_API long THFile_readHalf(THFile *self, THHalfStorage *storage);
 
 TH_API long THFile_writeByte(THFile *self, THByteStorage *storage);
 TH_API long THFile_writeChar(THFile *self, THCharStorage *storage);
@@ -54,6 +55,7 @@ TH_API long THFile_writeInt(THFile *self, THIntStorage *storage);
 TH_API long THFile_writeLong(THFile *self, THLongStorage *storage);
 TH_API long THFile_writeFloat(THFile *self, THFloatStorage *storage);
 TH_API long THFile_writeDouble(THFile *self, THDoubleStorage *storage);
+TH_API long THFile_writeHalf(THFile *self, THHalfStorage *storage);
 
 /* raw */
 TH_API long THFile_readByteRaw(THFile *self, unsigned char *data, long n);
@@ -63,6 +65,8 @@ TH_API long THFile_readIntRaw(THFile *self, int *data, long n);
 TH_API long THFile_readLongRaw(THFile *self, long *data, long n);
 TH_API long THFile_readFloatRaw(THFile *self, float *data, long n);
 TH_API long THFile_readDoubleRaw(THFile *self, double *data, long n);
+/* halves go through as their 16 bit patterns, in ascii files too */
+TH_API long THFile_readHalfRaw(THFile *self, THHalf *data, long n);
 TH_API long THFile_readStringRaw(THFile *self, const char *format, char **str_); /* you must deallocate str_ */
 
 TH_API long THFile_writeByteRaw(THFile *self, unsigned char *data, long n);
@@ -72,6 +76,7 @@ TH_API long THFile_writeIntRaw(THFile *self, int *data, long n);
 TH_API long THFile_writeLongRaw(THFile *self, long *data, long n);
 TH_API long THFile_writeFloatRaw(THFile *self, float *data, long n);
 TH_API long THFile_writeDoubleRaw(THFile *self, double *data, long n);
+TH_API long THFile_writeHalfRaw(THFile *self, THHalf *data, long n);
 TH_API long THFile_writeStringRaw(THFile *self, const char *str, long size);
 
 TH_API void THFile_synchronize(THFile *self);
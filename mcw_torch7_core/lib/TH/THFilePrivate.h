@@ -40,4 +40,12 @@ struct THFileVTable
     long (*position)(THFile *self);
     void (*close)(THFile *self);
     void (*free)(THFile *self);
+
+    /* optional (may be NULL): stores a reference to the nByte bytes of data
+       instead of a copy, retaining owner (released with release) for as
+       long as it needs them. check(owner, data, nByte) returns 0 once owner
+       no longer holds them there (e.g. a resized storage). Returns 0 if the
+       file copies them after all. */
+    int (*writeShared)(THFile *self, char *data, long nByte, void *owner, void (*retain)(void*),
+                       void (*release)(void*), int (*check)(void*, char*, long));
 };
@@ -0,0 +1,113 @@
+#include "THHalf.h"
+#include "THVector.h"
+#include "vector/THVectorKernels.h"
+
+#include <string.h>
+
+THHalf TH_float2half(float f)
+{
+  THHalf h;
+  unsigned int x, sign;
+
+  memcpy(&x, &f, sizeof(x));
+  sign = (x >> 16) & 0x8000;
+  x &= 0x7fffffff;
+
+  if(x >= 0x7f800000)          /* inf and nan (quieted, top payload bits kept) */
+    h.x = sign | 0x7c00 | (x > 0x7f800000 ? 0x200 | ((x >> 13) & 0x3ff) : 0);
+  else if(x >= 0x477ff000)     /* 65520 and above round to inf */
+    h.x = sign | 0x7c00;
+  else if(x < 0x38800000)      /* below 2^-14: denormal half */
+  {
+    unsigned int mantissa = (x & 0x7fffff) | 0x800000;
+    int shift = 126 - (int)(x >> 23);
+    unsigned int m, rem, half;
+
+    if(shift > 24)
+      h.x = sign;
+    else
+    {
+      m = mantissa >> shift;
+      rem = mantissa & ((1u << shift) - 1);
+      half = 1u << (shift - 1);
+      if(rem > half || (rem == half && (m & 1)))
+        m++;
+      h.x = sign | m;
+    }
+  }
+  else
+  {
+    x -= 112u << 23;                /* rebias the exponent */
+    x += 0xfff + ((x >> 13) & 1);   /* round to nearest even */
+    h.x = sign | (x >> 13);
+  }
+  return h;
+}
+
+float TH_half2float(THHalf h)
+{
+  unsigned int sign = (unsigned int)(h.x & 0x8000) << 16;
+  unsigned int exponent = (h.x >> 10) & 0x1f;
+  unsigned int mantissa = h.x & 0x3ff;
+  unsigned int x;
+  float f;
+
+  if(exponent == 0x1f)          /* inf and nan (quieted, as F16C does) */
+    x = sign | 0x7f800000 | (mantissa ? 0x400000 | (mantissa << 13) : 0);
+  else if(exponent != 0)
+    x = sign | ((exponent + 112) << 23) | (mantissa << 13);
+  else if(mantissa == 0)
+    x = sign;
+  else
+  {
+    /* denormal half: normalize it */
+    exponent = 113;
+    while(!(mantissa & 0x400))
+    {
+      mantissa <<= 1;
+      exponent--;
+    }
+    x = sign | (exponent << 23) | ((mantissa & 0x3ff) << 13);
+  }
+  memcpy(&f, &x, sizeof(f));
+  return f;
+}
+
+/* F16C came with AVX2 everywhere but on a few older chips, so the AVX2
+   level of THVector (which TH_VECTOR_ISA can cap) enables it */
+static int THHalf_useF16C(void)
+{
+#if defined(TH_HALF_HAVE_F16C)
+  return THVector_getIsa() >= TH_VECTOR_AVX2;
+#else
+  return 0;
+#endif
+}
+
+void THHalf_copyFromFloat(THHalf *y, const float *x, const long n)
+{
+  long i;
+#if defined(TH_HALF_HAVE_F16C)
+  if(THHalf_useF16C())
+  {
+    THHalf_copyFromFloat_F16C(y, x, n);
+    return;
+  }
+#endif
+  for(i = 0; i < n; i++)
+    y[i] = TH_float2half(x[i]);
+}
+
+void THHalf_copyToFloat(float *y, const THHalf *x, const long n)
+{
+  long i;
+#if defined(TH_HALF_HAVE_F16C)
+  if(THHalf_useF16C())
+  {
+    THHalf_copyToFloat_F16C(y, x, n);
+    return;
+  }
+#endif
+  for(i = 0; i < n; i++)
+    y[i] = TH_half2float(x[i]);
+}
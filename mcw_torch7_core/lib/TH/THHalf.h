@@ -0,0 +1,21 @@
+#ifndef TH_HALF_INC
+#define TH_HALF_INC
+
+#include "THGeneral.h"
+
+/* IEEE 754 binary16. It is a storage format only: there is no arithmetic
+   on it, values go through float. */
+typedef struct THHalf
+{
+  unsigned short x;
+} THHalf;
+
+/* rounds to nearest even; overflows to infinity, NaNs stay NaNs */
+TH_API THHalf TH_float2half(float f);
+TH_API float TH_half2float(THHalf h);
+
+/* Bulk conversions, with F16C instructions when the CPU has them */
+TH_API void THHalf_copyFromFloat(THHalf *y, const float *x, const long n);
+TH_API void THHalf_copyToFloat(float *y, const THHalf *x, const long n);
+
+#endif
@@ -208,9 +208,12 @@ static int THMemoryFile_mode(const char *mode, int *isReadable, int *isWritable)
   }
 
 
+static int THMemoryFile_isChunked(THFile *self);
+
 THCharStorage *THMemoryFile_storage(THFile *self)
 {
   THMemoryFile *mfself = (THMemoryFile*)self;
+  THArgCheck(!THMemoryFile_isChunked(self), 1, "chunked memory files have no storage, see THMemoryFile_chunk");
   THArgCheck(mfself->storage != NULL, 1, "attempt to use a closed file");
 
   THCharStorage_resize(mfself->storage, mfself->size+1);
@@ -448,7 +451,9 @@ THFile *THMemoryFile_newWithStorage(THCharStorage *storage, const char *mode)
     THMemoryFile_seekEnd,
     THMemoryFile_position,
     THMemoryFile_close,
-    THMemoryFile_free
+    THMemoryFile_free,
+
+    NULL
   };
 
   THMemoryFile *mfself;
@@ -489,3 +494,498 @@ THFile *THMemoryFile_new(const char *mode)
 {
   return THMemoryFile_newWithStorage(NULL, mode);
 }
+
+/********************************************************/
+
+/* Chunked memory files keep the stream in a list of chunks which are never
+   reallocated: runs of written bytes in buffers of chunkSize bytes, and
+   the storages of at least THMEMORYFILE_SHARED_SIZE bytes, referenced in
+   place (see writeShared). Each chunk retains the storage holding it. */
+#define THMEMORYFILE_SHARED_SIZE (64*1024)
+
+typedef struct THMemoryFileChunk
+{
+    char *data;
+    long size;
+    long offset; /* position of data[0] in the file */
+    void *owner;
+    void (*retain)(void*);
+    void (*release)(void*);
+    int (*check)(void*, char*, long); /* NULL for the buffers of the file */
+
+} THMemoryFileChunk;
+
+typedef struct THChunkedMemoryFile__
+{
+    THFile file;
+    THMemoryFileChunk *chunks;
+    long nChunks;
+    long maxChunks;
+    long chunkSize;
+    THCharStorage *buffer; /* being filled, NULL when closed */
+    long bufferUsed;
+    long size;
+    long position;
+
+} THChunkedMemoryFile;
+
+static struct THFileVTable THChunkedMemoryFile_vtable;
+
+static int THMemoryFile_isChunked(THFile *self)
+{
+  return (self->vtable == &THChunkedMemoryFile_vtable);
+}
+
+static void THChunkedMemoryFile_retainCharStorage(void *storage)
+{
+  THCharStorage_retain(storage);
+}
+
+static void THChunkedMemoryFile_freeCharStorage(void *storage)
+{
+  THCharStorage_free(storage);
+}
+
+static THMemoryFileChunk *THChunkedMemoryFile_pushChunk(THChunkedMemoryFile *self, char *data, void *owner,
+                                                        void (*retain)(void*), void (*release)(void*),
+                                                        int (*check)(void*, char*, long))
+{
+  THMemoryFileChunk *chunk;
+
+  if(self->nChunks == self->maxChunks)
+  {
+    self->maxChunks = (self->maxChunks > 0 ? 2*self->maxChunks : 16);
+    self->chunks = THRealloc(self->chunks, sizeof(THMemoryFileChunk)*self->maxChunks);
+  }
+  retain(owner);
+  chunk = &self->chunks[self->nChunks++];
+  chunk->data = data;
+  chunk->size = 0;
+  chunk->offset = self->size;
+  chunk->owner = owner;
+  chunk->retain = retain;
+  chunk->release = release;
+  chunk->check = check;
+  return chunk;
+}
+
+/* The data of a shared chunk moves if its storage is resized */
+static THMemoryFileChunk *THChunkedMemoryFile_checkChunk(THMemoryFileChunk *chunk)
+{
+  if(chunk->check && !chunk->check(chunk->owner, chunk->data, chunk->size))
+    THError("a storage written to the chunked memory file has been resized since");
+  return chunk;
+}
+
+/* Index of the chunk holding position (< size) */
+static long THChunkedMemoryFile_findChunk(THChunkedMemoryFile *self, long position)
+{
+  long lo = 0, hi = self->nChunks-1;
+
+  while(lo < hi)
+  {
+    long mid = (lo+hi+1)/2;
+    if(self->chunks[mid].offset <= position)
+      lo = mid;
+    else
+      hi = mid-1;
+  }
+  return lo;
+}
+
+static void THChunkedMemoryFile_checkWrite(THChunkedMemoryFile *self)
+{
+  THArgCheck(self->buffer != NULL, 1, "attempt to use a closed file");
+  THArgCheck(self->file.isWritable, 1, "attempt to write in a read-only file");
+  THArgCheck(self->position == self->size, 1, "chunked memory files are only written at their end");
+}
+
+static void THChunkedMemoryFile_append(THChunkedMemoryFile *self, const char *data, long n)
+{
+  while(n > 0)
+  {
+    THMemoryFileChunk *chunk = (self->nChunks > 0 ? &self->chunks[self->nChunks-1] : NULL);
+    long nCopy;
+
+    if(self->bufferUsed == self->buffer->size)
+    {
+      THCharStorage_free(self->buffer);
+      self->buffer = THCharStorage_newWithSize(self->chunkSize);
+      self->bufferUsed = 0;
+    }
+
+    /* a new chunk unless the last one ends where the buffer is filled */
+    if(!chunk || chunk->owner != self->buffer || chunk->data+chunk->size != self->buffer->data+self->bufferUsed)
+      chunk = THChunkedMemoryFile_pushChunk(self, self->buffer->data+self->bufferUsed, self->buffer,
+                                            THChunkedMemoryFile_retainCharStorage, THChunkedMemoryFile_freeCharStorage,
+                                            NULL);
+
+    nCopy = THMin(n, self->buffer->size-self->bufferUsed);
+    memcpy(chunk->data+chunk->size, data, nCopy);
+    chunk->size += nCopy;
+    self->bufferUsed += nCopy;
+    self->size += nCopy;
+    data += nCopy;
+    n -= nCopy;
+  }
+  self->position = self->size;
+}
+
+static long THChunkedMemoryFile_read(THChunkedMemoryFile *self, char *data, long nByte)
+{
+  long nRead = 0;
+
+  THArgCheck(self->buffer != NULL, 1, "attempt to use a closed file");
+  THArgCheck(self->file.isReadable, 1, "attempt to read in a write-only file");
+
+  if(self->position < self->size)
+  {
+    long c = THChunkedMemoryFile_findChunk(self, self->position);
+    nByte = THMin(nByte, self->size-self->position);
+    while(nRead < nByte)
+    {
+      THMemoryFileChunk *chunk = THChunkedMemoryFile_checkChunk(&self->chunks[c++]);
+      long start = self->position-chunk->offset;
+      long nCopy = THMin(nByte-nRead, chunk->size-start);
+      memcpy(data+nRead, chunk->data+start, nCopy);
+      self->position += nCopy;
+      nRead += nCopy;
+    }
+  }
+  return nRead;
+}
+
+#define CHUNKED_READ_WRITE_METHODS(TYPE, TYPEC)                         \
+  static long THChunkedMemoryFile_read##TYPEC(THFile *self, TYPE *data, long n) \
+  {                                                                     \
+    THChunkedMemoryFile *cfself = (THChunkedMemoryFile*)self;           \
+    long nread;                                                         \
+                                                                        \
+    THArgCheck(cfself->file.isBinary, 1, "chunked memory files are binary"); \
+    nread = THChunkedMemoryFile_read(cfself, (char*)data, sizeof(TYPE)*n)/sizeof(TYPE); \
+    if(nread != n)                                                      \
+    {                                                                   \
+      cfself->file.hasError = 1;                                        \
+      if(!cfself->file.isQuiet)                                         \
+        THError("read error: read %d blocks instead of %d", nread, n);  \
+    }                                                                   \
+    return nread;                                                       \
+  }                                                                     \
+                                                                        \
+  static long THChunkedMemoryFile_write##TYPEC(THFile *self, TYPE *data, long n) \
+  {                                                                     \
+    THChunkedMemoryFile *cfself = (THChunkedMemoryFile*)self;           \
+                                                                        \
+    THChunkedMemoryFile_checkWrite(cfself);                             \
+    THArgCheck(cfself->file.isBinary, 1, "chunked memory files are binary"); \
+    THChunkedMemoryFile_append(cfself, (const char*)data, sizeof(TYPE)*n); \
+    return n;                                                           \
+  }
+
+CHUNKED_READ_WRITE_METHODS(unsigned char, Byte)
+CHUNKED_READ_WRITE_METHODS(char, Char)
+CHUNKED_READ_WRITE_METHODS(short, Short)
+CHUNKED_READ_WRITE_METHODS(int, Int)
+CHUNKED_READ_WRITE_METHODS(long, Long)
+CHUNKED_READ_WRITE_METHODS(float, Float)
+CHUNKED_READ_WRITE_METHODS(double, Double)
+
+static long THChunkedMemoryFile_readString(THFile *self, const char *format, char **str_)
+{
+  THChunkedMemoryFile *cfself = (THChunkedMemoryFile*)self;
+  long str_size;
+
+  THArgCheck(cfself->buffer != NULL, 1, "attempt to use a closed file");
+  THArgCheck(cfself->file.isReadable, 1, "attempt to read in a write-only file");
+  THArgCheck((strlen(format) >= 2 ? (format[0] == '*') && (format[1] == 'a' || format[1] == 'l') : 0), 2, "format must be '*a' or '*l'");
+
+  if(cfself->position == cfself->size) /* eof ? */
+  {
+    cfself->file.hasError = 1;
+    if(!cfself->file.isQuiet)
+      THError("read error: read 0 blocks instead of 1");
+
+    *str_ = NULL;
+    return 0;
+  }
+
+  str_size = cfself->size-cfself->position;
+  if(format[1] == 'l')
+  {
+    long c = THChunkedMemoryFile_findChunk(cfself, cfself->position);
+    long position = cfself->position;
+    for(; c < cfself->nChunks; c++)
+    {
+      THMemoryFileChunk *chunk = THChunkedMemoryFile_checkChunk(&cfself->chunks[c]);
+      char *eol = memchr(chunk->data+(position-chunk->offset), '\n', chunk->offset+chunk->size-position);
+      if(eol)
+      {
+        str_size = chunk->offset+(eol-chunk->data)-cfself->position;
+        break;
+      }
+      position = chunk->offset+chunk->size;
+    }
+  }
+
+  *str_ = THAlloc(str_size);
+  THChunkedMemoryFile_read(cfself, *str_, str_size);
+  if(format[1] == 'l' && cfself->position < cfself->size)
+    cfself->position++; /* the '\n' */
+
+  return str_size;
+}
+
+static long THChunkedMemoryFile_writeString(THFile *self, const char *str, long size)
+{
+  THChunkedMemoryFile *cfself = (THChunkedMemoryFile*)self;
+
+  THChunkedMemoryFile_checkWrite(cfself);
+  THChunkedMemoryFile_append(cfself, str, size);
+  return size;
+}
+
+static int THChunkedMemoryFile_writeShared(THFile *self, char *data, long nByte, void *owner, void (*retain)(void*),
+                                           void (*release)(void*), int (*check)(void*, char*, long))
+{
+  THChunkedMemoryFile *cfself = (THChunkedMemoryFile*)self;
+
+  if(nByte < THMEMORYFILE_SHARED_SIZE)
+    return 0;
+
+  THChunkedMemoryFile_checkWrite(cfself);
+  THChunkedMemoryFile_pushChunk(cfself, data, owner, retain, release, check)->size = nByte;
+  cfself->size += nByte;
+  cfself->position = cfself->size;
+  return 1;
+}
+
+static int THChunkedMemoryFile_isOpened(THFile *self)
+{
+  THChunkedMemoryFile *cfself = (THChunkedMemoryFile*)self;
+  return (cfself->buffer != NULL);
+}
+
+static void THChunkedMemoryFile_synchronize(THFile *self)
+{
+  THChunkedMemoryFile *cfself = (THChunkedMemoryFile*)self;
+  THArgCheck(cfself->buffer != NULL, 1, "attempt to use a closed file");
+}
+
+static void THChunkedMemoryFile_seek(THFile *self, long position)
+{
+  THChunkedMemoryFile *cfself = (THChunkedMemoryFile*)self;
+
+  THArgCheck(cfself->buffer != NULL, 1, "attempt to use a closed file");
+  THArgCheck(position >= 0, 2, "position must be positive");
+
+  if(position <= cfself->size)
+    cfself->position = position;
+  else
+  {
+    cfself->file.hasError = 1;
+    if(!cfself->file.isQuiet)
+      THError("unable to seek at position %d", position);
+  }
+}
+
+static void THChunkedMemoryFile_seekEnd(THFile *self)
+{
+  THChunkedMemoryFile *cfself = (THChunkedMemoryFile*)self;
+  THArgCheck(cfself->buffer != NULL, 1, "attempt to use a closed file");
+
+  cfself->position = cfself->size;
+}
+
+static long THChunkedMemoryFile_position(THFile *self)
+{
+  THChunkedMemoryFile *cfself = (THChunkedMemoryFile*)self;
+  THArgCheck(cfself->buffer != NULL, 1, "attempt to use a closed file");
+  return cfself->position;
+}
+
+static void THChunkedMemoryFile_release(THChunkedMemoryFile *self)
+{
+  long c;
+
+  for(c = 0; c < self->nChunks; c++)
+    self->chunks[c].release(self->chunks[c].owner);
+  THFree(self->chunks);
+  self->chunks = NULL;
+  self->nChunks = 0;
+  self->maxChunks = 0;
+  THCharStorage_free(self->buffer);
+  self->buffer = NULL;
+}
+
+static void THChunkedMemoryFile_close(THFile *self)
+{
+  THChunkedMemoryFile *cfself = (THChunkedMemoryFile*)self;
+  THArgCheck(cfself->buffer != NULL, 1, "attempt to use a closed file");
+  THChunkedMemoryFile_release(cfself);
+}
+
+static void THChunkedMemoryFile_free(THFile *self)
+{
+  THChunkedMemoryFile *cfself = (THChunkedMemoryFile*)self;
+
+  if(cfself->buffer)
+    THChunkedMemoryFile_release(cfself);
+
+  THFree(cfself);
+}
+
+static struct THFileVTable THChunkedMemoryFile_vtable = {
+  THChunkedMemoryFile_isOpened,
+
+  THChunkedMemoryFile_readByte,
+  THChunkedMemoryFile_readChar,
+  THChunkedMemoryFile_readShort,
+  THChunkedMemoryFile_readInt,
+  THChunkedMemoryFile_readLong,
+  THChunkedMemoryFile_readFloat,
+  THChunkedMemoryFile_readDouble,
+  THChunkedMemoryFile_readString,
+
+  THChunkedMemoryFile_writeByte,
+  THChunkedMemoryFile_writeChar,
+  THChunkedMemoryFile_writeShort,
+  THChunkedMemoryFile_writeInt,
+  THChunkedMemoryFile_writeLong,
+  THChunkedMemoryFile_writeFloat,
+  THChunkedMemoryFile_writeDouble,
+  THChunkedMemoryFile_writeString,
+
+  THChunkedMemoryFile_synchronize,
+  THChunkedMemoryFile_seek,
+  THChunkedMemoryFile_seekEnd,
+  THChunkedMemoryFile_position,
+  THChunkedMemoryFile_close,
+  THChunkedMemoryFile_free,
+
+  THChunkedMemoryFile_writeShared
+};
+
+THFile *THMemoryFile_newChunked(const char *mode, long chunkSize)
+{
+  THChunkedMemoryFile *cfself;
+  int isReadable;
+  int isWritable;
+
+  THArgCheck(THMemoryFile_mode(mode, &isReadable, &isWritable), 1, "file mode should be 'r','w' or 'rw'");
+  THArgCheck(chunkSize > 0, 2, "chunk size must be positive");
+
+  cfself = THAlloc(sizeof(THChunkedMemoryFile));
+
+  cfself->chunks = NULL;
+  cfself->nChunks = 0;
+  cfself->maxChunks = 0;
+  cfself->chunkSize = chunkSize;
+  cfself->buffer = THCharStorage_newWithSize(chunkSize);
+  cfself->bufferUsed = 0;
+  cfself->size = 0;
+  cfself->position = 0;
+
+  cfself->file.vtable = &THChunkedMemoryFile_vtable;
+  cfself->file.isQuiet = 0;
+  cfself->file.isReadable = isReadable;
+  cfself->file.isWritable = isWritable;
+  cfself->file.isBinary = 1;
+  cfself->file.isAutoSpacing = 0;
+  cfself->file.hasError = 0;
+
+  return (THFile*)cfself;
+}
+
+long THMemoryFile_nChunks(THFile *self)
+{
+  if(THMemoryFile_isChunked(self))
+  {
+    THChunkedMemoryFile *cfself = (THChunkedMemoryFile*)self;
+    THArgCheck(cfself->buffer != NULL, 1, "attempt to use a closed file");
+    return cfself->nChunks;
+  }
+  else
+  {
+    THMemoryFile *mfself = (THMemoryFile*)self;
+    THArgCheck(mfself->storage != NULL, 1, "attempt to use a closed file");
+    return (mfself->size > 0 ? 1 : 0);
+  }
+}
+
+char *THMemoryFile_chunk(THFile *self, long index, long *size)
+{
+  THArgCheck(index >= 0 && index < THMemoryFile_nChunks(self), 2, "out of range");
+
+  if(THMemoryFile_isChunked(self))
+  {
+    THMemoryFileChunk *chunk = THChunkedMemoryFile_checkChunk(&((THChunkedMemoryFile*)self)->chunks[index]);
+    *size = chunk->size;
+    return chunk->data;
+  }
+  else
+  {
+    THMemoryFile *mfself = (THMemoryFile*)self;
+    *size = mfself->size;
+    return mfself->storage->data;
+  }
+}
+
+/* The storage of a chunk view is not resizable; freeing it releases the
+   owner of the chunk. */
+typedef struct THMemoryFileChunkView
+{
+    void *owner;
+    void (*release)(void*);
+
+} THMemoryFileChunkView;
+
+static void *THMemoryFileChunkView_malloc(void *ctx, long size)
+{
+  THError("chunk views cannot be allocated");
+  return NULL;
+}
+
+static void *THMemoryFileChunkView_realloc(void *ctx, void *ptr, long size)
+{
+  THError("chunk views cannot be resized");
+  return NULL;
+}
+
+static void THMemoryFileChunkView_free(void *ctx, void *ptr)
+{
+  THMemoryFileChunkView *view = ctx;
+  view->release(view->owner);
+  THFree(view);
+}
+
+static THAllocator THMemoryFileChunkView_allocator = {
+  THMemoryFileChunkView_malloc,
+  THMemoryFileChunkView_realloc,
+  THMemoryFileChunkView_free
+};
+
+THCharStorage *THMemoryFile_chunkStorage(THFile *self, long index)
+{
+  long size;
+  char *data = THMemoryFile_chunk(self, index, &size);
+  THMemoryFileChunk *chunk;
+  THMemoryFileChunkView *view;
+  THCharStorage *storage;
+
+  /* the storage of a plain memory file moves when it grows: copy it */
+  if(!THMemoryFile_isChunked(self))
+  {
+    storage = THCharStorage_newWithSize(size);
+    memcpy(storage->data, data, size);
+    return storage;
+  }
+
+  chunk = &((THChunkedMemoryFile*)self)->chunks[index];
+  chunk->retain(chunk->owner);
+  view = THAlloc(sizeof(THMemoryFileChunkView));
+  view->owner = chunk->owner;
+  view->release = chunk->release;
+  storage = THCharStorage_newWithDataAndAllocator(data, size, &THMemoryFileChunkView_allocator, view);
+  THCharStorage_clearFlag(storage, TH_STORAGE_RESIZABLE);
+  return storage;
+}
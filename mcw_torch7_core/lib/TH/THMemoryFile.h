@@ -9,4 +9,23 @@ TH_API THFile *THMemoryFile_new(const char *mode);
 
 TH_API THCharStorage *THMemoryFile_storage(THFile *self);
 
+/* Binary memory file kept in chunks which are never reallocated: buffers
+   of chunkSize bytes, and the large storages written with
+   THFile_write<Type>, which are referenced instead of copied. Such a
+   storage must be neither modified nor resized while the file, or a
+   chunkStorage view of it, is alive: reading a chunk whose storage has
+   been resized raises an error, a view is not checked. It can only be
+   written at its end, and has no storage. */
+TH_API THFile *THMemoryFile_newChunked(const char *mode, long chunkSize);
+
+/* The chunks of the file, in order (a plain memory file has one, its
+   storage, which moves when the file grows) */
+TH_API long THMemoryFile_nChunks(THFile *self);
+TH_API char *THMemoryFile_chunk(THFile *self, long index, long *size);
+
+/* A storage viewing the chunk of a chunked file, which keeps its data
+   alive (see above for shared storages). For a plain memory file, whose
+   storage moves when it grows, a copy of the chunk. */
+TH_API THCharStorage *THMemoryFile_chunkStorage(THFile *self, long index);
+
 #endif
@@ -0,0 +1,638 @@
+#include "THGeneral.h"
+#include "THPrefetchFile.h"
+#include "THFilePrivate.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <io.h>
+#include <time.h>
+#else
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/time.h>
+#define TH_PREFETCH_THREADS
+#endif
+
+/* A slot of the ring holds block b of the file (bytes b*blockSize on)
+   when FULL; block b always goes to slot b % nSlots. The threads fill
+   the EMPTY slots in block order, the reader empties a slot once it has
+   read past its block. */
+enum { TH_PREFETCH_EMPTY, TH_PREFETCH_FILLING, TH_PREFETCH_FULL };
+
+typedef struct THPrefetchSlot
+{
+    char *data;
+    long block;
+    long size;
+    int state;
+} THPrefetchSlot;
+
+/* The memory of all the slots. It is referenced by the file until it is
+   closed, and by each storage viewing a batch (see THPrefetchBatchAllocator),
+   and freed with the last reference. */
+typedef struct THPrefetchRing
+{
+    char *data;
+    int refcount;
+} THPrefetchRing;
+
+typedef struct THPrefetchFile__
+{
+    THFile file;
+
+    int fd;
+    char *name;
+    long fileSize;
+    long blockSize;
+
+    int nSlots;
+    THPrefetchSlot *slots;
+    THPrefetchRing *ring;
+    long position;
+    long heldBlock; /* handed over by nextBatch, -1 if none */
+    long nextBlock; /* next block to fetch */
+    long generation; /* bumped by seeks, drops the blocks in flight */
+
+    int stop;
+    int nThreads;
+    THPrefetchFileStats stats;
+    double startTime;
+#ifdef TH_PREFETCH_THREADS
+    pthread_t *threads;
+    pthread_mutex_t mutex;
+    pthread_cond_t filled;
+    pthread_cond_t freed;
+#endif
+
+} THPrefetchFile;
+
+#ifdef TH_PREFETCH_THREADS
+#define THPrefetchFile_lock(self) pthread_mutex_lock(&(self)->mutex)
+#define THPrefetchFile_unlock(self) pthread_mutex_unlock(&(self)->mutex)
+#define THPrefetchFile_wait(self, cond) pthread_cond_wait(&(self)->cond, &(self)->mutex)
+#define THPrefetchFile_broadcast(self, cond) pthread_cond_broadcast(&(self)->cond)
+#else
+#define THPrefetchFile_lock(self)
+#define THPrefetchFile_unlock(self)
+#define THPrefetchFile_wait(self, cond)
+#define THPrefetchFile_broadcast(self, cond)
+#endif
+
+static double THPrefetchFile_now(void)
+{
+#ifdef _WIN32
+  return (double)clock()/CLOCKS_PER_SEC;
+#else
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec*1e-6;
+#endif
+}
+
+static void THPrefetchRing_release(THPrefetchRing *ring)
+{
+  if(--ring->refcount == 0)
+  {
+    THFree(ring->data);
+    THFree(ring);
+  }
+}
+
+static void *THPrefetchBatchAllocator_alloc(void *ctx, long size)
+{
+  THError("cannot allocate the batch of a prefetch file");
+  return NULL;
+}
+
+static void *THPrefetchBatchAllocator_realloc(void *ctx, void *ptr, long size)
+{
+  THError("cannot resize the batch of a prefetch file");
+  return NULL;
+}
+
+static void THPrefetchBatchAllocator_free(void *ctx, void *ptr)
+{
+  THPrefetchRing_release((THPrefetchRing*)ctx);
+}
+
+THAllocator THPrefetchBatchAllocator = {
+  &THPrefetchBatchAllocator_alloc,
+  &THPrefetchBatchAllocator_realloc,
+  &THPrefetchBatchAllocator_free
+};
+
+static long THPrefetchFile_pread(THPrefetchFile *self, char *data, long size, long offset)
+{
+  long n = 0;
+  while(n < size)
+  {
+#ifdef _WIN32
+    long r = -1;
+    if(_lseeki64(self->fd, offset+n, SEEK_SET) >= 0)
+      r = _read(self->fd, data+n, (unsigned int)(size-n));
+#else
+    long r = (long)pread(self->fd, data+n, size-n, offset+n);
+#endif
+    if(r < 0 && errno == EINTR)
+      continue;
+    if(r <= 0)
+      break;
+    n += r;
+  }
+  return n;
+}
+
+/* Reads block b into its (claimed) slot. Called with the lock held, which
+   is released during the read. */
+static void THPrefetchFile_fill(THPrefetchFile *self, long b)
+{
+  THPrefetchSlot *slot = &self->slots[b % self->nSlots];
+  long generation = self->generation;
+  long offset = b*self->blockSize;
+  long n;
+
+  slot->state = TH_PREFETCH_FILLING;
+  slot->block = b;
+  THPrefetchFile_unlock(self);
+
+  n = THPrefetchFile_pread(self, slot->data, THMin(self->blockSize, self->fileSize-offset), offset);
+#ifdef POSIX_FADV_WILLNEED
+  /* the kernel can start on the block that will replace this one */
+  posix_fadvise(self->fd, offset+self->nSlots*self->blockSize, self->blockSize, POSIX_FADV_WILLNEED);
+#endif
+
+  THPrefetchFile_lock(self);
+  if(generation != self->generation)
+  {
+    slot->state = TH_PREFETCH_EMPTY;
+    THPrefetchFile_broadcast(self, freed);
+  }
+  else
+  {
+    slot->size = n;
+    slot->state = TH_PREFETCH_FULL;
+    self->stats.bytesFetched += n;
+    THPrefetchFile_broadcast(self, filled);
+  }
+}
+
+#ifdef TH_PREFETCH_THREADS
+static void *THPrefetchFile_thread(void *arg)
+{
+  THPrefetchFile *self = arg;
+
+  THPrefetchFile_lock(self);
+  while(!self->stop)
+  {
+    long b = self->nextBlock;
+    if(b*self->blockSize >= self->fileSize)
+      THPrefetchFile_wait(self, freed);
+    else if(self->slots[b % self->nSlots].state != TH_PREFETCH_EMPTY)
+    {
+      double start = THPrefetchFile_now();
+      THPrefetchFile_wait(self, freed);
+      self->stats.idleSeconds += THPrefetchFile_now()-start;
+    }
+    else
+    {
+      self->nextBlock++;
+      THPrefetchFile_fill(self, b);
+    }
+  }
+  THPrefetchFile_unlock(self);
+  return NULL;
+}
+#endif
+
+/* Returns the slot holding block b, waiting for it (or reading it without
+   threads). Called with the lock held. */
+static THPrefetchSlot *THPrefetchFile_acquire(THPrefetchFile *self, long b)
+{
+  THPrefetchSlot *slot = &self->slots[b % self->nSlots];
+  double start;
+
+  if(slot->state == TH_PREFETCH_FULL && slot->block == b)
+    return slot;
+
+  start = THPrefetchFile_now();
+  self->stats.nStalls++;
+  if(self->nThreads == 0)
+  {
+    self->nextBlock = b+1;
+    THPrefetchFile_fill(self, b);
+  }
+  while(!(slot->state == TH_PREFETCH_FULL && slot->block == b))
+    THPrefetchFile_wait(self, filled);
+  self->stats.stallSeconds += THPrefetchFile_now()-start;
+  return slot;
+}
+
+static void THPrefetchFile_release(THPrefetchFile *self, long b)
+{
+  THPrefetchSlot *slot = &self->slots[b % self->nSlots];
+  if(slot->state == TH_PREFETCH_FULL && slot->block == b)
+  {
+    slot->state = TH_PREFETCH_EMPTY;
+    THPrefetchFile_broadcast(self, freed);
+  }
+}
+
+static void THPrefetchFile_releaseHeld(THPrefetchFile *self)
+{
+  if(self->heldBlock >= 0)
+  {
+    THPrefetchFile_release(self, self->heldBlock);
+    self->heldBlock = -1;
+  }
+}
+
+static long THPrefetchFile_readBytes(THPrefetchFile *self, char *data, long n)
+{
+  long nread = 0;
+
+  THPrefetchFile_lock(self);
+  THPrefetchFile_releaseHeld(self);
+  while(nread < n && self->position < self->fileSize)
+  {
+    long b = self->position/self->blockSize;
+    long offset = self->position%self->blockSize;
+    THPrefetchSlot *slot = THPrefetchFile_acquire(self, b);
+    long m;
+
+    if(offset >= slot->size) /* short read from the disk */
+      break;
+    m = THMin(n-nread, slot->size-offset);
+
+    /* the slot stays FULL until we release it */
+    THPrefetchFile_unlock(self);
+    memcpy(data+nread, slot->data+offset, m);
+    THPrefetchFile_lock(self);
+
+    nread += m;
+    self->position += m;
+    self->stats.bytesRead += m;
+    if(offset+m == slot->size)
+      THPrefetchFile_release(self, b);
+  }
+  THPrefetchFile_unlock(self);
+  return nread;
+}
+
+static int THPrefetchFile_isOpened(THFile *self)
+{
+  THPrefetchFile *pfself = (THPrefetchFile*)self;
+  return (pfself->fd >= 0);
+}
+
+const char *THPrefetchFile_name(THFile *self)
+{
+  THPrefetchFile *pfself = (THPrefetchFile*)self;
+  return pfself->name;
+}
+
+#define READ_WRITE_METHODS(TYPE, TYPEC)                                 \
+  static long THPrefetchFile_read##TYPEC(THFile *self, TYPE *data, long n) \
+  {                                                                     \
+    THPrefetchFile *pfself = (THPrefetchFile*)(self);                   \
+    long nread;                                                         \
+                                                                        \
+    THArgCheck(pfself->fd >= 0, 1, "attempt to use a closed file");     \
+    THArgCheck(pfself->file.isBinary, 1, "a prefetch file can only be read in binary mode"); \
+                                                                        \
+    nread = THPrefetchFile_readBytes(pfself, (char*)data, sizeof(TYPE)*n)/sizeof(TYPE); \
+    if(nread != n)                                                      \
+    {                                                                   \
+      pfself->file.hasError = 1;                                        \
+      if(!pfself->file.isQuiet)                                         \
+        THError("read error: read %ld blocks instead of %ld", nread, n); \
+    }                                                                   \
+    return nread;                                                       \
+  }                                                                     \
+                                                                        \
+  static long THPrefetchFile_write##TYPEC(THFile *self, TYPE *data, long n) \
+  {                                                                     \
+    THArgCheck(0, 1, "attempt to write in a read-only file");           \
+    return 0;                                                           \
+  }
+
+READ_WRITE_METHODS(unsigned char, Byte)
+READ_WRITE_METHODS(char, Char)
+READ_WRITE_METHODS(short, Short)
+READ_WRITE_METHODS(int, Int)
+READ_WRITE_METHODS(long, Long)
+READ_WRITE_METHODS(float, Float)
+READ_WRITE_METHODS(double, Double)
+
+static long THPrefetchFile_readString(THFile *self, const char *format, char **str_)
+{
+  THPrefetchFile *pfself = (THPrefetchFile*)(self);
+  char *p = NULL;
+  long pos = 0L;
+
+  THArgCheck(pfself->fd >= 0, 1, "attempt to use a closed file");
+  THArgCheck((strlen(format) >= 2 ? (format[0] == '*') && (format[1] == 'a' || format[1] == 'l') : 0), 2, "format must be '*a' or '*l'");
+
+  if(format[1] == 'a')
+  {
+    long size = pfself->fileSize-pfself->position;
+    if(size > 0)
+    {
+      p = THAlloc(size);
+      pos = THPrefetchFile_readBytes(pfself, p, size);
+    }
+  }
+  else
+  {
+    long total = 0L;
+    char c;
+    while(THPrefetchFile_readBytes(pfself, &c, 1) == 1)
+    {
+      if(pos == total)
+      {
+        total += 1024L;
+        p = THRealloc(p, total);
+      }
+      if(c == '\n')
+      {
+        if(pos == 0L) /* an empty line is not an end of file */
+          p[pos++] = c;
+        break;
+      }
+      p[pos++] = c;
+    }
+    if(pos == 1L && p[0] == '\n')
+      pos = 0L;
+    else if(pos == 0L)
+    {
+      THFree(p);
+      p = NULL;
+    }
+  }
+
+  if(!p)
+  {
+    pfself->file.hasError = 1;
+    if(!pfself->file.isQuiet)
+      THError("read error: read 0 blocks instead of 1");
+    *str_ = NULL;
+    return 0;
+  }
+  *str_ = p;
+  return pos;
+}
+
+static long THPrefetchFile_writeString(THFile *self, const char *str, long size)
+{
+  THArgCheck(0, 1, "attempt to write in a read-only file");
+  return 0;
+}
+
+static void THPrefetchFile_synchronize(THFile *self)
+{
+}
+
+static void THPrefetchFile_seek(THFile *self, long position)
+{
+  THPrefetchFile *pfself = (THPrefetchFile*)(self);
+  int i;
+
+  THArgCheck(pfself->fd >= 0, 1, "attempt to use a closed file");
+  THArgCheck(position >= 0, 2, "position must be positive");
+
+  THPrefetchFile_lock(pfself);
+  pfself->heldBlock = -1;
+  pfself->generation++;
+  for(i = 0; i < pfself->nSlots; i++)
+  {
+    if(pfself->slots[i].state == TH_PREFETCH_FULL)
+      pfself->slots[i].state = TH_PREFETCH_EMPTY;
+  }
+  pfself->position = THMin(position, pfself->fileSize);
+  pfself->nextBlock = pfself->position/pfself->blockSize;
+  THPrefetchFile_broadcast(pfself, freed);
+  THPrefetchFile_unlock(pfself);
+}
+
+static void THPrefetchFile_seekEnd(THFile *self)
+{
+  THPrefetchFile *pfself = (THPrefetchFile*)(self);
+  THPrefetchFile_seek(self, pfself->fileSize);
+}
+
+static long THPrefetchFile_position(THFile *self)
+{
+  THPrefetchFile *pfself = (THPrefetchFile*)(self);
+  THArgCheck(pfself->fd >= 0, 1, "attempt to use a closed file");
+  return pfself->position;
+}
+
+static void THPrefetchFile_close(THFile *self)
+{
+  THPrefetchFile *pfself = (THPrefetchFile*)(self);
+  int i;
+
+  THArgCheck(pfself->fd >= 0, 1, "attempt to use a closed file");
+
+#ifdef TH_PREFETCH_THREADS
+  THPrefetchFile_lock(pfself);
+  pfself->stop = 1;
+  THPrefetchFile_broadcast(pfself, freed);
+  THPrefetchFile_unlock(pfself);
+  for(i = 0; i < pfself->nThreads; i++)
+    pthread_join(pfself->threads[i], NULL);
+  THFree(pfself->threads);
+  pthread_mutex_destroy(&pfself->mutex);
+  pthread_cond_destroy(&pfself->filled);
+  pthread_cond_destroy(&pfself->freed);
+#endif
+
+  /* the batches still viewed keep the ring alive */
+  THPrefetchRing_release(pfself->ring);
+  pfself->ring = NULL;
+  THFree(pfself->slots);
+  pfself->slots = NULL;
+
+  close(pfself->fd);
+  pfself->fd = -1;
+}
+
+static void THPrefetchFile_free(THFile *self)
+{
+  THPrefetchFile *pfself = (THPrefetchFile*)(self);
+  if(pfself->fd >= 0)
+    THPrefetchFile_close(self);
+  THFree(pfself->name);
+  THFree(pfself);
+}
+
+char *THPrefetchFile_nextBatch(THFile *self, long *size)
+{
+  THPrefetchFile *pfself = (THPrefetchFile*)(self);
+  char *data = NULL;
+
+  THArgCheck(pfself->fd >= 0, 1, "attempt to use a closed file");
+
+  *size = 0;
+  THPrefetchFile_lock(pfself);
+  THPrefetchFile_releaseHeld(pfself);
+  if(pfself->position < pfself->fileSize)
+  {
+    long b = pfself->position/pfself->blockSize;
+    long offset = pfself->position%pfself->blockSize;
+    THPrefetchSlot *slot = THPrefetchFile_acquire(pfself, b);
+
+    if(offset < slot->size)
+    {
+      data = slot->data+offset;
+      *size = slot->size-offset;
+      pfself->position += *size;
+      pfself->stats.bytesRead += *size;
+      pfself->heldBlock = b;
+    }
+    else
+      pfself->file.hasError = 1;
+  }
+  THPrefetchFile_unlock(pfself);
+  return data;
+}
+
+void *THPrefetchFile_retainBatch(THFile *self)
+{
+  THPrefetchFile *pfself = (THPrefetchFile*)(self);
+
+  THArgCheck(pfself->fd >= 0, 1, "attempt to use a closed file");
+  pfself->ring->refcount++;
+  return pfself->ring;
+}
+
+void THPrefetchFile_stats(THFile *self, THPrefetchFileStats *stats)
+{
+  THPrefetchFile *pfself = (THPrefetchFile*)(self);
+
+  THArgCheck(pfself->fd >= 0, 1, "attempt to use a closed file");
+  THPrefetchFile_lock(pfself);
+  *stats = pfself->stats;
+  THPrefetchFile_unlock(pfself);
+  stats->seconds = THPrefetchFile_now()-pfself->startTime;
+}
+
+THFile *THPrefetchFile_new(const char *name, long blockSize, int nBlocks, int nThreads, int isQuiet)
+{
+  static struct THFileVTable vtable = {
+    THPrefetchFile_isOpened,
+
+    THPrefetchFile_readByte,
+    THPrefetchFile_readChar,
+    THPrefetchFile_readShort,
+    THPrefetchFile_readInt,
+    THPrefetchFile_readLong,
+    THPrefetchFile_readFloat,
+    THPrefetchFile_readDouble,
+    THPrefetchFile_readString,
+
+    THPrefetchFile_writeByte,
+    THPrefetchFile_writeChar,
+    THPrefetchFile_writeShort,
+    THPrefetchFile_writeInt,
+    THPrefetchFile_writeLong,
+    THPrefetchFile_writeFloat,
+    THPrefetchFile_writeDouble,
+    THPrefetchFile_writeString,
+
+    THPrefetchFile_synchronize,
+    THPrefetchFile_seek,
+    THPrefetchFile_seekEnd,
+    THPrefetchFile_position,
+    THPrefetchFile_close,
+    THPrefetchFile_free,
+
+    NULL
+  };
+
+  THPrefetchFile *self;
+  int fd, i;
+
+  THArgCheck(blockSize > 0, 2, "block size must be positive");
+  THArgCheck(nBlocks > 0, 3, "at least one block expected");
+  THArgCheck(nThreads >= 0, 4, "number of threads must be positive or zero");
+
+#ifdef _WIN32
+  fd = _open(name, _O_RDONLY | _O_BINARY);
+#else
+  fd = open(name, O_RDONLY);
+#endif
+  if(fd < 0)
+  {
+    if(isQuiet)
+      return 0;
+    else
+      THError("cannot open <%s> in mode r", name);
+  }
+#ifdef POSIX_FADV_SEQUENTIAL
+  posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+  self = THAlloc(sizeof(THPrefetchFile));
+  self->fd = fd;
+  self->name = THAlloc(strlen(name)+1);
+  strcpy(self->name, name);
+#ifdef _WIN32
+  self->fileSize = (long)_lseeki64(fd, 0, SEEK_END);
+#else
+  self->fileSize = (long)lseek(fd, 0, SEEK_END);
+#endif
+  self->blockSize = blockSize;
+
+  self->nSlots = nBlocks;
+  self->ring = THAlloc(sizeof(THPrefetchRing));
+  self->ring->data = THAlloc(blockSize*nBlocks);
+  self->ring->refcount = 1;
+  self->slots = THAlloc(sizeof(THPrefetchSlot)*nBlocks);
+  for(i = 0; i < nBlocks; i++)
+  {
+    self->slots[i].data = self->ring->data + i*blockSize;
+    self->slots[i].block = -1;
+    self->slots[i].size = 0;
+    self->slots[i].state = TH_PREFETCH_EMPTY;
+  }
+  self->position = 0;
+  self->heldBlock = -1;
+  self->nextBlock = 0;
+  self->generation = 0;
+  self->stop = 0;
+  memset(&self->stats, 0, sizeof(THPrefetchFileStats));
+  self->startTime = THPrefetchFile_now();
+
+  self->file.vtable = &vtable;
+  self->file.isQuiet = isQuiet;
+  self->file.isReadable = 1;
+  self->file.isWritable = 0;
+  self->file.isBinary = 1;
+  self->file.isAutoSpacing = 0;
+  self->file.hasError = 0;
+
+#ifdef TH_PREFETCH_THREADS
+  self->nThreads = nThreads;
+  pthread_mutex_init(&self->mutex, NULL);
+  pthread_cond_init(&self->filled, NULL);
+  pthread_cond_init(&self->freed, NULL);
+  self->threads = THAlloc(sizeof(pthread_t)*(nThreads+1));
+  for(i = 0; i < nThreads; i++)
+  {
+    if(pthread_create(&self->threads[i], NULL, THPrefetchFile_thread, self))
+    {
+      self->nThreads = i;
+      THPrefetchFile_free(&self->file);
+      THError("unable to start the prefetch threads of <%s>", name);
+    }
+  }
+#else
+  self->nThreads = 0;
+#endif
+
+  return &self->file;
+}
@@ -0,0 +1,37 @@
+#ifndef TH_PREFETCH_FILE_INC
+#define TH_PREFETCH_FILE_INC
+
+#include "THFile.h"
+#include "THAllocator.h"
+
+/* Read-only binary file streamed through a ring of nBlocks buffers of
+   blockSize bytes, which nThreads background threads fill ahead of the
+   reader. With nThreads == 0 the blocks are read on demand. */
+TH_API THFile *THPrefetchFile_new(const char *name, long blockSize, int nBlocks, int nThreads, int isQuiet);
+
+TH_API const char *THPrefetchFile_name(THFile *self);
+
+/* Hands over the rest of the current block without copying, and moves the
+   file position to the end of it. The data stays valid until the next
+   read, seek or nextBatch on the file. Returns NULL at the end of file. */
+TH_API char *THPrefetchFile_nextBatch(THFile *self, long *size);
+
+/* A reference to the memory of the batches, which outlives the file: a
+   storage created on a batch with THPrefetchBatchAllocator and this context
+   (and not resizable) keeps the memory alive after the file is closed. */
+TH_API void *THPrefetchFile_retainBatch(THFile *self);
+extern THAllocator THPrefetchBatchAllocator;
+
+typedef struct THPrefetchFileStats
+{
+  long bytesRead;       /* bytes handed to the reader */
+  long bytesFetched;    /* bytes read from the disk */
+  double seconds;       /* since the file was opened */
+  double stallSeconds;  /* reader time spent waiting for a block */
+  long nStalls;         /* number of such waits */
+  double idleSeconds;   /* thread time spent waiting for a free buffer */
+} THPrefetchFileStats;
+
+TH_API void THPrefetchFile_stats(THFile *self, THPrefetchFileStats *stats);
+
+#endif
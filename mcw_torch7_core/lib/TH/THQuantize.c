@@ -0,0 +1,168 @@
+#include "THQuantize.h"
+#include "THVector.h"
+#include "vector/THVectorKernels.h"
+
+#include <string.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#if defined(USE_SSE4_1)
+#include <smmintrin.h>
+#endif
+
+/* The GEMMs run THQUANT_GEMM_MR x THQUANT_GEMM_NR tiles of dot products
+   between rows of a and rows of b. The rows of b are taken in blocks of
+   about THQUANT_GEMM_NC_BYTES, which stay in L2 while the threads share
+   out the rows of a. */
+#define THQUANT_GEMM_MR 2
+#define THQUANT_GEMM_NR 4
+#define THQUANT_GEMM_NC_BYTES (128*1024)
+#define THQUANT_OMP_THRESHOLD 65536
+
+typedef void (*THQuantKernel)(long k, const signed char * const *a, const signed char * const *b, int *c);
+
+#if !defined(USE_SSE4_1)
+static void THQuant_gemmKernel_DEFAULT(long k, const signed char * const *a, const signed char * const *b, int *c)
+{
+  long i, j, l;
+
+  for(i = 0; i < THQUANT_GEMM_MR; i++)
+  {
+    for(j = 0; j < THQUANT_GEMM_NR; j++)
+    {
+      int sum = 0;
+      for(l = 0; l < k; l++)
+        sum += a[i][l]*b[j][l];
+      c[i*THQUANT_GEMM_NR+j] = sum;
+    }
+  }
+}
+#endif
+
+#if defined(USE_SSE4_1)
+/* |a| * (b with the sign of a) by pmaddubsw: pairs of products summed in
+   int16 (at most 2*127*127, no saturation), then by pmaddwd in int32 */
+static TH_INLINE __m128i THQuant_madd_SSE4(__m128i a, __m128i b)
+{
+  return _mm_madd_epi16(_mm_maddubs_epi16(_mm_abs_epi8(a), _mm_sign_epi8(b, a)), _mm_set1_epi16(1));
+}
+
+static int THQuant_hsum_SSE4(__m128i x)
+{
+  x = _mm_add_epi32(x, _mm_shuffle_epi32(x, 0x4e));
+  x = _mm_add_epi32(x, _mm_shuffle_epi32(x, 0xb1));
+  return _mm_cvtsi128_si32(x);
+}
+
+static void THQuant_gemmKernel_SSE4(long k, const signed char * const *a, const signed char * const *b, int *c)
+{
+  __m128i acc[THQUANT_GEMM_MR*THQUANT_GEMM_NR];
+  long i, j, l;
+
+  for(i = 0; i < THQUANT_GEMM_MR*THQUANT_GEMM_NR; i++)
+    acc[i] = _mm_setzero_si128();
+  for(l = 0; l <= k-16; l += 16)
+  {
+    __m128i a0 = _mm_loadu_si128((const __m128i*)(a[0]+l));
+    __m128i a1 = _mm_loadu_si128((const __m128i*)(a[1]+l));
+    for(j = 0; j < THQUANT_GEMM_NR; j++)
+    {
+      __m128i bj = _mm_loadu_si128((const __m128i*)(b[j]+l));
+      acc[j] = _mm_add_epi32(acc[j], THQuant_madd_SSE4(a0, bj));
+      acc[THQUANT_GEMM_NR+j] = _mm_add_epi32(acc[THQUANT_GEMM_NR+j], THQuant_madd_SSE4(a1, bj));
+    }
+  }
+  for(i = 0; i < THQUANT_GEMM_MR; i++)
+  {
+    for(j = 0; j < THQUANT_GEMM_NR; j++)
+    {
+      long p;
+      int sum = THQuant_hsum_SSE4(acc[i*THQUANT_GEMM_NR+j]);
+      for(p = l; p < k; p++)
+        sum += a[i][p]*b[j][p];
+      c[i*THQUANT_GEMM_NR+j] = sum;
+    }
+  }
+}
+#endif
+
+static THQuantKernel THQuant_kernel(void)
+{
+#if defined(TH_VECTOR_HAVE_AVX2)
+  if(THVector_getIsa() >= TH_VECTOR_AVX2)
+    return THQuant_gemmKernel_AVX2;
+#endif
+#if defined(USE_SSE4_1)
+  return THQuant_gemmKernel_SSE4;
+#else
+  return THQuant_gemmKernel_DEFAULT;
+#endif
+}
+
+/* Row pointers of the tile at (i, j): rows past m (n) repeat the last one,
+   and their results are dropped */
+static void THQuant_tileRows(long i, long j, long m, long n,
+                             const signed char *a, long lda, const signed char *b, long ldb,
+                             const signed char **ar, const signed char **br)
+{
+  long t;
+  for(t = 0; t < THQUANT_GEMM_MR; t++)
+    ar[t] = a + THMin(i+t, m-1)*lda;
+  for(t = 0; t < THQUANT_GEMM_NR; t++)
+    br[t] = b + THMin(j+t, n-1)*ldb;
+}
+
+static long THQuant_blockRows(long ldb)
+{
+  long nc = THQUANT_GEMM_NC_BYTES/THMax(ldb, 1);
+  return THMax(THQUANT_GEMM_NR, nc/THQUANT_GEMM_NR*THQUANT_GEMM_NR);
+}
+
+static int THQuant_parallel(long m, long n, long k)
+{
+#ifdef _OPENMP
+  return !omp_in_parallel() && ((double)m*(double)n*(double)k >= THQUANT_OMP_THRESHOLD);
+#else
+  return 0;
+#endif
+}
+
+void THQuant_gemmInt32(long m, long n, long k,
+                       const signed char *a, long lda,
+                       const signed char *b, long ldb,
+                       int *c, long ldc)
+{
+  THQuantKernel kernel = THQuant_kernel();
+  long nc = THQuant_blockRows(ldb);
+  int parallel = THQuant_parallel(m, n, k);
+  long jc, i;
+
+  if(m == 0 || n == 0)
+    return;
+
+  for(jc = 0; jc < n; jc += nc)
+  {
+    long jEnd = THMin(n, jc+nc);
+#pragma omp parallel for if(parallel) private(i)
+    for(i = 0; i < m; i += THQUANT_GEMM_MR)
+    {
+      const signed char *ar[THQUANT_GEMM_MR], *br[THQUANT_GEMM_NR];
+      int tile[THQUANT_GEMM_MR*THQUANT_GEMM_NR];
+      long j, ii, jj;
+
+      for(j = jc; j < jEnd; j += THQUANT_GEMM_NR)
+      {
+        THQuant_tileRows(i, j, m, n, a, lda, b, ldb, ar, br);
+        kernel(k, ar, br, tile);
+        for(ii = 0; ii < THMin(THQUANT_GEMM_MR, m-i); ii++)
+          for(jj = 0; jj < THMin(THQUANT_GEMM_NR, jEnd-j); jj++)
+            c[(i+ii)*ldc+j+jj] = tile[ii*THQUANT_GEMM_NR+jj];
+      }
+    }
+  }
+}
+
+#include "generic/THQuantize.c"
+#include "THGenerateFloatTypes.h"
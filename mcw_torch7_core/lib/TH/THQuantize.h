@@ -0,0 +1,26 @@
+#ifndef TH_QUANTIZE_INC
+#define TH_QUANTIZE_INC
+
+#include "THGeneral.h"
+
+#define THQuant_(NAME) TH_CONCAT_4(TH,Real,Quant_,NAME)
+
+/* Symmetric int8 quantization: x ~ scale*q with q in [-127, 127]. -128 is
+   never produced, which lets the SIMD kernels multiply with pmaddubsw
+   (unsigned x signed bytes) on |a| and b*sign(a) without saturating. */
+
+/* Rows of quantized operands are best padded with zeros to a multiple of
+   TH_QUANT_ALIGN values: the kernels then run without scalar tails */
+#define TH_QUANT_ALIGN 32
+#define TH_QUANT_PADDED(k) ((((k)+TH_QUANT_ALIGN-1)/TH_QUANT_ALIGN)*TH_QUANT_ALIGN)
+
+/* c[i*ldc+j] = sum_l a[i*lda+l]*b[j*ldb+l], l < k: int8 x int8 -> int32 */
+TH_API void THQuant_gemmInt32(long m, long n, long k,
+                              const signed char *a, long lda,
+                              const signed char *b, long ldb,
+                              int *c, long ldc);
+
+#include "generic/THQuantize.h"
+#include "THGenerateFloatTypes.h"
+
+#endif
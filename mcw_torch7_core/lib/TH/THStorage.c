@@ -3,5 +3,11 @@
 #include "generic/THStorage.c"
 #include "THGenerateAllTypes.h"
 
+#include "generic/THStorage.c"
+#include "THGenerateHalfType.h"
+
 #include "generic/THStorageCopy.c"
 #include "THGenerateAllTypes.h"
+
+#include "generic/THStorageCopy.c"
+#include "THGenerateHalfType.h"
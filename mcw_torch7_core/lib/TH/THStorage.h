@@ -3,6 +3,7 @@
 
 #include "THGeneral.h"
 #include "THAllocator.h"
+#include "THHalf.h"
 
 #define THStorage        TH_CONCAT_3(TH,Real,Storage)
 #define THStorage_(NAME) TH_CONCAT_4(TH,Real,Storage_,NAME)
@@ -14,7 +15,13 @@
 #include "generic/THStorage.h"
 #include "THGenerateAllTypes.h"
 
+#include "generic/THStorage.h"
+#include "THGenerateHalfType.h"
+
 #include "generic/THStorageCopy.h"
 #include "THGenerateAllTypes.h"
 
+#include "generic/THStorageCopy.h"
+#include "THGenerateHalfType.h"
+
 #endif
@@ -8,12 +8,22 @@
 #include "generic/THTensor.c"
 #include "THGenerateAllTypes.h"
 
+#include "generic/THTensor.c"
+#include "THGenerateHalfType.h"
+
 #include "generic/THTensorCopy.c"
 #include "THGenerateAllTypes.h"
 
+#include "generic/THTensorCopy.c"
+#include "THGenerateHalfType.h"
+
 #include "generic/THTensorRandom.c"
 #include "THGenerateAllTypes.h"
 
+/* below this many multiply-adds per matrix, baddbmm spreads the batch over
+   threads instead of leaving each product to a (parallel) gemm */
+#define TH_TENSOR_BMM_OMP_THRESHOLD 65536
+
 #include "generic/THTensorMath.c"
 #include "THGenerateAllTypes.h"
 
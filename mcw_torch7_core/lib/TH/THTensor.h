@@ -11,9 +11,15 @@
 #include "generic/THTensor.h"
 #include "THGenerateAllTypes.h"
 
+#include "generic/THTensor.h"
+#include "THGenerateHalfType.h"
+
 #include "generic/THTensorCopy.h"
 #include "THGenerateAllTypes.h"
 
+#include "generic/THTensorCopy.h"
+#include "THGenerateHalfType.h"
+
 #include "THTensorMacros.h"
 
 /* random numbers */
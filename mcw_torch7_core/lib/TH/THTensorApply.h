@@ -1,6 +1,10 @@
 #ifndef TH_TENSOR_APPLY_INC
 #define TH_TENSOR_APPLY_INC
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
 #define TH_TENSOR_APPLY3(TYPE1, TENSOR1, TYPE2, TENSOR2, TYPE3, TENSOR3, CODE) \
 { \
   TYPE1 *TENSOR1##_data = NULL; \
@@ -425,4 +429,362 @@
   THFree(TENSOR##_counter); \
 }
 
+/*
+ * Parallel apply engine (TH_TENSOR_PAPPLY*), for pointwise code only: CODE
+ * may not depend on the visiting order nor write shared state.
+ *
+ * Dims of size 1 are dropped and adjacent dims are merged whenever every
+ * tensor allows it, so most tensors iterate as one or two dims. The counters
+ * live on the stack. Above TH_TENSOR_APPLY_OMP_THRESHOLD elements the
+ * iteration space is split in equal ranges across the OpenMP threads.
+ * In the _VEC variants, VECCODE replaces the element loop on inner runs that
+ * are contiguous in every tensor: TENSOR##_data then points to the run and
+ * TH_TENSOR_APPLY_len is its length. Tensors of different shapes that cannot
+ * be brought to a common shape go through the serial TH_TENSOR_APPLY*.
+ */
+
+#define TH_TENSOR_APPLY_MAX_DIMS 16
+#define TH_TENSOR_APPLY_OMP_THRESHOLD 100000
+
+typedef struct THTensorApplyIter
+{
+  int nDim;
+  long size[TH_TENSOR_APPLY_MAX_DIMS];      /* innermost first */
+  long stride[3][TH_TENSOR_APPLY_MAX_DIMS];
+  long counter[TH_TENSOR_APPLY_MAX_DIMS];
+  long offset[3];
+} THTensorApplyIter;
+
+static TH_INLINE long THTensorApply_nElement(int nDim, const long *size)
+{
+  long n = (nDim ? 1 : 0);
+  int d;
+  for(d = 0; d < nDim; d++)
+    n *= size[d];
+  return n;
+}
+
+/* size-1 dims dropped, dims merged when all the tensors allow it */
+static TH_INLINE int THTensorApply_collapse(int nTensor, int nDim, long **size, long **stride,
+                                            long *csize, long (*cstride)[TH_TENSOR_APPLY_MAX_DIMS])
+{
+  int n = 0, d, t, merge;
+
+  for(d = nDim-1; d >= 0; d--)
+  {
+    if(size[0][d] == 1)
+      continue;
+
+    merge = (n > 0);
+    for(t = 0; t < nTensor && merge; t++)
+      merge = (stride[t][d] == cstride[t][n-1]*csize[n-1]);
+
+    if(merge)
+      csize[n-1] *= size[0][d];
+    else
+    {
+      if(n == TH_TENSOR_APPLY_MAX_DIMS)
+        return -1;
+      csize[n] = size[0][d];
+      for(t = 0; t < nTensor; t++)
+        cstride[t][n] = stride[t][d];
+      n++;
+    }
+  }
+
+  if(n == 0) /* a single element */
+  {
+    csize[0] = 1;
+    for(t = 0; t < nTensor; t++)
+      cstride[t][0] = 1;
+    n = 1;
+  }
+
+  return n;
+}
+
+/* Returns 0 when the tensors cannot be iterated together */
+static TH_INLINE int THTensorApply_init(THTensorApplyIter *it, int nTensor, int *nDim, long **size, long **stride)
+{
+  int t, d, sameShape = 1;
+
+  for(t = 1; t < nTensor && sameShape; t++)
+  {
+    sameShape = (nDim[t] == nDim[0]);
+    for(d = 0; d < nDim[0] && sameShape; d++)
+      sameShape = (size[t][d] == size[0][d]);
+  }
+
+  if(sameShape)
+    it->nDim = THTensorApply_collapse(nTensor, nDim[0], size, stride, it->size, it->stride);
+  else
+  {
+    /* e.g. a contiguous 6 with a contiguous 2x3: collapse each on its own */
+    long csize[TH_TENSOR_APPLY_MAX_DIMS];
+    long cstride[1][TH_TENSOR_APPLY_MAX_DIMS];
+
+    it->nDim = -1;
+    for(t = 0; t < nTensor; t++)
+    {
+      int n = THTensorApply_collapse(1, nDim[t], size+t, stride+t, csize, cstride);
+      if(n < 0 || (t > 0 && n != it->nDim))
+        return 0;
+      for(d = 0; d < n; d++)
+      {
+        if(t > 0 && csize[d] != it->size[d])
+          return 0;
+        it->size[d] = csize[d];
+        it->stride[t][d] = cstride[0][d];
+      }
+      it->nDim = n;
+    }
+  }
+
+  return it->nDim > 0;
+}
+
+/* positions the iterator on the element of linear index 'index' */
+static TH_INLINE void THTensorApply_seek(THTensorApplyIter *it, int nTensor, long index)
+{
+  int d, t;
+
+  for(t = 0; t < nTensor; t++)
+    it->offset[t] = 0;
+
+  for(d = 0; d < it->nDim; d++)
+  {
+    it->counter[d] = index % it->size[d];
+    index /= it->size[d];
+    for(t = 0; t < nTensor; t++)
+      it->offset[t] += it->counter[d]*it->stride[t][d];
+  }
+}
+
+static TH_INLINE long THTensorApply_runLength(THTensorApplyIter *it, long remaining)
+{
+  long len = it->size[0] - it->counter[0];
+  return (len < remaining ? len : remaining);
+}
+
+static TH_INLINE void THTensorApply_advance(THTensorApplyIter *it, int nTensor, long len)
+{
+  int d, t;
+
+  for(t = 0; t < nTensor; t++)
+    it->offset[t] += len*it->stride[t][0];
+  it->counter[0] += len;
+
+  for(d = 0; d < it->nDim-1 && it->counter[d] == it->size[d]; d++)
+  {
+    for(t = 0; t < nTensor; t++)
+      it->offset[t] += it->stride[t][d+1] - it->counter[d]*it->stride[t][d];
+    it->counter[d] = 0;
+    it->counter[d+1]++;
+  }
+}
+
+/* Opens a block in which [TH_TENSOR_APPLY_start, TH_TENSOR_APPLY_end) is the
+   range of linear indices handled by the current thread */
+#ifdef _OPENMP
+#define TH_TENSOR_APPLY_RANGE_BEGIN(N) \
+{ \
+  int TH_TENSOR_APPLY_omp = ((N) > TH_TENSOR_APPLY_OMP_THRESHOLD && !omp_in_parallel()); \
+  _Pragma("omp parallel if(TH_TENSOR_APPLY_omp) firstprivate(TH_TENSOR_APPLY_it)") \
+  { \
+    long TH_TENSOR_APPLY_nThread = omp_get_num_threads(); \
+    long TH_TENSOR_APPLY_chunk = ((N) + TH_TENSOR_APPLY_nThread - 1) / TH_TENSOR_APPLY_nThread; \
+    long TH_TENSOR_APPLY_start, TH_TENSOR_APPLY_end; \
+    TH_TENSOR_APPLY_chunk = (TH_TENSOR_APPLY_chunk + 15) & ~15L; /* whole cache lines */ \
+    TH_TENSOR_APPLY_start = omp_get_thread_num()*TH_TENSOR_APPLY_chunk; \
+    TH_TENSOR_APPLY_end = TH_TENSOR_APPLY_start + TH_TENSOR_APPLY_chunk; \
+    if(TH_TENSOR_APPLY_end > (N)) \
+      TH_TENSOR_APPLY_end = (N);
+
+#define TH_TENSOR_APPLY_RANGE_END \
+  } \
+}
+#else
+#define TH_TENSOR_APPLY_RANGE_BEGIN(N) \
+{ \
+  { \
+    long TH_TENSOR_APPLY_start = 0, TH_TENSOR_APPLY_end = (N);
+
+#define TH_TENSOR_APPLY_RANGE_END \
+  } \
+}
+#endif
+
+#define TH_TENSOR_PAPPLY3_VEC(TYPE1, TENSOR1, TYPE2, TENSOR2, TYPE3, TENSOR3, CODE, VECCODE) \
+{ \
+  THTensorApplyIter TH_TENSOR_APPLY_it; \
+  int TH_TENSOR_APPLY_nDim[3] = {TENSOR1->nDimension, TENSOR2->nDimension, TENSOR3->nDimension}; \
+  long *TH_TENSOR_APPLY_size[3] = {TENSOR1->size, TENSOR2->size, TENSOR3->size}; \
+  long *TH_TENSOR_APPLY_stride[3] = {TENSOR1->stride, TENSOR2->stride, TENSOR3->stride}; \
+  long TH_TENSOR_APPLY_n = THTensorApply_nElement(TENSOR1->nDimension, TENSOR1->size); \
+\
+  if(TH_TENSOR_APPLY_n != THTensorApply_nElement(TENSOR2->nDimension, TENSOR2->size) || \
+     TH_TENSOR_APPLY_n != THTensorApply_nElement(TENSOR3->nDimension, TENSOR3->size)) \
+    THError("inconsistent tensor size"); \
+\
+  if(!THTensorApply_init(&TH_TENSOR_APPLY_it, 3, TH_TENSOR_APPLY_nDim, TH_TENSOR_APPLY_size, TH_TENSOR_APPLY_stride)) \
+  { \
+    TH_TENSOR_APPLY3(TYPE1, TENSOR1, TYPE2, TENSOR2, TYPE3, TENSOR3, CODE) \
+  } \
+  else if(TH_TENSOR_APPLY_n > 0) \
+  { \
+    TYPE1 *TENSOR1##_base = TENSOR1->storage->data+TENSOR1->storageOffset; \
+    TYPE2 *TENSOR2##_base = TENSOR2->storage->data+TENSOR2->storageOffset; \
+    TYPE3 *TENSOR3##_base = TENSOR3->storage->data+TENSOR3->storageOffset; \
+    TH_TENSOR_APPLY_RANGE_BEGIN(TH_TENSOR_APPLY_n) \
+    long TH_TENSOR_APPLY_len, TH_TENSOR_APPLY_i; \
+    THTensorApply_seek(&TH_TENSOR_APPLY_it, 3, TH_TENSOR_APPLY_start); \
+    while(TH_TENSOR_APPLY_start < TH_TENSOR_APPLY_end) \
+    { \
+      TYPE1 *TENSOR1##_data = TENSOR1##_base + TH_TENSOR_APPLY_it.offset[0]; \
+      TYPE2 *TENSOR2##_data = TENSOR2##_base + TH_TENSOR_APPLY_it.offset[1]; \
+      TYPE3 *TENSOR3##_data = TENSOR3##_base + TH_TENSOR_APPLY_it.offset[2]; \
+      TH_TENSOR_APPLY_len = THTensorApply_runLength(&TH_TENSOR_APPLY_it, TH_TENSOR_APPLY_end-TH_TENSOR_APPLY_start); \
+      if(TH_TENSOR_APPLY_it.stride[0][0] == 1 && TH_TENSOR_APPLY_it.stride[1][0] == 1 && TH_TENSOR_APPLY_it.stride[2][0] == 1) \
+      { \
+        VECCODE \
+      } \
+      else \
+      { \
+        long TENSOR1##_stride = TH_TENSOR_APPLY_it.stride[0][0]; \
+        long TENSOR2##_stride = TH_TENSOR_APPLY_it.stride[1][0]; \
+        long TENSOR3##_stride = TH_TENSOR_APPLY_it.stride[2][0]; \
+        for(TH_TENSOR_APPLY_i = 0; TH_TENSOR_APPLY_i < TH_TENSOR_APPLY_len; TH_TENSOR_APPLY_i++, \
+            TENSOR1##_data += TENSOR1##_stride, TENSOR2##_data += TENSOR2##_stride, TENSOR3##_data += TENSOR3##_stride) \
+        { \
+          CODE \
+        } \
+      } \
+      THTensorApply_advance(&TH_TENSOR_APPLY_it, 3, TH_TENSOR_APPLY_len); \
+      TH_TENSOR_APPLY_start += TH_TENSOR_APPLY_len; \
+    } \
+    TH_TENSOR_APPLY_RANGE_END \
+  } \
+}
+
+#define TH_TENSOR_PAPPLY2_VEC(TYPE1, TENSOR1, TYPE2, TENSOR2, CODE, VECCODE) \
+{ \
+  THTensorApplyIter TH_TENSOR_APPLY_it; \
+  int TH_TENSOR_APPLY_nDim[2] = {TENSOR1->nDimension, TENSOR2->nDimension}; \
+  long *TH_TENSOR_APPLY_size[2] = {TENSOR1->size, TENSOR2->size}; \
+  long *TH_TENSOR_APPLY_stride[2] = {TENSOR1->stride, TENSOR2->stride}; \
+  long TH_TENSOR_APPLY_n = THTensorApply_nElement(TENSOR1->nDimension, TENSOR1->size); \
+\
+  if(TH_TENSOR_APPLY_n != THTensorApply_nElement(TENSOR2->nDimension, TENSOR2->size)) \
+    THError("inconsistent tensor size"); \
+\
+  if(!THTensorApply_init(&TH_TENSOR_APPLY_it, 2, TH_TENSOR_APPLY_nDim, TH_TENSOR_APPLY_size, TH_TENSOR_APPLY_stride)) \
+  { \
+    TH_TENSOR_APPLY2(TYPE1, TENSOR1, TYPE2, TENSOR2, CODE) \
+  } \
+  else if(TH_TENSOR_APPLY_n > 0) \
+  { \
+    TYPE1 *TENSOR1##_base = TENSOR1->storage->data+TENSOR1->storageOffset; \
+    TYPE2 *TENSOR2##_base = TENSOR2->storage->data+TENSOR2->storageOffset; \
+    TH_TENSOR_APPLY_RANGE_BEGIN(TH_TENSOR_APPLY_n) \
+    long TH_TENSOR_APPLY_len, TH_TENSOR_APPLY_i; \
+    THTensorApply_seek(&TH_TENSOR_APPLY_it, 2, TH_TENSOR_APPLY_start); \
+    while(TH_TENSOR_APPLY_start < TH_TENSOR_APPLY_end) \
+    { \
+      TYPE1 *TENSOR1##_data = TENSOR1##_base + TH_TENSOR_APPLY_it.offset[0]; \
+      TYPE2 *TENSOR2##_data = TENSOR2##_base + TH_TENSOR_APPLY_it.offset[1]; \
+      TH_TENSOR_APPLY_len = THTensorApply_runLength(&TH_TENSOR_APPLY_it, TH_TENSOR_APPLY_end-TH_TENSOR_APPLY_start); \
+      if(TH_TENSOR_APPLY_it.stride[0][0] == 1 && TH_TENSOR_APPLY_it.stride[1][0] == 1) \
+      { \
+        VECCODE \
+      } \
+      else \
+      { \
+        long TENSOR1##_stride = TH_TENSOR_APPLY_it.stride[0][0]; \
+        long TENSOR2##_stride = TH_TENSOR_APPLY_it.stride[1][0]; \
+        for(TH_TENSOR_APPLY_i = 0; TH_TENSOR_APPLY_i < TH_TENSOR_APPLY_len; TH_TENSOR_APPLY_i++, \
+            TENSOR1##_data += TENSOR1##_stride, TENSOR2##_data += TENSOR2##_stride) \
+        { \
+          CODE \
+        } \
+      } \
+      THTensorApply_advance(&TH_TENSOR_APPLY_it, 2, TH_TENSOR_APPLY_len); \
+      TH_TENSOR_APPLY_start += TH_TENSOR_APPLY_len; \
+    } \
+    TH_TENSOR_APPLY_RANGE_END \
+  } \
+}
+
+#define TH_TENSOR_PAPPLY_VEC(TYPE, TENSOR, CODE, VECCODE) \
+{ \
+  THTensorApplyIter TH_TENSOR_APPLY_it; \
+  int TH_TENSOR_APPLY_nDim[1] = {TENSOR->nDimension}; \
+  long *TH_TENSOR_APPLY_size[1] = {TENSOR->size}; \
+  long *TH_TENSOR_APPLY_stride[1] = {TENSOR->stride}; \
+  long TH_TENSOR_APPLY_n = THTensorApply_nElement(TENSOR->nDimension, TENSOR->size); \
+\
+  if(!THTensorApply_init(&TH_TENSOR_APPLY_it, 1, TH_TENSOR_APPLY_nDim, TH_TENSOR_APPLY_size, TH_TENSOR_APPLY_stride)) \
+  { \
+    TH_TENSOR_APPLY(TYPE, TENSOR, CODE) \
+  } \
+  else if(TH_TENSOR_APPLY_n > 0) \
+  { \
+    TYPE *TENSOR##_base = TENSOR->storage->data+TENSOR->storageOffset; \
+    TH_TENSOR_APPLY_RANGE_BEGIN(TH_TENSOR_APPLY_n) \
+    long TH_TENSOR_APPLY_len, TH_TENSOR_APPLY_i; \
+    THTensorApply_seek(&TH_TENSOR_APPLY_it, 1, TH_TENSOR_APPLY_start); \
+    while(TH_TENSOR_APPLY_start < TH_TENSOR_APPLY_end) \
+    { \
+      TYPE *TENSOR##_data = TENSOR##_base + TH_TENSOR_APPLY_it.offset[0]; \
+      TH_TENSOR_APPLY_len = THTensorApply_runLength(&TH_TENSOR_APPLY_it, TH_TENSOR_APPLY_end-TH_TENSOR_APPLY_start); \
+      if(TH_TENSOR_APPLY_it.stride[0][0] == 1) \
+      { \
+        VECCODE \
+      } \
+      else \
+      { \
+        long TENSOR##_stride = TH_TENSOR_APPLY_it.stride[0][0]; \
+        for(TH_TENSOR_APPLY_i = 0; TH_TENSOR_APPLY_i < TH_TENSOR_APPLY_len; TH_TENSOR_APPLY_i++, TENSOR##_data += TENSOR##_stride) \
+        { \
+          CODE \
+        } \
+      } \
+      THTensorApply_advance(&TH_TENSOR_APPLY_it, 1, TH_TENSOR_APPLY_len); \
+      TH_TENSOR_APPLY_start += TH_TENSOR_APPLY_len; \
+    } \
+    TH_TENSOR_APPLY_RANGE_END \
+  } \
+}
+
+/* element loops over contiguous runs, for the variants without VECCODE */
+#define TH_TENSOR_APPLY_CONTIGUOUS3(TENSOR1, TENSOR2, TENSOR3, CODE) \
+  for(TH_TENSOR_APPLY_i = 0; TH_TENSOR_APPLY_i < TH_TENSOR_APPLY_len; TH_TENSOR_APPLY_i++, \
+      TENSOR1##_data++, TENSOR2##_data++, TENSOR3##_data++) \
+  { \
+    CODE \
+  }
+
+#define TH_TENSOR_APPLY_CONTIGUOUS2(TENSOR1, TENSOR2, CODE) \
+  for(TH_TENSOR_APPLY_i = 0; TH_TENSOR_APPLY_i < TH_TENSOR_APPLY_len; TH_TENSOR_APPLY_i++, \
+      TENSOR1##_data++, TENSOR2##_data++) \
+  { \
+    CODE \
+  }
+
+#define TH_TENSOR_APPLY_CONTIGUOUS(TENSOR, CODE) \
+  for(TH_TENSOR_APPLY_i = 0; TH_TENSOR_APPLY_i < TH_TENSOR_APPLY_len; TH_TENSOR_APPLY_i++, TENSOR##_data++) \
+  { \
+    CODE \
+  }
+
+#define TH_TENSOR_PAPPLY3(TYPE1, TENSOR1, TYPE2, TENSOR2, TYPE3, TENSOR3, CODE) \
+  TH_TENSOR_PAPPLY3_VEC(TYPE1, TENSOR1, TYPE2, TENSOR2, TYPE3, TENSOR3, CODE, \
+                        TH_TENSOR_APPLY_CONTIGUOUS3(TENSOR1, TENSOR2, TENSOR3, CODE))
+
+#define TH_TENSOR_PAPPLY2(TYPE1, TENSOR1, TYPE2, TENSOR2, CODE) \
+  TH_TENSOR_PAPPLY2_VEC(TYPE1, TENSOR1, TYPE2, TENSOR2, CODE, \
+                        TH_TENSOR_APPLY_CONTIGUOUS2(TENSOR1, TENSOR2, CODE))
+
+#define TH_TENSOR_PAPPLY(TYPE, TENSOR, CODE) \
+  TH_TENSOR_PAPPLY_VEC(TYPE, TENSOR, CODE, TH_TENSOR_APPLY_CONTIGUOUS(TENSOR, CODE))
+
 #endif
@@ -0,0 +1,154 @@
+#include "THVector.h"
+#include "vector/THVectorKernels.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+#define TH_VECTOR_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+static int THVector_isa = -1;
+
+static TH_INLINE void THVector_ready(void)
+{
+  if(THVector_isa < 0)
+    THVector_setIsa(-1);
+}
+
+#ifdef TH_VECTOR_X86
+static void THVector_cpuid(unsigned int leaf, unsigned int regs[4])
+{
+#ifdef _MSC_VER
+  __cpuidex((int*)regs, (int)leaf, 0);
+#else
+  __cpuid_count(leaf, 0, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+/* XCR0: which register states the OS saves on context switches */
+static unsigned long long THVector_xgetbv(void)
+{
+#ifdef _MSC_VER
+  return _xgetbv(0);
+#else
+  unsigned int eax, edx;
+  __asm__ __volatile__(".byte 0x0f, 0x01, 0xd0" : "=a"(eax), "=d"(edx) : "c"(0));
+  return ((unsigned long long)edx << 32) | eax;
+#endif
+}
+#endif
+
+int THVector_cpuIsa(void)
+{
+  static int cpuIsa = -1;
+
+  if(cpuIsa < 0)
+  {
+    int isa = TH_VECTOR_DEFAULT;
+#if defined(TH_VECTOR_X86)
+    unsigned int regs[4], maxLeaf, ecx1, edx1;
+
+    THVector_cpuid(0, regs);
+    maxLeaf = regs[0];
+    THVector_cpuid(1, regs);
+    ecx1 = regs[2];
+    edx1 = regs[3];
+#if defined(USE_SSE2)
+    if(edx1 & (1 << 26))
+      isa = TH_VECTOR_SSE2;
+#endif
+#if defined(TH_VECTOR_HAVE_AVX)
+    /* AVX needs OSXSAVE and the OS saving the SSE and AVX states */
+    if((ecx1 & (1 << 27)) && (ecx1 & (1 << 28)) && (THVector_xgetbv() & 6) == 6)
+    {
+      isa = TH_VECTOR_AVX;
+#if defined(TH_VECTOR_HAVE_AVX2)
+      if(maxLeaf >= 7)
+      {
+        THVector_cpuid(7, regs);
+        if((regs[1] & (1 << 5)) && (ecx1 & (1 << 12)))
+          isa = TH_VECTOR_AVX2;
+      }
+#endif
+    }
+#endif
+    (void)maxLeaf;
+    (void)edx1;
+#elif defined(__NEON__)
+    isa = TH_VECTOR_SSE2;
+#endif
+    cpuIsa = isa;
+  }
+  return cpuIsa;
+}
+
+const char* THVector_isaName(int isa)
+{
+  switch(isa)
+  {
+    case TH_VECTOR_DEFAULT:
+      return "default";
+    case TH_VECTOR_SSE2:
+#ifdef __NEON__
+      return "neon";
+#else
+      return "sse2";
+#endif
+    case TH_VECTOR_AVX:
+      return "avx";
+    case TH_VECTOR_AVX2:
+      return "avx2";
+  }
+  return "unknown";
+}
+
+/* Plain C kernels: the operators generic/THVector.c generates for the
+   integer types, renamed THFloatVector_fill_DEFAULT etc. */
+#undef THVector_
+#define THVector_(NAME) TH_CONCAT_4(TH,Real,Vector_,NAME##_DEFAULT)
+#include "generic/THVector.c"
+#include "THGenerateFloatTypes.h"
+#undef THVector_
+#define THVector_(NAME) TH_CONCAT_4(TH,Real,Vector_,NAME)
+
+#include "generic/THVectorDispatch.c"
+#include "THGenerateFloatTypes.h"
+
+void THVector_setIsa(int isa)
+{
+  int cpuIsa = THVector_cpuIsa();
+
+  if(isa < 0)
+  {
+    const char *env = getenv("TH_VECTOR_ISA");
+    isa = cpuIsa;
+    if(env)
+    {
+      int i;
+      for(i = TH_VECTOR_DEFAULT; i <= TH_VECTOR_AVX2; i++)
+      {
+        if(!strcmp(env, THVector_isaName(i)))
+          isa = i;
+      }
+    }
+  }
+  if(isa > cpuIsa)
+    isa = cpuIsa;
+
+  THFloatVector_resolve(isa);
+  THDoubleVector_resolve(isa);
+  THVector_isa = isa;
+}
+
+int THVector_getIsa(void)
+{
+  THVector_ready();
+  return THVector_isa;
+}
@@ -0,0 +1,110 @@
+/* Compares THFloatBlas_gemm against the triple loop it replaced, for the
+   four transa/transb combinations. Usage: THGemmBenchmark [m n k [iter]] */
+
+#include "THBlas.h"
+#include <sys/time.h>
+
+static double now(void)
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec*1e-6;
+}
+
+/* the THBlas_(gemm) fallback before the blocked engine */
+static void naiveGemm(char transa, char transb, long m, long n, long k, float alpha, float *a, long lda, float *b, long ldb, float beta, float *c, long ldc)
+{
+  int transa_ = ((transa == 't') || (transa == 'T'));
+  int transb_ = ((transb == 't') || (transb == 'T'));
+  long i, j, l;
+
+  for(i = 0; i < m; i++)
+  {
+    for(j = 0; j < n; j++)
+    {
+      float sum = 0;
+      for(l = 0; l < k; l++)
+        sum += (transa_ ? a[i*lda+l] : a[l*lda+i]) * (transb_ ? b[l*ldb+j] : b[j*ldb+l]);
+      c[j*ldc+i] = beta*c[j*ldc+i]+alpha*sum;
+    }
+  }
+}
+
+static void fillRandom(float *x, long n)
+{
+  long i;
+  for(i = 0; i < n; i++)
+    x[i] = (float)rand()/RAND_MAX - 0.5f;
+}
+
+static int run(char transa, char transb, long m, long n, long k, int iter)
+{
+  long lda = (transa == 'n' ? m : k);
+  long ldb = (transb == 'n' ? k : n);
+  float *a = THAlloc(sizeof(float)*m*k);
+  float *b = THAlloc(sizeof(float)*k*n);
+  float *c0 = THAlloc(sizeof(float)*m*n);
+  float *c1 = THAlloc(sizeof(float)*m*n);
+  double flops = 2.0*m*n*k*iter;
+  double t, tNaive, tBlocked, err = 0, ref = 0;
+  long i;
+  int it;
+
+  fillRandom(a, m*k);
+  fillRandom(b, k*n);
+  fillRandom(c0, m*n);
+  memcpy(c1, c0, sizeof(float)*m*n);
+
+  t = now();
+  for(it = 0; it < iter; it++)
+    naiveGemm(transa, transb, m, n, k, 0.5f, a, lda, b, ldb, 0.25f, c0, m);
+  tNaive = now()-t;
+
+  t = now();
+  for(it = 0; it < iter; it++)
+    THFloatBlas_gemm(transa, transb, m, n, k, 0.5f, a, lda, b, ldb, 0.25f, c1, m);
+  tBlocked = now()-t;
+
+  for(i = 0; i < m*n; i++)
+  {
+    err = THMax(err, fabs(c0[i]-c1[i]));
+    ref = THMax(ref, fabs(c0[i]));
+  }
+
+  printf("%c%c %5ld x %5ld x %5ld   naive %8.3f GFLOP/s   gemm %8.3f GFLOP/s   speedup %6.2fx   max rel err %.2e\n",
+         transa, transb, m, n, k, flops/tNaive*1e-9, flops/tBlocked*1e-9, tNaive/tBlocked, err/(ref > 0 ? ref : 1));
+
+  THFree(a);
+  THFree(b);
+  THFree(c0);
+  THFree(c1);
+
+  return err <= 1e-4*(ref > 0 ? ref : 1)*k;
+}
+
+int main(int argc, char **argv)
+{
+  static const long shapes[][3] = {{64, 64, 64}, {127, 255, 65}, {256, 256, 256}, {512, 512, 512}, {96, 3025, 363}};
+  static const char trans[][2] = {{'n', 'n'}, {'t', 'n'}, {'n', 't'}, {'t', 't'}};
+  int ok = 1;
+  int s, t;
+
+  if(argc >= 4)
+  {
+    long m = atol(argv[1]), n = atol(argv[2]), k = atol(argv[3]);
+    int iter = (argc >= 5 ? atoi(argv[4]) : 1);
+    for(t = 0; t < 4; t++)
+      ok &= run(trans[t][0], trans[t][1], m, n, k, iter);
+  }
+  else
+  {
+    for(s = 0; s < (int)(sizeof(shapes)/sizeof(shapes[0])); s++)
+      for(t = 0; t < 4; t++)
+        ok &= run(trans[t][0], trans[t][1], shapes[s][0], shapes[s][1], shapes[s][2], 1);
+  }
+
+  if(!ok)
+    printf("MISMATCH between naive and blocked gemm\n");
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,128 @@
+/* Compares the int8 inference path of nn.QuantizedLinear (dynamic per-row
+   quantization of x, then THFloatQuant_gemm) against the float path
+   (THFloatBlas_gemm) on y = x W^T, with W m x k and x n x k: throughput,
+   and error relative to the float result. The raw int32 GEMM is checked
+   exactly against a triple loop. Usage: THQuantBenchmark [m n k [iter]] */
+
+#include "THBlas.h"
+#include "THQuantize.h"
+#include "THVector.h"
+#include <math.h>
+#include <sys/time.h>
+
+static double now(void)
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec*1e-6;
+}
+
+static void fillRandom(float *x, long n)
+{
+  long i;
+  for(i = 0; i < n; i++)
+    x[i] = (float)rand()/RAND_MAX - 0.5f;
+}
+
+static int checkInt32(long m, long n, long k, const signed char *a, long lda, const signed char *b, long ldb)
+{
+  int *c = THAlloc(sizeof(int)*m*n);
+  long i, j, l, bad = 0;
+
+  THQuant_gemmInt32(m, n, k, a, lda, b, ldb, c, n);
+  for(i = 0; i < m; i++)
+  {
+    for(j = 0; j < n; j++)
+    {
+      int sum = 0;
+      for(l = 0; l < k; l++)
+        sum += a[i*lda+l]*b[j*ldb+l];
+      bad += (sum != c[i*n+j]);
+    }
+  }
+  THFree(c);
+  return bad == 0;
+}
+
+static int run(long m, long n, long k, int iter)
+{
+  long ldk = TH_QUANT_PADDED(k);
+  float *w = THAlloc(sizeof(float)*m*k);
+  float *x = THAlloc(sizeof(float)*n*k);
+  float *y0 = THAlloc(sizeof(float)*n*m);
+  float *y1 = THAlloc(sizeof(float)*n*m);
+  signed char *qw = THAlloc(m*ldk);
+  signed char *qx = THAlloc(n*ldk);
+  float *wScale = THAlloc(sizeof(float)*m);
+  float *xScale = THAlloc(sizeof(float)*n);
+  double ops = 2.0*m*n*k*iter;
+  double t, tFloat, tQuant, err = 0, ref = 0;
+  long i;
+  int it, exact;
+
+  fillRandom(w, m*k);
+  fillRandom(x, n*k);
+  THFloatQuant_quantizeRows(qw, ldk, wScale, w, m, k, k, 0);
+
+  t = now();
+  for(it = 0; it < iter; it++)
+    THFloatBlas_gemm('t', 'n', m, n, k, 1, w, k, x, k, 0, y0, m);
+  tFloat = now()-t;
+
+  t = now();
+  for(it = 0; it < iter; it++)
+  {
+    THFloatQuant_quantizeRows(qx, ldk, xScale, x, n, k, k, 0);
+    THFloatQuant_gemm(m, n, ldk, qw, ldk, wScale, NULL, qx, ldk, xScale, 0, y1, 1, m);
+  }
+  tQuant = now()-t;
+
+  for(i = 0; i < m*n; i++)
+  {
+    err = THMax(err, fabs(y0[i]-y1[i]));
+    ref = THMax(ref, fabs(y0[i]));
+  }
+  err /= (ref > 0 ? ref : 1);
+  exact = checkInt32(THMin(m, 67), THMin(n, 33), k, qw, ldk, qx, ldk);
+
+  printf("%5ld x %5ld x %5ld   float %8.3f GFLOP/s   int8 %8.3f GOP/s   speedup %6.2fx   max rel err %.2e   int32 %s\n",
+         m, n, k, ops/tFloat*1e-9, ops/tQuant*1e-9, tFloat/tQuant, err, exact ? "exact" : "WRONG");
+
+  THFree(w);
+  THFree(x);
+  THFree(y0);
+  THFree(y1);
+  THFree(qw);
+  THFree(qx);
+  THFree(wScale);
+  THFree(xScale);
+
+  return exact && err < 2e-2;
+}
+
+int main(int argc, char **argv)
+{
+  /* Linear layers (outputs x batch x inputs) and SpatialConvolutionMM
+     frames (planes x positions x nInputPlane*kH*kW) */
+  static const long shapes[][3] = {{1000, 1, 4096}, {1024, 64, 1024}, {4096, 32, 4096}, {64, 3136, 576}, {256, 196, 2304}};
+  int ok = 1;
+  int s;
+
+  printf("instruction set: %s\n", THVector_isaName(THVector_getIsa()));
+  if(argc >= 4)
+  {
+    long m = atol(argv[1]), n = atol(argv[2]), k = atol(argv[3]);
+    int iter = (argc >= 5 ? atoi(argv[4]) : 1);
+    ok &= run(m, n, k, iter);
+  }
+  else
+  {
+    for(s = 0; s < (int)(sizeof(shapes)/sizeof(shapes[0])); s++)
+      ok &= run(shapes[s][0], shapes[s][1], shapes[s][2], 3);
+  }
+
+  if(!ok)
+    printf("MISMATCH between the int8 and float paths\n");
+
+  return ok ? 0 : 1;
+}
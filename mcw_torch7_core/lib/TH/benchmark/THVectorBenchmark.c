@@ -0,0 +1,141 @@
+/* Throughput of the THVector kernels at every instruction set level the CPU
+   supports, in GB/s of memory touched, and their largest deviation from the
+   plain C kernels. Usage: THVectorBenchmark [n [iter]] */
+
+#include "THVector.h"
+#include <sys/time.h>
+
+enum { FILL, ADD, DIFF, SCALE, MUL, SUM, DOT, MAX, MIN, EXP, LOG, TANH, SIGMOID, NKERNELS };
+
+static const char *kernelNames[NKERNELS] = {
+  "fill", "add", "diff", "scale", "mul", "sum", "dot", "max", "min", "exp", "log", "tanh", "sigmoid"
+};
+
+/* arrays read and written by each kernel */
+static const int kernelStreams[NKERNELS] = {1, 3, 3, 2, 3, 1, 2, 1, 1, 2, 2, 2, 2};
+
+static double now(void)
+{
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec*1e-6;
+}
+
+/* x in [-8, 8), y in [1e-3, 100) (valid for log), z is the output */
+#define BENCHMARK_RUN(Real, real)                                       \
+  static double run##Real(int kernel, real *x, real *y, real *z, long n, long *index) \
+  {                                                                     \
+    switch(kernel)                                                      \
+    {                                                                   \
+      case FILL: TH##Real##Vector_fill(z, (real)0.5, n); break;         \
+      case ADD: TH##Real##Vector_add(z, x, (real)0.5, n); break;        \
+      case DIFF: TH##Real##Vector_diff(z, x, y, n); break;              \
+      case SCALE: TH##Real##Vector_scale(z, (real)0.999, n); break;     \
+      case MUL: TH##Real##Vector_mul(z, y, n); break;                   \
+      case SUM: return TH##Real##Vector_sum(x, n);                      \
+      case DOT: return TH##Real##Vector_dot(x, y, n);                   \
+      case MAX: return TH##Real##Vector_max(x, n, index);               \
+      case MIN: return TH##Real##Vector_min(x, n, index);               \
+      case EXP: TH##Real##Vector_exp(z, x, n); break;                   \
+      case LOG: TH##Real##Vector_log(z, y, n); break;                   \
+      case TANH: TH##Real##Vector_tanh(z, x, n); break;                 \
+      case SIGMOID: TH##Real##Vector_sigmoid(z, x, n); break;           \
+    }                                                                   \
+    return 0;                                                           \
+  }                                                                     \
+                                                                        \
+  /* Returns 0 if a level deviates too much from the plain C kernels */ \
+  static int benchmark##Real(const char *typeName, long n, int iter, double tolerance) \
+  {                                                                     \
+    real *x = THAlloc(sizeof(real)*n);                                  \
+    real *y = THAlloc(sizeof(real)*n);                                  \
+    real *z = THAlloc(sizeof(real)*n);                                  \
+    real *zRef = THAlloc(sizeof(real)*n);                               \
+    int cpuIsa = THVector_cpuIsa();                                     \
+    int ok = 1;                                                         \
+    int kernel, isa, it;                                                \
+    long i;                                                             \
+                                                                        \
+    for(i = 0; i < n; i++)                                              \
+    {                                                                   \
+      x[i] = (real)(16.0*rand()/RAND_MAX - 8.0);                        \
+      y[i] = (real)(1e-3 + 100.0*rand()/((double)RAND_MAX+1));          \
+    }                                                                   \
+                                                                        \
+    for(kernel = 0; kernel < NKERNELS; kernel++)                        \
+    {                                                                   \
+      double valueRef = 0, maxErr = 0;                                  \
+      long indexRef = 0;                                                \
+      printf("%-8s %-7s", kernelNames[kernel], typeName);               \
+      for(isa = TH_VECTOR_DEFAULT; isa <= cpuIsa; isa++)                \
+      {                                                                 \
+        double value, t;                                                \
+        long index = 0;                                                 \
+        THVector_setIsa(isa);                                           \
+                                                                        \
+        /* one checked call from a known state, then the timed ones */  \
+        for(i = 0; i < n; i++)                                          \
+          z[i] = y[i];                                                  \
+        value = run##Real(kernel, x, y, z, n, &index);                  \
+        if(isa == TH_VECTOR_DEFAULT)                                    \
+        {                                                               \
+          valueRef = value;                                             \
+          indexRef = index;                                             \
+          memcpy(zRef, z, sizeof(real)*n);                              \
+        }                                                               \
+        else if(kernel >= SUM && kernel <= MIN)                         \
+        {                                                               \
+          maxErr = THMax(maxErr, fabs(value-valueRef)/THMax(fabs(valueRef), 1)); \
+          if(index != indexRef)                                         \
+            maxErr = HUGE_VAL;                                          \
+        }                                                               \
+        else                                                            \
+        {                                                               \
+          for(i = 0; i < n; i++)                                        \
+            maxErr = THMax(maxErr, fabs((double)z[i]-zRef[i])/THMax(fabs(zRef[i]), 1e-30)); \
+        }                                                               \
+                                                                        \
+        t = now();                                                      \
+        for(it = 0; it < iter; it++)                                    \
+          run##Real(kernel, x, y, z, n, &index);                        \
+        t = now()-t;                                                    \
+        printf(" %9.2f", (double)kernelStreams[kernel]*sizeof(real)*n*iter/t*1e-9); \
+      }                                                                 \
+      printf("   %.2e\n", maxErr);                                      \
+      if(!(maxErr <= tolerance))                                        \
+        ok = 0;                                                         \
+    }                                                                   \
+    THVector_setIsa(-1);                                                \
+                                                                        \
+    THFree(x);                                                          \
+    THFree(y);                                                          \
+    THFree(z);                                                          \
+    THFree(zRef);                                                       \
+    return ok;                                                          \
+  }
+
+BENCHMARK_RUN(Float, float)
+BENCHMARK_RUN(Double, double)
+
+int main(int argc, char **argv)
+{
+  long n = (argc >= 2 ? atol(argv[1]) : 1L << 20);
+  int iter = (argc >= 3 ? atoi(argv[2]) : 100);
+  int isa, ok = 1;
+
+  printf("n = %ld, %d iterations, CPU level %s, default level %s\n", n, iter,
+         THVector_isaName(THVector_cpuIsa()), THVector_isaName(THVector_getIsa()));
+  printf("%-16s", "GB/s");
+  for(isa = TH_VECTOR_DEFAULT; isa <= THVector_cpuIsa(); isa++)
+    printf(" %9s", THVector_isaName(isa));
+  printf("   max rel err\n");
+
+  /* the float approximations (exp, log...) are allowed a few ulp */
+  ok &= benchmarkFloat("float", n, iter, 1e-6);
+  ok &= benchmarkDouble("double", n, iter, 1e-12);
+
+  if(!ok)
+    printf("MISMATCH between the plain C and the vectorized kernels\n");
+
+  return ok ? 0 : 1;
+}
@@ -57,6 +57,47 @@ SET(SSE4_2_CODE "
   }
 ")
 
+SET(AVX_CODE "
+  #include <immintrin.h>
+
+  int main()
+  {
+    __m256 a;
+    a = _mm256_set1_ps(0);
+    a = _mm256_add_ps(a, a);
+    return 0;
+  }
+")
+
+SET(AVX2_CODE "
+  #include <immintrin.h>
+
+  int main()
+  {
+    __m256i a;
+    __m256 b;
+    a = _mm256_set1_epi32(0);
+    a = _mm256_add_epi32(a, a);
+    b = _mm256_set1_ps(0);
+    b = _mm256_fmadd_ps(b, b, b);
+    return 0;
+  }
+")
+
+SET(F16C_CODE "
+  #include <immintrin.h>
+
+  int main()
+  {
+    __m256 a;
+    __m128i b;
+    a = _mm256_set1_ps(0);
+    b = _mm256_cvtps_ph(a, 0);
+    a = _mm256_cvtph_ps(b);
+    return 0;
+  }
+")
+
 MACRO(CHECK_SSE lang type flags)
   SET(__FLAG_I 1)
   SET(CMAKE_REQUIRED_FLAGS_SAVE ${CMAKE_REQUIRED_FLAGS})
@@ -91,9 +132,13 @@ CHECK_SSE(C "SSE2" " ;-msse2;/arch:SSE2")
 CHECK_SSE(C "SSE3" " ;-msse3;/arch:SSE3")
 CHECK_SSE(C "SSE4_1" " ;-msse4.1;-msse4;/arch:SSE4")
 CHECK_SSE(C "SSE4_2" " ;-msse4.2;-msse4;/arch:SSE4")
+CHECK_SSE(C "AVX" " ;-mavx;/arch:AVX")
+CHECK_SSE(C "AVX2" " ;-mavx2 -mfma;/arch:AVX2")
 
 CHECK_SSE(CXX "SSE1" " ;-msse;/arch:SSE")
 CHECK_SSE(CXX "SSE2" " ;-msse2;/arch:SSE2")
 CHECK_SSE(CXX "SSE3" " ;-msse3;/arch:SSE3")
 CHECK_SSE(CXX "SSE4_1" " ;-msse4.1;-msse4;/arch:SSE4")
 CHECK_SSE(CXX "SSE4_2" " ;-msse4.2;-msse4;/arch:SSE4")
+CHECK_SSE(CXX "AVX" " ;-mavx;/arch:AVX")
+CHECK_SSE(CXX "AVX2" " ;-mavx2 -mfma;/arch:AVX2")
@@ -267,6 +267,330 @@ void THBlas_(ger)(long m, long n, real alpha, real *x, long incx, real *y, long
   }
 }
 
+/* Built-in GEMM, used when no BLAS library is found at compile time.
+   The classic three-level blocking is used: op(B) is packed into
+   THBLAS_GEMM_KC x THBLAS_GEMM_NC slabs that stay in the last level cache,
+   op(A) into THBLAS_GEMM_MC x THBLAS_GEMM_KC blocks that stay in L2, and a
+   THBLAS_GEMM_MR x THBLAS_GEMM_NR micro-kernel keeps its part of C in
+   registers while streaming through the packed panels. */
+
+#if defined(TH_REAL_IS_FLOAT) && (defined(USE_SSE2) || defined(TH_VECTOR_HAVE_AVX))
+#define THBLAS_GEMM_MR 8
+#else
+#define THBLAS_GEMM_MR 4
+#endif
+#define THBLAS_GEMM_NR 4
+#define THBLAS_GEMM_MC 128
+#define THBLAS_GEMM_KC 256
+#define THBLAS_GEMM_NC 4096
+#define THBLAS_GEMM_OMP_THRESHOLD 65536
+
+/* Copies a mc x kc block of op(A) into row panels of THBLAS_GEMM_MR rows.
+   Each panel is stored k-major; rows past mc are zero padded. */
+static void THBlas_(gemmPackA)(int transa, long mc, long kc, real *a, long lda, real *ap)
+{
+  long i, p, ir;
+
+  for(ir = 0; ir < mc; ir += THBLAS_GEMM_MR)
+  {
+    long mr = THMin(mc-ir, THBLAS_GEMM_MR);
+
+    if(transa)
+    {
+      for(i = 0; i < mr; i++)
+      {
+        real *a_ = a+(ir+i)*lda;
+        for(p = 0; p < kc; p++)
+          ap[p*THBLAS_GEMM_MR+i] = a_[p];
+      }
+    }
+    else
+    {
+      for(p = 0; p < kc; p++)
+      {
+        real *a_ = a+p*lda+ir;
+        for(i = 0; i < mr; i++)
+          ap[p*THBLAS_GEMM_MR+i] = a_[i];
+      }
+    }
+
+    for(i = mr; i < THBLAS_GEMM_MR; i++)
+    {
+      for(p = 0; p < kc; p++)
+        ap[p*THBLAS_GEMM_MR+i] = 0;
+    }
+
+    ap += THBLAS_GEMM_MR*kc;
+  }
+}
+
+/* Copies a kc x nc block of op(B) into column panels of THBLAS_GEMM_NR
+   columns. Each panel is stored k-major; columns past nc are zero padded. */
+static void THBlas_(gemmPackB)(int transb, long kc, long nc, real *b, long ldb, real *bp, int parallel)
+{
+  long jr;
+
+#pragma omp parallel for if(parallel) private(jr)
+  for(jr = 0; jr < nc; jr += THBLAS_GEMM_NR)
+  {
+    long nr = THMin(nc-jr, THBLAS_GEMM_NR);
+    real *bp_ = bp+jr*kc;
+    long j, p;
+
+    if(transb)
+    {
+      for(p = 0; p < kc; p++)
+      {
+        real *b_ = b+p*ldb+jr;
+        for(j = 0; j < nr; j++)
+          bp_[p*THBLAS_GEMM_NR+j] = b_[j];
+      }
+    }
+    else
+    {
+      for(j = 0; j < nr; j++)
+      {
+        real *b_ = b+(jr+j)*ldb;
+        for(p = 0; p < kc; p++)
+          bp_[p*THBLAS_GEMM_NR+j] = b_[p];
+      }
+    }
+
+    for(j = nr; j < THBLAS_GEMM_NR; j++)
+    {
+      for(p = 0; p < kc; p++)
+        bp_[p*THBLAS_GEMM_NR+j] = 0;
+    }
+  }
+}
+
+/* ab (column-major, THBLAS_GEMM_MR x THBLAS_GEMM_NR) = ap * bp */
+static void THBlas_(gemmKernel)(long kc, real *ap, real *bp, real *ab)
+{
+  long p;
+
+#if defined(TH_REAL_IS_FLOAT) || defined(TH_REAL_IS_DOUBLE)
+  /* AVX micro-kernels live in vector/, compiled for their instruction set */
+#if defined(TH_VECTOR_HAVE_AVX2)
+  if(THVector_getIsa() >= TH_VECTOR_AVX2)
+  {
+    THBlas_(gemmKernel_AVX2)(kc, ap, bp, ab);
+    return;
+  }
+#endif
+#if defined(TH_VECTOR_HAVE_AVX)
+  if(THVector_getIsa() >= TH_VECTOR_AVX)
+  {
+    THBlas_(gemmKernel_AVX)(kc, ap, bp, ab);
+    return;
+  }
+#endif
+#endif
+
+#if defined(TH_REAL_IS_FLOAT) && defined(USE_SSE2)
+  __m128 c00 = _mm_setzero_ps(), c10 = _mm_setzero_ps();
+  __m128 c01 = _mm_setzero_ps(), c11 = _mm_setzero_ps();
+  __m128 c02 = _mm_setzero_ps(), c12 = _mm_setzero_ps();
+  __m128 c03 = _mm_setzero_ps(), c13 = _mm_setzero_ps();
+  for(p = 0; p < kc; p++)
+  {
+    __m128 a0 = _mm_loadu_ps(ap);
+    __m128 a1 = _mm_loadu_ps(ap+4);
+    __m128 b_;
+    b_ = _mm_set1_ps(bp[0]);
+    c00 = _mm_add_ps(c00, _mm_mul_ps(a0, b_));
+    c10 = _mm_add_ps(c10, _mm_mul_ps(a1, b_));
+    b_ = _mm_set1_ps(bp[1]);
+    c01 = _mm_add_ps(c01, _mm_mul_ps(a0, b_));
+    c11 = _mm_add_ps(c11, _mm_mul_ps(a1, b_));
+    b_ = _mm_set1_ps(bp[2]);
+    c02 = _mm_add_ps(c02, _mm_mul_ps(a0, b_));
+    c12 = _mm_add_ps(c12, _mm_mul_ps(a1, b_));
+    b_ = _mm_set1_ps(bp[3]);
+    c03 = _mm_add_ps(c03, _mm_mul_ps(a0, b_));
+    c13 = _mm_add_ps(c13, _mm_mul_ps(a1, b_));
+    ap += THBLAS_GEMM_MR;
+    bp += THBLAS_GEMM_NR;
+  }
+  _mm_storeu_ps(ab, c00);    _mm_storeu_ps(ab+4, c10);
+  _mm_storeu_ps(ab+8, c01);  _mm_storeu_ps(ab+12, c11);
+  _mm_storeu_ps(ab+16, c02); _mm_storeu_ps(ab+20, c12);
+  _mm_storeu_ps(ab+24, c03); _mm_storeu_ps(ab+28, c13);
+#elif defined(TH_REAL_IS_DOUBLE) && defined(USE_SSE2)
+  __m128d c00 = _mm_setzero_pd(), c10 = _mm_setzero_pd();
+  __m128d c01 = _mm_setzero_pd(), c11 = _mm_setzero_pd();
+  __m128d c02 = _mm_setzero_pd(), c12 = _mm_setzero_pd();
+  __m128d c03 = _mm_setzero_pd(), c13 = _mm_setzero_pd();
+  for(p = 0; p < kc; p++)
+  {
+    __m128d a0 = _mm_loadu_pd(ap);
+    __m128d a1 = _mm_loadu_pd(ap+2);
+    __m128d b_;
+    b_ = _mm_set1_pd(bp[0]);
+    c00 = _mm_add_pd(c00, _mm_mul_pd(a0, b_));
+    c10 = _mm_add_pd(c10, _mm_mul_pd(a1, b_));
+    b_ = _mm_set1_pd(bp[1]);
+    c01 = _mm_add_pd(c01, _mm_mul_pd(a0, b_));
+    c11 = _mm_add_pd(c11, _mm_mul_pd(a1, b_));
+    b_ = _mm_set1_pd(bp[2]);
+    c02 = _mm_add_pd(c02, _mm_mul_pd(a0, b_));
+    c12 = _mm_add_pd(c12, _mm_mul_pd(a1, b_));
+    b_ = _mm_set1_pd(bp[3]);
+    c03 = _mm_add_pd(c03, _mm_mul_pd(a0, b_));
+    c13 = _mm_add_pd(c13, _mm_mul_pd(a1, b_));
+    ap += THBLAS_GEMM_MR;
+    bp += THBLAS_GEMM_NR;
+  }
+  _mm_storeu_pd(ab, c00);    _mm_storeu_pd(ab+2, c10);
+  _mm_storeu_pd(ab+4, c01);  _mm_storeu_pd(ab+6, c11);
+  _mm_storeu_pd(ab+8, c02);  _mm_storeu_pd(ab+10, c12);
+  _mm_storeu_pd(ab+12, c03); _mm_storeu_pd(ab+14, c13);
+#else
+  long i, j;
+  for(i = 0; i < THBLAS_GEMM_MR*THBLAS_GEMM_NR; i++)
+    ab[i] = 0;
+  for(p = 0; p < kc; p++)
+  {
+    for(j = 0; j < THBLAS_GEMM_NR; j++)
+    {
+      real z = bp[j];
+      for(i = 0; i < THBLAS_GEMM_MR; i++)
+        ab[j*THBLAS_GEMM_MR+i] += ap[i]*z;
+    }
+    ap += THBLAS_GEMM_MR;
+    bp += THBLAS_GEMM_NR;
+  }
+#endif
+}
+
+/* c = beta*c + alpha*(packed A block)*(packed B panels), for a mc x nc tile */
+static void THBlas_(gemmMacroKernel)(long mc, long nc, long kc, real alpha, real *ap, real *bp, real beta, real *c, long ldc)
+{
+  real ab[THBLAS_GEMM_MR*THBLAS_GEMM_NR];
+  long ir, jr, i, j;
+
+  for(jr = 0; jr < nc; jr += THBLAS_GEMM_NR)
+  {
+    long nr = THMin(nc-jr, THBLAS_GEMM_NR);
+    for(ir = 0; ir < mc; ir += THBLAS_GEMM_MR)
+    {
+      long mr = THMin(mc-ir, THBLAS_GEMM_MR);
+      THBlas_(gemmKernel)(kc, ap+ir*kc, bp+jr*kc, ab);
+
+      for(j = 0; j < nr; j++)
+      {
+        real *c_ = c+(jr+j)*ldc+ir;
+        real *ab_ = ab+j*THBLAS_GEMM_MR;
+        if(beta == 0)
+        {
+          for(i = 0; i < mr; i++)
+            c_[i] = alpha*ab_[i];
+        }
+        else
+        {
+          for(i = 0; i < mr; i++)
+            c_[i] = beta*c_[i] + alpha*ab_[i];
+        }
+      }
+    }
+  }
+}
+
+static void THBlas_(gemmBlocked)(int transa, int transb, long m, long n, long k, real alpha, real *a, long lda, real *b, long ldb, real beta, real *c, long ldc)
+{
+  int parallel = 0;
+  int nThreads = 1;
+  long jc, pc;
+  real *ap, *bp;
+
+  if((m == 0) || (n == 0))
+    return;
+
+  /* nothing to accumulate: c = beta*c, without touching a or b */
+  if((k == 0) || (alpha == 0))
+  {
+    long i, j;
+    for(j = 0; j < n; j++)
+    {
+      real *c_ = c+j*ldc;
+      for(i = 0; i < m; i++)
+        c_[i] = (beta == 0 ? 0 : beta*c_[i]);
+    }
+    return;
+  }
+
+#ifdef _OPENMP
+  parallel = !omp_in_parallel() && ((double)m*(double)n*(double)k >= THBLAS_GEMM_OMP_THRESHOLD);
+  if(parallel)
+    nThreads = omp_get_max_threads();
+#endif
+
+  ap = THAlloc(sizeof(real)*nThreads*THBLAS_GEMM_MC*THBLAS_GEMM_KC);
+  bp = THAlloc(sizeof(real)*THBLAS_GEMM_KC*((THMin(n, THBLAS_GEMM_NC)+THBLAS_GEMM_NR-1)/THBLAS_GEMM_NR)*THBLAS_GEMM_NR);
+
+  for(jc = 0; jc < n; jc += THBLAS_GEMM_NC)
+  {
+    long nc = THMin(n-jc, THBLAS_GEMM_NC);
+    long nPanels = (nc+THBLAS_GEMM_NR-1)/THBLAS_GEMM_NR;
+
+    for(pc = 0; pc < k; pc += THBLAS_GEMM_KC)
+    {
+      long kc = THMin(k-pc, THBLAS_GEMM_KC);
+      real beta_ = (pc == 0 ? beta : 1);
+      long mBlocks = (m+THBLAS_GEMM_MC-1)/THBLAS_GEMM_MC;
+      long nChunks, chunkPanels, nTiles, t;
+
+      THBlas_(gemmPackB)(transb, kc, nc, (transb ? b+pc*ldb+jc : b+jc*ldb+pc), ldb, bp, parallel);
+
+      /* the tiles handed to threads are (MC rows) x (chunkPanels panels);
+         split N further only when there are not enough row blocks */
+      nChunks = THMax(1, THMin(nPanels, (nThreads+mBlocks-1)/mBlocks));
+      chunkPanels = (nPanels+nChunks-1)/nChunks;
+      nChunks = (nPanels+chunkPanels-1)/chunkPanels;
+      nTiles = mBlocks*nChunks;
+
+#pragma omp parallel if(parallel) private(t)
+      {
+        long packed = -1;
+        real *ap_ = ap;
+#ifdef _OPENMP
+        ap_ += omp_get_thread_num()*THBLAS_GEMM_MC*THBLAS_GEMM_KC;
+#endif
+
+#pragma omp for schedule(static)
+        for(t = 0; t < nTiles; t++)
+        {
+          long ib = t/nChunks;
+          long ic = ib*THBLAS_GEMM_MC;
+          long mc = THMin(m-ic, THBLAS_GEMM_MC);
+          long jr0 = (t%nChunks)*chunkPanels*THBLAS_GEMM_NR;
+          long jr1 = THMin(jr0+chunkPanels*THBLAS_GEMM_NR, nc);
+
+          /* static scheduling hands each thread consecutive tiles, so the
+             A block is usually reused across them */
+          if(ib != packed)
+          {
+            THBlas_(gemmPackA)(transa, mc, kc, (transa ? a+ic*lda+pc : a+pc*lda+ic), lda, ap_);
+            packed = ib;
+          }
+
+          THBlas_(gemmMacroKernel)(mc, jr1-jr0, kc, alpha, ap_, bp+jr0*kc, beta_, c+(jc+jr0)*ldc+ic, ldc);
+        }
+      }
+    }
+  }
+
+  THFree(ap);
+  THFree(bp);
+}
+
+#undef THBLAS_GEMM_MR
+#undef THBLAS_GEMM_NR
+#undef THBLAS_GEMM_MC
+#undef THBLAS_GEMM_KC
+#undef THBLAS_GEMM_NC
+#undef THBLAS_GEMM_OMP_THRESHOLD
+
 void THBlas_(gemm)(char transa, char transb, long m, long n, long k, real alpha, real *a, long lda, real *b, long ldb, real beta, real *c, long ldc)
 {
   int transa_ = ((transa == 't') || (transa == 'T'));
@@ -315,77 +639,8 @@ void THBlas_(gemm)(char transa, char transb, long m, long n, long k, real alpha,
     return;
   }
 #endif
-  {
-    long i, j, l;
-    if(!transa_ && !transb_)
-    {
-      real *a_ = a;
-      for(i = 0; i < m; i++)
-      {
-        real *b_ = b;
-        for(j = 0; j < n; j++)
-        {
-          real sum = 0;
-          for(l = 0; l < k; l++)
-            sum += a_[l*lda]*b_[l];
-          b_ += ldb;
-          c[j*ldc+i] = beta*c[j*ldc+i]+alpha*sum;
-        }
-        a_++;
-      }
-    }
-    else if(transa_ && !transb_)
-    {
-      real *a_ = a;
-      for(i = 0; i < m; i++)
-      {
-        real *b_ = b;
-        for(j = 0; j < n; j++)
-        {
-          real sum = 0;
-          for(l = 0; l < k; l++)
-            sum += a_[l]*b_[l];
-          b_ += ldb;
-          c[j*ldc+i] = beta*c[j*ldc+i]+alpha*sum;
-        }
-        a_ += lda;
-      }
-    }
-    else if(!transa_ && transb_)
-    {
-      real *a_ = a;
-      for(i = 0; i < m; i++)
-      {
-        real *b_ = b;
-        for(j = 0; j < n; j++)
-        {
-          real sum = 0;
-          for(l = 0; l < k; l++)
-            sum += a_[l*lda]*b_[l*ldb];
-          b_++;
-          c[j*ldc+i] = beta*c[j*ldc+i]+alpha*sum;
-        }
-        a_++;
-      }
-    }
-    else
-    {
-      real *a_ = a;
-      for(i = 0; i < m; i++)
-      {
-        real *b_ = b;
-        for(j = 0; j < n; j++)
-        {
-          real sum = 0;
-          for(l = 0; l < k; l++)
-            sum += a_[l]*b_[l*ldb];
-          b_++;
-          c[j*ldc+i] = beta*c[j*ldc+i]+alpha*sum;
-        }
-        a_ += lda;
-      }
-    }
-  }
+
+  THBlas_(gemmBlocked)(transa_, transb_, m, n, k, alpha, a, lda, b, ldb, beta, c, ldc);
 }
 
 #endif
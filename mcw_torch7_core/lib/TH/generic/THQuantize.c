@@ -0,0 +1,115 @@
+#ifndef TH_GENERIC_FILE
+#define TH_GENERIC_FILE "generic/THQuantize.c"
+#else
+
+/* x rounded to the nearest (even) integer, without branches: adding and
+   removing 1.5*2^23 (2^52) pushes the fraction out of the mantissa */
+#if defined(TH_REAL_IS_FLOAT)
+#define THQUANT_ROUNDER 12582912.0f
+#else
+#define THQUANT_ROUNDER 6755399441055744.0
+#endif
+
+real THQuant_(scale)(const real *x, const long n)
+{
+  real absMax = 0;
+  long i;
+
+#if defined(TH_REAL_IS_FLOAT) && defined(TH_VECTOR_HAVE_AVX2)
+  if(THVector_getIsa() >= TH_VECTOR_AVX2)
+    absMax = THFloatQuant_absMax_AVX2(x, n);
+  else
+#endif
+  for(i = 0; i < n; i++)
+  {
+    real v = (x[i] < 0 ? -x[i] : x[i]);
+    absMax = (v > absMax ? v : absMax);
+  }
+  return (absMax > 0 ? absMax/127 : 1);
+}
+
+void THQuant_(quantize)(signed char *q, const real *x, const long n, const real scale)
+{
+  real inv = 1/scale;
+  long i;
+
+#if defined(TH_REAL_IS_FLOAT) && defined(TH_VECTOR_HAVE_AVX2)
+  if(THVector_getIsa() >= TH_VECTOR_AVX2)
+  {
+    THFloatQuant_quantize_AVX2(q, x, n, inv);
+    return;
+  }
+#endif
+  for(i = 0; i < n; i++)
+  {
+    real v = x[i]*inv;
+    v = (v+THQUANT_ROUNDER)-THQUANT_ROUNDER;
+    v = (v > -127 ? v : -127);
+    v = (v < 127 ? v : 127);
+    q[i] = (signed char)(int)v;
+  }
+}
+
+void THQuant_(quantizeRows)(signed char *q, long ldq, real *scale,
+                            const real *x, long m, long n, long ldx, real fixedScale)
+{
+  long i;
+
+  THArgCheck(ldq >= n, 2, "quantized rows too short");
+#pragma omp parallel for if(m*n >= THQUANT_OMP_THRESHOLD) private(i)
+  for(i = 0; i < m; i++)
+  {
+    scale[i] = (fixedScale != 0 ? fixedScale : THQuant_(scale)(x+i*ldx, n));
+    THQuant_(quantize)(q+i*ldq, x+i*ldx, n, scale[i]);
+    memset(q+i*ldq+n, 0, ldq-n);
+  }
+}
+
+void THQuant_(gemm)(long m, long n, long k,
+                    const signed char *a, long lda, const real *aScale, const real *bias,
+                    const signed char *b, long ldb, const real *bScale,
+                    int relu, real *y, long ys0, long ys1)
+{
+  THQuantKernel kernel = THQuant_kernel();
+  long nc = THQuant_blockRows(ldb);
+  int parallel = THQuant_parallel(m, n, k);
+  long jc, i;
+
+  if(m == 0 || n == 0)
+    return;
+
+  for(jc = 0; jc < n; jc += nc)
+  {
+    long jEnd = THMin(n, jc+nc);
+#pragma omp parallel for if(parallel) private(i)
+    for(i = 0; i < m; i += THQUANT_GEMM_MR)
+    {
+      const signed char *ar[THQUANT_GEMM_MR], *br[THQUANT_GEMM_NR];
+      int tile[THQUANT_GEMM_MR*THQUANT_GEMM_NR];
+      long j, ii, jj;
+
+      for(j = jc; j < jEnd; j += THQUANT_GEMM_NR)
+      {
+        THQuant_tileRows(i, j, m, n, a, lda, b, ldb, ar, br);
+        kernel(k, ar, br, tile);
+
+        /* requantization: int32 sums back to real, bias and ReLU */
+        for(ii = 0; ii < THMin(THQUANT_GEMM_MR, m-i); ii++)
+        {
+          real s = aScale[i+ii];
+          real offset = (bias ? bias[i+ii] : 0);
+          real *y_ = y + (i+ii)*ys0;
+          for(jj = 0; jj < THMin(THQUANT_GEMM_NR, jEnd-j); jj++)
+          {
+            real v = s*bScale[j+jj]*(real)tile[ii*THQUANT_GEMM_NR+jj] + offset;
+            y_[(j+jj)*ys1] = (relu && v < 0 ? 0 : v);
+          }
+        }
+      }
+    }
+  }
+}
+
+#undef THQUANT_ROUNDER
+
+#endif
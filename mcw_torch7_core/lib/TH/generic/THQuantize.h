@@ -0,0 +1,25 @@
+#ifndef TH_GENERIC_FILE
+#define TH_GENERIC_FILE "generic/THQuantize.h"
+#else
+
+/* max|x|/127 over n values, 1 if they are all zero */
+TH_API real THQuant_(scale)(const real *x, const long n);
+
+/* q[i] = round(x[i]/scale), clamped to [-127, 127] */
+TH_API void THQuant_(quantize)(signed char *q, const real *x, const long n, const real scale);
+
+/* Quantizes the m rows of x (n values, ldx apart) into the rows of q (ldq
+   apart, zero padded from n to ldq). scale[i] receives the scale of row i:
+   its own THQuant_(scale) if fixedScale is 0, else fixedScale. */
+TH_API void THQuant_(quantizeRows)(signed char *q, long ldq, real *scale,
+                                   const real *x, long m, long n, long ldx, real fixedScale);
+
+/* y[i*ys0+j*ys1] = aScale[i]*bScale[j]*(a_i . b_j) + bias[i], with the dot
+   products of the int8 rows accumulated in int32 and dequantized, biased
+   (bias may be NULL) and, if relu, clamped at 0 while still in registers */
+TH_API void THQuant_(gemm)(long m, long n, long k,
+                           const signed char *a, long lda, const real *aScale, const real *bias,
+                           const signed char *b, long ldb, const real *bScale,
+                           int relu, real *y, long ys0, long ys1);
+
+#endif
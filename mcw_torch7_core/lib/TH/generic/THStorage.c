@@ -38,7 +38,12 @@ THStorage* THStorage_(newWithAllocator)(long size,
 
 THStorage* THStorage_(newWithMapping)(const char *filename, long size, int shared)
 {
-  THMapAllocatorContext *ctx = THMapAllocatorContext_new(filename, shared);
+  return THStorage_(newWithMappingOffset)(filename, 0, size, shared);
+}
+
+THStorage* THStorage_(newWithMappingOffset)(const char *filename, long offset, long size, int shared)
+{
+  THMapAllocatorContext *ctx = THMapAllocatorContext_newWithOffset(filename, shared, offset);
 
   THStorage *storage = THStorage_(newWithAllocator)(size,
                                                     &THMapAllocator,
@@ -44,6 +44,8 @@ TH_API THStorage* THStorage_(newWithSize2)(real, real);
 TH_API THStorage* THStorage_(newWithSize3)(real, real, real);
 TH_API THStorage* THStorage_(newWithSize4)(real, real, real, real);
 TH_API THStorage* THStorage_(newWithMapping)(const char *filename, long size, int shared);
+/* maps size elements of the file from byte offset on (the rest of the file if size <= 0) */
+TH_API THStorage* THStorage_(newWithMappingOffset)(const char *filename, long offset, long size, int shared);
 
 /* takes ownership of data */
 TH_API THStorage* THStorage_(newWithData)(real *data, long size);
@@ -15,6 +15,12 @@ void THStorage_(copy)(THStorage *storage, THStorage *src)
   THStorage_(rawCopy)(storage, src->data);
 }
 
+/* Half has no arithmetic: values go through float */
+#if defined(TH_REAL_IS_HALF)
+#define THStorage_copyValue(x) TH_float2half((float)(x))
+#else
+#define THStorage_copyValue(x) ((real)(x))
+#endif
 
 #define IMPLEMENT_THStorage_COPY(TYPENAMESRC) \
 void THStorage_(copy##TYPENAMESRC)(THStorage *storage, TH##TYPENAMESRC##Storage *src) \
@@ -22,7 +28,7 @@ void THStorage_(copy##TYPENAMESRC)(THStorage *storage, TH##TYPENAMESRC##Storage
   long i; \
   THArgCheck(storage->size == src->size, 2, "size mismatch"); \
   for(i = 0; i < storage->size; i++) \
-    storage->data[i] = (real)src->data[i]; \
+    storage->data[i] = THStorage_copyValue(src->data[i]); \
 }
 
 IMPLEMENT_THStorage_COPY(Byte)
@@ -30,7 +36,34 @@ IMPLEMENT_THStorage_COPY(Char)
 IMPLEMENT_THStorage_COPY(Short)
 IMPLEMENT_THStorage_COPY(Int)
 IMPLEMENT_THStorage_COPY(Long)
+#if defined(TH_REAL_IS_HALF)
+void THStorage_(copyFloat)(THStorage *storage, THFloatStorage *src)
+{
+  THArgCheck(storage->size == src->size, 2, "size mismatch");
+  THHalf_copyFromFloat(storage->data, src->data, storage->size);
+}
+#else
 IMPLEMENT_THStorage_COPY(Float)
+#endif
 IMPLEMENT_THStorage_COPY(Double)
 
+void THStorage_(copyHalf)(THStorage *storage, THHalfStorage *src)
+{
+  THArgCheck(storage->size == src->size, 2, "size mismatch");
+#if defined(TH_REAL_IS_HALF)
+  THStorage_(rawCopy)(storage, src->data);
+#elif defined(TH_REAL_IS_FLOAT)
+  THHalf_copyToFloat(storage->data, src->data, storage->size);
+#else
+  {
+    long i;
+    for(i = 0; i < storage->size; i++)
+      storage->data[i] = (real)TH_half2float(src->data[i]);
+  }
+#endif
+}
+
+#undef IMPLEMENT_THStorage_COPY
+#undef THStorage_copyValue
+
 #endif
@@ -4,13 +4,20 @@
 
 void THTensor_(copy)(THTensor *tensor, THTensor *src)
 {
-  TH_TENSOR_APPLY2(real, tensor, real, src, *tensor_data = (real)(*src_data);)
+  TH_TENSOR_APPLY2(real, tensor, real, src, *tensor_data = *src_data;)
 }
 
+/* Half has no arithmetic: values go through float */
+#if defined(TH_REAL_IS_HALF)
+#define THTensor_copyValue(x) TH_float2half((float)(x))
+#else
+#define THTensor_copyValue(x) ((real)(x))
+#endif
+
 #define IMPLEMENT_THTensor_COPY(TYPENAMESRC, TYPE_SRC) \
 void THTensor_(copy##TYPENAMESRC)(THTensor *tensor, TH##TYPENAMESRC##Tensor *src) \
 { \
-  TH_TENSOR_APPLY2(real, tensor, TYPE_SRC, src, *tensor_data = (real)(*src_data);) \
+  TH_TENSOR_APPLY2(real, tensor, TYPE_SRC, src, *tensor_data = THTensor_copyValue(*src_data);) \
 }
 
 IMPLEMENT_THTensor_COPY(Byte, unsigned char)
@@ -18,7 +25,39 @@ IMPLEMENT_THTensor_COPY(Char, char)
 IMPLEMENT_THTensor_COPY(Short, short)
 IMPLEMENT_THTensor_COPY(Int, int)
 IMPLEMENT_THTensor_COPY(Long, long)
+#if defined(TH_REAL_IS_HALF)
+/* the contiguous runs go through the vectorized conversion */
+void THTensor_(copyFloat)(THTensor *tensor, THFloatTensor *src)
+{
+  TH_TENSOR_PAPPLY2_VEC(real, tensor, float, src,
+                        *tensor_data = TH_float2half(*src_data);,
+                        THHalf_copyFromFloat(tensor_data, src_data, TH_TENSOR_APPLY_len);)
+}
+#else
 IMPLEMENT_THTensor_COPY(Float, float)
+#endif
 IMPLEMENT_THTensor_COPY(Double, double)
 
+#if defined(TH_REAL_IS_HALF)
+void THTensor_(copyHalf)(THTensor *tensor, THHalfTensor *src)
+{
+  THTensor_(copy)(tensor, src);
+}
+#elif defined(TH_REAL_IS_FLOAT)
+void THTensor_(copyHalf)(THTensor *tensor, THHalfTensor *src)
+{
+  TH_TENSOR_PAPPLY2_VEC(real, tensor, THHalf, src,
+                        *tensor_data = TH_half2float(*src_data);,
+                        THHalf_copyToFloat(tensor_data, src_data, TH_TENSOR_APPLY_len);)
+}
+#else
+void THTensor_(copyHalf)(THTensor *tensor, THHalfTensor *src)
+{
+  TH_TENSOR_APPLY2(real, tensor, THHalf, src, *tensor_data = (real)TH_half2float(*src_data);)
+}
+#endif
+
+#undef IMPLEMENT_THTensor_COPY
+#undef THTensor_copyValue
+
 #endif
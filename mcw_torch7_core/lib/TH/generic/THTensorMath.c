@@ -2,18 +2,16 @@
 #define TH_GENERIC_FILE "generic/THTensorMath.c"
 #else
 
-#define TH_OMP_OVERHEAD_THRESHOLD 100000
-
 void THTensor_(fill)(THTensor *r_, real value)
 {
-  TH_TENSOR_APPLY(real, r_, 
-                  THVector_(fill)(r__data, value, r__size); break;);
+  TH_TENSOR_PAPPLY_VEC(real, r_, *r__data = value;,
+                       THVector_(fill)(r__data, value, TH_TENSOR_APPLY_len););
 }
 
 void THTensor_(zero)(THTensor *r_)
 {
-  TH_TENSOR_APPLY(real, r_, 
-                  THVector_(fill)(r__data, 0, r__size); break;);
+  TH_TENSOR_PAPPLY_VEC(real, r_, *r__data = 0;,
+                       THVector_(fill)(r__data, 0, TH_TENSOR_APPLY_len););
 }
 
 void THTensor_(maskedFill)(THTensor *tensor, THByteTensor *mask, real value)
@@ -179,6 +177,11 @@ void THTensor_(indexFill)(THTensor *tensor, int dim, THLongTensor *index, real v
 accreal THTensor_(dot)(THTensor *tensor, THTensor *src)
 {
   accreal sum = 0;
+  if(THTensor_(isContiguous)(tensor) && THTensor_(isContiguous)(src))
+  {
+    THArgCheck(THTensor_(nElement)(tensor) == THTensor_(nElement)(src), 2, "inconsistent tensor size");
+    return THVector_(dot)(THTensor_(data)(tensor), THTensor_(data)(src), THTensor_(nElement)(tensor));
+  }
   /* we use a trick here. careful with that. */
   TH_TENSOR_APPLY2(real, tensor, real, src,
                    long sz = (tensor_size-tensor_i < src_size-src_i ? tensor_size-tensor_i : src_size-src_i);
@@ -195,6 +198,8 @@ real THTensor_(minall)(THTensor *tensor)
 {
   real theMin;
   THArgCheck(tensor->nDimension > 0, 1, "tensor must have one dimension");
+  if(THTensor_(isContiguous)(tensor))
+    return THVector_(min)(THTensor_(data)(tensor), THTensor_(nElement)(tensor), NULL);
   theMin = THTensor_(data)(tensor)[0];
   TH_TENSOR_APPLY(real, tensor, if(*tensor_data < theMin) theMin = *tensor_data;);
   return theMin; 
@@ -204,6 +209,8 @@ real THTensor_(maxall)(THTensor *tensor)
 {
   real theMax;
   THArgCheck(tensor->nDimension > 0, 1, "tensor must have one dimension");
+  if(THTensor_(isContiguous)(tensor))
+    return THVector_(max)(THTensor_(data)(tensor), THTensor_(nElement)(tensor), NULL);
   theMax = THTensor_(data)(tensor)[0];
   TH_TENSOR_APPLY(real, tensor, if(*tensor_data > theMax) theMax = *tensor_data;);
   return theMax; 
@@ -212,6 +219,8 @@ real THTensor_(maxall)(THTensor *tensor)
 accreal THTensor_(sumall)(THTensor *tensor)
 {
   accreal sum = 0;
+  if(THTensor_(isContiguous)(tensor))
+    return THVector_(sum)(THTensor_(data)(tensor), THTensor_(nElement)(tensor));
   TH_TENSOR_APPLY(real, tensor, sum += *tensor_data;);
   return sum;
 }
@@ -226,121 +235,62 @@ accreal THTensor_(prodall)(THTensor *tensor)
 void THTensor_(add)(THTensor *r_, THTensor *t, real value)
 {
   THTensor_(resizeAs)(r_, t);
-  if (THTensor_(isContiguous)(r_) && THTensor_(isContiguous)(t) && THTensor_(nElement)(r_) == THTensor_(nElement)(t)) {
-      real *tp = THTensor_(data)(t);
-      real *rp = THTensor_(data)(r_);
-      long sz = THTensor_(nElement)(t);
-      long i;
-      #pragma omp parallel for if(sz > TH_OMP_OVERHEAD_THRESHOLD) private(i)
-      for (i=0; i<sz; i++)
-          rp[i] = tp[i] + value;
-  } else {
-      TH_TENSOR_APPLY2(real, r_, real, t, *r__data = *t_data + value;);
-  }
+  TH_TENSOR_PAPPLY2(real, r_, real, t, *r__data = *t_data + value;);
 }
 
 void THTensor_(mul)(THTensor *r_, THTensor *t, real value)
 {
   THTensor_(resizeAs)(r_, t);
-  if (THTensor_(isContiguous)(r_) && THTensor_(isContiguous)(t) && THTensor_(nElement)(r_) == THTensor_(nElement)(t)) {
-      real *tp = THTensor_(data)(t);
-      real *rp = THTensor_(data)(r_);
-      long sz = THTensor_(nElement)(t);
-      long i;
-      #pragma omp parallel for if(sz > TH_OMP_OVERHEAD_THRESHOLD) private(i)
-      for (i=0; i<sz; i++)
-          rp[i] = tp[i] * value;
+  if (r_ == t) {
+    TH_TENSOR_PAPPLY_VEC(real, r_, *r__data *= value;,
+                         THVector_(scale)(r__data, value, TH_TENSOR_APPLY_len););
   } else {
-      TH_TENSOR_APPLY2(real, r_, real, t, *r__data = *t_data * value;);
+    TH_TENSOR_PAPPLY2(real, r_, real, t, *r__data = *t_data * value;);
   }
 }
 
 void THTensor_(div)(THTensor *r_, THTensor *t, real value)
 {
   THTensor_(resizeAs)(r_, t);
-  if (THTensor_(isContiguous)(r_) && THTensor_(isContiguous)(t) && THTensor_(nElement)(r_) == THTensor_(nElement)(t)) {
-      real *tp = THTensor_(data)(t);
-      real *rp = THTensor_(data)(r_);
-      long sz = THTensor_(nElement)(t);
-      long i;
-      #pragma omp parallel for if(sz > TH_OMP_OVERHEAD_THRESHOLD) private(i)
-      for (i=0; i<sz; i++)
-          rp[i] = tp[i] / value;
-  } else {
-      TH_TENSOR_APPLY2(real, r_, real, t, *r__data = *t_data / value;);
-  }
+  TH_TENSOR_PAPPLY2(real, r_, real, t, *r__data = *t_data / value;);
 }
 
 void THTensor_(clamp)(THTensor *r_, THTensor *t, real min_value, real max_value)
 {
   THTensor_(resizeAs)(r_, t);
-  if (THTensor_(isContiguous)(r_) && THTensor_(isContiguous)(t) && THTensor_(nElement)(r_) == THTensor_(nElement)(t)) {
-      real *tp = THTensor_(data)(t);
-      real *rp = THTensor_(data)(r_);
-      real t_val;
-      long sz = THTensor_(nElement)(t);
-      long i;
-      #pragma omp parallel for if(sz > TH_OMP_OVERHEAD_THRESHOLD) private(i)
-      for (i=0; i<sz; i++)
-          rp[i] = (tp[i] < min_value) ? min_value : (tp[i] > max_value ? max_value : tp[i]);
-  } else {
-      TH_TENSOR_APPLY2(real, r_, real, t, *r__data = (*t_data < min_value) ? min_value : (*t_data > max_value ? max_value : *t_data););
-  }
+  TH_TENSOR_PAPPLY2(real, r_, real, t, *r__data = (*t_data < min_value) ? min_value : (*t_data > max_value ? max_value : *t_data););
 }
 
 void THTensor_(cadd)(THTensor *r_, THTensor *t, real value, THTensor *src)
 {
   THTensor_(resizeAs)(r_, t);
-  if (THTensor_(isContiguous)(r_) && THTensor_(isContiguous)(t) && THTensor_(isContiguous)(src) && THTensor_(nElement)(r_) == THTensor_(nElement)(src)) {
-    if(r_ == t) {
+  if (r_ == t) {
+    if (THTensor_(isContiguous)(r_) && THTensor_(isContiguous)(src) && THTensor_(nElement)(r_) == THTensor_(nElement)(src)) {
       THBlas_(axpy)(THTensor_(nElement)(t), value, THTensor_(data)(src), 1, THTensor_(data)(r_), 1);
     } else {
-      real *tp = THTensor_(data)(t);
-      real *sp = THTensor_(data)(src);
-      real *rp = THTensor_(data)(r_);
-      long sz = THTensor_(nElement)(t);
-      long i;
-      #pragma omp parallel for if(sz > TH_OMP_OVERHEAD_THRESHOLD) private(i)
-      for (i=0; i< sz; i++)
-          rp[i] = tp[i] + value * sp[i];
+      TH_TENSOR_PAPPLY2_VEC(real, r_, real, src, *r__data += value * *src_data;,
+                            THVector_(add)(r__data, src_data, value, TH_TENSOR_APPLY_len););
     }
   } else {
-      TH_TENSOR_APPLY3(real, r_, real, t, real, src, *r__data = *t_data + value * *src_data;);
+    TH_TENSOR_PAPPLY3(real, r_, real, t, real, src, *r__data = *t_data + value * *src_data;);
   }
 }
 
 void THTensor_(cmul)(THTensor *r_, THTensor *t, THTensor *src)
 {
   THTensor_(resizeAs)(r_, t);
-  if (THTensor_(isContiguous)(r_) && THTensor_(isContiguous)(t) && THTensor_(isContiguous)(src) && THTensor_(nElement)(r_) == THTensor_(nElement)(src)) {
-      real *tp = THTensor_(data)(t);
-      real *sp = THTensor_(data)(src);
-      real *rp = THTensor_(data)(r_);
-      long sz = THTensor_(nElement)(t);
-      long i;
-      #pragma omp parallel for if(sz > TH_OMP_OVERHEAD_THRESHOLD) private(i)
-      for (i=0; i<sz; i++)
-        rp[i] = tp[i] * sp[i];
+  if (r_ == t) {
+    TH_TENSOR_PAPPLY2_VEC(real, r_, real, src, *r__data *= *src_data;,
+                          THVector_(mul)(r__data, src_data, TH_TENSOR_APPLY_len););
   } else {
-      TH_TENSOR_APPLY3(real, r_, real, t, real, src, *r__data = *t_data * *src_data;);
+    TH_TENSOR_PAPPLY3(real, r_, real, t, real, src, *r__data = *t_data * *src_data;);
   }
 }
 
 void THTensor_(cdiv)(THTensor *r_, THTensor *t, THTensor *src)
 {
   THTensor_(resizeAs)(r_, t);
-  if (THTensor_(isContiguous)(r_) && THTensor_(isContiguous)(t) && THTensor_(isContiguous)(src) && THTensor_(nElement)(r_) == THTensor_(nElement)(src)) {
-      real *tp = THTensor_(data)(t);
-      real *sp = THTensor_(data)(src);
-      real *rp = THTensor_(data)(r_);
-      long sz = THTensor_(nElement)(t);
-      long i;
-      #pragma omp parallel for if(sz > TH_OMP_OVERHEAD_THRESHOLD) private(i)
-      for (i=0; i<sz; i++)
-        rp[i] = tp[i] / sp[i];
-  } else {
-      TH_TENSOR_APPLY3(real, r_, real, t, real, src, *r__data = *t_data / *src_data;);
-  }
+  TH_TENSOR_PAPPLY3(real, r_, real, t, real, src, *r__data = *t_data / *src_data;);
 }
 
 void THTensor_(addcmul)(THTensor *r_, THTensor *t, real value, THTensor *src1, THTensor *src2)
@@ -351,7 +301,7 @@ void THTensor_(addcmul)(THTensor *r_, THTensor *t, real value, THTensor *src1, T
     THTensor_(copy)(r_, t);
   }
 
-  TH_TENSOR_APPLY3(real, r_, real, src1, real, src2, *r__data += value * *src1_data * *src2_data;);
+  TH_TENSOR_PAPPLY3(real, r_, real, src1, real, src2, *r__data += value * *src1_data * *src2_data;);
 }
 
 
@@ -363,7 +313,7 @@ void THTensor_(addcdiv)(THTensor *r_, THTensor *t, real value, THTensor *src1, T
     THTensor_(copy)(r_, t);
   }
 
-  TH_TENSOR_APPLY3(real, r_, real, src1, real, src2, *r__data += value * *src1_data / *src2_data;);
+  TH_TENSOR_PAPPLY3(real, r_, real, src1, real, src2, *r__data += value * *src1_data / *src2_data;);
 }
 
 void THTensor_(addmv)(THTensor *r_, real beta, THTensor *t, real alpha, THTensor *mat, THTensor *vec)
@@ -560,6 +510,128 @@ void THTensor_(addmm)(THTensor *r_, real beta, THTensor *t, real alpha, THTensor
     THTensor_(freeCopyTo)(r__, r_);
 } 
 
+/* r_[p] = beta*t[p] + alpha*batch1[p]*batch2[p] for every p. The strides are
+   the same for all the matrices of a batch, so the layout is settled once (as
+   in addmm) and gemm is then called directly on each matrix. */
+void THTensor_(baddbmm)(THTensor *r_, real beta, THTensor *t, real alpha, THTensor *batch1, THTensor *batch2)
+{
+  char transpose_r, transpose_m1, transpose_m2;
+  THTensor *r__, *m1_, *m2_;
+  long nBatch, m, n, k, lda, ldb, ldc, p;
+  real *m1_data, *m2_data, *r_data;
+  int parallel;
+
+  if( (batch1->nDimension != 3) || (batch2->nDimension != 3) )
+    THError("batch of matrices expected");
+
+  if(t->nDimension != 3)
+    THError("size mismatch");
+
+  if( (t->size[0] != batch1->size[0]) || (batch2->size[0] != batch1->size[0]) ||
+      (t->size[1] != batch1->size[1]) || (t->size[2] != batch2->size[2]) || (batch1->size[2] != batch2->size[1]) )
+    THError("size mismatch");
+
+  if(t != r_)
+  {
+    THTensor_(resizeAs)(r_, t);
+    THTensor_(copy)(r_, t);
+  }
+
+  /* r_ */
+  if(r_->stride[1] == 1)
+  {
+    transpose_r = 'n';
+    r__ = r_;
+  }
+  else if(r_->stride[2] == 1)
+  {
+    THTensor *swap = batch2;
+    batch2 = batch1;
+    batch1 = swap;
+    transpose_r = 't';
+    r__ = r_;
+  }
+  else
+  {
+    transpose_r = 'n';
+
+    r__ = THTensor_(newWithSize3d)(r_->size[0], r_->size[2], r_->size[1]);
+    THTensor_(transpose)(r__, NULL, 1, 2);
+    THTensor_(copy)(r__, r_);
+  }
+
+  /* batch1 */
+  if(batch1->stride[(transpose_r == 'n' ? 1 : 2)] == 1)
+  {
+    transpose_m1 = 'n';
+    m1_ = batch1;
+  }
+  else if(batch1->stride[(transpose_r == 'n' ? 2 : 1)] == 1)
+  {
+    transpose_m1 = 't';
+    m1_ = batch1;
+  }
+  else
+  {
+    transpose_m1 = (transpose_r == 'n' ? 't' : 'n');
+    m1_ = THTensor_(newContiguous)(batch1);
+  }
+
+  /* batch2 */
+  if(batch2->stride[(transpose_r == 'n' ? 1 : 2)] == 1)
+  {
+    transpose_m2 = 'n';
+    m2_ = batch2;
+  }
+  else if(batch2->stride[(transpose_r == 'n' ? 2 : 1)] == 1)
+  {
+    transpose_m2 = 't';
+    m2_ = batch2;
+  }
+  else
+  {
+    transpose_m2 = (transpose_r == 'n' ? 't' : 'n');
+    m2_ = THTensor_(newContiguous)(batch2);
+  }
+
+  nBatch = r__->size[0];
+  m = r__->size[(transpose_r == 'n' ? 1 : 2)];
+  n = r__->size[(transpose_r == 'n' ? 2 : 1)];
+  k = m1_->size[(transpose_r == 'n' ? 2 : 1)];
+  lda = (transpose_m1 == 'n' ? m1_->stride[(transpose_r == 'n' ? 2 : 1)] : m1_->stride[(transpose_r == 'n' ? 1 : 2)]);
+  ldb = (transpose_m2 == 'n' ? m2_->stride[(transpose_r == 'n' ? 2 : 1)] : m2_->stride[(transpose_r == 'n' ? 1 : 2)]);
+  ldc = r__->stride[(transpose_r == 'n' ? 2 : 1)];
+  m1_data = THTensor_(data)(m1_);
+  m2_data = THTensor_(data)(m2_);
+  r_data = THTensor_(data)(r__);
+
+  /* large products are parallelised by gemm itself */
+  parallel = (nBatch > 1) && ((double)m*(double)n*(double)k < TH_TENSOR_BMM_OMP_THRESHOLD);
+
+#pragma omp parallel for if(parallel) private(p)
+  for(p = 0; p < nBatch; p++)
+  {
+    THBlas_(gemm)(transpose_m1,
+                  transpose_m2,
+                  m, n, k,
+                  alpha,
+                  m1_data + p*m1_->stride[0], lda,
+                  m2_data + p*m2_->stride[0], ldb,
+                  beta,
+                  r_data + p*r__->stride[0], ldc);
+  }
+
+  /* free intermediate variables */
+  if(m1_ != batch1)
+    THTensor_(free)(m1_);
+
+  if(m2_ != batch2)
+    THTensor_(free)(m2_);
+
+  if(r__ != r_)
+    THTensor_(freeCopyTo)(r__, r_);
+}
+
 void THTensor_(addr)(THTensor *r_, real beta, THTensor *t, real alpha, THTensor *vec1, THTensor *vec2)
 {
   if( (vec1->nDimension != 1) || (vec2->nDimension != 1) )
@@ -748,11 +820,11 @@ void THTensor_(sign)(THTensor *r_, THTensor *t)
   THTensor_(resizeAs)(r_, t);
 
 #if defined (TH_REAL_IS_BYTE)
-  TH_TENSOR_APPLY2(real, r_, real, t, 
+  TH_TENSOR_PAPPLY2(real, r_, real, t, 
 		   if (*t_data > 0) *r__data = 1;
 		   else *r__data = 0;);
 #else
-  TH_TENSOR_APPLY2(real, r_, real, t, 
+  TH_TENSOR_PAPPLY2(real, r_, real, t, 
 		   if (*t_data > 0) *r__data = 1;
 		   else if (*t_data < 0) *r__data = -1;
 		   else *r__data = 0;);
@@ -947,117 +1019,279 @@ void THTensor_(reshape)(THTensor *r_, THTensor *t, THLongStorage *size)
   THTensor_(copy)(r_, t);
 }
 
-/* I cut and pasted (slightly adapted) the quicksort code from
-   http://www.alienryderflex.com/quicksort/
-   This public-domain C implementation by Darel Rex Finley.
-   Thanks man :)
+/* Sorting and selection work on contiguous copies of the slices, in which
+   each value is replaced by an unsigned key with the same order: the bits
+   of a float with the sign bit flipped (all of them for negative numbers),
+   a signed integer with the sign bit flipped. Descending order complements
+   the keys. Equal keys keep their index order, so that sort is stable and
+   topk/kthvalue agree with it. */
+#if defined(TH_REAL_IS_DOUBLE) || defined(TH_REAL_IS_LONG)
+#define radix_t unsigned long long
+#else
+#define radix_t unsigned int
+#endif
+#define RADIX_TOP ((radix_t)1 << (8*sizeof(radix_t)-1))
+
+/* slices longer than this are sorted by several threads */
+#define TH_SORT_PARALLEL_MIN 65536
+/* slices shorter than this are insertion sorted */
+#define TH_SORT_INSERTION_MAX 32
 
-    Updated Oct 16 2013: change choice of pivot to avoid worst-case being a pre-sorted input - Daniel and Julien
-    Updated Oct 24 2013: change pivot comparison to strict inequality to avoid worst-case on constant input, see Sedgewick, Algorithms in C, Addison Wesley, 1990, p. 120 - Julien
-*/
-#define  MAX_LEVELS  300
-static void THTensor_(quicksortascend)(real *arr, long *idx, long elements, long stride)
+static radix_t THTensor_(sortKey)(real x, int descendingOrder)
 {
-  long beg[MAX_LEVELS], end[MAX_LEVELS], i=0, L, R, P, swap, pid;
-  real rswap, piv;
-  
-  beg[0]=0; end[0]=elements;
-  while (i>=0) {
-    L=beg[i]; R=end[i]-1;
-    if (L<R) {
-      P=(L+R)>>1; /* Choose pivot as middle element of the current block */
-      piv=arr[P*stride];
-      pid=idx[P*stride];
-      rswap=arr[L*stride];
-      swap=idx[L*stride];
-      arr[L*stride]=piv;
-      idx[L*stride]=pid;
-      arr[P*stride]=rswap;
-      idx[P*stride]=swap;
-      while (L<R) {
-        while (arr[R*stride]>piv && L<R)
-            R--;
-        if (L<R) {
-            idx[L*stride]=idx[R*stride];
-            arr[L*stride]=arr[R*stride];
-            L++;
-        }
-        while (arr[L*stride]<piv && L<R)
-            L++;
-        if (L<R) {
-            idx[R*stride]=idx[L*stride];
-            arr[R*stride]=arr[L*stride];
-            R--;
-        }
-      }
-      idx[L*stride]=pid;
-      arr[L*stride]=piv;
-      beg[i+1]=L+1;
-      end[i+1]=end[i];
-      end[i++]=L;
-      if (end[i]-beg[i]>end[i-1]-beg[i-1]) {
-        swap=beg[i]; beg[i]=beg[i-1]; beg[i-1]=swap;
-        swap=end[i]; end[i]=end[i-1]; end[i-1]=swap;
-      }
+  radix_t k;
+#if defined(TH_REAL_IS_FLOAT) || defined(TH_REAL_IS_DOUBLE)
+  union { real x; radix_t k; } u;
+  u.x = x;
+  k = (u.k & RADIX_TOP) ? ~u.k : (u.k | RADIX_TOP);
+#else
+  k = (radix_t)x ^ RADIX_TOP;
+#endif
+  return descendingOrder ? ~k : k;
+}
+
+static real THTensor_(sortValue)(radix_t k, int descendingOrder)
+{
+  if(descendingOrder)
+    k = ~k;
+#if defined(TH_REAL_IS_FLOAT) || defined(TH_REAL_IS_DOUBLE)
+  {
+    union { real x; radix_t k; } u;
+    u.k = (k & RADIX_TOP) ? (k & ~RADIX_TOP) : ~k;
+    return u.x;
+  }
+#else
+  return (real)(k ^ RADIX_TOP);
+#endif
+}
+
+/* offset in a tensor of the slice number s along dimension */
+static long THTensor_(sliceOffset)(long s, int nDimension, long *size, long *stride, int dimension)
+{
+  long offset = 0;
+  int d;
+  for(d = nDimension-1; d >= 0; d--)
+  {
+    if(d == dimension)
+      continue;
+    offset += (s % size[d])*stride[d];
+    s /= size[d];
+  }
+  return offset;
+}
+
+#define SORT_LESS(keys, idx, i, j) \
+  ((keys)[i] < (keys)[j] || ((keys)[i] == (keys)[j] && (idx)[i] < (idx)[j]))
+
+#define SORT_SWAP(keys, idx, i, j)              \
+  {                                             \
+    radix_t SORT_k = (keys)[i];                 \
+    long SORT_i = (idx)[i];                     \
+    (keys)[i] = (keys)[j]; (idx)[i] = (idx)[j]; \
+    (keys)[j] = SORT_k; (idx)[j] = SORT_i;      \
+  }
+
+static void THTensor_(insertionSort)(radix_t *keys, long *idx, long n)
+{
+  long i, j;
+  for(i = 1; i < n; i++)
+  {
+    radix_t k = keys[i];
+    long ki = idx[i];
+    for(j = i; j > 0 && (keys[j-1] > k || (keys[j-1] == k && idx[j-1] > ki)); j--)
+    {
+      keys[j] = keys[j-1];
+      idx[j] = idx[j-1];
     }
-    else {
-      i--;
+    keys[j] = k;
+    idx[j] = ki;
+  }
+}
+
+/* One pass of the LSD radix sort on the byte at shift: scatters keys/idx
+   into tmpKeys/tmpIdx. Each of the nThreads chunks counts its keys, then
+   writes them after those of the smaller bytes and of the previous chunks,
+   which keeps the pass stable. Returns 0 (and does nothing) if all the keys
+   have the same byte. */
+static int THTensor_(radixPass)(radix_t *keys, long *idx, radix_t *tmpKeys, long *tmpIdx,
+                                long n, int shift, int nThreads, long *count)
+{
+  long chunk = (n+nThreads-1)/nThreads;
+  long total;
+  int t, b, skip = 0;
+
+#pragma omp parallel for if(nThreads > 1) num_threads(nThreads) private(t)
+  for(t = 0; t < nThreads; t++)
+  {
+    long *c = count + 256*t;
+    long i, end = THMin(n, (t+1)*chunk);
+    memset(c, 0, 256*sizeof(long));
+    for(i = t*chunk; i < end; i++)
+      c[(keys[i] >> shift) & 255]++;
+  }
+
+  total = 0;
+  for(b = 0; b < 256; b++)
+  {
+    long sum = 0;
+    for(t = 0; t < nThreads; t++)
+      sum += count[256*t+b];
+    if(sum == n)
+      skip = 1;
+    for(t = 0; t < nThreads; t++)
+    {
+      long c = count[256*t+b];
+      count[256*t+b] = total;
+      total += c;
+    }
+  }
+  if(skip)
+    return 0;
+
+#pragma omp parallel for if(nThreads > 1) num_threads(nThreads) private(t)
+  for(t = 0; t < nThreads; t++)
+  {
+    long *c = count + 256*t;
+    long i, end = THMin(n, (t+1)*chunk);
+    for(i = t*chunk; i < end; i++)
+    {
+      long j = c[(keys[i] >> shift) & 255]++;
+      tmpKeys[j] = keys[i];
+      tmpIdx[j] = idx[i];
     }
   }
+  return 1;
 }
 
-static void THTensor_(quicksortdescend)(real *arr, long *idx, long elements, long stride)
+/* Sorts keys (and idx along) in place; tmpKeys/tmpIdx hold n elements */
+static void THTensor_(radixSort)(radix_t *keys, long *idx, radix_t *tmpKeys, long *tmpIdx, long n, int nThreads)
 {
-  long beg[MAX_LEVELS], end[MAX_LEVELS], i=0, L, R, P, swap, pid;
-  real rswap, piv;
-  
-  beg[0]=0; end[0]=elements;
-  while (i>=0) {
-    L=beg[i]; R=end[i]-1;
-    if (L<R) {
-      P=(L+R)>>1; /* Choose pivot as middle element of the current block */
-      piv=arr[P*stride];
-      pid=idx[P*stride];
-      rswap=arr[L*stride];
-      swap=idx[L*stride];
-      arr[L*stride]=piv;
-      idx[L*stride]=pid;
-      arr[P*stride]=rswap;
-      idx[P*stride]=swap;
-      while (L<R) {
-        while (arr[R*stride]<piv && L<R)
-            R--;
-        if (L<R) {
-            idx[L*stride]=idx[R*stride];
-            arr[L*stride]=arr[R*stride];
-            L++;
-        }
-        while (arr[L*stride]>piv && L<R)
-            L++;
-        if (L<R) {
-            idx[R*stride]=idx[L*stride];
-            arr[R*stride]=arr[L*stride];
-            R--;
-        }
-      }
-      idx[L*stride]=pid;
-      arr[L*stride]=piv;
-      beg[i+1]=L+1;
-      end[i+1]=end[i];
-      end[i++]=L;
-      if (end[i]-beg[i]>end[i-1]-beg[i-1]) {
-        swap=beg[i]; beg[i]=beg[i-1]; beg[i-1]=swap;
-        swap=end[i]; end[i]=end[i-1]; end[i-1]=swap;
-      }
+  radix_t *srcKeys = keys, *dstKeys = tmpKeys;
+  long *srcIdx = idx, *dstIdx = tmpIdx;
+  long *count;
+  int shift;
+
+  if(n <= TH_SORT_INSERTION_MAX)
+  {
+    THTensor_(insertionSort)(keys, idx, n);
+    return;
+  }
+
+  count = THAlloc(sizeof(long)*256*nThreads);
+  for(shift = 0; shift < 8*(int)sizeof(radix_t); shift += 8)
+  {
+    if(THTensor_(radixPass)(srcKeys, srcIdx, dstKeys, dstIdx, n, shift, nThreads, count))
+    {
+      radix_t *swapKeys = srcKeys;
+      long *swapIdx = srcIdx;
+      srcKeys = dstKeys; dstKeys = swapKeys;
+      srcIdx = dstIdx; dstIdx = swapIdx;
     }
-    else {
-      i--;
+  }
+  if(srcKeys != keys)
+  {
+    memcpy(keys, srcKeys, sizeof(radix_t)*n);
+    memcpy(idx, srcIdx, sizeof(long)*n);
+  }
+  THFree(count);
+}
+
+static void THTensor_(siftDown)(radix_t *keys, long *idx, long i, long n)
+{
+  for(;;)
+  {
+    long c = 2*i+1;
+    if(c >= n)
+      break;
+    if(c+1 < n && SORT_LESS(keys, idx, c, c+1))
+      c++;
+    if(!SORT_LESS(keys, idx, i, c))
+      break;
+    SORT_SWAP(keys, idx, i, c);
+    i = c;
+  }
+}
+
+/* Moves the k smallest elements of keys/idx to the first k positions, in
+   no particular order: a max-heap of the k best so far, O(n log k). */
+static void THTensor_(heapSelect)(radix_t *keys, long *idx, long n, long k)
+{
+  long i;
+  for(i = k/2-1; i >= 0; i--)
+    THTensor_(siftDown)(keys, idx, i, k);
+  for(i = k; i < n; i++)
+  {
+    if(SORT_LESS(keys, idx, i, 0))
+    {
+      SORT_SWAP(keys, idx, i, 0);
+      THTensor_(siftDown)(keys, idx, 0, k);
     }
   }
 }
 
+/* Introselect: partitions keys/idx so that the k smallest elements come
+   first and the k-th smallest is at k-1. Quickselect with a median of three
+   pivot, which falls back to a heap selection when it stops shrinking the
+   range fast enough. The heap selection alone is faster for small k. */
+static void THTensor_(quickSelect)(radix_t *keys, long *idx, long n, long k)
+{
+  long L = 0, R = n-1;
+  int depth = 0, maxDepth = 2;
+  long m;
+
+  for(m = n; m > 1; m >>= 1)
+    maxDepth += 2;
+
+  if(k <= 0)
+    return;
+
+  while(R > L)
+  {
+    long P, i, j;
+
+    if(R-L < 16 || depth++ > maxDepth || (k-L)*64 < R-L+1)
+    {
+      /* the k-L smallest of [L, R], then the largest of them at k-1 */
+      THTensor_(heapSelect)(keys+L, idx+L, R-L+1, k-L);
+      SORT_SWAP(keys, idx, L, k-1);
+      return;
+    }
+
+    P = L+(R-L)/2;
+    if(SORT_LESS(keys, idx, P, L))
+      SORT_SWAP(keys, idx, P, L);
+    if(SORT_LESS(keys, idx, R, L))
+      SORT_SWAP(keys, idx, R, L);
+    if(SORT_LESS(keys, idx, R, P))
+      SORT_SWAP(keys, idx, R, P);
+    /* L <= P <= R: the pivot goes to R-1, L and R are sentinels */
+    SORT_SWAP(keys, idx, P, R-1);
+    i = L;
+    j = R-1;
+    for(;;)
+    {
+      do i++; while(SORT_LESS(keys, idx, i, R-1));
+      do j--; while(SORT_LESS(keys, idx, R-1, j));
+      if(i >= j)
+        break;
+      SORT_SWAP(keys, idx, i, j);
+    }
+    SORT_SWAP(keys, idx, i, R-1);
+
+    if(i == k-1)
+      return;
+    else if(i < k-1)
+      L = i+1;
+    else
+      R = i-1;
+  }
+}
+
 void THTensor_(sort)(THTensor *rt_, THLongTensor *ri_, THTensor *t, int dimension, int descendingOrder)
 {
+  long size, nSlice, s;
+  int nThreads = 1, sliceThreads = 1;
+
   THArgCheck(dimension >= 0 && dimension < THTensor_(nDimension)(t), 2, "invalid dimension");
 
   THTensor_(resizeAs)(rt_, t);
@@ -1069,24 +1303,159 @@ void THTensor_(sort)(THTensor *rt_, THLongTensor *ri_, THTensor *t, int dimensio
     THLongStorage_free(size);
   }
 
-  if(descendingOrder)
+  size = THTensor_(size)(t, dimension);
+  nSlice = (size > 0 ? THTensor_(nElement)(t)/size : 0);
+
+#ifdef _OPENMP
+  if(!omp_in_parallel())
+    nThreads = omp_get_max_threads();
+#endif
+  /* a few long slices: the threads share each slice, else the slices */
+  if(size >= TH_SORT_PARALLEL_MIN && nSlice < nThreads)
+    sliceThreads = nThreads;
+  else if(nSlice*size < TH_SORT_PARALLEL_MIN)
+    nThreads = 1;
+
+#pragma omp parallel if(sliceThreads == 1 && nThreads > 1) num_threads(nThreads) private(s)
   {
-    TH_TENSOR_DIM_APPLY2(real, rt_, long, ri_, dimension, 
-                         long i;
-                         for(i = 0; i < ri__size; i++)
-                           ri__data[i*ri__stride] = i;
-                         THTensor_(quicksortdescend)(rt__data, ri__data, rt__size, rt__stride);)
+    radix_t *keys = THAlloc(sizeof(radix_t)*2*size);
+    long *idx = THAlloc(sizeof(long)*2*size);
+
+#pragma omp for
+    for(s = 0; s < nSlice; s++)
+    {
+      real *rt_data = THTensor_(data)(rt_) + THTensor_(sliceOffset)(s, rt_->nDimension, rt_->size, rt_->stride, dimension);
+      long *ri_data = THLongTensor_data(ri_) + THTensor_(sliceOffset)(s, ri_->nDimension, ri_->size, ri_->stride, dimension);
+      long rt_stride = rt_->stride[dimension];
+      long ri_stride = ri_->stride[dimension];
+      long i;
+
+      for(i = 0; i < size; i++)
+      {
+        keys[i] = THTensor_(sortKey)(rt_data[i*rt_stride], descendingOrder);
+        idx[i] = i;
       }
-  else
+      THTensor_(radixSort)(keys, idx, keys+size, idx+size, size, sliceThreads);
+      for(i = 0; i < size; i++)
+      {
+        rt_data[i*rt_stride] = THTensor_(sortValue)(keys[i], descendingOrder);
+        ri_data[i*ri_stride] = idx[i];
+      }
+    }
+
+    THFree(keys);
+    THFree(idx);
+  }
+}
+
+/* Selects the k first elements of each slice of t in the order given by
+   descendingOrder into rt_/ri_ (of size k along dimension), sorted if
+   sorted is true. kthvalue keeps only the last one. */
+static void THTensor_(selectDim)(THTensor *rt_, THLongTensor *ri_, THTensor *t, long k, int dimension,
+                                 int descendingOrder, int sorted, int lastOnly)
+{
+  THLongStorage *dim;
+  long size, nSlice, s;
+  int nThreads = 1;
+
+  size = THTensor_(size)(t, dimension);
+  nSlice = (size > 0 ? THTensor_(nElement)(t)/size : 0);
+
+  dim = THTensor_(newSizeOf)(t);
+  THLongStorage_set(dim, dimension, lastOnly ? 1 : k);
+  THTensor_(resize)(rt_, dim, NULL);
+  THLongTensor_resize(ri_, dim, NULL);
+  THLongStorage_free(dim);
+  if(k == 0)
+    return;
+
+#ifdef _OPENMP
+  if(!omp_in_parallel() && nSlice > 1 && nSlice*size >= TH_SORT_PARALLEL_MIN)
+    nThreads = omp_get_max_threads();
+#endif
+
+#pragma omp parallel if(nThreads > 1) num_threads(nThreads) private(s)
   {
-    TH_TENSOR_DIM_APPLY2(real, rt_, long, ri_, dimension,
-                         long i;
-                         for(i = 0; i < ri__size; i++)
-                           ri__data[i*ri__stride] = i;
-                         THTensor_(quicksortascend)(rt__data, ri__data, rt__size, rt__stride);)
+    radix_t *keys = THAlloc(sizeof(radix_t)*(size+k));
+    long *idx = THAlloc(sizeof(long)*(size+k));
+
+#pragma omp for
+    for(s = 0; s < nSlice; s++)
+    {
+      real *t_data = THTensor_(data)(t) + THTensor_(sliceOffset)(s, t->nDimension, t->size, t->stride, dimension);
+      real *rt_data = THTensor_(data)(rt_) + THTensor_(sliceOffset)(s, rt_->nDimension, rt_->size, rt_->stride, dimension);
+      long *ri_data = THLongTensor_data(ri_) + THTensor_(sliceOffset)(s, ri_->nDimension, ri_->size, ri_->stride, dimension);
+      long t_stride = t->stride[dimension];
+      long rt_stride = rt_->stride[dimension];
+      long ri_stride = ri_->stride[dimension];
+      long i;
+
+      for(i = 0; i < size; i++)
+      {
+        keys[i] = THTensor_(sortKey)(t_data[i*t_stride], descendingOrder);
+        idx[i] = i;
       }
+      THTensor_(quickSelect)(keys, idx, size, k);
+
+      if(lastOnly)
+      {
+        *rt_data = THTensor_(sortValue)(keys[k-1], descendingOrder);
+        *ri_data = idx[k-1];
+        continue;
+      }
+
+      if(sorted)
+      {
+        /* gathers the k first elements again in index order, so that the
+           stable radix sort breaks the ties by index */
+        radix_t kthKey = keys[k-1];
+        long kthIdx = idx[k-1], j = 0;
+        for(i = 0; i < size; i++)
+        {
+          radix_t key = THTensor_(sortKey)(t_data[i*t_stride], descendingOrder);
+          if(key < kthKey || (key == kthKey && i <= kthIdx))
+          {
+            keys[j] = key;
+            idx[j++] = i;
+          }
+        }
+        THTensor_(radixSort)(keys, idx, keys+size, idx+size, k, 1);
+      }
+      for(i = 0; i < k; i++)
+      {
+        rt_data[i*rt_stride] = THTensor_(sortValue)(keys[i], descendingOrder);
+        ri_data[i*ri_stride] = idx[i];
+      }
+    }
+
+    THFree(keys);
+    THFree(idx);
+  }
+}
+
+void THTensor_(topk)(THTensor *rt_, THLongTensor *ri_, THTensor *t, long k, int dimension, int descendingOrder, int sorted)
+{
+  THArgCheck(dimension >= 0 && dimension < THTensor_(nDimension)(t), 3, "invalid dimension");
+  THArgCheck(k >= 0 && k <= THTensor_(size)(t, dimension), 2, "k not in range for dimension");
+
+  THTensor_(selectDim)(rt_, ri_, t, k, dimension, descendingOrder, sorted, 0);
+}
+
+void THTensor_(kthvalue)(THTensor *values_, THLongTensor *indices_, THTensor *t, long k, int dimension)
+{
+  THArgCheck(dimension >= 0 && dimension < THTensor_(nDimension)(t), 3, "invalid dimension");
+  THArgCheck(k > 0 && k <= THTensor_(size)(t, dimension), 2, "k not in range for dimension");
+
+  THTensor_(selectDim)(values_, indices_, t, k, dimension, 0, 0, 1);
 }
 
+#undef SORT_LESS
+#undef SORT_SWAP
+#undef radix_t
+#undef RADIX_TOP
+#undef TH_SORT_PARALLEL_MIN
+#undef TH_SORT_INSERTION_MAX
+
 void THTensor_(tril)(THTensor *r_, THTensor *t, long k)
 {
   long t_size_0, t_size_1;
@@ -1199,30 +1568,26 @@ void THTensor_(cat)(THTensor *r_, THTensor *ta, THTensor *tb, int dimension)
   void THTensor_(NAME##Value)(THByteTensor *r_, THTensor* t, real value)	\
   {									\
     THByteTensor_rawResize(r_, t->nDimension, t->size, NULL);		\
-    THByteTensor_zero(r_);						\
-    TH_TENSOR_APPLY2(unsigned char, r_, real, t,			\
-		     if (*t_data OP value) *r__data = 1;);		\
+    TH_TENSOR_PAPPLY2(unsigned char, r_, real, t,			\
+		      *r__data = (*t_data OP value););			\
   }									\
   void THTensor_(NAME##ValueT)(THTensor* r_, THTensor* t, real value)	\
   {									\
     THTensor_(rawResize)(r_, t->nDimension, t->size, NULL);		\
-    THTensor_(zero)(r_);						\
-    TH_TENSOR_APPLY2(real, r_, real, t,					\
-		     if (*t_data OP value) *r__data = 1;);		\
+    TH_TENSOR_PAPPLY2(real, r_, real, t,				\
+		      *r__data = (*t_data OP value););			\
   }									\
   void THTensor_(NAME##Tensor)(THByteTensor *r_, THTensor *ta, THTensor *tb) \
   {									\
     THByteTensor_rawResize(r_, ta->nDimension, ta->size, NULL);		\
-    THByteTensor_zero(r_);						\
-    TH_TENSOR_APPLY3(unsigned char, r_, real, ta, real, tb,		\
-		     if(*ta_data OP *tb_data) *r__data = 1;);		\
+    TH_TENSOR_PAPPLY3(unsigned char, r_, real, ta, real, tb,		\
+		      *r__data = (*ta_data OP *tb_data););		\
   }									\
   void THTensor_(NAME##TensorT)(THTensor *r_, THTensor *ta, THTensor *tb) \
   {									\
     THTensor_(rawResize)(r_, ta->nDimension, ta->size, NULL);		\
-    THTensor_(zero)(r_);						\
-    TH_TENSOR_APPLY3(real, r_, real, ta, real, tb,			\
-		     if(*ta_data OP *tb_data) *r__data = 1;);		\
+    TH_TENSOR_PAPPLY3(real, r_, real, ta, real, tb,			\
+		      *r__data = (*ta_data OP *tb_data););		\
   }									\
 
 
@@ -1237,14 +1602,23 @@ TENSOR_IMPLEMENT_LOGICAL(ne,!=)
   void THTensor_(NAME)(THTensor *r_, THTensor *t)                \
   {                                                           \
     THTensor_(resizeAs)(r_, t);                               \
-    TH_TENSOR_APPLY2(real, t, real, r_, *r__data = CFUNC(*t_data);); \
+    TH_TENSOR_PAPPLY2(real, t, real, r_, *r__data = CFUNC(*t_data);); \
   }                                                           \
 
 #define LAB_IMPLEMENT_BASIC_FUNCTION_VALUE(NAME, CFUNC)                 \
   void THTensor_(NAME)(THTensor *r_, THTensor *t, real value)              \
   {                                                                     \
     THTensor_(resizeAs)(r_, t);                                         \
-    TH_TENSOR_APPLY2(real, t, real, r_, *r__data = CFUNC(*t_data, value);); \
+    TH_TENSOR_PAPPLY2(real, t, real, r_, *r__data = CFUNC(*t_data, value);); \
+  }                                                                     \
+
+/* contiguous runs go through the THVector kernel of the same name */
+#define LAB_IMPLEMENT_VECTOR_FUNCTION(NAME, CFUNC)                      \
+  void THTensor_(NAME)(THTensor *r_, THTensor *t)                       \
+  {                                                                     \
+    THTensor_(resizeAs)(r_, t);                                         \
+    TH_TENSOR_PAPPLY2_VEC(real, t, real, r_, *r__data = CFUNC(*t_data);, \
+                          THVector_(NAME)(r__data, t_data, TH_TENSOR_APPLY_len);); \
   }                                                                     \
 
 #if defined(TH_REAL_IS_LONG)
@@ -1274,9 +1648,9 @@ TENSOR_IMPLEMENT_LOGICAL_SUM(logicalany, |=, 0)
 /* floating point only now */
 #if defined(TH_REAL_IS_FLOAT) || defined(TH_REAL_IS_DOUBLE)
 
-LAB_IMPLEMENT_BASIC_FUNCTION(log,log)
+LAB_IMPLEMENT_VECTOR_FUNCTION(log,log)
 LAB_IMPLEMENT_BASIC_FUNCTION(log1p,log1p)
-LAB_IMPLEMENT_BASIC_FUNCTION(exp,exp)
+LAB_IMPLEMENT_VECTOR_FUNCTION(exp,exp)
 LAB_IMPLEMENT_BASIC_FUNCTION(cos,cos)
 LAB_IMPLEMENT_BASIC_FUNCTION(acos,acos)
 LAB_IMPLEMENT_BASIC_FUNCTION(cosh,cosh)
@@ -1285,7 +1659,7 @@ LAB_IMPLEMENT_BASIC_FUNCTION(asin,asin)
 LAB_IMPLEMENT_BASIC_FUNCTION(sinh,sinh)
 LAB_IMPLEMENT_BASIC_FUNCTION(tan,tan)
 LAB_IMPLEMENT_BASIC_FUNCTION(atan,atan)
-LAB_IMPLEMENT_BASIC_FUNCTION(tanh,tanh)
+LAB_IMPLEMENT_VECTOR_FUNCTION(tanh,tanh)
 LAB_IMPLEMENT_BASIC_FUNCTION_VALUE(pow,pow)
 LAB_IMPLEMENT_BASIC_FUNCTION(sqrt,sqrt)
 LAB_IMPLEMENT_BASIC_FUNCTION(ceil,ceil)
@@ -1296,7 +1670,7 @@ LAB_IMPLEMENT_BASIC_FUNCTION(abs,fabs)
 void THTensor_(atan2)(THTensor *r_, THTensor *tx, THTensor *ty)
 {
   THTensor_(resizeAs)(r_, tx);
-  TH_TENSOR_APPLY3(real, r_, real, tx, real, ty, *r__data = atan2(*tx_data,*ty_data););
+  TH_TENSOR_PAPPLY3(real, r_, real, tx, real, ty, *r__data = atan2(*tx_data,*ty_data););
 }
 
 void THTensor_(mean)(THTensor *r_, THTensor *t, int dimension)
@@ -1575,47 +1949,139 @@ void THTensor_(randn)(THTensor *r_, THGenerator *_generator, THLongStorage *size
   THTensor_(normal)(r_, _generator, 0, 1);
 }
 
-void THTensor_(histc)(THTensor *hist, THTensor *tensor, long nbins, real minvalue, real maxvalue)
+/* Counts (or sums the weights of) the elements of tensor in nbins bins
+   between minval and maxval, in a single pass: each thread bins a range of
+   the elements into its own histogram, and the histograms are summed at the
+   end. An element x goes to bin floor((x-minval)/(maxval-minval)*bins)+1, with
+   bins slightly below nbins so that maxval goes to the last bin. */
+static void THTensor_(histcPass)(THTensor *hist, THTensor *tensor, THTensor *weights,
+                                 long nbins, real minval, real maxval)
 {
-  THTensor *clone;
-  real minval;
-  real maxval;
-  real bins;
+  THTensorApplyIter it;
+  int nTensor = (weights ? 2 : 1);
+  int nDim[2];
+  long *size[2], *stride[2];
+  real *base[2];
+  long n = THTensor_(nElement)(tensor);
+  real bins = (real)(nbins)-1e-6;
+  real range = maxval-minval;
+  accreal *partial;
   real *h_data;
+  int nThreads = 1, t;
+  long b;
 
   THTensor_(resize1d)(hist, nbins);
   THTensor_(zero)(hist);
-  minval = minvalue;
-  maxval = maxvalue;
-  if (minval == maxval) 
+  if(n == 0)
+    return;
+
+  nDim[0] = tensor->nDimension;
+  size[0] = tensor->size;
+  stride[0] = tensor->stride;
+  base[0] = THTensor_(data)(tensor);
+  if(weights)
   {
-    minval = THTensor_(minall)(tensor);
-    maxval = THTensor_(maxall)(tensor);
+    nDim[1] = weights->nDimension;
+    size[1] = weights->size;
+    stride[1] = weights->stride;
+    base[1] = THTensor_(data)(weights);
   }
-  if (minval == maxval)
+  if(!THTensorApply_init(&it, nTensor, nDim, size, stride))
   {
-    minval = minval - 1;
-    maxval = maxval + 1;
+    /* layouts which cannot be iterated together, e.g. a transposed matrix
+       with a vector of weights: bin contiguous copies */
+    THTensor *tensorc = THTensor_(newContiguous)(tensor);
+    THTensor *weightsc = (weights ? THTensor_(newContiguous)(weights) : NULL);
+    THTensor_(histcPass)(hist, tensorc, weightsc, nbins, minval, maxval);
+    THTensor_(free)(tensorc);
+    if(weightsc)
+      THTensor_(free)(weightsc);
+    return;
+  }
+
+#ifdef _OPENMP
+  if(n > TH_TENSOR_APPLY_OMP_THRESHOLD && !omp_in_parallel())
+    nThreads = omp_get_max_threads();
+#endif
+  partial = THAlloc(sizeof(accreal)*nbins*nThreads);
+  memset(partial, 0, sizeof(accreal)*nbins*nThreads);
+
+#pragma omp parallel num_threads(nThreads) firstprivate(it) private(t)
+  {
+    long chunk, start, end;
+    int nt = 1;
+    accreal *h;
+
+#ifdef _OPENMP
+    t = omp_get_thread_num();
+    nt = omp_get_num_threads();
+#else
+    t = 0;
+#endif
+    h = partial + nbins*t;
+    chunk = (n+nt-1)/nt;
+    start = THMin(n, t*chunk);
+    end = THMin(n, start+chunk);
+
+    THTensorApply_seek(&it, nTensor, start);
+    while(start < end)
+    {
+      real *x = base[0] + it.offset[0];
+      real *w = (weights ? base[1] + it.offset[1] : NULL);
+      long x_stride = it.stride[0][0];
+      long w_stride = (weights ? it.stride[1][0] : 0);
+      long len = THTensorApply_runLength(&it, end-start);
+      long i;
+
+      for(i = 0; i < len; i++)
+      {
+        real bin = floor((x[i*x_stride]-minval)/range*bins);
+        if(bin >= 0 && bin < nbins)
+          h[(long)bin] += (w ? w[i*w_stride] : 1);
+      }
+      THTensorApply_advance(&it, nTensor, len);
+      start += len;
+    }
   }
-  bins = (real)(nbins)-1e-6;
 
-  
-  clone = THTensor_(newWithSize1d)(THTensor_(nElement)(tensor));
-  THTensor_(copy)(clone,tensor);
-  THTensor_(add)(clone, clone, -minval);
-  THTensor_(div)(clone, clone, (maxval-minval));
-  THTensor_(mul)(clone, clone, bins);
-  THTensor_(floor)(clone, clone);
-  THTensor_(add)(clone, clone, 1);
-  
   h_data = THTensor_(data)(hist);
+  for(t = 0; t < nThreads; t++)
+  {
+    for(b = 0; b < nbins; b++)
+      h_data[b] += partial[nbins*t+b];
+  }
+  THFree(partial);
+}
+
+/* the range of the histogram: [minvalue, maxvalue], or the range of the
+   elements if they are equal, widened if empty */
+static void THTensor_(histcRange)(THTensor *tensor, real *minval, real *maxval)
+{
+  if(*minval == *maxval && THTensor_(nElement)(tensor) > 0)
+  {
+    *minval = THTensor_(minall)(tensor);
+    *maxval = THTensor_(maxall)(tensor);
+  }
+  if(*minval == *maxval)
+  {
+    *minval = *minval - 1;
+    *maxval = *maxval + 1;
+  }
+}
 
-  TH_TENSOR_APPLY(real, clone,                                         \
-                  if ((*clone_data <= nbins) && (*clone_data >= 1)) {  \
-                    *(h_data + (int)(*clone_data) - 1) += 1;           \
-                  });
+void THTensor_(histc)(THTensor *hist, THTensor *tensor, long nbins, real minvalue, real maxvalue)
+{
+  THArgCheck(nbins > 0, 3, "number of bins must be positive");
+  THTensor_(histcRange)(tensor, &minvalue, &maxvalue);
+  THTensor_(histcPass)(hist, tensor, NULL, nbins, minvalue, maxvalue);
+}
 
-  THTensor_(free)(clone);
+void THTensor_(histcw)(THTensor *hist, THTensor *tensor, THTensor *weights, long nbins, real minvalue, real maxvalue)
+{
+  THArgCheck(THTensor_(nElement)(tensor) == THTensor_(nElement)(weights), 3, "tensor and weights must have the same number of elements");
+  THArgCheck(nbins > 0, 4, "number of bins must be positive");
+  THTensor_(histcRange)(tensor, &minvalue, &maxvalue);
+  THTensor_(histcPass)(hist, tensor, weights, nbins, minvalue, maxvalue);
 }
 
 #endif /* floating point only part */
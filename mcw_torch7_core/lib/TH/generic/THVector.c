@@ -81,4 +81,60 @@ static TH_INLINE void THVector_(mul)(real *y, const real *x, const long n)
     y[i] *= x[i];
 }
 
+static TH_INLINE accreal THVector_(sum)(const real *x, const long n)
+{
+  accreal sum = 0;
+  long i;
+
+  for(i = 0; i < n; i++)
+    sum += x[i];
+  return sum;
+}
+
+static TH_INLINE accreal THVector_(dot)(const real *x, const real *y, const long n)
+{
+  accreal sum = 0;
+  long i;
+
+  for(i = 0; i < n; i++)
+    sum += x[i]*y[i];
+  return sum;
+}
+
+static TH_INLINE real THVector_(max)(const real *x, const long n, long *index)
+{
+  real value = x[0];
+  long i, imax = 0;
+
+  for(i = 1; i < n; i++)
+  {
+    if(x[i] > value)
+    {
+      value = x[i];
+      imax = i;
+    }
+  }
+  if(index)
+    *index = imax;
+  return value;
+}
+
+static TH_INLINE real THVector_(min)(const real *x, const long n, long *index)
+{
+  real value = x[0];
+  long i, imin = 0;
+
+  for(i = 1; i < n; i++)
+  {
+    if(x[i] < value)
+    {
+      value = x[i];
+      imin = i;
+    }
+  }
+  if(index)
+    *index = imin;
+  return value;
+}
+
 #endif
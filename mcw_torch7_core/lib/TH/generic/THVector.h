@@ -0,0 +1,28 @@
+#ifndef TH_GENERIC_FILE
+#define TH_GENERIC_FILE "generic/THVector.h"
+#else
+
+/* Kernels on n contiguous elements */
+TH_API void THVector_(fill)(real *x, const real c, const long n);
+TH_API void THVector_(add)(real *y, const real *x, const real c, const long n);   /* y += c*x */
+TH_API void THVector_(diff)(real *z, const real *x, const real *y, const long n); /* z = x-y */
+TH_API void THVector_(scale)(real *y, const real c, const long n);
+TH_API void THVector_(mul)(real *y, const real *x, const long n);
+
+/* Reductions, accumulated in accreal */
+TH_API accreal THVector_(sum)(const real *x, const long n);
+TH_API accreal THVector_(dot)(const real *x, const real *y, const long n);
+
+/* Largest (smallest) of n > 0 elements; *index, if not NULL, receives its
+   first position. NaNs are skipped, unless x[0] is one. */
+TH_API real THVector_(max)(const real *x, const long n, long *index);
+TH_API real THVector_(min)(const real *x, const long n, long *index);
+
+/* y = f(x); y may be x. The vectorized float versions are approximations
+   accurate to a few ulp. */
+TH_API void THVector_(exp)(real *y, const real *x, const long n);
+TH_API void THVector_(log)(real *y, const real *x, const long n);
+TH_API void THVector_(tanh)(real *y, const real *x, const long n);
+TH_API void THVector_(sigmoid)(real *y, const real *x, const long n);
+
+#endif
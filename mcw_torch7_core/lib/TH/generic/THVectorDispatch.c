@@ -0,0 +1,203 @@
+#ifndef TH_GENERIC_FILE
+#define TH_GENERIC_FILE "generic/THVectorDispatch.c"
+#else
+
+static void THVector_(exp_DEFAULT)(real *y, const real *x, const long n)
+{
+  long i;
+  for(i = 0; i < n; i++)
+    y[i] = exp(x[i]);
+}
+
+static void THVector_(log_DEFAULT)(real *y, const real *x, const long n)
+{
+  long i;
+  for(i = 0; i < n; i++)
+    y[i] = log(x[i]);
+}
+
+static void THVector_(tanh_DEFAULT)(real *y, const real *x, const long n)
+{
+  long i;
+  for(i = 0; i < n; i++)
+    y[i] = tanh(x[i]);
+}
+
+static void THVector_(sigmoid_DEFAULT)(real *y, const real *x, const long n)
+{
+  long i;
+  for(i = 0; i < n; i++)
+    y[i] = 1./(1.+exp(-x[i]));
+}
+
+static struct
+{
+  void (*fill)(real *, const real, const long);
+  void (*add)(real *, const real *, const real, const long);
+  void (*diff)(real *, const real *, const real *, const long);
+  void (*scale)(real *, const real, const long);
+  void (*mul)(real *, const real *, const long);
+  accreal (*sum)(const real *, const long);
+  accreal (*dot)(const real *, const real *, const long);
+  real (*max)(const real *, const long, long *);
+  real (*min)(const real *, const long, long *);
+  void (*exp)(real *, const real *, const long);
+  void (*log)(real *, const real *, const long);
+  void (*tanh)(real *, const real *, const long);
+  void (*sigmoid)(real *, const real *, const long);
+} THVector_(kernels);
+
+#define THVECTOR_USE(NAME, ISA) THVector_(kernels).NAME = THVector_(NAME##_##ISA)
+
+/* Each level overrides the kernels it implements */
+static void THVector_(resolve)(int isa)
+{
+  THVECTOR_USE(fill, DEFAULT);
+  THVECTOR_USE(add, DEFAULT);
+  THVECTOR_USE(diff, DEFAULT);
+  THVECTOR_USE(scale, DEFAULT);
+  THVECTOR_USE(mul, DEFAULT);
+  THVECTOR_USE(sum, DEFAULT);
+  THVECTOR_USE(dot, DEFAULT);
+  THVECTOR_USE(max, DEFAULT);
+  THVECTOR_USE(min, DEFAULT);
+  THVECTOR_USE(exp, DEFAULT);
+  THVECTOR_USE(log, DEFAULT);
+  THVECTOR_USE(tanh, DEFAULT);
+  THVECTOR_USE(sigmoid, DEFAULT);
+
+#if defined(USE_SSE2)
+  if(isa >= TH_VECTOR_SSE2)
+  {
+    THVECTOR_USE(fill, SSE2);
+    THVECTOR_USE(add, SSE2);
+    THVECTOR_USE(diff, SSE2);
+    THVECTOR_USE(scale, SSE2);
+    THVECTOR_USE(mul, SSE2);
+    THVECTOR_USE(sum, SSE2);
+    THVECTOR_USE(dot, SSE2);
+    THVECTOR_USE(max, SSE2);
+    THVECTOR_USE(min, SSE2);
+  }
+#elif defined(__NEON__) && defined(TH_REAL_IS_FLOAT)
+  if(isa >= TH_VECTOR_SSE2)
+  {
+    THVECTOR_USE(fill, NEON);
+    THVECTOR_USE(add, NEON);
+    THVECTOR_USE(diff, NEON);
+    THVECTOR_USE(scale, NEON);
+    THVECTOR_USE(mul, NEON);
+  }
+#endif
+
+#ifdef TH_VECTOR_HAVE_AVX
+  if(isa >= TH_VECTOR_AVX)
+  {
+    THVECTOR_USE(fill, AVX);
+    THVECTOR_USE(add, AVX);
+    THVECTOR_USE(diff, AVX);
+    THVECTOR_USE(scale, AVX);
+    THVECTOR_USE(mul, AVX);
+    THVECTOR_USE(sum, AVX);
+    THVECTOR_USE(dot, AVX);
+    THVECTOR_USE(max, AVX);
+    THVECTOR_USE(min, AVX);
+  }
+#endif
+
+#ifdef TH_VECTOR_HAVE_AVX2
+  if(isa >= TH_VECTOR_AVX2)
+  {
+    THVECTOR_USE(add, AVX2);
+    THVECTOR_USE(dot, AVX2);
+#if defined(TH_REAL_IS_FLOAT)
+    THVECTOR_USE(exp, AVX2);
+    THVECTOR_USE(log, AVX2);
+    THVECTOR_USE(tanh, AVX2);
+    THVECTOR_USE(sigmoid, AVX2);
+#endif
+  }
+#endif
+}
+
+#undef THVECTOR_USE
+
+void THVector_(fill)(real *x, const real c, const long n)
+{
+  THVector_ready();
+  THVector_(kernels).fill(x, c, n);
+}
+
+void THVector_(add)(real *y, const real *x, const real c, const long n)
+{
+  THVector_ready();
+  THVector_(kernels).add(y, x, c, n);
+}
+
+void THVector_(diff)(real *z, const real *x, const real *y, const long n)
+{
+  THVector_ready();
+  THVector_(kernels).diff(z, x, y, n);
+}
+
+void THVector_(scale)(real *y, const real c, const long n)
+{
+  THVector_ready();
+  THVector_(kernels).scale(y, c, n);
+}
+
+void THVector_(mul)(real *y, const real *x, const long n)
+{
+  THVector_ready();
+  THVector_(kernels).mul(y, x, n);
+}
+
+accreal THVector_(sum)(const real *x, const long n)
+{
+  THVector_ready();
+  return THVector_(kernels).sum(x, n);
+}
+
+accreal THVector_(dot)(const real *x, const real *y, const long n)
+{
+  THVector_ready();
+  return THVector_(kernels).dot(x, y, n);
+}
+
+real THVector_(max)(const real *x, const long n, long *index)
+{
+  THVector_ready();
+  return THVector_(kernels).max(x, n, index);
+}
+
+real THVector_(min)(const real *x, const long n, long *index)
+{
+  THVector_ready();
+  return THVector_(kernels).min(x, n, index);
+}
+
+void THVector_(exp)(real *y, const real *x, const long n)
+{
+  THVector_ready();
+  THVector_(kernels).exp(y, x, n);
+}
+
+void THVector_(log)(real *y, const real *x, const long n)
+{
+  THVector_ready();
+  THVector_(kernels).log(y, x, n);
+}
+
+void THVector_(tanh)(real *y, const real *x, const long n)
+{
+  THVector_ready();
+  THVector_(kernels).tanh(y, x, n);
+}
+
+void THVector_(sigmoid)(real *y, const real *x, const long n)
+{
+  THVector_ready();
+  THVector_(kernels).sigmoid(y, x, n);
+}
+
+#endif
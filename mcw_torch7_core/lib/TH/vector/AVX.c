@@ -0,0 +1,332 @@
+#include "THVectorKernels.h"
+#include <immintrin.h>
+
+void THDoubleVector_fill_AVX(double *x, const double c, const long n)
+{
+  long i;
+  __m256d YMM0 = _mm256_set1_pd(c);
+  for (i=0; i<=n-16; i+=16) {
+    _mm256_storeu_pd(x+i   , YMM0);
+    _mm256_storeu_pd(x+i+ 4, YMM0);
+    _mm256_storeu_pd(x+i+ 8, YMM0);
+    _mm256_storeu_pd(x+i+12, YMM0);
+  }
+  for (; i<n; i++)
+    x[i] = c;
+}
+
+void THDoubleVector_add_AVX(double *y, const double *x, const double c, const long n)
+{
+  long i;
+  __m256d YMM7 = _mm256_set1_pd(c);
+  for (i=0; i<=n-8; i+=8) {
+    __m256d YMM0 = _mm256_loadu_pd(x+i  );
+    __m256d YMM1 = _mm256_loadu_pd(x+i+4);
+    __m256d YMM2 = _mm256_loadu_pd(y+i  );
+    __m256d YMM3 = _mm256_loadu_pd(y+i+4);
+    _mm256_storeu_pd(y+i  , _mm256_add_pd(YMM2, _mm256_mul_pd(YMM0, YMM7)));
+    _mm256_storeu_pd(y+i+4, _mm256_add_pd(YMM3, _mm256_mul_pd(YMM1, YMM7)));
+  }
+  for (; i<n; i++)
+    y[i] += c * x[i];
+}
+
+void THDoubleVector_diff_AVX(double *z, const double *x, const double *y, const long n)
+{
+  long i;
+  for (i=0; i<=n-8; i+=8) {
+    __m256d YMM0 = _mm256_loadu_pd(x+i  );
+    __m256d YMM1 = _mm256_loadu_pd(x+i+4);
+    __m256d YMM2 = _mm256_loadu_pd(y+i  );
+    __m256d YMM3 = _mm256_loadu_pd(y+i+4);
+    _mm256_storeu_pd(z+i  , _mm256_sub_pd(YMM0, YMM2));
+    _mm256_storeu_pd(z+i+4, _mm256_sub_pd(YMM1, YMM3));
+  }
+  for (; i<n; i++)
+    z[i] = x[i] - y[i];
+}
+
+void THDoubleVector_scale_AVX(double *y, const double c, const long n)
+{
+  long i;
+  __m256d YMM7 = _mm256_set1_pd(c);
+  for (i=0; i<=n-8; i+=8) {
+    __m256d YMM0 = _mm256_loadu_pd(y+i  );
+    __m256d YMM1 = _mm256_loadu_pd(y+i+4);
+    _mm256_storeu_pd(y+i  , _mm256_mul_pd(YMM0, YMM7));
+    _mm256_storeu_pd(y+i+4, _mm256_mul_pd(YMM1, YMM7));
+  }
+  for (; i<n; i++)
+    y[i] *= c;
+}
+
+void THDoubleVector_mul_AVX(double *y, const double *x, const long n)
+{
+  long i;
+  for (i=0; i<=n-8; i+=8) {
+    __m256d YMM0 = _mm256_loadu_pd(x+i  );
+    __m256d YMM1 = _mm256_loadu_pd(x+i+4);
+    __m256d YMM2 = _mm256_loadu_pd(y+i  );
+    __m256d YMM3 = _mm256_loadu_pd(y+i+4);
+    _mm256_storeu_pd(y+i  , _mm256_mul_pd(YMM2, YMM0));
+    _mm256_storeu_pd(y+i+4, _mm256_mul_pd(YMM3, YMM1));
+  }
+  for (; i<n; i++)
+    y[i] *= x[i];
+}
+
+static double THDoubleVector_hsum_AVX(__m256d YMM0)
+{
+  double buf[4];
+  _mm256_storeu_pd(buf, YMM0);
+  return (buf[0] + buf[1]) + (buf[2] + buf[3]);
+}
+
+double THDoubleVector_sum_AVX(const double *x, const long n)
+{
+  long i;
+  double sum;
+  __m256d YMM0 = _mm256_setzero_pd(), YMM1 = _mm256_setzero_pd();
+  for (i=0; i<=n-8; i+=8) {
+    YMM0 = _mm256_add_pd(YMM0, _mm256_loadu_pd(x+i  ));
+    YMM1 = _mm256_add_pd(YMM1, _mm256_loadu_pd(x+i+4));
+  }
+  sum = THDoubleVector_hsum_AVX(_mm256_add_pd(YMM0, YMM1));
+  for (; i<n; i++)
+    sum += x[i];
+  return sum;
+}
+
+double THDoubleVector_dot_AVX(const double *x, const double *y, const long n)
+{
+  long i;
+  double sum;
+  __m256d YMM0 = _mm256_setzero_pd(), YMM1 = _mm256_setzero_pd();
+  for (i=0; i<=n-8; i+=8) {
+    YMM0 = _mm256_add_pd(YMM0, _mm256_mul_pd(_mm256_loadu_pd(x+i  ), _mm256_loadu_pd(y+i  )));
+    YMM1 = _mm256_add_pd(YMM1, _mm256_mul_pd(_mm256_loadu_pd(x+i+4), _mm256_loadu_pd(y+i+4)));
+  }
+  sum = THDoubleVector_hsum_AVX(_mm256_add_pd(YMM0, YMM1));
+  for (; i<n; i++)
+    sum += x[i] * y[i];
+  return sum;
+}
+
+/* First i with x[i] == value (value is not NaN) */
+static long THDoubleVector_find_AVX(const double *x, const long n, const double value)
+{
+  long i;
+  __m256d YMM7 = _mm256_set1_pd(value);
+  for (i=0; i<=n-4; i+=4) {
+    int mask = _mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(x+i), YMM7, _CMP_EQ_OQ));
+    if (mask) {
+      for (; !(mask & 1); mask >>= 1, i++);
+      return i;
+    }
+  }
+  for (; i<n && x[i] != value; i++);
+  return i;
+}
+
+/* The running maximum is the second operand of vmaxpd, so NaNs in x are
+   skipped but a NaN in x[0] sticks, as in the sequential loop. */
+#define TH_VECTOR_AVX_MINMAX(TYPE, REAL, VEC, W, SUFFIX, NAME, OP, CMP) \
+  REAL TH##TYPE##Vector_##NAME##_AVX(const REAL *x, const long n, long *index) \
+  {                                                                     \
+    long i;                                                             \
+    int k;                                                              \
+    REAL value, buf[W];                                                 \
+    VEC YMM0 = _mm256_set1_p##SUFFIX(x[0]), YMM1 = YMM0;                \
+    for (i=0; i<=n-2*W; i+=2*W) {                                       \
+      YMM0 = OP##_p##SUFFIX(_mm256_loadu_p##SUFFIX(x+i  ), YMM0);       \
+      YMM1 = OP##_p##SUFFIX(_mm256_loadu_p##SUFFIX(x+i+W), YMM1);       \
+    }                                                                   \
+    _mm256_storeu_p##SUFFIX(buf, OP##_p##SUFFIX(YMM1, YMM0));           \
+    value = buf[0];                                                     \
+    for (k=1; k<W; k++)                                                 \
+      if (buf[k] CMP value)                                             \
+        value = buf[k];                                                 \
+    for (; i<n; i++)                                                    \
+      if (x[i] CMP value)                                               \
+        value = x[i];                                                   \
+    if (index)                                                          \
+      *index = (value != value) ? 0 : TH##TYPE##Vector_find_AVX(x, n, value); \
+    return value;                                                       \
+  }
+
+TH_VECTOR_AVX_MINMAX(Double, double, __m256d, 4, d, max, _mm256_max, >)
+TH_VECTOR_AVX_MINMAX(Double, double, __m256d, 4, d, min, _mm256_min, <)
+
+void THFloatVector_fill_AVX(float *x, const float c, const long n)
+{
+  long i;
+  __m256 YMM0 = _mm256_set1_ps(c);
+  for (i=0; i<=n-32; i+=32) {
+    _mm256_storeu_ps(x+i   , YMM0);
+    _mm256_storeu_ps(x+i+ 8, YMM0);
+    _mm256_storeu_ps(x+i+16, YMM0);
+    _mm256_storeu_ps(x+i+24, YMM0);
+  }
+  for (; i<n; i++)
+    x[i] = c;
+}
+
+void THFloatVector_add_AVX(float *y, const float *x, const float c, const long n)
+{
+  long i;
+  __m256 YMM7 = _mm256_set1_ps(c);
+  for (i=0; i<=n-16; i+=16) {
+    __m256 YMM0 = _mm256_loadu_ps(x+i  );
+    __m256 YMM1 = _mm256_loadu_ps(x+i+8);
+    __m256 YMM2 = _mm256_loadu_ps(y+i  );
+    __m256 YMM3 = _mm256_loadu_ps(y+i+8);
+    _mm256_storeu_ps(y+i  , _mm256_add_ps(YMM2, _mm256_mul_ps(YMM0, YMM7)));
+    _mm256_storeu_ps(y+i+8, _mm256_add_ps(YMM3, _mm256_mul_ps(YMM1, YMM7)));
+  }
+  for (; i<n; i++)
+    y[i] += c * x[i];
+}
+
+void THFloatVector_diff_AVX(float *z, const float *x, const float *y, const long n)
+{
+  long i;
+  for (i=0; i<=n-16; i+=16) {
+    __m256 YMM0 = _mm256_loadu_ps(x+i  );
+    __m256 YMM1 = _mm256_loadu_ps(x+i+8);
+    __m256 YMM2 = _mm256_loadu_ps(y+i  );
+    __m256 YMM3 = _mm256_loadu_ps(y+i+8);
+    _mm256_storeu_ps(z+i  , _mm256_sub_ps(YMM0, YMM2));
+    _mm256_storeu_ps(z+i+8, _mm256_sub_ps(YMM1, YMM3));
+  }
+  for (; i<n; i++)
+    z[i] = x[i] - y[i];
+}
+
+void THFloatVector_scale_AVX(float *y, const float c, const long n)
+{
+  long i;
+  __m256 YMM7 = _mm256_set1_ps(c);
+  for (i=0; i<=n-16; i+=16) {
+    __m256 YMM0 = _mm256_loadu_ps(y+i  );
+    __m256 YMM1 = _mm256_loadu_ps(y+i+8);
+    _mm256_storeu_ps(y+i  , _mm256_mul_ps(YMM0, YMM7));
+    _mm256_storeu_ps(y+i+8, _mm256_mul_ps(YMM1, YMM7));
+  }
+  for (; i<n; i++)
+    y[i] *= c;
+}
+
+void THFloatVector_mul_AVX(float *y, const float *x, const long n)
+{
+  long i;
+  for (i=0; i<=n-16; i+=16) {
+    __m256 YMM0 = _mm256_loadu_ps(x+i  );
+    __m256 YMM1 = _mm256_loadu_ps(x+i+8);
+    __m256 YMM2 = _mm256_loadu_ps(y+i  );
+    __m256 YMM3 = _mm256_loadu_ps(y+i+8);
+    _mm256_storeu_ps(y+i  , _mm256_mul_ps(YMM2, YMM0));
+    _mm256_storeu_ps(y+i+8, _mm256_mul_ps(YMM3, YMM1));
+  }
+  for (; i<n; i++)
+    y[i] *= x[i];
+}
+
+/* Float reductions accumulate in double, like accreal */
+double THFloatVector_sum_AVX(const float *x, const long n)
+{
+  long i;
+  double sum;
+  __m256d YMM0 = _mm256_setzero_pd(), YMM1 = _mm256_setzero_pd();
+  for (i=0; i<=n-8; i+=8) {
+    __m256 YMM2 = _mm256_loadu_ps(x+i);
+    YMM0 = _mm256_add_pd(YMM0, _mm256_cvtps_pd(_mm256_castps256_ps128(YMM2)));
+    YMM1 = _mm256_add_pd(YMM1, _mm256_cvtps_pd(_mm256_extractf128_ps(YMM2, 1)));
+  }
+  sum = THDoubleVector_hsum_AVX(_mm256_add_pd(YMM0, YMM1));
+  for (; i<n; i++)
+    sum += x[i];
+  return sum;
+}
+
+double THFloatVector_dot_AVX(const float *x, const float *y, const long n)
+{
+  long i;
+  double sum;
+  __m256d YMM0 = _mm256_setzero_pd(), YMM1 = _mm256_setzero_pd();
+  for (i=0; i<=n-8; i+=8) {
+    __m256 YMM2 = _mm256_loadu_ps(x+i);
+    __m256 YMM3 = _mm256_loadu_ps(y+i);
+    YMM0 = _mm256_add_pd(YMM0, _mm256_mul_pd(_mm256_cvtps_pd(_mm256_castps256_ps128(YMM2)),
+                                             _mm256_cvtps_pd(_mm256_castps256_ps128(YMM3))));
+    YMM1 = _mm256_add_pd(YMM1, _mm256_mul_pd(_mm256_cvtps_pd(_mm256_extractf128_ps(YMM2, 1)),
+                                             _mm256_cvtps_pd(_mm256_extractf128_ps(YMM3, 1))));
+  }
+  sum = THDoubleVector_hsum_AVX(_mm256_add_pd(YMM0, YMM1));
+  for (; i<n; i++)
+    sum += (double)x[i] * y[i];
+  return sum;
+}
+
+static long THFloatVector_find_AVX(const float *x, const long n, const float value)
+{
+  long i;
+  __m256 YMM7 = _mm256_set1_ps(value);
+  for (i=0; i<=n-8; i+=8) {
+    int mask = _mm256_movemask_ps(_mm256_cmp_ps(_mm256_loadu_ps(x+i), YMM7, _CMP_EQ_OQ));
+    if (mask) {
+      for (; !(mask & 1); mask >>= 1, i++);
+      return i;
+    }
+  }
+  for (; i<n && x[i] != value; i++);
+  return i;
+}
+
+TH_VECTOR_AVX_MINMAX(Float, float, __m256, 8, s, max, _mm256_max, >)
+TH_VECTOR_AVX_MINMAX(Float, float, __m256, 8, s, min, _mm256_min, <)
+
+void THFloatBlas_gemmKernel_AVX(long kc, float *ap, float *bp, float *ab)
+{
+  long p;
+  __m256 c0 = _mm256_setzero_ps();
+  __m256 c1 = _mm256_setzero_ps();
+  __m256 c2 = _mm256_setzero_ps();
+  __m256 c3 = _mm256_setzero_ps();
+  for(p = 0; p < kc; p++)
+  {
+    __m256 a0 = _mm256_loadu_ps(ap);
+    c0 = _mm256_add_ps(c0, _mm256_mul_ps(a0, _mm256_set1_ps(bp[0])));
+    c1 = _mm256_add_ps(c1, _mm256_mul_ps(a0, _mm256_set1_ps(bp[1])));
+    c2 = _mm256_add_ps(c2, _mm256_mul_ps(a0, _mm256_set1_ps(bp[2])));
+    c3 = _mm256_add_ps(c3, _mm256_mul_ps(a0, _mm256_set1_ps(bp[3])));
+    ap += 8;
+    bp += 4;
+  }
+  _mm256_storeu_ps(ab, c0);
+  _mm256_storeu_ps(ab+8, c1);
+  _mm256_storeu_ps(ab+16, c2);
+  _mm256_storeu_ps(ab+24, c3);
+}
+
+void THDoubleBlas_gemmKernel_AVX(long kc, double *ap, double *bp, double *ab)
+{
+  long p;
+  __m256d c0 = _mm256_setzero_pd();
+  __m256d c1 = _mm256_setzero_pd();
+  __m256d c2 = _mm256_setzero_pd();
+  __m256d c3 = _mm256_setzero_pd();
+  for(p = 0; p < kc; p++)
+  {
+    __m256d a0 = _mm256_loadu_pd(ap);
+    c0 = _mm256_add_pd(c0, _mm256_mul_pd(a0, _mm256_set1_pd(bp[0])));
+    c1 = _mm256_add_pd(c1, _mm256_mul_pd(a0, _mm256_set1_pd(bp[1])));
+    c2 = _mm256_add_pd(c2, _mm256_mul_pd(a0, _mm256_set1_pd(bp[2])));
+    c3 = _mm256_add_pd(c3, _mm256_mul_pd(a0, _mm256_set1_pd(bp[3])));
+    ap += 4;
+    bp += 4;
+  }
+  _mm256_storeu_pd(ab, c0);
+  _mm256_storeu_pd(ab+4, c1);
+  _mm256_storeu_pd(ab+8, c2);
+  _mm256_storeu_pd(ab+12, c3);
+}
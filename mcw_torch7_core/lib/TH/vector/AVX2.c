@@ -0,0 +1,352 @@
+#include "THVectorKernels.h"
+#include <immintrin.h>
+#include <math.h>
+
+void THDoubleVector_add_AVX2(double *y, const double *x, const double c, const long n)
+{
+  long i;
+  __m256d YMM7 = _mm256_set1_pd(c);
+  for (i=0; i<=n-8; i+=8) {
+    _mm256_storeu_pd(y+i  , _mm256_fmadd_pd(_mm256_loadu_pd(x+i  ), YMM7, _mm256_loadu_pd(y+i  )));
+    _mm256_storeu_pd(y+i+4, _mm256_fmadd_pd(_mm256_loadu_pd(x+i+4), YMM7, _mm256_loadu_pd(y+i+4)));
+  }
+  for (; i<n; i++)
+    y[i] += c * x[i];
+}
+
+static double THDoubleVector_hsum_AVX2(__m256d YMM0)
+{
+  double buf[4];
+  _mm256_storeu_pd(buf, YMM0);
+  return (buf[0] + buf[1]) + (buf[2] + buf[3]);
+}
+
+double THDoubleVector_dot_AVX2(const double *x, const double *y, const long n)
+{
+  long i;
+  double sum;
+  __m256d YMM0 = _mm256_setzero_pd(), YMM1 = _mm256_setzero_pd();
+  __m256d YMM2 = _mm256_setzero_pd(), YMM3 = _mm256_setzero_pd();
+  for (i=0; i<=n-16; i+=16) {
+    YMM0 = _mm256_fmadd_pd(_mm256_loadu_pd(x+i   ), _mm256_loadu_pd(y+i   ), YMM0);
+    YMM1 = _mm256_fmadd_pd(_mm256_loadu_pd(x+i+ 4), _mm256_loadu_pd(y+i+ 4), YMM1);
+    YMM2 = _mm256_fmadd_pd(_mm256_loadu_pd(x+i+ 8), _mm256_loadu_pd(y+i+ 8), YMM2);
+    YMM3 = _mm256_fmadd_pd(_mm256_loadu_pd(x+i+12), _mm256_loadu_pd(y+i+12), YMM3);
+  }
+  sum = THDoubleVector_hsum_AVX2(_mm256_add_pd(_mm256_add_pd(YMM0, YMM1), _mm256_add_pd(YMM2, YMM3)));
+  for (; i<n; i++)
+    sum += x[i] * y[i];
+  return sum;
+}
+
+void THFloatVector_add_AVX2(float *y, const float *x, const float c, const long n)
+{
+  long i;
+  __m256 YMM7 = _mm256_set1_ps(c);
+  for (i=0; i<=n-16; i+=16) {
+    _mm256_storeu_ps(y+i  , _mm256_fmadd_ps(_mm256_loadu_ps(x+i  ), YMM7, _mm256_loadu_ps(y+i  )));
+    _mm256_storeu_ps(y+i+8, _mm256_fmadd_ps(_mm256_loadu_ps(x+i+8), YMM7, _mm256_loadu_ps(y+i+8)));
+  }
+  for (; i<n; i++)
+    y[i] += c * x[i];
+}
+
+/* Accumulated in double, like accreal */
+double THFloatVector_dot_AVX2(const float *x, const float *y, const long n)
+{
+  long i;
+  double sum;
+  __m256d YMM0 = _mm256_setzero_pd(), YMM1 = _mm256_setzero_pd();
+  for (i=0; i<=n-8; i+=8) {
+    __m256 YMM2 = _mm256_loadu_ps(x+i);
+    __m256 YMM3 = _mm256_loadu_ps(y+i);
+    YMM0 = _mm256_fmadd_pd(_mm256_cvtps_pd(_mm256_castps256_ps128(YMM2)),
+                           _mm256_cvtps_pd(_mm256_castps256_ps128(YMM3)), YMM0);
+    YMM1 = _mm256_fmadd_pd(_mm256_cvtps_pd(_mm256_extractf128_ps(YMM2, 1)),
+                           _mm256_cvtps_pd(_mm256_extractf128_ps(YMM3, 1)), YMM1);
+  }
+  sum = THDoubleVector_hsum_AVX2(_mm256_add_pd(YMM0, YMM1));
+  for (; i<n; i++)
+    sum += (double)x[i] * y[i];
+  return sum;
+}
+
+/* Transcendentals, after the Cephes single precision routines. The
+   polynomials are accurate to about 1 ulp on their reduced ranges. */
+
+/* exp(x) = 2^k * exp(r), with k = round(x/ln2) and |r| <= ln2/2. 2^k is
+   applied as two factors so that results down to the denormals and up to
+   the overflow to inf come out right. */
+static __m256 THFloatVector_exp8_AVX2(__m256 x)
+{
+  __m256 k, r, p;
+  __m256i k1, k2;
+
+  /* min/max keep NaN: it is returned when in the second operand */
+  x = _mm256_max_ps(_mm256_set1_ps(-104.f), _mm256_min_ps(_mm256_set1_ps(89.f), x));
+  k = _mm256_round_ps(_mm256_mul_ps(x, _mm256_set1_ps(1.44269504088896341f)),
+                      _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+  r = _mm256_fnmadd_ps(k, _mm256_set1_ps(0.693359375f), x);
+  r = _mm256_fnmadd_ps(k, _mm256_set1_ps(-2.12194440e-4f), r);
+
+  p = _mm256_set1_ps(1.9875691500e-4f);
+  p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(1.3981999507e-3f));
+  p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(8.3334519073e-3f));
+  p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(4.1665795894e-2f));
+  p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(1.6666665459e-1f));
+  p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(5.0000001201e-1f));
+  p = _mm256_fmadd_ps(p, _mm256_mul_ps(r, r), _mm256_add_ps(r, _mm256_set1_ps(1.f)));
+
+  k1 = _mm256_cvtps_epi32(k);
+  k2 = _mm256_srai_epi32(k1, 1);
+  k1 = _mm256_sub_epi32(k1, k2);
+  k1 = _mm256_slli_epi32(_mm256_add_epi32(k1, _mm256_set1_epi32(127)), 23);
+  k2 = _mm256_slli_epi32(_mm256_add_epi32(k2, _mm256_set1_epi32(127)), 23);
+  return _mm256_mul_ps(_mm256_mul_ps(p, _mm256_castsi256_ps(k1)), _mm256_castsi256_ps(k2));
+}
+
+/* log(x) = e*ln2 + log(m), with m in [sqrt(1/2), sqrt(2)) */
+static __m256 THFloatVector_log8_AVX2(__m256 x)
+{
+  __m256 e, m, z, p, small, lt;
+  __m256i bits;
+  __m256 zero = _mm256_setzero_ps();
+
+  /* denormals are scaled by 2^23 first */
+  small = _mm256_cmp_ps(x, _mm256_set1_ps(1.17549435e-38f), _CMP_LT_OQ);
+  m = _mm256_blendv_ps(x, _mm256_mul_ps(x, _mm256_set1_ps(8388608.f)), small);
+  bits = _mm256_castps_si256(m);
+  e = _mm256_cvtepi32_ps(_mm256_sub_epi32(_mm256_srli_epi32(bits, 23), _mm256_set1_epi32(126)));
+  e = _mm256_sub_ps(e, _mm256_and_ps(small, _mm256_set1_ps(23.f)));
+  m = _mm256_castsi256_ps(_mm256_or_si256(_mm256_and_si256(bits, _mm256_set1_epi32(0x007fffff)),
+                                          _mm256_set1_epi32(0x3f000000)));
+
+  /* m in [0.5, 1): fold to [sqrt(1/2), sqrt(2)) and subtract 1 */
+  lt = _mm256_cmp_ps(m, _mm256_set1_ps(0.707106781186547524f), _CMP_LT_OQ);
+  e = _mm256_sub_ps(e, _mm256_and_ps(lt, _mm256_set1_ps(1.f)));
+  m = _mm256_sub_ps(_mm256_add_ps(m, _mm256_and_ps(lt, m)), _mm256_set1_ps(1.f));
+
+  z = _mm256_mul_ps(m, m);
+  p = _mm256_set1_ps(7.0376836292e-2f);
+  p = _mm256_fmadd_ps(p, m, _mm256_set1_ps(-1.1514610310e-1f));
+  p = _mm256_fmadd_ps(p, m, _mm256_set1_ps(1.1676998740e-1f));
+  p = _mm256_fmadd_ps(p, m, _mm256_set1_ps(-1.2420140846e-1f));
+  p = _mm256_fmadd_ps(p, m, _mm256_set1_ps(1.4249322787e-1f));
+  p = _mm256_fmadd_ps(p, m, _mm256_set1_ps(-1.6668057665e-1f));
+  p = _mm256_fmadd_ps(p, m, _mm256_set1_ps(2.0000714765e-1f));
+  p = _mm256_fmadd_ps(p, m, _mm256_set1_ps(-2.4999993993e-1f));
+  p = _mm256_fmadd_ps(p, m, _mm256_set1_ps(3.3333331174e-1f));
+  p = _mm256_mul_ps(_mm256_mul_ps(p, m), z);
+  p = _mm256_fmadd_ps(e, _mm256_set1_ps(-2.12194440e-4f), p);
+  p = _mm256_fnmadd_ps(z, _mm256_set1_ps(0.5f), p);
+  p = _mm256_fmadd_ps(e, _mm256_set1_ps(0.693359375f), _mm256_add_ps(m, p));
+
+  /* log(0) = -inf, log(inf) = inf, log(x < 0) = log(NaN) = NaN */
+  p = _mm256_blendv_ps(p, _mm256_set1_ps(-HUGE_VALF), _mm256_cmp_ps(x, zero, _CMP_EQ_OQ));
+  p = _mm256_blendv_ps(p, x, _mm256_cmp_ps(x, _mm256_set1_ps(HUGE_VALF), _CMP_EQ_OQ));
+  p = _mm256_or_ps(p, _mm256_cmp_ps(x, zero, _CMP_NGE_UQ));
+  return p;
+}
+
+/* tanh(x): odd polynomial for |x| < 0.625, 1 - 2/(exp(2|x|)+1) above */
+static __m256 THFloatVector_tanh8_AVX2(__m256 x)
+{
+  __m256 signmask = _mm256_set1_ps(-0.f);
+  __m256 ax = _mm256_andnot_ps(signmask, x);
+  __m256 z = _mm256_mul_ps(x, x);
+  __m256 p, q;
+
+  p = _mm256_set1_ps(-5.70498872745e-3f);
+  p = _mm256_fmadd_ps(p, z, _mm256_set1_ps(2.06390887954e-2f));
+  p = _mm256_fmadd_ps(p, z, _mm256_set1_ps(-5.37397155531e-2f));
+  p = _mm256_fmadd_ps(p, z, _mm256_set1_ps(1.33314422036e-1f));
+  p = _mm256_fmadd_ps(p, z, _mm256_set1_ps(-3.33332819422e-1f));
+  p = _mm256_fmadd_ps(_mm256_mul_ps(p, z), x, x);
+
+  q = THFloatVector_exp8_AVX2(_mm256_add_ps(ax, ax));
+  q = _mm256_sub_ps(_mm256_set1_ps(1.f), _mm256_div_ps(_mm256_set1_ps(2.f), _mm256_add_ps(q, _mm256_set1_ps(1.f))));
+  q = _mm256_or_ps(q, _mm256_and_ps(signmask, x));
+
+  return _mm256_blendv_ps(q, p, _mm256_cmp_ps(ax, _mm256_set1_ps(0.625f), _CMP_LT_OQ));
+}
+
+/* sigmoid(x) = 1/(1+e) for x >= 0 and e/(1+e) for x < 0, with e = exp(-|x|).
+   exp(-x) would overflow to inf for x < -88 and flush the result to 0,
+   where 1/(1+exp(-x)) still gives the small or denormal value. */
+static __m256 THFloatVector_sigmoid8_AVX2(__m256 x)
+{
+  __m256 one = _mm256_set1_ps(1.f);
+  __m256 signmask = _mm256_set1_ps(-0.f);
+  __m256 e = THFloatVector_exp8_AVX2(_mm256_or_ps(x, signmask));
+  __m256 num = _mm256_blendv_ps(one, e, x);
+  return _mm256_div_ps(num, _mm256_add_ps(one, e));
+}
+
+#define TH_VECTOR_AVX2_UNARY(NAME)                                      \
+  void THFloatVector_##NAME##_AVX2(float *y, const float *x, const long n) \
+  {                                                                     \
+    long i;                                                             \
+    float buf[8];                                                       \
+    for (i=0; i<=n-8; i+=8)                                             \
+      _mm256_storeu_ps(y+i, THFloatVector_##NAME##8_AVX2(_mm256_loadu_ps(x+i))); \
+    if (i < n) {                                                        \
+      long k;                                                           \
+      for (k=0; k<8; k++)                                               \
+        buf[k] = (i+k < n) ? x[i+k] : 0;                                \
+      _mm256_storeu_ps(buf, THFloatVector_##NAME##8_AVX2(_mm256_loadu_ps(buf))); \
+      for (k=0; i+k<n; k++)                                             \
+        y[i+k] = buf[k];                                                \
+    }                                                                   \
+  }
+
+TH_VECTOR_AVX2_UNARY(exp)
+TH_VECTOR_AVX2_UNARY(log)
+TH_VECTOR_AVX2_UNARY(tanh)
+TH_VECTOR_AVX2_UNARY(sigmoid)
+
+void THFloatBlas_gemmKernel_AVX2(long kc, float *ap, float *bp, float *ab)
+{
+  long p;
+  __m256 c0 = _mm256_setzero_ps();
+  __m256 c1 = _mm256_setzero_ps();
+  __m256 c2 = _mm256_setzero_ps();
+  __m256 c3 = _mm256_setzero_ps();
+  for(p = 0; p < kc; p++)
+  {
+    __m256 a0 = _mm256_loadu_ps(ap);
+    c0 = _mm256_fmadd_ps(a0, _mm256_set1_ps(bp[0]), c0);
+    c1 = _mm256_fmadd_ps(a0, _mm256_set1_ps(bp[1]), c1);
+    c2 = _mm256_fmadd_ps(a0, _mm256_set1_ps(bp[2]), c2);
+    c3 = _mm256_fmadd_ps(a0, _mm256_set1_ps(bp[3]), c3);
+    ap += 8;
+    bp += 4;
+  }
+  _mm256_storeu_ps(ab, c0);
+  _mm256_storeu_ps(ab+8, c1);
+  _mm256_storeu_ps(ab+16, c2);
+  _mm256_storeu_ps(ab+24, c3);
+}
+
+void THDoubleBlas_gemmKernel_AVX2(long kc, double *ap, double *bp, double *ab)
+{
+  long p;
+  __m256d c0 = _mm256_setzero_pd();
+  __m256d c1 = _mm256_setzero_pd();
+  __m256d c2 = _mm256_setzero_pd();
+  __m256d c3 = _mm256_setzero_pd();
+  for(p = 0; p < kc; p++)
+  {
+    __m256d a0 = _mm256_loadu_pd(ap);
+    c0 = _mm256_fmadd_pd(a0, _mm256_set1_pd(bp[0]), c0);
+    c1 = _mm256_fmadd_pd(a0, _mm256_set1_pd(bp[1]), c1);
+    c2 = _mm256_fmadd_pd(a0, _mm256_set1_pd(bp[2]), c2);
+    c3 = _mm256_fmadd_pd(a0, _mm256_set1_pd(bp[3]), c3);
+    ap += 4;
+    bp += 4;
+  }
+  _mm256_storeu_pd(ab, c0);
+  _mm256_storeu_pd(ab+4, c1);
+  _mm256_storeu_pd(ab+8, c2);
+  _mm256_storeu_pd(ab+12, c3);
+}
+
+/* |a| * (b with the sign of a) by vpmaddubsw: pairs of products summed in
+   int16 (at most 2*127*127, no saturation), then by vpmaddwd in int32 */
+static TH_INLINE __m256i THQuant_madd_AVX2(__m256i a, __m256i b)
+{
+  return _mm256_madd_epi16(_mm256_maddubs_epi16(_mm256_abs_epi8(a), _mm256_sign_epi8(b, a)), _mm256_set1_epi16(1));
+}
+
+static int THQuant_hsum_AVX2(__m256i x)
+{
+  __m128i s = _mm_add_epi32(_mm256_castsi256_si128(x), _mm256_extracti128_si256(x, 1));
+  s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4e));
+  s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xb1));
+  return _mm_cvtsi128_si32(s);
+}
+
+void THQuant_gemmKernel_AVX2(long k, const signed char * const *a, const signed char * const *b, int *c)
+{
+  __m256i c00 = _mm256_setzero_si256(), c01 = _mm256_setzero_si256();
+  __m256i c02 = _mm256_setzero_si256(), c03 = _mm256_setzero_si256();
+  __m256i c10 = _mm256_setzero_si256(), c11 = _mm256_setzero_si256();
+  __m256i c12 = _mm256_setzero_si256(), c13 = _mm256_setzero_si256();
+  long i, j, l;
+
+  for (l=0; l<=k-32; l+=32) {
+    __m256i a0 = _mm256_loadu_si256((const __m256i*)(a[0]+l));
+    __m256i a1 = _mm256_loadu_si256((const __m256i*)(a[1]+l));
+    __m256i bj = _mm256_loadu_si256((const __m256i*)(b[0]+l));
+    c00 = _mm256_add_epi32(c00, THQuant_madd_AVX2(a0, bj));
+    c10 = _mm256_add_epi32(c10, THQuant_madd_AVX2(a1, bj));
+    bj = _mm256_loadu_si256((const __m256i*)(b[1]+l));
+    c01 = _mm256_add_epi32(c01, THQuant_madd_AVX2(a0, bj));
+    c11 = _mm256_add_epi32(c11, THQuant_madd_AVX2(a1, bj));
+    bj = _mm256_loadu_si256((const __m256i*)(b[2]+l));
+    c02 = _mm256_add_epi32(c02, THQuant_madd_AVX2(a0, bj));
+    c12 = _mm256_add_epi32(c12, THQuant_madd_AVX2(a1, bj));
+    bj = _mm256_loadu_si256((const __m256i*)(b[3]+l));
+    c03 = _mm256_add_epi32(c03, THQuant_madd_AVX2(a0, bj));
+    c13 = _mm256_add_epi32(c13, THQuant_madd_AVX2(a1, bj));
+  }
+  c[0] = THQuant_hsum_AVX2(c00);
+  c[1] = THQuant_hsum_AVX2(c01);
+  c[2] = THQuant_hsum_AVX2(c02);
+  c[3] = THQuant_hsum_AVX2(c03);
+  c[4] = THQuant_hsum_AVX2(c10);
+  c[5] = THQuant_hsum_AVX2(c11);
+  c[6] = THQuant_hsum_AVX2(c12);
+  c[7] = THQuant_hsum_AVX2(c13);
+  for (; l<k; l++)
+    for (i=0; i<2; i++)
+      for (j=0; j<4; j++)
+        c[i*4+j] += a[i][l]*b[j][l];
+}
+
+float THFloatQuant_absMax_AVX2(const float *x, const long n)
+{
+  long i;
+  float absMax, buf[8];
+  __m256 YMM0 = _mm256_setzero_ps(), YMM1 = _mm256_setzero_ps();
+  __m256 YMM7 = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+  for (i=0; i<=n-16; i+=16) {
+    /* max_ps returns its second operand on NaNs: they are skipped */
+    YMM0 = _mm256_max_ps(_mm256_and_ps(_mm256_loadu_ps(x+i  ), YMM7), YMM0);
+    YMM1 = _mm256_max_ps(_mm256_and_ps(_mm256_loadu_ps(x+i+8), YMM7), YMM1);
+  }
+  _mm256_storeu_ps(buf, _mm256_max_ps(YMM0, YMM1));
+  absMax = buf[0];
+  for (i=1; i<8; i++)
+    absMax = (buf[i] > absMax ? buf[i] : absMax);
+  for (i=n-n%16; i<n; i++) {
+    float v = (x[i] < 0 ? -x[i] : x[i]);
+    absMax = (v > absMax ? v : absMax);
+  }
+  return absMax;
+}
+
+/* q = x*inv rounded to nearest even and clamped to [-127, 127]; the
+   saturating packs reorder the 128-bit lanes, which the permute undoes */
+void THFloatQuant_quantize_AVX2(signed char *q, const float *x, const long n, const float inv)
+{
+  long i;
+  __m256 YMM4 = _mm256_set1_ps(inv);
+  __m256 YMM5 = _mm256_set1_ps(-127);
+  __m256 YMM6 = _mm256_set1_ps(127);
+  __m256i YMM7 = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+  for (i=0; i<=n-32; i+=32) {
+    __m256i YMM0 = _mm256_cvtps_epi32(_mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(x+i   ), YMM4), YMM5), YMM6));
+    __m256i YMM1 = _mm256_cvtps_epi32(_mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(x+i+ 8), YMM4), YMM5), YMM6));
+    __m256i YMM2 = _mm256_cvtps_epi32(_mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(x+i+16), YMM4), YMM5), YMM6));
+    __m256i YMM3 = _mm256_cvtps_epi32(_mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(x+i+24), YMM4), YMM5), YMM6));
+    YMM0 = _mm256_packs_epi16(_mm256_packs_epi32(YMM0, YMM1), _mm256_packs_epi32(YMM2, YMM3));
+    _mm256_storeu_si256((__m256i*)(q+i), _mm256_permutevar8x32_epi32(YMM0, YMM7));
+  }
+  for (; i<n; i++) {
+    float v = x[i]*inv;
+    v = (v+12582912.0f)-12582912.0f;
+    v = (v > -127 ? v : -127);
+    v = (v < 127 ? v : 127);
+    q[i] = (signed char)(int)v;
+  }
+}
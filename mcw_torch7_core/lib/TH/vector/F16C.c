@@ -0,0 +1,28 @@
+#include "THVectorKernels.h"
+#include <immintrin.h>
+
+void THHalf_copyFromFloat_F16C(THHalf *y, const float *x, const long n)
+{
+  long i;
+  for (i=0; i<=n-16; i+=16) {
+    __m128i XMM0 = _mm256_cvtps_ph(_mm256_loadu_ps(x+i  ), _MM_FROUND_TO_NEAREST_INT);
+    __m128i XMM1 = _mm256_cvtps_ph(_mm256_loadu_ps(x+i+8), _MM_FROUND_TO_NEAREST_INT);
+    _mm_storeu_si128((__m128i*)(y+i  ), XMM0);
+    _mm_storeu_si128((__m128i*)(y+i+8), XMM1);
+  }
+  for (; i<n; i++)
+    y[i] = TH_float2half(x[i]);
+}
+
+void THHalf_copyToFloat_F16C(float *y, const THHalf *x, const long n)
+{
+  long i;
+  for (i=0; i<=n-16; i+=16) {
+    __m256 YMM0 = _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(x+i  )));
+    __m256 YMM1 = _mm256_cvtph_ps(_mm_loadu_si128((const __m128i*)(x+i+8)));
+    _mm256_storeu_ps(y+i  , YMM0);
+    _mm256_storeu_ps(y+i+8, YMM1);
+  }
+  for (; i<n; i++)
+    y[i] = TH_half2float(x[i]);
+}
@@ -0,0 +1,331 @@
+#include "THVectorKernels.h"
+#include <emmintrin.h>
+
+void THDoubleVector_fill_SSE2(double *x, const double c, const long n)
+{
+  long i;
+  __m128d XMM0 = _mm_set1_pd(c);
+  for (i=0; i<=n-8; i+=8) {
+    _mm_storeu_pd(x+i  , XMM0);
+    _mm_storeu_pd(x+i+2, XMM0);
+    _mm_storeu_pd(x+i+4, XMM0);
+    _mm_storeu_pd(x+i+6, XMM0);
+  }
+  for (; i<n; i++)
+    x[i] = c;
+}
+
+void THDoubleVector_add_SSE2(double *y, const double *x, const double c, const long n)
+{
+  long i;
+  __m128d XMM7 = _mm_set1_pd(c);
+  for (i=0; i<=n-4; i+=4) {
+    __m128d XMM0 = _mm_loadu_pd(x+i  );
+    __m128d XMM1 = _mm_loadu_pd(x+i+2);
+    __m128d XMM2 = _mm_loadu_pd(y+i  );
+    __m128d XMM3 = _mm_loadu_pd(y+i+2);
+    XMM2 = _mm_add_pd(XMM2, _mm_mul_pd(XMM0, XMM7));
+    XMM3 = _mm_add_pd(XMM3, _mm_mul_pd(XMM1, XMM7));
+    _mm_storeu_pd(y+i  , XMM2);
+    _mm_storeu_pd(y+i+2, XMM3);
+  }
+  for (; i<n; i++)
+    y[i] += c * x[i];
+}
+
+void THDoubleVector_diff_SSE2(double *z, const double *x, const double *y, const long n)
+{
+  long i;
+  for (i=0; i<=n-8; i+=8) {
+    __m128d XMM0 = _mm_loadu_pd(x+i  );
+    __m128d XMM1 = _mm_loadu_pd(x+i+2);
+    __m128d XMM2 = _mm_loadu_pd(x+i+4);
+    __m128d XMM3 = _mm_loadu_pd(x+i+6);
+    __m128d XMM4 = _mm_loadu_pd(y+i  );
+    __m128d XMM5 = _mm_loadu_pd(y+i+2);
+    __m128d XMM6 = _mm_loadu_pd(y+i+4);
+    __m128d XMM7 = _mm_loadu_pd(y+i+6);
+    _mm_storeu_pd(z+i  , _mm_sub_pd(XMM0, XMM4));
+    _mm_storeu_pd(z+i+2, _mm_sub_pd(XMM1, XMM5));
+    _mm_storeu_pd(z+i+4, _mm_sub_pd(XMM2, XMM6));
+    _mm_storeu_pd(z+i+6, _mm_sub_pd(XMM3, XMM7));
+  }
+  for (; i<n; i++)
+    z[i] = x[i] - y[i];
+}
+
+void THDoubleVector_scale_SSE2(double *y, const double c, const long n)
+{
+  long i;
+  __m128d XMM7 = _mm_set1_pd(c);
+  for (i=0; i<=n-4; i+=4) {
+    __m128d XMM0 = _mm_loadu_pd(y+i  );
+    __m128d XMM1 = _mm_loadu_pd(y+i+2);
+    _mm_storeu_pd(y+i  , _mm_mul_pd(XMM0, XMM7));
+    _mm_storeu_pd(y+i+2, _mm_mul_pd(XMM1, XMM7));
+  }
+  for (; i<n; i++)
+    y[i] *= c;
+}
+
+void THDoubleVector_mul_SSE2(double *y, const double *x, const long n)
+{
+  long i;
+  for (i=0; i<=n-8; i+=8) {
+    __m128d XMM0 = _mm_loadu_pd(x+i  );
+    __m128d XMM1 = _mm_loadu_pd(x+i+2);
+    __m128d XMM2 = _mm_loadu_pd(x+i+4);
+    __m128d XMM3 = _mm_loadu_pd(x+i+6);
+    __m128d XMM4 = _mm_loadu_pd(y+i  );
+    __m128d XMM5 = _mm_loadu_pd(y+i+2);
+    __m128d XMM6 = _mm_loadu_pd(y+i+4);
+    __m128d XMM7 = _mm_loadu_pd(y+i+6);
+    _mm_storeu_pd(y+i  , _mm_mul_pd(XMM4, XMM0));
+    _mm_storeu_pd(y+i+2, _mm_mul_pd(XMM5, XMM1));
+    _mm_storeu_pd(y+i+4, _mm_mul_pd(XMM6, XMM2));
+    _mm_storeu_pd(y+i+6, _mm_mul_pd(XMM7, XMM3));
+  }
+  for (; i<n; i++)
+    y[i] *= x[i];
+}
+
+static double THDoubleVector_hsum_SSE2(__m128d XMM0)
+{
+  double buf[2];
+  _mm_storeu_pd(buf, XMM0);
+  return buf[0] + buf[1];
+}
+
+double THDoubleVector_sum_SSE2(const double *x, const long n)
+{
+  long i;
+  double sum;
+  __m128d XMM0 = _mm_setzero_pd(), XMM1 = _mm_setzero_pd();
+  for (i=0; i<=n-4; i+=4) {
+    XMM0 = _mm_add_pd(XMM0, _mm_loadu_pd(x+i  ));
+    XMM1 = _mm_add_pd(XMM1, _mm_loadu_pd(x+i+2));
+  }
+  sum = THDoubleVector_hsum_SSE2(_mm_add_pd(XMM0, XMM1));
+  for (; i<n; i++)
+    sum += x[i];
+  return sum;
+}
+
+double THDoubleVector_dot_SSE2(const double *x, const double *y, const long n)
+{
+  long i;
+  double sum;
+  __m128d XMM0 = _mm_setzero_pd(), XMM1 = _mm_setzero_pd();
+  for (i=0; i<=n-4; i+=4) {
+    XMM0 = _mm_add_pd(XMM0, _mm_mul_pd(_mm_loadu_pd(x+i  ), _mm_loadu_pd(y+i  )));
+    XMM1 = _mm_add_pd(XMM1, _mm_mul_pd(_mm_loadu_pd(x+i+2), _mm_loadu_pd(y+i+2)));
+  }
+  sum = THDoubleVector_hsum_SSE2(_mm_add_pd(XMM0, XMM1));
+  for (; i<n; i++)
+    sum += x[i] * y[i];
+  return sum;
+}
+
+/* First i with x[i] == value (value is not NaN) */
+static long THDoubleVector_find_SSE2(const double *x, const long n, const double value)
+{
+  long i;
+  __m128d XMM7 = _mm_set1_pd(value);
+  for (i=0; i<=n-2; i+=2) {
+    int mask = _mm_movemask_pd(_mm_cmpeq_pd(_mm_loadu_pd(x+i), XMM7));
+    if (mask)
+      return (mask & 1) ? i : i+1;
+  }
+  for (; i<n && x[i] != value; i++);
+  return i;
+}
+
+/* The running maximum is the second operand of maxpd, so NaNs in x are
+   skipped but a NaN in x[0] sticks, as in the sequential loop. */
+#define TH_VECTOR_SSE2_MINMAX(NAME, OP, CMP)                            \
+  double THDoubleVector_##NAME##_SSE2(const double *x, const long n, long *index) \
+  {                                                                     \
+    long i;                                                             \
+    double value, buf[2];                                               \
+    __m128d XMM0 = _mm_set1_pd(x[0]), XMM1 = XMM0;                      \
+    for (i=0; i<=n-4; i+=4) {                                           \
+      XMM0 = OP##_pd(_mm_loadu_pd(x+i  ), XMM0);                        \
+      XMM1 = OP##_pd(_mm_loadu_pd(x+i+2), XMM1);                        \
+    }                                                                   \
+    _mm_storeu_pd(buf, OP##_pd(XMM1, XMM0));                            \
+    value = (buf[1] CMP buf[0]) ? buf[1] : buf[0];                      \
+    for (; i<n; i++)                                                    \
+      if (x[i] CMP value)                                               \
+        value = x[i];                                                   \
+    if (index)                                                          \
+      *index = (value != value) ? 0 : THDoubleVector_find_SSE2(x, n, value); \
+    return value;                                                       \
+  }
+
+TH_VECTOR_SSE2_MINMAX(max, _mm_max, >)
+TH_VECTOR_SSE2_MINMAX(min, _mm_min, <)
+
+void THFloatVector_fill_SSE2(float *x, const float c, const long n)
+{
+  long i;
+  __m128 XMM0 = _mm_set_ps1(c);
+  for (i=0; i<=n-16; i+=16) {
+    _mm_storeu_ps(x+i   , XMM0);
+    _mm_storeu_ps(x+i+ 4, XMM0);
+    _mm_storeu_ps(x+i+ 8, XMM0);
+    _mm_storeu_ps(x+i+12, XMM0);
+  }
+  for (; i<n; i++)
+    x[i] = c;
+}
+
+void THFloatVector_add_SSE2(float *y, const float *x, const float c, const long n)
+{
+  long i;
+  __m128 XMM7 = _mm_set_ps1(c);
+  for (i=0; i<=n-8; i+=8) {
+    __m128 XMM0 = _mm_loadu_ps(x+i  );
+    __m128 XMM1 = _mm_loadu_ps(x+i+4);
+    __m128 XMM2 = _mm_loadu_ps(y+i  );
+    __m128 XMM3 = _mm_loadu_ps(y+i+4);
+    XMM2 = _mm_add_ps(XMM2, _mm_mul_ps(XMM0, XMM7));
+    XMM3 = _mm_add_ps(XMM3, _mm_mul_ps(XMM1, XMM7));
+    _mm_storeu_ps(y+i  , XMM2);
+    _mm_storeu_ps(y+i+4, XMM3);
+  }
+  for (; i<n; i++)
+    y[i] += c * x[i];
+}
+
+void THFloatVector_diff_SSE2(float *z, const float *x, const float *y, const long n)
+{
+  long i;
+  for (i=0; i<=n-16; i+=16) {
+    __m128 XMM0 = _mm_loadu_ps(x+i   );
+    __m128 XMM1 = _mm_loadu_ps(x+i+ 4);
+    __m128 XMM2 = _mm_loadu_ps(x+i+ 8);
+    __m128 XMM3 = _mm_loadu_ps(x+i+12);
+    __m128 XMM4 = _mm_loadu_ps(y+i   );
+    __m128 XMM5 = _mm_loadu_ps(y+i+ 4);
+    __m128 XMM6 = _mm_loadu_ps(y+i+ 8);
+    __m128 XMM7 = _mm_loadu_ps(y+i+12);
+    _mm_storeu_ps(z+i   , _mm_sub_ps(XMM0, XMM4));
+    _mm_storeu_ps(z+i+ 4, _mm_sub_ps(XMM1, XMM5));
+    _mm_storeu_ps(z+i+ 8, _mm_sub_ps(XMM2, XMM6));
+    _mm_storeu_ps(z+i+12, _mm_sub_ps(XMM3, XMM7));
+  }
+  for (; i<n; i++)
+    z[i] = x[i] - y[i];
+}
+
+void THFloatVector_scale_SSE2(float *y, const float c, const long n)
+{
+  long i;
+  __m128 XMM7 = _mm_set_ps1(c);
+  for (i=0; i<=n-8; i+=8) {
+    __m128 XMM0 = _mm_loadu_ps(y+i  );
+    __m128 XMM1 = _mm_loadu_ps(y+i+4);
+    _mm_storeu_ps(y+i  , _mm_mul_ps(XMM0, XMM7));
+    _mm_storeu_ps(y+i+4, _mm_mul_ps(XMM1, XMM7));
+  }
+  for (; i<n; i++)
+    y[i] *= c;
+}
+
+void THFloatVector_mul_SSE2(float *y, const float *x, const long n)
+{
+  long i;
+  for (i=0; i<=n-16; i+=16) {
+    __m128 XMM0 = _mm_loadu_ps(x+i   );
+    __m128 XMM1 = _mm_loadu_ps(x+i+ 4);
+    __m128 XMM2 = _mm_loadu_ps(x+i+ 8);
+    __m128 XMM3 = _mm_loadu_ps(x+i+12);
+    __m128 XMM4 = _mm_loadu_ps(y+i   );
+    __m128 XMM5 = _mm_loadu_ps(y+i+ 4);
+    __m128 XMM6 = _mm_loadu_ps(y+i+ 8);
+    __m128 XMM7 = _mm_loadu_ps(y+i+12);
+    _mm_storeu_ps(y+i   , _mm_mul_ps(XMM4, XMM0));
+    _mm_storeu_ps(y+i+ 4, _mm_mul_ps(XMM5, XMM1));
+    _mm_storeu_ps(y+i+ 8, _mm_mul_ps(XMM6, XMM2));
+    _mm_storeu_ps(y+i+12, _mm_mul_ps(XMM7, XMM3));
+  }
+  for (; i<n; i++)
+    y[i] *= x[i];
+}
+
+/* Float reductions accumulate in double, like accreal */
+double THFloatVector_sum_SSE2(const float *x, const long n)
+{
+  long i;
+  double sum;
+  __m128d XMM0 = _mm_setzero_pd(), XMM1 = _mm_setzero_pd();
+  for (i=0; i<=n-4; i+=4) {
+    __m128 XMM2 = _mm_loadu_ps(x+i);
+    XMM0 = _mm_add_pd(XMM0, _mm_cvtps_pd(XMM2));
+    XMM1 = _mm_add_pd(XMM1, _mm_cvtps_pd(_mm_movehl_ps(XMM2, XMM2)));
+  }
+  sum = THDoubleVector_hsum_SSE2(_mm_add_pd(XMM0, XMM1));
+  for (; i<n; i++)
+    sum += x[i];
+  return sum;
+}
+
+double THFloatVector_dot_SSE2(const float *x, const float *y, const long n)
+{
+  long i;
+  double sum;
+  __m128d XMM0 = _mm_setzero_pd(), XMM1 = _mm_setzero_pd();
+  for (i=0; i<=n-4; i+=4) {
+    __m128 XMM2 = _mm_loadu_ps(x+i);
+    __m128 XMM3 = _mm_loadu_ps(y+i);
+    XMM0 = _mm_add_pd(XMM0, _mm_mul_pd(_mm_cvtps_pd(XMM2), _mm_cvtps_pd(XMM3)));
+    XMM1 = _mm_add_pd(XMM1, _mm_mul_pd(_mm_cvtps_pd(_mm_movehl_ps(XMM2, XMM2)),
+                                       _mm_cvtps_pd(_mm_movehl_ps(XMM3, XMM3))));
+  }
+  sum = THDoubleVector_hsum_SSE2(_mm_add_pd(XMM0, XMM1));
+  for (; i<n; i++)
+    sum += (double)x[i] * y[i];
+  return sum;
+}
+
+static long THFloatVector_find_SSE2(const float *x, const long n, const float value)
+{
+  long i;
+  __m128 XMM7 = _mm_set_ps1(value);
+  for (i=0; i<=n-4; i+=4) {
+    int mask = _mm_movemask_ps(_mm_cmpeq_ps(_mm_loadu_ps(x+i), XMM7));
+    if (mask) {
+      for (; !(mask & 1); mask >>= 1, i++);
+      return i;
+    }
+  }
+  for (; i<n && x[i] != value; i++);
+  return i;
+}
+
+#define TH_VECTOR_SSE2_MINMAX_FLOAT(NAME, OP, CMP)                      \
+  float THFloatVector_##NAME##_SSE2(const float *x, const long n, long *index) \
+  {                                                                     \
+    long i;                                                             \
+    int k;                                                              \
+    float value, buf[4];                                                \
+    __m128 XMM0 = _mm_set_ps1(x[0]), XMM1 = XMM0;                       \
+    for (i=0; i<=n-8; i+=8) {                                           \
+      XMM0 = OP##_ps(_mm_loadu_ps(x+i  ), XMM0);                        \
+      XMM1 = OP##_ps(_mm_loadu_ps(x+i+4), XMM1);                        \
+    }                                                                   \
+    _mm_storeu_ps(buf, OP##_ps(XMM1, XMM0));                            \
+    value = buf[0];                                                     \
+    for (k=1; k<4; k++)                                                 \
+      if (buf[k] CMP value)                                             \
+        value = buf[k];                                                 \
+    for (; i<n; i++)                                                    \
+      if (x[i] CMP value)                                               \
+        value = x[i];                                                   \
+    if (index)                                                          \
+      *index = (value != value) ? 0 : THFloatVector_find_SSE2(x, n, value); \
+    return value;                                                       \
+  }
+
+TH_VECTOR_SSE2_MINMAX_FLOAT(max, _mm_max, >)
+TH_VECTOR_SSE2_MINMAX_FLOAT(min, _mm_min, <)
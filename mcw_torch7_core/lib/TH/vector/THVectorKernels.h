@@ -0,0 +1,86 @@
+#ifndef TH_VECTOR_KERNELS_INC
+#define TH_VECTOR_KERNELS_INC
+
+#include "THGeneral.h"
+#include "THHalf.h"
+
+/* Instruction set specific kernels, private to TH. Each vector/<ISA>.c is
+   compiled with its own instruction set flags and only called once
+   THVector_getIsa() says the CPU supports it. */
+
+/* vector/SSE2.c */
+void THDoubleVector_fill_SSE2(double *x, const double c, const long n);
+void THDoubleVector_add_SSE2(double *y, const double *x, const double c, const long n);
+void THDoubleVector_diff_SSE2(double *z, const double *x, const double *y, const long n);
+void THDoubleVector_scale_SSE2(double *y, const double c, const long n);
+void THDoubleVector_mul_SSE2(double *y, const double *x, const long n);
+double THDoubleVector_sum_SSE2(const double *x, const long n);
+double THDoubleVector_dot_SSE2(const double *x, const double *y, const long n);
+double THDoubleVector_max_SSE2(const double *x, const long n, long *index);
+double THDoubleVector_min_SSE2(const double *x, const long n, long *index);
+void THFloatVector_fill_SSE2(float *x, const float c, const long n);
+void THFloatVector_add_SSE2(float *y, const float *x, const float c, const long n);
+void THFloatVector_diff_SSE2(float *z, const float *x, const float *y, const long n);
+void THFloatVector_scale_SSE2(float *y, const float c, const long n);
+void THFloatVector_mul_SSE2(float *y, const float *x, const long n);
+double THFloatVector_sum_SSE2(const float *x, const long n);
+double THFloatVector_dot_SSE2(const float *x, const float *y, const long n);
+float THFloatVector_max_SSE2(const float *x, const long n, long *index);
+float THFloatVector_min_SSE2(const float *x, const long n, long *index);
+
+/* vector/NEON.c */
+void THFloatVector_fill_NEON(float *x, const float c, const long n);
+void THFloatVector_add_NEON(float *y, const float *x, const float c, const long n);
+void THFloatVector_diff_NEON(float *z, const float *x, const float *y, const long n);
+void THFloatVector_scale_NEON(float *y, const float c, const long n);
+void THFloatVector_mul_NEON(float *y, const float *x, const long n);
+
+/* vector/AVX.c */
+void THDoubleVector_fill_AVX(double *x, const double c, const long n);
+void THDoubleVector_add_AVX(double *y, const double *x, const double c, const long n);
+void THDoubleVector_diff_AVX(double *z, const double *x, const double *y, const long n);
+void THDoubleVector_scale_AVX(double *y, const double c, const long n);
+void THDoubleVector_mul_AVX(double *y, const double *x, const long n);
+double THDoubleVector_sum_AVX(const double *x, const long n);
+double THDoubleVector_dot_AVX(const double *x, const double *y, const long n);
+double THDoubleVector_max_AVX(const double *x, const long n, long *index);
+double THDoubleVector_min_AVX(const double *x, const long n, long *index);
+void THFloatVector_fill_AVX(float *x, const float c, const long n);
+void THFloatVector_add_AVX(float *y, const float *x, const float c, const long n);
+void THFloatVector_diff_AVX(float *z, const float *x, const float *y, const long n);
+void THFloatVector_scale_AVX(float *y, const float c, const long n);
+void THFloatVector_mul_AVX(float *y, const float *x, const long n);
+double THFloatVector_sum_AVX(const float *x, const long n);
+double THFloatVector_dot_AVX(const float *x, const float *y, const long n);
+float THFloatVector_max_AVX(const float *x, const long n, long *index);
+float THFloatVector_min_AVX(const float *x, const long n, long *index);
+
+/* vector/AVX2.c (AVX2 and FMA) */
+void THDoubleVector_add_AVX2(double *y, const double *x, const double c, const long n);
+double THDoubleVector_dot_AVX2(const double *x, const double *y, const long n);
+void THFloatVector_add_AVX2(float *y, const float *x, const float c, const long n);
+double THFloatVector_dot_AVX2(const float *x, const float *y, const long n);
+void THFloatVector_exp_AVX2(float *y, const float *x, const long n);
+void THFloatVector_log_AVX2(float *y, const float *x, const long n);
+void THFloatVector_tanh_AVX2(float *y, const float *x, const long n);
+void THFloatVector_sigmoid_AVX2(float *y, const float *x, const long n);
+
+/* vector/AVX2.c: int8 GEMM micro-kernel (see THQuantize.c), c (2x4,
+   row-major) = dot products over k of the rows a[0..1] and b[0..3], and
+   the float to int8 conversions */
+void THQuant_gemmKernel_AVX2(long k, const signed char * const *a, const signed char * const *b, int *c);
+float THFloatQuant_absMax_AVX2(const float *x, const long n);
+void THFloatQuant_quantize_AVX2(signed char *q, const float *x, const long n, const float inv);
+
+/* vector/F16C.c (AVX2 and F16C): THHalf <-> float */
+void THHalf_copyFromFloat_F16C(THHalf *y, const float *x, const long n);
+void THHalf_copyToFloat_F16C(float *y, const THHalf *x, const long n);
+
+/* Micro-kernels of the built-in GEMM (see generic/THBlas.c): ab, column-major
+   8x4 (float) or 4x4 (double), receives the product of the packed panels */
+void THFloatBlas_gemmKernel_AVX(long kc, float *ap, float *bp, float *ab);
+void THDoubleBlas_gemmKernel_AVX(long kc, double *ap, double *bp, double *ab);
+void THFloatBlas_gemmKernel_AVX2(long kc, float *ap, float *bp, float *ab);
+void THDoubleBlas_gemmKernel_AVX2(long kc, double *ap, double *bp, double *ab);
+
+#endif
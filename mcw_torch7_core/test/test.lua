@@ -368,6 +368,53 @@ function torchtest.mv()
    mytester:assertlt(err, precision, 'error in torch.mv')
 end
 
+function torchtest.bmm()
+   local num_batches = 10
+   local M, N, O = 23, 8, 12
+   local b1 = torch.randn(num_batches, M, N)
+   local b2 = torch.randn(num_batches, N, O)
+   local res = torch.bmm(b1, b2)
+
+   for i = 1, num_batches do
+     local r = torch.mm(b1[i], b2[i])
+     mytester:assertTensorEq(r, res[i], precision, 'result matrix ' .. i .. ' wrong')
+   end
+end
+
+function torchtest.baddbmm()
+   local num_batches = 10
+   local M, N, O = 12, 8, 5
+   local b1 = torch.randn(num_batches, M, N)
+   local b2 = torch.randn(num_batches, N, O)
+   local res = torch.bmm(b1, b2)
+
+   local res2 = torch.baddbmm(res:clone(), b1, b2)
+   mytester:assertTensorEq(res2, res*2, precision, 'baddbmm res')
+
+   res2 = torch.baddbmm(res:clone(), 0.5, res:clone(), 2, b1, b2)
+   mytester:assertTensorEq(res2, res*2.5, precision, 'baddbmm res with scalars')
+
+   -- transposed operands and result
+   local b1t = torch.randn(num_batches, N, M):transpose(2, 3)
+   local b2t = torch.randn(num_batches, O, N):transpose(2, 3)
+   local rt = torch.randn(num_batches, O, M):transpose(2, 3)
+   local expected = rt:clone()
+   for i = 1, num_batches do
+      expected[i]:addmm(0.5, 2, b1t[i], b2t[i])
+   end
+   rt:baddbmm(0.5, 2, b1t, b2t)
+   mytester:assertTensorEq(rt, expected, precision, 'baddbmm on transposed tensors')
+
+   -- neither rows nor columns contiguous
+   local r = torch.randn(num_batches, M, O, 2):select(4, 1)
+   expected = r:clone()
+   for i = 1, num_batches do
+      expected[i]:addmm(b1[i], b2[i])
+   end
+   r:baddbmm(b1, b2)
+   mytester:assertTensorEq(r, expected, precision, 'baddbmm on non-contiguous result')
+end
+
 function torchtest.add()
    -- [res] torch.add([res,] tensor1, tensor2)
    local m1 = torch.randn(100,100)
@@ -685,6 +732,39 @@ function torchtest.cumprod()
    torch.cumprod(mxx,x,2)
    mytester:asserteq(maxdiff(mx,mxx),0,'torch.cumprod value')
 end
+function torchtest.histc()
+   local x = torch.Tensor{ 2, 4, 2, 2, 5, 4 }
+   local y = torch.histc(x, 5, 1, 5)
+   mytester:assertTensorEq(y, torch.Tensor{ 0, 3, 0, 2, 1 }, 1e-16, 'torch.histc bins')
+   -- large and non-contiguous, against a serial count
+   local x = torch.randn(msize*2, msize*10):t()
+   local y = torch.Tensor()
+   torch.histc(y, x, 10, -1, 1)
+   local z = torch.zeros(10)
+   x:apply(function(v)
+      local b = math.floor((v+1)/2*(10-1e-6))
+      if b >= 0 and b < 10 then z[b+1] = z[b+1] + 1 end
+   end)
+   mytester:asserteq(maxdiff(y,z),0,'torch.histc large')
+   mytester:asserteq(torch.histc(x, 7):sum(),x:nElement(),'torch.histc full range')
+end
+function torchtest.histcw()
+   local x = torch.Tensor{ 2, 4, 2, 2, 5, 4 }
+   local w = torch.Tensor{ 1, 2, 3, 4, 5, 6 }
+   local y = torch.histcw(x, w, 5, 1, 5)
+   mytester:assertTensorEq(y, torch.Tensor{ 0, 8, 0, 8, 5 }, 1e-16, 'torch.histcw bins')
+   local x = torch.rand(msize, msize)
+   mytester:asserteq(maxdiff(torch.histcw(x, torch.ones(msize, msize)), torch.histc(x)), 0, 'torch.histcw unit weights')
+   -- a transposed tensor with weights of another shape
+   local w = torch.rand(msize*msize)
+   local z = torch.zeros(10)
+   local xc = x:t():contiguous()
+   for i = 1,w:size(1) do
+      local b = math.floor(xc:storage()[i]*(10-1e-6))
+      if b >= 0 and b < 10 then z[b+1] = z[b+1] + w[i] end
+   end
+   mytester:assertlt(maxdiff(torch.histcw(x:t(), w, 10, 0, 1), z), 1e-10, 'torch.histcw transposed')
+end
 function torchtest.cross()
    local x = torch.rand(msize,3,msize)
    local y = torch.rand(msize,3,msize)
@@ -956,6 +1036,55 @@ function torchtest.sortDescending()
    end
    mytester:assert(indicesCorrect, 'torch.sort (descending) indices with equal keys')
 end
+function torchtest.sortLarge()
+   -- long enough for the threads to share the slice
+   local x = torch.floor(torch.randn(200000)*1000)
+   local mx,ix = torch.sort(x)
+   mytester:asserteq(maxdiff(mx,x:index(1,ix)),0,'torch.sort (large) indices')
+   local stable = true
+   for j = 2,mx:size(1) do
+      stable = stable and (mx[j-1] < mx[j] or (mx[j-1] == mx[j] and ix[j-1] < ix[j]))
+   end
+   mytester:assert(stable, 'torch.sort (large) increasing and stable')
+   for _,t in ipairs{'torch.IntTensor', 'torch.FloatTensor', 'torch.LongTensor'} do
+      local my,iy = torch.sort(x:type(t), true)
+      mytester:asserteq(maxdiff(my:double(),mx:index(1,torch.range(mx:size(1),1,-1):long())),0,'torch.sort (large) ' .. t)
+   end
+end
+function torchtest.topk()
+   local x = torch.floor(torch.rand(msize,msize*10)*100)
+   for _,dir in ipairs{false, true} do
+      local mx,ix = torch.sort(x,2,dir)
+      for _,k in ipairs{1, 7, msize, msize*10} do
+         local mxx = torch.Tensor()
+         local ixx = torch.LongTensor()
+         torch.topk(mxx,ixx,x,k,2,dir)
+         mytester:asserteq(maxdiff(mxx,mx:narrow(2,1,k)),0,'torch.topk value')
+         mytester:asserteq(maxdiff(ixx,ix:narrow(2,1,k)),0,'torch.topk index')
+         local my,iy = torch.topk(x,k,2,dir,false)
+         mytester:asserteq(maxdiff(my:sum(2),mx:narrow(2,1,k):sum(2)),0,'torch.topk (unsorted) value')
+         for j = 1,msize do
+            mytester:asserteq(maxdiff(x[j]:index(1,iy[j]),my[j]),0,'torch.topk (unsorted) index')
+         end
+      end
+   end
+   local y = x:t()
+   local my,iy = torch.topk(y,5,1,true)
+   local mx,ix = torch.topk(x,5,2,true)
+   mytester:asserteq(maxdiff(my,mx:t()),0,'torch.topk (dim 1) value')
+   mytester:asserteq(maxdiff(iy,ix:t()),0,'torch.topk (dim 1) index')
+end
+function torchtest.kthvalue()
+   local x = torch.rand(msize,msize)
+   local mx,ix = torch.sort(x)
+   for _,k in ipairs{1, 13, msize} do
+      local mxx,ixx = torch.kthvalue(x,k)
+      mytester:asserteq(maxdiff(mxx,mx:narrow(2,k,1)),0,'torch.kthvalue value')
+      mytester:asserteq(maxdiff(ixx,ix:narrow(2,k,1)),0,'torch.kthvalue index')
+   end
+   local mxx,ixx = torch.kthvalue(x,msize/2,1)
+   mytester:asserteq(maxdiff(mxx,torch.sort(x,1):narrow(1,msize/2,1)),0,'torch.kthvalue (dim 1) value')
+end
 function torchtest.tril()
    local x = torch.rand(msize,msize)
    local mx = torch.tril(x)
@@ -1651,6 +1780,24 @@ function torchtest.chunk()
    end
 end
 
+function torchtest.halfCopy()
+   local x = torch.randn(17, 33):float()
+   local h = x:half()
+   mytester:assert(torch.typename(h) == 'torch.HalfTensor', 'half() should return a HalfTensor')
+   local y = h:float()
+   local err = (y - x):abs():cdiv(x:clone():abs():add(1e-4)):max()
+   mytester:assertlt(err, 2^-11 + 1e-7, 'error in Float/Half round trip')
+   mytester:assertTensorEq(y:half():float(), y, 0, 'Half values should round trip exactly')
+
+   local ht = x:t():half()
+   mytester:assertTensorEq(ht:float(), y:t(), 0, 'error in non-contiguous copy')
+   mytester:assertTensorEq(h:double():float(), y, 0, 'error in Half/Double copy')
+
+   h[1][2] = 0.5
+   mytester:asserteq(h[1][2], 0.5, 'error in element access')
+   mytester:asserteq(torch.HalfTensor{65504}[1], 65504, 'error in table constructor')
+end
+
 function torch.test(tests)
    math.randomseed(os.time())
    if torch.getdefaulttensortype() == 'torch.FloatTensor' then
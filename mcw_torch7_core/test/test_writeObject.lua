@@ -39,6 +39,116 @@ function tests.test_a_recursive_closure()
   local copyFoo = serializeAndDeserialize(foo)
   myTester:assert(copyFoo(42) == foo(42), 'the closures should give same output')
 end
+
+function tests.test_mapped_save_and_load()
+  local weight = torch.randn(100, 37)
+  local obj = {
+    weight = weight,
+    view = weight:narrow(1, 11, 20),
+    index = torch.LongTensor{3, 1, 2},
+    bytes = torch.ByteTensor(5000):fill(7),
+    empty = torch.FloatTensor(),
+    name = 'checkpoint',
+  }
+  local filename = os.tmpname()
+  torch.save(filename, obj, 'mmap')
+  local copy = torch.load(filename, 'mmap')
+  os.remove(filename)
+
+  myTester:assert(copy.name == obj.name, 'the strings should be equal')
+  myTester:assertTensorEq(copy.weight, obj.weight, 1e-16, 'the tensors should be equal')
+  myTester:assertTensorEq(copy.view, obj.view, 1e-16, 'the views should be equal')
+  myTester:assert(torch.pointer(copy.view:storage()) == torch.pointer(copy.weight:storage()), 'the views should share their storage')
+  myTester:assert(copy.index:equal(obj.index), 'the long tensors should be equal')
+  myTester:assert(copy.bytes:equal(obj.bytes), 'the byte tensors should be equal')
+  myTester:assert(copy.empty:nElement() == 0, 'the empty tensor should stay empty')
+
+  copy.weight:zero()
+  myTester:assert(copy.weight:sum() == 0, 'the mapped tensors should be writable')
+end
        
+function tests.test_prefetch_file()
+  local x = torch.range(1, 10000):float()
+  local filename = os.tmpname()
+  local file = torch.DiskFile(filename, 'w'):binary()
+  file:writeFloat(x:storage())
+  file:writeObject(x)
+  file:close()
+
+  for _, nThreads in ipairs{0, 2} do
+    local file = torch.PrefetchFile(filename, 4000, 3, nThreads)
+    local batch = torch.FloatTensor()
+    local n = 0
+    while n < x:nElement() do
+      myTester:assert(file:nextBatch(batch), 'the batches should cover the floats')
+      myTester:assertTensorEq(batch, x:narrow(1, n+1, batch:nElement()), 1e-16, 'the batches should be equal')
+      n = n + batch:nElement()
+    end
+    local y = file:readObject()
+    myTester:assertTensorEq(y, x, 1e-16, 'the objects should be equal')
+    myTester:assert(file:nextBatch() == nil, 'nextBatch should return nil at the end of the file')
+
+    file:seek(4*100)
+    local z = file:readFloat(100)
+    myTester:assert(z[1] == 101 and z[100] == 200, 'the floats should be read after the seek')
+
+    local stats = file:stats()
+    myTester:assert(stats.bytesRead >= 4*x:nElement() and stats.throughput > 0, 'the bytes read should be counted')
+
+    -- a batch keeps the buffers alive after the file is closed and collected
+    file:seek(0)
+    local last = torch.FloatTensor()
+    file:nextBatch(last)
+    local expected = last:clone()
+    file:close()
+    file = nil
+    collectgarbage()
+    myTester:assertTensorEq(last, expected, 1e-16, 'the batch should outlive the file')
+  end
+  os.remove(filename)
+end
+
+function tests.test_half()
+  local x = torch.randn(20, 7):half()
+  local obj = {x = x, view = x:narrow(1, 3, 5)}
+  for _, mode in ipairs{'binary', 'ascii', 'mmap'} do
+    local filename = os.tmpname()
+    torch.save(filename, obj, mode)
+    local copy = torch.load(filename, mode)
+    os.remove(filename)
+    myTester:assert(torch.typename(copy.x) == 'torch.HalfTensor', 'the tensor should stay a HalfTensor')
+    myTester:assertTensorEq(copy.x:float(), x:float(), 0, 'the half tensors should be equal')
+    myTester:assertTensorEq(copy.view:float(), obj.view:float(), 0, 'the half views should be equal')
+  end
+end
+
+function tests.test_chunked_memory_file()
+  local big = torch.randn(100, 1000)
+  local obj = {big = big, small = torch.range(1, 10), name = 'chunked'}
+
+  local file = torch.MemoryFile('rw', 4096)
+  file:writeObject(obj)
+  local nChunks, size, shared = 0, 0, false
+  for chunk in file:chunks() do
+    nChunks = nChunks + 1
+    size = size + chunk:size()
+    shared = shared or chunk:size() == 8*big:nElement()
+  end
+  myTester:assert(nChunks > 1, 'the file should hold several chunks')
+  myTester:assert(size == file:position()-1, 'the chunks should cover the file')
+  myTester:assert(shared, 'the large storage should be one chunk')
+
+  file:seek(1)
+  local copy = file:readObject()
+  file:close()
+  myTester:assertTensorEq(copy.big, big, 0, 'the large tensor should be read back')
+  myTester:assertTensorEq(copy.small, obj.small, 0, 'the small tensor should be read back')
+  myTester:assert(copy.name == obj.name, 'the string should be read back')
+
+  local str = torch.serialize(obj)
+  myTester:assert(#str == size, 'serialize should make the same stream')
+  myTester:assertTensorEq(torch.deserialize(str).big, big, 0, 'serialize should round trip')
+end
+
 myTester:add(tests)
 myTester:run()
@@ -0,0 +1,47 @@
+-- Time torch.sort against torch.topk and torch.kthvalue on wide score
+-- vectors, and torch.sort with one thread against all of them
+require 'torch'
+
+local function time(f)
+   local nrep = 3
+   local timer = torch.Timer()
+   for i = 1,nrep do
+      f()
+   end
+   return timer:time().real/nrep
+end
+
+local function timeTopk(nrow, n, k)
+   local x = torch.rand(nrow, n):float()
+   local y, i = torch.FloatTensor(), torch.LongTensor()
+
+   print(string.format('%d x %d, k = %d', nrow, n, k))
+   print(string.format('  sort+narrow: %.4fs', time(function()
+      torch.sort(y, i, x, 2, true)
+      y:narrow(2, 1, k)
+   end)))
+   print(string.format('  topk:        %.4fs', time(function() torch.topk(y, i, x, k, 2, true) end)))
+   print(string.format('  topk (unsorted): %.4fs', time(function() torch.topk(y, i, x, k, 2, true, false) end)))
+   print(string.format('  kthvalue:    %.4fs', time(function() torch.kthvalue(y, i, x, n/2, 2) end)))
+end
+
+local function timeThreads(nrow, n)
+   local x = torch.rand(nrow, n):float()
+   local y, i = torch.FloatTensor(), torch.LongTensor()
+   local nThreads = torch.getnumthreads()
+
+   torch.setnumthreads(1)
+   local t1 = time(function() torch.sort(y, i, x) end)
+   torch.setnumthreads(nThreads)
+   local tn = time(function() torch.sort(y, i, x) end)
+   print(string.format('sort %d x %d: %.4fs with 1 thread, %.4fs with %d threads',
+                       nrow, n, t1, tn, nThreads))
+end
+
+timeTopk(1, 100000, 100)
+timeTopk(128, 100000, 100)
+timeTopk(1024, 1000, 10)
+
+timeThreads(1, 10000000)
+timeThreads(64, 100000)
+timeThreads(100000, 64)